@@ -435,6 +435,11 @@
  *  released immediately after use. */
 #define LV_CACHE_DEF_SIZE       0
 
+/** LVGL 8 image cache: entries kept open between draws. asset_pack.c keeps the
+ *  decoded ui_img_* itself (budgeted, preloaded), where reopening is a lookup,
+ *  and an open entry there cannot be evicted - so only a few are held here. */
+#define LV_IMG_CACHE_DEF_SIZE   4
+
 /** Default number of image header cache entries. The cache is used to store the headers of images
  *  The main logic is like `LV_CACHE_DEF_SIZE` but for image headers. */
 #define LV_IMAGE_HEADER_CACHE_DEF_CNT 0
@@ -0,0 +1,270 @@
+"""
+Display asset pack builder - SquareLine images -> one image for the "assets" flash partition
+
+Layout must match src/asset_pack.h:
+  AssetHeader (16 B) | AssetEntry[count] (52 B each) | image data, 4-byte aligned
+
+Images are taken from the SquareLine export (lib/ui/images/<name>.c) for every
+LV_IMG_DECLARE in lib/ui/ui.h and stored run-length encoded by pixel
+(RLE, when that is smaller) or raw. src/ui_assets.c is regenerated with
+descriptors of the same names pointing at the pack, so the screens need no
+change and the C arrays stay out of the app image (lib/ui/library.json).
+
+  python pack_assets.py [out.bin]   regenerate src/ui_assets.c and build the pack
+  python pack_assets.py font        cut ui_font_MontserratBold120.c down to FONT_120_CHARS
+PlatformIO:  pio run -t uploadassets
+"""
+import os
+import re
+import struct
+import sys
+import zlib
+
+ASSET_MAGIC = 0x53415452   # "RTAS"
+ASSET_VERSION = 1
+ASSET_NAME_LEN = 32
+ASSET_MAX = 32
+ASSET_PARTITION = "assets"
+
+CODEC_RAW, CODEC_RLE = 0, 1
+RLE_MAX_RUN = 128
+
+# LV_IMG_CF_* values for LVGL 8
+CF_VALUES = {"LV_IMG_CF_TRUE_COLOR": 4, "LV_IMG_CF_TRUE_COLOR_ALPHA": 5}
+CF_PIXEL_BYTES = {4: 2, 5: 3}   # LV_COLOR_DEPTH 16
+
+# The 120 px font only ever shows the countdown and the shake count
+FONT_120 = os.path.join("lib", "ui", "fonts", "ui_font_MontserratBold120.c")
+FONT_120_CHARS = "0123456789"
+
+HERE = os.path.dirname(os.path.abspath(__file__)) if "__file__" in globals() else os.getcwd()
+
+
+# =============================================================================
+# IMAGES
+# =============================================================================
+def declared_images(ui_h):
+    with open(ui_h) as f:
+        return re.findall(r"LV_IMG_DECLARE\(\s*(\w+)\s*\)", f.read())
+
+
+def read_image(path, name):
+    """(w, h, cf, pixel bytes) from a SquareLine image source"""
+    with open(path) as f:
+        src = f.read()
+    body = re.search(r"%s_data\[\]\s*=\s*\{(.*?)\};" % name, src, re.S)
+    w = int(re.search(r"\.header\.w\s*=\s*(\d+)", src).group(1))
+    h = int(re.search(r"\.header\.h\s*=\s*(\d+)", src).group(1))
+    cf = CF_VALUES[re.search(r"\.header\.cf\s*=\s*(\w+)", src).group(1)]
+    data = bytes(int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", body.group(1)))
+    if len(data) != w * h * CF_PIXEL_BYTES[cf]:
+        raise RuntimeError("%s: %d bytes for %dx%d" % (name, len(data), w, h))
+    return w, h, cf, data
+
+
+def rle_encode(data, px):
+    """Control byte c: c & 0x80 -> (c & 0x7F) + 1 copies of one pixel, else c + 1 literal pixels"""
+    pixels = [data[i:i + px] for i in range(0, len(data), px)]
+    out = bytearray()
+    i, n = 0, len(pixels)
+    while i < n:
+        run = 1
+        while i + run < n and run < RLE_MAX_RUN and pixels[i + run] == pixels[i]:
+            run += 1
+        if run > 1:
+            out.append(0x80 | (run - 1))
+            out += pixels[i]
+            i += run
+            continue
+        start = i
+        while i < n and i - start < RLE_MAX_RUN and (i + 1 >= n or pixels[i + 1] != pixels[i]):
+            i += 1
+        out.append(i - start - 1)
+        out += b"".join(pixels[start:i])
+    return bytes(out)
+
+
+def build_pack(ui_dir):
+    names = declared_images(os.path.join(ui_dir, "ui.h"))
+    if len(names) > ASSET_MAX:
+        raise RuntimeError("%d images, pack holds %d" % (len(names), ASSET_MAX))
+
+    images = []
+    for name in names:
+        if len(name) >= ASSET_NAME_LEN:
+            raise RuntimeError("%s: name longer than %d" % (name, ASSET_NAME_LEN - 1))
+        w, h, cf, raw = read_image(os.path.join(ui_dir, "images", name + ".c"), name)
+        rle = rle_encode(raw, CF_PIXEL_BYTES[cf])
+        codec, blob = (CODEC_RLE, rle) if len(rle) < len(raw) else (CODEC_RAW, raw)
+        images.append((name, w, h, cf, codec, len(raw), blob))
+
+    offset = 16 + 52 * len(images)
+    index = b""
+    body = b""
+    for name, w, h, cf, codec, raw_size, blob in images:
+        pad = (-offset) % 4
+        body += b"\0" * pad
+        offset += pad
+        index += struct.pack("<%dsIIIHHBBH" % ASSET_NAME_LEN, name.encode(), offset, len(blob),
+                             raw_size, w, h, cf, codec, 0)
+        body += blob
+        offset += len(blob)
+
+    header = struct.pack("<IHHII", ASSET_MAGIC, ASSET_VERSION, len(images), offset,
+                         zlib.crc32(index) & 0xFFFFFFFF)
+    return header + index + body, images
+
+
+def write_descriptors(path, images):
+    """Same-named lv_img_dsc_t that the asset decoder resolves through the pack"""
+    lines = [
+        "// Generated by pack_assets.py from the SquareLine export - do not edit.",
+        "// Pixels live in the \"assets\" partition; asset_pack.c decodes them by name.",
+        "",
+        "#include \"ui.h\"",
+        "#include \"asset_pack.h\"",
+        "",
+    ]
+    for name, w, h, cf, codec, raw_size, blob in images:
+        lines += [
+            "const lv_img_dsc_t %s = {" % name,
+            "   .header.always_zero = 0,",
+            "   .header.w = %d," % w,
+            "   .header.h = %d," % h,
+            "   .data_size = 0,",
+            "   .header.cf = ASSET_PACK_CF,",
+            "   .data = (const uint8_t *)\"%s\"};" % name,
+            "",
+        ]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def write_pack(out_path, project_dir):
+    image, images = build_pack(os.path.join(project_dir, "lib", "ui"))
+    write_descriptors(os.path.join(project_dir, "src", "ui_assets.c"), images)
+    os.makedirs(os.path.dirname(out_path) or ".", exist_ok=True)
+    with open(out_path, "wb") as f:
+        f.write(image)
+    for name, w, h, cf, codec, raw_size, blob in images:
+        print("  %-28s %3dx%-3d %-3s %7d -> %7d B" % (name, w, h, ("raw", "rle")[codec],
+                                                    raw_size, len(blob)))
+    print("Asset pack: %d images, %d bytes -> %s" % (len(images), len(image), out_path))
+    return len(image)
+
+
+# =============================================================================
+# FONT SUBSET
+# =============================================================================
+def subset_font(path, chars):
+    """Keep only `chars` (one contiguous range) in an lv_font_conv --no-compress font"""
+    with open(path) as f:
+        src = f.read()
+    codes = sorted(ord(c) for c in chars)
+    if codes != list(range(codes[0], codes[-1] + 1)):
+        raise RuntimeError("subset must be one contiguous range")
+
+    cmap = re.search(r"\.range_start = (\d+), \.range_length = (\d+), \.glyph_id_start = (\d+)", src)
+    first, count, id0 = (int(v) for v in cmap.groups())
+    if len(re.findall(r"\.range_start", src)) != 1:
+        raise RuntimeError("expected a single format-0 cmap")
+    keep_ids = [id0 + c - first for c in codes]
+
+    dsc_block = re.search(r"(glyph_dsc\[\] = \{\n)(.*?)(\n\};)", src, re.S)
+    dscs = dsc_block.group(2).split("\n")
+    bmp_block = re.search(r"(glyph_bitmap\[\] = \{\n)(.*?)(\n\};)", src, re.S)
+    bitmap = bytes(int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", bmp_block.group(2)))
+
+    def field(line, key):
+        return int(re.search(r"\.%s = (-?\d+)" % key, line).group(1))
+
+    new_bitmap = b""
+    new_dscs = [dscs[0]]
+    bmp_lines = []
+    for gid in keep_ids:
+        line = dscs[gid].rstrip(",")
+        start = field(line, "bitmap_index")
+        size = field(line, "box_w") * field(line, "box_h")
+        glyph = bitmap[start:start + size]
+        bmp_lines.append("    /* U+%04X \"%s\" */" % (codes[keep_ids.index(gid)], chr(codes[keep_ids.index(gid)])))
+        for i in range(0, len(glyph), 8):
+            bmp_lines.append("    " + ", ".join("0x%x" % b for b in glyph[i:i + 8]) + ",")
+        bmp_lines.append("")
+        new_dscs.append(re.sub(r"\.bitmap_index = \d+", ".bitmap_index = %d" % len(new_bitmap), line) + ",")
+        new_bitmap += glyph
+    new_dscs[-1] = new_dscs[-1].rstrip(",")
+
+    # Kerning pairs between kept glyphs, renumbered
+    ids = re.search(r"(kern_pair_glyph_ids\[\] =\n\{\n)(.*?)(\n\};)", src, re.S)
+    vals = re.search(r"(kern_pair_values\[\] =\n\{\n)(.*?)(\n\};)", src, re.S)
+    pair_ids = [int(v) for v in re.findall(r"-?\d+", ids.group(2))]
+    pair_vals = [int(v) for v in re.findall(r"-?\d+", vals.group(2))]
+    remap = {gid: i + 1 for i, gid in enumerate(keep_ids)}
+    kept = [(remap[pair_ids[2 * i]], remap[pair_ids[2 * i + 1]], pair_vals[i])
+            for i in range(len(pair_vals))
+            if pair_ids[2 * i] in remap and pair_ids[2 * i + 1] in remap]
+
+    out = src[:bmp_block.start(2)] + "\n".join(bmp_lines).rstrip() + src[bmp_block.end(2):]
+    out = out[:out.index(dsc_block.group(1)) + len(dsc_block.group(1))] + "\n".join(new_dscs) + \
+        out[out.index(dsc_block.group(1)) + len(dsc_block.group(1)) + len(dsc_block.group(2)):]
+    out = out.replace(cmap.group(0), ".range_start = %d, .range_length = %d, .glyph_id_start = 1"
+                      % (codes[0], len(codes)))
+    ids_txt = "\n".join("    %d, %d," % (l, r) for l, r, v in kept).rstrip(",") or "    0"
+    vals_txt = "\n".join("    %d," % v for l, r, v in kept).rstrip(",") or "    0"
+    out = re.sub(r"(kern_pair_glyph_ids\[\] =\n\{\n)(.*?)(\n\};)", lambda m: m.group(1) + ids_txt + m.group(3),
+                 out, count=1, flags=re.S)
+    out = re.sub(r"(kern_pair_values\[\] =\n\{\n)(.*?)(\n\};)", lambda m: m.group(1) + vals_txt + m.group(3),
+                 out, count=1, flags=re.S)
+    out = re.sub(r"\.pair_cnt = \d+", ".pair_cnt = %d" % len(kept), out, count=1)
+    out = re.sub(r"-r 0x[0-9a-fA-F]+-0x[0-9a-fA-F]+", "-r 0x%x-0x%x" % (codes[0], codes[-1]), out, count=1)
+    with open(path, "w") as f:
+        f.write(out)
+    print("%s: %d glyphs, %d -> %d bitmap bytes, %d kerning pairs"
+          % (path, len(codes), len(bitmap), len(new_bitmap), len(kept)))
+
+
+def partition(csv_path, label):
+    """(offset, size) of a partition in partitions.csv"""
+    with open(csv_path) as f:
+        for line in f:
+            cols = [c.strip() for c in line.split("#")[0].split(",")]
+            if len(cols) >= 5 and cols[0] == label:
+                return int(cols[3], 0), int(cols[4], 0)
+    raise RuntimeError("no '%s' partition in %s" % (label, csv_path))
+
+
+try:
+    Import("env")   # noqa: F821 - PlatformIO extra script
+except NameError:
+    env = None
+
+if env is not None:
+    BIN = os.path.join(env.subst("$BUILD_DIR"), "assets.bin")
+    CSV = os.path.join(env.subst("$PROJECT_DIR"), env.GetProjectOption("board_build.partitions"))
+
+    def build_action(target, source, env):
+        offset, size = partition(CSV, ASSET_PARTITION)
+        if write_pack(BIN, env.subst("$PROJECT_DIR")) > size:
+            raise RuntimeError("asset pack does not fit the %d-byte partition" % size)
+
+    def upload_action(target, source, env):
+        offset, _ = partition(CSV, ASSET_PARTITION)
+        env.Execute(env.VerboseAction(
+            '"$PYTHONEXE" "$UPLOADER" --chip esp32s3 --port "$UPLOAD_PORT" --baud $UPLOAD_SPEED '
+            'write_flash 0x%x "%s"' % (offset, BIN), "Writing asset pack at 0x%x" % offset))
+
+    env.AddCustomTarget(
+        name="buildassets", dependencies=None, actions=[build_action],
+        title="Build asset pack", description="Encode the SquareLine images into assets.bin")
+    env.AddCustomTarget(
+        name="uploadassets", dependencies=None,
+        actions=[build_action, env.VerboseAction(env.AutodetectUploadPort, "Looking for upload port..."),
+                 upload_action],
+        title="Upload asset pack", description="Build assets.bin and flash the assets partition")
+
+elif __name__ == "__main__":
+    if len(sys.argv) > 1 and sys.argv[1] == "font":
+        subset_font(os.path.join(HERE, FONT_120), FONT_120_CHARS)
+    else:
+        out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(HERE, ".pio", "assets.bin")
+        write_pack(out, HERE)
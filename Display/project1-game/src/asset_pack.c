@@ -0,0 +1,295 @@
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "asset_pack.h"
+
+_Static_assert(sizeof(asset_pack_header_t) == 16, "asset_pack_header_t layout is shared with pack_assets.py");
+_Static_assert(sizeof(asset_pack_entry_t) == 52, "asset_pack_entry_t layout is shared with pack_assets.py");
+
+static const char *TAG = "assets";
+static const uint8_t *s_base = NULL;                    // Mapped partition
+static const asset_pack_entry_t *s_entries = NULL;
+static uint16_t s_count = 0;
+
+// Decoded images, keyed by descriptor. refs = LVGL decoder sessions open on it
+typedef struct {
+    const lv_img_dsc_t *img;
+    const asset_pack_entry_t *entry;
+    uint8_t *pixels;
+    uint16_t refs;
+    uint32_t last_use;
+} asset_cache_slot_t;
+
+static asset_cache_slot_t s_cache[ASSET_PACK_MAX];
+static uint32_t s_cache_tick = 0;
+static asset_cache_stats_t s_stats;
+
+static const asset_pack_entry_t *find_entry(const char *name)
+{
+    for (uint16_t i = 0; i < s_count; i++) {
+        if (strncmp(s_entries[i].name, name, ASSET_PACK_NAME_LEN) == 0) {
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+const asset_pack_entry_t *asset_pack_find(const lv_img_dsc_t *img)
+{
+    if (!s_base || !img || img->header.cf != ASSET_PACK_CF || !img->data) {
+        return NULL;
+    }
+    return find_entry((const char *)img->data);
+}
+
+void asset_pack_get_cache_stats(asset_cache_stats_t *out)
+{
+    *out = s_stats;
+}
+
+// Per-pixel RLE into dst; false if the stream does not fill exactly raw bytes
+static bool rle_decode(uint8_t *dst, uint32_t raw, const uint8_t *src, uint32_t n, uint32_t px)
+{
+    uint32_t in = 0;
+    uint32_t out = 0;
+    while (in < n && out < raw) {
+        const uint8_t c = src[in++];
+        const uint32_t count = (uint32_t)(c & 0x7F) + 1;
+        if (out + count * px > raw) {
+            return false;
+        }
+        if (c & 0x80) {
+            if (in + px > n) {
+                return false;
+            }
+            for (uint32_t i = 0; i < count; i++, out += px) {
+                memcpy(dst + out, src + in, px);
+            }
+            in += px;
+        } else {
+            if (in + count * px > n) {
+                return false;
+            }
+            memcpy(dst + out, src + in, count * px);
+            in += count * px;
+            out += count * px;
+        }
+    }
+    return out == raw;
+}
+
+static lv_res_t decoder_info(lv_img_decoder_t *decoder, const void *src, lv_img_header_t *header)
+{
+    (void)decoder;
+    if (lv_img_src_get_type(src) != LV_IMG_SRC_VARIABLE) {
+        return LV_RES_INV;
+    }
+    const asset_pack_entry_t *e = asset_pack_find((const lv_img_dsc_t *)src);
+    if (!e) {
+        return LV_RES_INV;
+    }
+    header->always_zero = 0;
+    header->w = e->w;
+    header->h = e->h;
+    header->cf = e->cf;
+    return LV_RES_OK;
+}
+
+// Decode an entry into a fresh PSRAM buffer
+static uint8_t *decode_entry(const asset_pack_entry_t *e)
+{
+    uint8_t *buf = heap_caps_malloc(e->raw_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        ESP_LOGE(TAG, "%s: no PSRAM for %lu bytes", e->name, (unsigned long)e->raw_bytes);
+        return NULL;
+    }
+    const uint8_t *data = s_base + e->offset;
+    if (e->codec == ASSET_CODEC_RAW) {
+        memcpy(buf, data, e->raw_bytes);                // PSRAM reads beat flash cache misses when blending
+        return buf;
+    }
+    const uint32_t px = (uint32_t)e->raw_bytes / ((uint32_t)e->w * e->h);
+    if (!rle_decode(buf, e->raw_bytes, data, e->bytes, px)) {
+        ESP_LOGE(TAG, "%s: corrupt RLE stream", e->name);
+        heap_caps_free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+static asset_cache_slot_t *cache_lookup(const lv_img_dsc_t *img)
+{
+    for (int i = 0; i < ASSET_PACK_MAX; i++) {
+        if (s_cache[i].img == img) {
+            return &s_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// Evict least recently used unreferenced images until `bytes` more fit the budget
+static bool cache_make_room(uint32_t bytes)
+{
+    const uint32_t budget = ASSET_CACHE_BUDGET_KB * 1024UL;
+    if (bytes > budget) {
+        return false;
+    }
+    while (s_stats.bytes + bytes > budget) {
+        asset_cache_slot_t *victim = NULL;
+        for (int i = 0; i < ASSET_PACK_MAX; i++) {
+            asset_cache_slot_t *c = &s_cache[i];
+            if (c->img && c->refs == 0 && (!victim || (int32_t)(c->last_use - victim->last_use) < 0)) {
+                victim = c;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        s_stats.bytes -= victim->entry->raw_bytes;
+        s_stats.evictions++;
+        heap_caps_free(victim->pixels);
+        memset(victim, 0, sizeof(*victim));
+    }
+    return true;
+}
+
+// Decode into the cache; NULL if it does not fit or decoding failed
+static asset_cache_slot_t *cache_fill(const lv_img_dsc_t *img, const asset_pack_entry_t *e)
+{
+    asset_cache_slot_t *slot = cache_lookup(NULL);
+    if (!slot || !cache_make_room(e->raw_bytes)) {
+        return NULL;
+    }
+    uint8_t *pixels = decode_entry(e);
+    if (!pixels) {
+        return NULL;
+    }
+    slot->img = img;
+    slot->entry = e;
+    slot->pixels = pixels;
+    slot->refs = 0;
+    slot->last_use = ++s_cache_tick;
+    s_stats.bytes += e->raw_bytes;
+    return slot;
+}
+
+bool asset_pack_preload(const lv_img_dsc_t *const *imgs, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (cache_lookup(imgs[i])) {
+            continue;
+        }
+        const asset_pack_entry_t *e = asset_pack_find(imgs[i]);
+        if (!e) {
+            continue;
+        }
+        if (!cache_fill(imgs[i], e)) {
+            return false;
+        }
+        s_stats.preloads++;
+        return true;
+    }
+    return false;
+}
+
+static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
+{
+    (void)decoder;
+    const lv_img_dsc_t *img = (const lv_img_dsc_t *)dsc->src;
+    const asset_pack_entry_t *e = asset_pack_find(img);
+    if (!e) {
+        return LV_RES_INV;
+    }
+
+    asset_cache_slot_t *slot = cache_lookup(img);
+    if (slot) {
+        s_stats.hits++;
+    } else {
+        s_stats.misses++;
+        slot = cache_fill(img, e);
+    }
+    if (slot) {
+        slot->refs++;
+        slot->last_use = ++s_cache_tick;
+        dsc->img_data = slot->pixels;
+        dsc->user_data = slot;
+        return LV_RES_OK;
+    }
+
+    // Budget full of open images: decode for this session only
+    uint8_t *pixels = decode_entry(e);
+    if (!pixels) {
+        return LV_RES_INV;
+    }
+    s_stats.uncached++;
+    dsc->img_data = pixels;
+    dsc->user_data = NULL;
+    return LV_RES_OK;
+}
+
+static void decoder_close(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
+{
+    (void)decoder;
+    asset_cache_slot_t *slot = (asset_cache_slot_t *)dsc->user_data;
+    if (slot) {
+        slot->refs--;                                   // Stays decoded for the next open
+    } else if (dsc->img_data) {
+        heap_caps_free((void *)dsc->img_data);
+    }
+    dsc->img_data = NULL;
+    dsc->user_data = NULL;
+}
+
+bool asset_pack_init(void)
+{
+    const esp_partition_t *part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSET_PACK_SUBTYPE, ASSET_PACK_LABEL);
+    if (!part) {
+        ESP_LOGE(TAG, "No '%s' partition", ASSET_PACK_LABEL);
+        return false;
+    }
+
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    const asset_pack_header_t *h = (const asset_pack_header_t *)ptr;
+    const asset_pack_entry_t *e = (const asset_pack_entry_t *)((const uint8_t *)ptr + sizeof(*h));
+    const uint32_t index_bytes = (uint32_t)h->count * sizeof(*e);
+    if (h->magic != ASSET_PACK_MAGIC || h->version != ASSET_PACK_VERSION ||
+            h->count > ASSET_PACK_MAX || h->size > part->size ||
+            sizeof(*h) + index_bytes > h->size ||
+            esp_rom_crc32_le(0, (const uint8_t *)e, index_bytes) != h->index_crc) {
+        ESP_LOGE(TAG, "No valid asset pack - run `pio run -t uploadassets`");
+        esp_partition_munmap(handle);
+        return false;
+    }
+    for (uint16_t i = 0; i < h->count; i++) {
+        const uint32_t px = (e[i].cf == LV_IMG_CF_TRUE_COLOR_ALPHA) ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+        if (e[i].offset + e[i].bytes > h->size || e[i].codec > ASSET_CODEC_RLE ||
+                e[i].raw_bytes != (uint32_t)e[i].w * e[i].h * px ||
+                (e[i].codec == ASSET_CODEC_RAW && e[i].bytes != e[i].raw_bytes) ||
+                e[i].name[ASSET_PACK_NAME_LEN - 1] != '\0') {
+            ESP_LOGE(TAG, "Bad entry %u", (unsigned)i);
+            esp_partition_munmap(handle);
+            return false;
+        }
+    }
+    s_base = (const uint8_t *)ptr;
+    s_entries = e;
+    s_count = h->count;
+
+    lv_img_decoder_t *decoder = lv_img_decoder_create();
+    lv_img_decoder_set_info_cb(decoder, decoder_info);
+    lv_img_decoder_set_open_cb(decoder, decoder_open);
+    lv_img_decoder_set_close_cb(decoder, decoder_close);
+    ESP_LOGI(TAG, "%u images, %lu bytes mapped", (unsigned)s_count, (unsigned long)h->size);
+    return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lvgl.h"
+
+/**
+ * Pre-encoded SquareLine images in their own flash partition
+ *
+ * pack_assets.py turns the images of the SquareLine export into one image
+ * (per-pixel RLE or raw) and `pio run -t uploadassets` writes it to the
+ * "assets" partition (partitions.csv). It also generates src/ui_assets.c:
+ * the same ui_img_* descriptors the screens use, with cf ASSET_PACK_CF and
+ * the image name as data, so the pixel arrays no longer sit in the app.
+ *
+ * asset_pack_init() maps the partition once and registers an LVGL image
+ * decoder for ASSET_PACK_CF. Decoded images live in a PSRAM cache keyed by
+ * descriptor, up to ASSET_CACHE_BUDGET_KB; the least recently drawn image
+ * that nothing has open is evicted first. asset_pack_preload() decodes
+ * ahead of time, so showing a hidden image is a lookup, not a decode.
+ *
+ * Layout (little-endian, every image 4-byte aligned):
+ *   asset_pack_header_t | asset_pack_entry_t[count] | image data...
+ */
+#define ASSET_PACK_LABEL        "assets"
+#define ASSET_PACK_SUBTYPE      0x41            // custom data subtype (partitions.csv)
+#define ASSET_PACK_MAGIC        0x53415452UL    // "RTAS"
+#define ASSET_PACK_VERSION      1
+#define ASSET_PACK_MAX          32
+#define ASSET_PACK_NAME_LEN     32
+#define ASSET_PACK_CF           LV_IMG_CF_USER_ENCODED_0
+
+#ifndef ASSET_CACHE_BUDGET_KB
+#define ASSET_CACHE_BUDGET_KB   1536            // decoded PSRAM; every ui_img_* is ~1.1 MB
+#endif
+
+typedef enum {
+    ASSET_CODEC_RAW = 0,        // stored as LVGL pixels
+    ASSET_CODEC_RLE = 1,        // c & 0x80: (c & 0x7F) + 1 copies of one pixel, else c + 1 literal pixels
+} asset_codec_t;
+
+// On-flash format (must match pack_assets.py)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;             // entries
+    uint32_t size;              // whole image in bytes
+    uint32_t index_crc;         // CRC32 (esp_rom_crc32_le, seed 0) of the entry table
+} asset_pack_header_t;
+
+typedef struct {
+    char name[ASSET_PACK_NAME_LEN]; // ui_img_* symbol, NUL-padded
+    uint32_t offset;            // from the start of the image
+    uint32_t bytes;             // encoded
+    uint32_t raw_bytes;         // decoded
+    uint16_t w;
+    uint16_t h;
+    uint8_t cf;                 // lv_img_cf_t
+    uint8_t codec;              // asset_codec_t
+    uint16_t reserved;
+} asset_pack_entry_t;
+
+typedef struct {
+    uint32_t hits;              // opens served from the cache
+    uint32_t misses;            // opens that had to decode
+    uint32_t preloads;          // decoded by asset_pack_preload()
+    uint32_t evictions;
+    uint32_t uncached;          // decoded outside the budget (everything else open)
+    uint32_t bytes;             // decoded bytes held now
+} asset_cache_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Map the assets partition, check its index and register the decoder
+ *
+ * @note Call after lvgl_port_init() with the LVGL lock held. On false the
+ *       ASSET_PACK_CF images stay blank.
+ */
+bool asset_pack_init(void);
+
+/**
+ * @brief Pack entry for a ui_assets.c descriptor, NULL if not in the pack
+ */
+const asset_pack_entry_t *asset_pack_find(const lv_img_dsc_t *img);
+
+/**
+ * @brief Decode the first of imgs[0..n) that is not cached yet
+ *
+ * @return true if one was decoded (call again on a later tick), false once
+ *         all are cached or the rest do not fit the budget
+ * @note Call with the LVGL lock held; one decode is a few ms.
+ */
+bool asset_pack_preload(const lv_img_dsc_t *const *imgs, size_t n);
+
+void asset_pack_get_cache_stats(asset_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
@@ -17,8 +18,15 @@
 static const char *TAG = "lv_port";                      // Tag for logging
 static SemaphoreHandle_t lvgl_mux;                       // LVGL mutex for synchronization
 static TaskHandle_t lvgl_task_handle = NULL;             // Handle for the LVGL task
-
-#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0
+// Wake-up from other tasks (lvgl_port_wake). A semaphore rather than the task
+// notification, which the flush callbacks already use to wait for vsync.
+static SemaphoreHandle_t lvgl_wake_sem = NULL;
+static lv_timer_t *lvgl_wake_timer = NULL;               // Made ready on every wake-up
+static lvgl_port_frame_stats_t frame_stats;              // Updated by flush_callback (LVGL task)
+static lvgl_port_frame_cb_t frame_cb = NULL;             // Told about every frame_stats update
+static volatile uint32_t vsync_count = 0;                // Incremented by lvgl_port_notify_rgb_vsync (ISR)
+
+#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0 || LVGL_PORT_DIRTY_COPY
 // Function to get the next frame buffer for double buffering
 static void *get_next_frame_buffer(esp_lcd_panel_handle_t panel_handle)
 {
@@ -33,7 +41,9 @@ static void *get_next_frame_buffer(esp_lcd_panel_handle_t panel_handle)
     }
     return next_fb;                                       // Return the next frame buffer
 }
+#endif
 
+#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0
 // Function to rotate and copy pixels from one buffer to another
 IRAM_ATTR static void rotate_copy_pixel(const uint16_t *from, uint16_t *to, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end, uint16_t w, uint16_t h, uint16_t rotation)
 {
@@ -264,6 +274,77 @@ static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     lv_disp_flush_ready(drv); // Mark the display flush as complete
 }
 
+#elif LVGL_PORT_DIRTY_COPY
+
+static int64_t frame_start_us = 0; // Set by render_start_callback
+
+static void render_start_callback(lv_disp_drv_t *drv)
+{
+    (void)drv;
+    frame_start_us = esp_timer_get_time();
+}
+
+// Copy this frame's unjoined dirty areas row by row; returns bytes copied
+static uint32_t flush_dirty_areas(uint16_t *dst, const uint16_t *src)
+{
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing(); // Areas LVGL just rendered
+    uint32_t bytes = 0;
+    for (int i = 0; i < disp->inv_p; i++) {
+        if (disp->inv_area_joined[i]) {
+            continue;
+        }
+        const lv_area_t *a = &disp->inv_areas[i];
+        const size_t row_bytes = (size_t)(a->x2 + 1 - a->x1) * sizeof(uint16_t);
+        for (int y = a->y1; y <= a->y2; y++) {
+            const size_t offset = (size_t)y * LVGL_PORT_H_RES + a->x1;
+            memcpy(dst + offset, src + offset, row_bytes);
+        }
+        bytes += row_bytes * (a->y2 + 1 - a->y1);
+    }
+    return bytes;
+}
+
+static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t) drv->user_data; // Get the panel handle from driver user data
+    (void)area; // Direct mode: color_map is the whole LVGL buffer, areas come from the display
+
+    /* Action after last area refresh */
+    if (lv_disp_flush_is_last(drv)) {
+        const int64_t flush_start_us = esp_timer_get_time();
+
+        /* Bring the hidden frame buffer up to date with the dirty areas, then show it */
+        void *next_fb = get_next_frame_buffer(panel_handle);
+        uint32_t bytes = flush_dirty_areas(next_fb, (const uint16_t *)color_map);
+        esp_lcd_panel_draw_bitmap(panel_handle, 0, 0, LVGL_PORT_H_RES, LVGL_PORT_V_RES, next_fb);
+
+        /* Wait until the previous frame buffer is released by the RGB panel */
+        ulTaskNotifyValueClear(NULL, ULONG_MAX);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* Same areas into the frame buffer that just went off screen */
+        bytes += flush_dirty_areas(get_next_frame_buffer(panel_handle), (const uint16_t *)color_map);
+        get_next_frame_buffer(panel_handle);
+
+        const int64_t now_us = esp_timer_get_time();
+        const uint32_t render_us = (uint32_t)(flush_start_us - frame_start_us);
+        const uint32_t flush_us = (uint32_t)(now_us - flush_start_us);
+        frame_stats.frames++;
+        frame_stats.total_bytes += bytes;
+        frame_stats.last_bytes = bytes;
+        frame_stats.last_render_us = render_us;
+        frame_stats.last_flush_us = flush_us;
+        if (bytes > frame_stats.max_bytes) frame_stats.max_bytes = bytes;
+        if (render_us > frame_stats.max_render_us) frame_stats.max_render_us = render_us;
+        if (flush_us > frame_stats.max_flush_us) frame_stats.max_flush_us = flush_us;
+        if (frame_cb) {
+            frame_cb(&frame_stats);
+        }
+    }
+
+    lv_disp_flush_ready(drv); // Mark the display flush as complete
+}
+
 #else
 
 static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
@@ -386,8 +467,8 @@ static lv_disp_t *display_init(esp_lcd_panel_handle_t panel_handle)
     ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(panel_handle, 3, &lvgl_port_rgb_last_buf, &buf1, &buf2));
     lvgl_port_rgb_next_buf = lvgl_port_rgb_last_buf; // Set the next RGB buffer
     lvgl_port_flush_next_buf = buf2; // Set the flush next buffer
-#elif (LVGL_PORT_LCD_RGB_BUFFER_NUMS == 3) && (EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0)
-    // Using three frame buffers, one for LVGL rendering and two for RGB driver (one used for rotation)
+#elif (LVGL_PORT_LCD_RGB_BUFFER_NUMS == 3) && ((EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0) || LVGL_PORT_DIRTY_COPY)
+    // Using three frame buffers, one for LVGL rendering and two for RGB driver (rotation / dirty-area copies)
     void *fbs[3];
     ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(panel_handle, 3, &fbs[0], &fbs[1], &fbs[2]));
     buf1 = fbs[2]; // Set buf1 to the third frame buffer
@@ -421,6 +502,9 @@ static lv_disp_t *display_init(esp_lcd_panel_handle_t panel_handle)
     disp_drv.full_refresh = 1; // Enable full refresh
 #elif LVGL_PORT_DIRECT_MODE
     disp_drv.direct_mode = 1; // Enable direct mode
+#endif
+#if LVGL_PORT_DIRTY_COPY && (EXAMPLE_LVGL_PORT_ROTATION_DEGREE == 0)
+    disp_drv.render_start_cb = render_start_callback; // Frame timing for lvgl_port_get_frame_stats
 #endif
     return lv_disp_drv_register(&disp_drv); // Register the display driver
 }
@@ -489,9 +573,26 @@ static void lvgl_port_task(void *arg)
     ESP_LOGD(TAG, "Starting LVGL task"); // Log the task start
 
     uint32_t task_delay_ms = LVGL_PORT_TASK_MAX_DELAY_MS; // Set initial task delay
+    bool woken = false; // Set when lvgl_port_wake() ended the wait early
+    int64_t stats_log_us = esp_timer_get_time(); // Last frame statistics log
+    uint32_t stats_log_frames = 0;
     while (1) {
         if (lvgl_port_lock(-1)) { // Try to lock the LVGL mutex
+            if (woken && lvgl_wake_timer) {
+                lv_timer_ready(lvgl_wake_timer); // Run the wake timer now instead of at its period
+            }
             task_delay_ms = lv_timer_handler(); // Handle LVGL timer events
+
+            const int64_t now_us = esp_timer_get_time();
+            if (now_us - stats_log_us >= LVGL_PORT_STATS_LOG_MS * 1000LL && frame_stats.frames != stats_log_frames) {
+                ESP_LOGI(TAG, "%lu frames, last %lu B, max %lu B, render max %lu us, flush max %lu us",
+                         (unsigned long)(frame_stats.frames - stats_log_frames),
+                         (unsigned long)frame_stats.last_bytes, (unsigned long)frame_stats.max_bytes,
+                         (unsigned long)frame_stats.max_render_us, (unsigned long)frame_stats.max_flush_us);
+                stats_log_frames = frame_stats.frames;
+                frame_stats.max_bytes = frame_stats.max_render_us = frame_stats.max_flush_us = 0;
+                stats_log_us = now_us;
+            }
             lvgl_port_unlock(); // Unlock the mutex
         }
         // Ensure the delay time is within limits
@@ -500,7 +601,8 @@ static void lvgl_port_task(void *arg)
         } else if (task_delay_ms < LVGL_PORT_TASK_MIN_DELAY_MS) {
             task_delay_ms = LVGL_PORT_TASK_MIN_DELAY_MS;
         }
-        vTaskDelay(pdMS_TO_TICKS(task_delay_ms)); // Delay the task for the calculated time
+        // Sleep until the next LVGL timer is due or another task wakes us
+        woken = xSemaphoreTake(lvgl_wake_sem, pdMS_TO_TICKS(task_delay_ms)) == pdTRUE;
     }
 }
 
@@ -536,6 +638,8 @@ esp_err_t lvgl_port_init(esp_lcd_panel_handle_t lcd_handle, void *tp_handle)
 
     lvgl_mux = xSemaphoreCreateRecursiveMutex(); // Create a recursive mutex for LVGL
     assert(lvgl_mux); // Ensure mutex creation was successful
+    lvgl_wake_sem = xSemaphoreCreateBinary(); // Wake-up signal for the LVGL task
+    assert(lvgl_wake_sem); // Ensure semaphore creation was successful
 
     ESP_LOGI(TAG, "Create LVGL task"); // Log task creation
     BaseType_t core_id = (LVGL_PORT_TASK_CORE < 0) ? tskNO_AFFINITY : LVGL_PORT_TASK_CORE; // Determine core ID for the task
@@ -563,9 +667,37 @@ void lvgl_port_unlock(void)
     xSemaphoreGiveRecursive(lvgl_mux); // Release the mutex
 }
 
+void lvgl_port_set_wake_timer(lv_timer_t *timer)
+{
+    lvgl_wake_timer = timer; // Call with the LVGL lock held
+}
+
+void lvgl_port_get_frame_stats(lvgl_port_frame_stats_t *out)
+{
+    *out = frame_stats;
+}
+
+void lvgl_port_set_frame_cb(lvgl_port_frame_cb_t cb)
+{
+    frame_cb = cb; // Call with the LVGL lock held
+}
+
+uint32_t lvgl_port_get_vsync_count(void)
+{
+    return vsync_count;
+}
+
+void lvgl_port_wake(void)
+{
+    if (lvgl_wake_sem) {
+        xSemaphoreGive(lvgl_wake_sem); // Several wake-ups before the task runs collapse into one
+    }
+}
+
 bool lvgl_port_notify_rgb_vsync(void)
 {
     BaseType_t need_yield = pdFALSE; // Flag to check if a yield is needed
+    vsync_count = vsync_count + 1; // Only writer
 #if LVGL_PORT_FULL_REFRESH && (LVGL_PORT_LCD_RGB_BUFFER_NUMS == 3) && (EXAMPLE_LVGL_PORT_ROTATION_DEGREE == 0)
     if (lvgl_port_rgb_next_buf != lvgl_port_rgb_last_buf) {
         lvgl_port_flush_next_buf = lvgl_port_rgb_last_buf; // Set next buffer for flushing
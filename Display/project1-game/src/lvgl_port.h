@@ -57,7 +57,7 @@ extern "C" {
 #define CONFIG_EXAMPLE_LVGL_PORT_AVOID_TEAR_ENABLE    1
 #endif
 #ifndef CONFIG_EXAMPLE_LVGL_PORT_AVOID_TEAR_MODE
-#define CONFIG_EXAMPLE_LVGL_PORT_AVOID_TEAR_MODE      2
+#define CONFIG_EXAMPLE_LVGL_PORT_AVOID_TEAR_MODE      4
 #endif
 #ifndef CONFIG_EXAMPLE_LVGL_PORT_ROTATION_DEGREE
 #define CONFIG_EXAMPLE_LVGL_PORT_ROTATION_DEGREE      0
@@ -108,6 +108,12 @@ extern "C" {
 #elif LVGL_PORT_AVOID_TEAR_MODE == 3
 #define LVGL_PORT_LCD_RGB_BUFFER_NUMS   (2)
 #define LVGL_PORT_DIRECT_MODE           (1)
+#elif LVGL_PORT_AVOID_TEAR_MODE == 4
+/* LVGL renders only dirty areas into a third, never-displayed buffer; flush
+ * copies just those areas into the two RGB frame buffers (no full-screen copies) */
+#define LVGL_PORT_LCD_RGB_BUFFER_NUMS   (3)
+#define LVGL_PORT_DIRECT_MODE           (1)
+#define LVGL_PORT_DIRTY_COPY            (1)
 #endif
 
 #if EXAMPLE_LVGL_PORT_ROTATION_DEGREE == 0
@@ -131,10 +137,59 @@ extern "C" {
 #define LVGL_PORT_DIRECT_MODE           (0)
 #endif
 
+#ifndef LVGL_PORT_DIRTY_COPY
+#define LVGL_PORT_DIRTY_COPY            (0)
+#endif
+
+/**
+ * Frame statistics (LVGL_PORT_DIRTY_COPY), logged every LVGL_PORT_STATS_LOG_MS
+ */
+#define LVGL_PORT_STATS_LOG_MS          (10000)
+
+typedef struct {
+    uint32_t frames;            // Frames flushed since boot
+    uint64_t total_bytes;       // Bytes copied into RGB frame buffers since boot
+    uint32_t last_bytes;        // Last frame: bytes copied (both frame buffers)
+    uint32_t last_render_us;    // Last frame: render start -> first flush
+    uint32_t last_flush_us;     // Last frame: copies + buffer switch + vsync wait
+    uint32_t max_bytes;         // Worst since the last log
+    uint32_t max_render_us;
+    uint32_t max_flush_us;
+} lvgl_port_frame_stats_t;
+
+typedef void (*lvgl_port_frame_cb_t)(const lvgl_port_frame_stats_t *stats);
+
 esp_err_t lvgl_port_init(esp_lcd_panel_handle_t lcd_handle, void *tp_handle);
 bool lvgl_port_lock(int timeout_ms);
 void lvgl_port_unlock(void);
 bool lvgl_port_notify_rgb_vsync(void);
+
+/**
+ * @brief Run the wake timer (lvgl_port_set_wake_timer) as soon as possible
+ *
+ * @note Safe from any task, e.g. the ESP-NOW receive callback. The LVGL task
+ *       leaves its sleep, makes the timer ready and runs lv_timer_handler().
+ */
+void lvgl_port_wake(void);
+void lvgl_port_set_wake_timer(lv_timer_t *timer);
+
+/**
+ * @brief Copy of the frame statistics (all zero unless LVGL_PORT_DIRTY_COPY)
+ *
+ * @note Call with the LVGL lock held.
+ */
+void lvgl_port_get_frame_stats(lvgl_port_frame_stats_t *out);
+
+/**
+ * @brief Call `cb` after every flushed frame (LVGL task, lock held), NULL to stop
+ *
+ * @note Only LVGL_PORT_DIRTY_COPY times its frames; other modes never call it.
+ */
+void lvgl_port_set_frame_cb(lvgl_port_frame_cb_t cb);
+
+/**
+ * @brief RGB panel vsync interrupts since boot
+ */
 uint32_t lvgl_port_get_vsync_count(void);
 
 #ifdef __cplusplus
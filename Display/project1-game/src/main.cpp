@@ -12,29 +12,24 @@
 #include "esp_wifi.h"
 #include "nvs_flash.h"
 #include "esp_system.h"
+#include "esp_attr.h"
 #include "ui.h"
 #include "Protocol.h"
+#include "SpscQueue.h"
+#include "Histogram.h"
 #include "lvgl_port.h"
+#include "asset_pack.h"
+#include "ota_update.h"
 #include <string.h>
 
 static const char* kTag = "DISPLAY";
 static constexpr bool kEnableEspNow = true;
-static portMUX_TYPE s_ui_mux = portMUX_INITIALIZER_UNLOCKED;
-static bool s_pkt_pending = false;
-static uint8_t s_pending_pkt[PACKET_SIZE] = {};
-static int64_t s_last_ui_update_us = 0;
-static uint16_t s_player_time_ms[4] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
+static uint32_t s_player_time_ticks[4] = {RESULT_TICKS_NONE, RESULT_TICKS_NONE, RESULT_TICKS_NONE, RESULT_TICKS_NONE};
 static int16_t s_player_score[4] = {-1, -1, -1, -1};
 static bool s_show_scores = false;
 static bool s_applied_show_scores = false;
-static bool s_has_last_cmd = false;
-static uint8_t s_last_cmd = 0;
-static uint8_t s_last_data_high = 0;
-static uint8_t s_last_data_low = 0;
 static bool s_state_dirty = false;
-static constexpr int64_t kUiApplyIntervalUs = 150000; // 150ms
-static uint8_t s_ready_mask = 0;
-static bool s_ready_mask_dirty = false;
+static constexpr int64_t kPromptBlinkHalfUs = 500000; // prompted panel: 0.5 s on, 0.5 s off
 static uint8_t s_prompt_mask = 0;
 static bool s_prompt_mask_dirty = false;
 static uint8_t s_prompt_slot = 0;
@@ -55,14 +50,20 @@ static lv_obj_t* panel_for_player(uint8_t player) {
     }
 }
 
-static uint32_t stick_color(uint8_t player) {
-    switch (player) {
-        case 1: return 0xFFFFFF; // White
-        case 2: return 0x0000FF; // Blue
-        case 3: return 0xFF0000; // Red
-        case 4: return 0xFFFF00; // Yellow
-        default: return kBorderDefault;
-    }
+// Identity color of a joystick ID: same palette as the host's rings, repeating past 8
+static uint32_t stick_color(uint8_t stick_id) {
+    static const uint32_t kPalette[] = {
+        0xFFFFFF, // White
+        0x0000FF, // Blue
+        0xFF0000, // Red
+        0xFFFF00, // Yellow
+        0x00FFFF, // Cyan
+        0xFF00FF, // Magenta
+        0xFF6000, // Orange
+        0x8000FF, // Purple
+    };
+    if (!isStickId(stick_id)) return kBorderDefault;
+    return kPalette[stickIndex(stick_id) % (sizeof(kPalette) / sizeof(kPalette[0]))];
 }
 
 static void set_panel_border_color(uint8_t player, uint32_t color) {
@@ -96,14 +97,103 @@ struct UiState {
     uint8_t countdown;
     uint8_t winner;
     bool ready[4];
-    uint16_t time_ms[4];
+    uint32_t time_ticks[4];   // RESULT_TICK_US units, RESULT_TICKS_NONE = hidden
     int16_t score[4];
 };
 
 static UiState s_pending_state;
 static UiState s_applied_state;
 
-static constexpr uint8_t kEspnowChannel = ESPNOW_CHANNEL;
+// One display command, as queued by the ESP-NOW callback for the LVGL task
+struct DisplayMsg {
+    uint8_t cmd;
+    bool fine;          // DISP_TIME_Px from a 4-byte batch item: ticks is valid
+    uint16_t data;      // GamePacket data (data_high << 8 | data_low)
+    uint32_t ticks;     // RESULT_TICK_US units
+    uint32_t rx_us;     // esp_timer_get_time() when the frame arrived (low 32 bits)
+};
+
+// WiFi task -> LVGL task. Sized for a full batch plus whatever arrives
+// before the next ui_timer_cb; everything queued is applied in order.
+static constexpr uint32_t kRxQueueSize = 64;
+static SpscQueue<DisplayMsg, kRxQueueSize> s_rx_queue;
+static uint32_t s_rx_drops_logged = 0;
+
+// Telemetry (DISPLAY TELEMETRY in Protocol.h): drop counters from the WiFi
+// task, frame timing and packet-to-pixel latency from the LVGL task. Logged
+// and sent to the host every TELEMETRY_PERIOD_MS; kEnableHud also shows a
+// summary on the top layer (its own redraws then show up in the numbers).
+static constexpr bool kEnableHud = false;
+static constexpr bool kEnableTelemetryReport = true;
+static constexpr int64_t kTelemetryPeriodUs = TELEMETRY_PERIOD_MS * 1000LL;
+static constexpr int64_t kHudPeriodUs = 500000;
+static volatile uint32_t s_drops[DISPLAY_DROP_COUNT] = {};  // written by the WiFi task only
+static LogHistogram s_render_hist;    // per period, LVGL task only
+static LogHistogram s_flush_hist;
+static LogHistogram s_latency_hist;
+static uint32_t s_queue_max = 0;
+static int64_t s_telemetry_us = 0;
+static int64_t s_hud_us = 0;
+
+// Standings of every arena, forwarded by the coordinator host; LVGL task only.
+// Shown on the top layer on the idle screens once another arena has reported.
+static uint32_t s_arena_values[MAX_ARENAS][ARENA_FIELD_COUNT] = {};
+static bool s_arena_known[MAX_ARENAS] = {};
+static bool s_arena_dirty = false;
+static bool s_arena_shown = false;
+static lv_obj_t* s_arena_label = nullptr;
+// All-time fastest reactions from the host (LEADERBOARD in Protocol.h); LVGL task only.
+// Shown on the top layer on the idle screens once the host has sent a time.
+static uint8_t s_board_stick[LEADERBOARD_SIZE] = {};   // 1-N, 0 = empty rank
+static uint32_t s_board_ticks[LEADERBOARD_SIZE] = {};
+static bool s_board_dirty = false;
+static bool s_board_shown = false;
+static lv_obj_t* s_board_label = nullptr;
+// Next tournament match, entrant per player slot (TOURNAMENT in Protocol.h); LVGL task only.
+// Shown on the top layer, in the leaderboard's place, until that match starts.
+static uint8_t s_tour_entrant[4] = {};   // 1-N, 0 = empty seat
+static bool s_tour_next = false;         // seats arrived, their match hasn't started
+static bool s_tour_dirty = false;
+static bool s_tour_shown = false;
+static lv_obj_t* s_tour_label = nullptr;
+// Live shake progress per player (SHAKE STREAM in Protocol.h); LVGL task only.
+// Shown as a percentage in the player's time label until the result arrives.
+static uint8_t s_shake_count[4] = {};
+static uint8_t s_shake_target[4] = {};
+static uint8_t s_shake_dirty = 0;     // bit per player
+static uint32_t s_hud_frames = 0;
+static lv_obj_t* s_hud_label = nullptr;
+
+static inline void count_drop(DisplayDrop reason) {
+    s_drops[reason] = s_drops[reason] + 1;
+}
+
+static bool s_has_last_msg = false;
+static DisplayMsg s_last_msg = {};
+
+static inline bool is_display_cmd(uint8_t cmd) {
+    return cmd >= DISP_IDLE && cmd <= DISP_DEUCE;
+}
+
+// Same -DARENA_ID as this table's host and sticks (ARENAS in Protocol.h)
+#ifndef ARENA_ID
+#define ARENA_ID 0
+#endif
+static_assert(ARENA_ID < MAX_ARENAS, "ARENA_ID out of range");
+static constexpr uint8_t kEspnowChannel = arenaChannel(ARENA_ID);  // where listening starts
+
+// Channel follow (CHANNEL SELECTION in Protocol.h): the WiFi task notes the
+// host's beacons, channel_timer_cb hops and follows them
+static constexpr uint64_t kChannelTimerUs = 50000;
+static volatile uint8_t s_beacon_channel = 0;   // 0 = no beacon since the last tick
+static volatile bool s_host_heard = false;
+static uint8_t s_channel = kEspnowChannel;
+static bool s_channel_locked = false;
+// Last host channel, kept over resets other than power-on: a warm boot listens there first
+static constexpr uint32_t kKeptChannelMagic = 0xC4A50000;
+static RTC_NOINIT_ATTR uint32_t s_kept_channel;
+static int64_t s_last_host_us = 0;
+static int64_t s_listen_start_us = 0;
 static const uint8_t kHostMac[6] = {0x88, 0x57, 0x21, 0xB3, 0x05, 0xAC};
 
 static void send_ack(uint8_t acked_cmd) {
@@ -117,6 +207,64 @@ static void send_ack(uint8_t acked_cmd) {
     }
 }
 
+// Sequenced ACK for a ReliablePacket (see RELIABLE DELIVERY in Protocol.h)
+static SeqWindow s_host_window;
+
+static void send_seq_ack(const ReliablePacket& rx) {
+    ReliablePacket ack;
+    buildSeqAck(&ack, ID_DISPLAY, &rx, &s_host_window);
+    esp_err_t err = esp_now_send(kHostMac, reinterpret_cast<const uint8_t*>(&ack), sizeof(ack));
+    if (err == ESP_OK) {
+        ESP_LOGI(kTag, "ACK sent for cmd=0x%02X seq=%u cum=%u", rx.base.cmd, rx.seq, s_host_window.cum);
+    } else {
+        ESP_LOGW(kTag, "ACK send failed for cmd=0x%02X seq=%u err=%d", rx.base.cmd, rx.seq, (int)err);
+    }
+}
+
+// Firmware hello (CMD_REQ_ID with our version) so the host knows we take CMD_BATCH
+static void send_hello() {
+    GamePacket pkt;
+    buildPacket(&pkt, ID_HOST, ID_DISPLAY, CMD_REQ_ID, FW_VERSION_DATA);
+    esp_err_t err = esp_now_send(kHostMac, reinterpret_cast<const uint8_t*>(&pkt), sizeof(pkt));
+    ESP_LOGI(kTag, "Hello %s sent err=%d", FW_VERSION_STRING, (int)err);
+}
+
+// Images the next screens are likely to reveal, decoded into the asset cache
+// one per quiet UI tick so GO, the banners and the winner appear without a decode
+static const lv_img_dsc_t* const kPreloadFromIdle[] = {
+    &ui_img_img_reactmode_png, &ui_img_img_shakemode_png, &ui_img_725341252,
+    &ui_img_img_group_winner_png, &ui_img_img_deucemode_png,
+};
+static const lv_img_dsc_t* const kPreloadFromRound[] = {
+    &ui_img_725341252, &ui_img_img_group_winner_png, &ui_img_img_deucemode_png,
+};
+static const lv_img_dsc_t* const kPreloadFromWinner[] = {
+    &ui_img_img_reactmode_png, &ui_img_img_shakemode_png, &ui_img_img_deucemode_png,
+    &ui_img_725341252,
+};
+static bool s_preload_done = false;
+static const lv_img_dsc_t* s_next_banner = nullptr;  // DISP_NEXT_ROUND: the next round's banner
+
+static void preload_next_assets(ScreenMode mode) {
+    switch (mode) {
+        case ScreenMode::NONE:
+        case ScreenMode::IDLE:
+        case ScreenMode::PROMPT:
+            s_preload_done = !asset_pack_preload(kPreloadFromIdle, sizeof(kPreloadFromIdle) / sizeof(kPreloadFromIdle[0]));
+            break;
+        case ScreenMode::WINNER:
+            s_preload_done = !asset_pack_preload(kPreloadFromWinner, sizeof(kPreloadFromWinner) / sizeof(kPreloadFromWinner[0]));
+            break;
+        default:
+            // The host told us what comes next: that banner before the rest
+            if (s_next_banner && asset_pack_preload(&s_next_banner, 1)) {
+                break;
+            }
+            s_preload_done = !asset_pack_preload(kPreloadFromRound, sizeof(kPreloadFromRound) / sizeof(kPreloadFromRound[0]));
+            break;
+    }
+}
+
 static inline void safe_flag(lv_obj_t* obj, bool hide) {
     if (!obj) {
         return;
@@ -202,10 +350,10 @@ static void update_player_label(uint8_t player) {
     if (!label) {
         return;
     }
-    uint16_t time_ms = s_player_time_ms[player - 1];
+    uint32_t ticks = s_player_time_ticks[player - 1];
     int16_t score = s_player_score[player - 1];
     char buf[32];
-    if (time_ms == 0xFFFF) {
+    if (ticks == RESULT_TICKS_NONE) {
         if (score >= 0) {
             snprintf(buf, sizeof(buf), "W: %u", (unsigned)score);
             lv_label_set_text(label, buf);
@@ -215,20 +363,23 @@ static void update_player_label(uint8_t player) {
         }
         return;
     }
+    // One decimal: round ticks to 0.1 ms
+    const uint32_t tenths = (ticks + RESULT_TICKS_PER_MS / 20) / (RESULT_TICKS_PER_MS / 10);
     if (score >= 0) {
-        snprintf(buf, sizeof(buf), "%u ms\nW: %u", (unsigned)time_ms, (unsigned)score);
+        snprintf(buf, sizeof(buf), "%u.%u ms\nW: %u", (unsigned)(tenths / 10), (unsigned)(tenths % 10),
+                 (unsigned)score);
     } else {
-        snprintf(buf, sizeof(buf), "%u ms", (unsigned)time_ms);
+        snprintf(buf, sizeof(buf), "%u.%u ms", (unsigned)(tenths / 10), (unsigned)(tenths % 10));
     }
     lv_label_set_text(label, buf);
     lv_obj_clear_flag(label, LV_OBJ_FLAG_HIDDEN);
 }
 
-static void set_player_time(uint8_t player, uint16_t time_ms) {
+static void set_player_time(uint8_t player, uint32_t ticks) {
     if (player < 1 || player > 4) {
         return;
     }
-    s_player_time_ms[player - 1] = time_ms;
+    s_player_time_ticks[player - 1] = ticks;
     // Remove GO and ring when results are shown
     lv_obj_add_flag(ui_imgGo, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(ui_centerCircle, LV_OBJ_FLAG_HIDDEN);
@@ -241,9 +392,11 @@ static void clear_time_labels() {
     lv_obj_add_flag(ui_labelPlayer3Timing, LV_OBJ_FLAG_HIDDEN);
     lv_obj_add_flag(ui_labelPlayer4Timing, LV_OBJ_FLAG_HIDDEN);
     for (int i = 0; i < 4; i++) {
-        s_player_time_ms[i] = 0xFFFF;
+        s_player_time_ticks[i] = RESULT_TICKS_NONE;
         s_player_score[i] = -1;
+        s_shake_target[i] = 0;
     }
+    s_shake_dirty = 0;
 }
 
 static void show_winner(uint8_t player) {
@@ -267,14 +420,63 @@ static void show_winner(uint8_t player) {
     }
 }
 
-static void update_state_from_packet(const uint8_t *pkt) {
-    uint8_t cmd = pkt[3];
-    uint8_t data_high = pkt[4];
-    uint8_t data_low = pkt[5];
-    uint16_t data = ((uint16_t)data_high << 8) | data_low;
+static void update_state_from_msg(const DisplayMsg& msg) {
+    uint8_t cmd = msg.cmd;
+    uint8_t data_high = (uint8_t)(msg.data >> 8);
+    uint8_t data_low = (uint8_t)(msg.data & 0xFF);
+    uint16_t data = msg.data;
+
+    // Arena standings: one field per message, the last completes an arena
+    if (cmd == CMD_ARENA_STANDING) {
+        if (data_high < MAX_ARENAS && data_low < ARENA_FIELD_COUNT) {
+            s_arena_values[data_high][data_low] = msg.ticks;
+            if (data_low == ARENA_FIELD_COUNT - 1) {
+                s_arena_known[data_high] = true;
+                s_arena_dirty = true;
+            }
+        }
+        return;
+    }
+
+    // Leaderboard: rank / stick in data, time in ticks
+    if (cmd == DISP_LEADERBOARD) {
+        if (data_high < LEADERBOARD_SIZE) {
+            s_board_stick[data_high] = data_low;
+            s_board_ticks[data_high] = msg.ticks;
+            s_board_dirty = true;
+        }
+        return;
+    }
+
+    // Tournament seat: player slot / entrant in data
+    if (cmd == DISP_TOUR_SEAT) {
+        if (data_high >= 1 && data_high <= 4) {
+            s_tour_entrant[data_high - 1] = data_low;
+            s_tour_next = true;
+            s_tour_dirty = true;
+        }
+        return;
+    }
+
+    // Shake progress: player / count in data, target in ticks
+    if (cmd == DISP_SHAKE_PROGRESS) {
+        if (data_high >= 1 && data_high <= 4 && msg.ticks > 0) {
+            s_shake_count[data_high - 1] = data_low;
+            s_shake_target[data_high - 1] = (uint8_t)msg.ticks;
+            s_shake_dirty |= 1 << (data_high - 1);
+        }
+        return;
+    }
+
+    // Next round's mode (ROUND LOOKAHEAD): warm its banner, show nothing yet
+    if (cmd == DISP_NEXT_ROUND) {
+        s_next_banner = data_high == MODE_SHAKE ? &ui_img_img_shakemode_png : &ui_img_img_reactmode_png;
+        s_preload_done = false;
+        return;
+    }
 
     // Only handle display commands; ignore joystick/other commands.
-    if (cmd < DISP_IDLE || cmd > DISP_PLAYER_PROMPT) {
+    if (!is_display_cmd(cmd)) {
         return;
     }
 
@@ -282,16 +484,15 @@ static void update_state_from_packet(const uint8_t *pkt) {
         s_show_deuce = false;
     }
 
-    if (s_has_last_cmd &&
-        cmd == s_last_cmd &&
-        data_high == s_last_data_high &&
-        data_low == s_last_data_low) {
-        return; // skip duplicate updates to reduce flicker
+    if (s_has_last_msg &&
+        cmd == s_last_msg.cmd &&
+        msg.fine == s_last_msg.fine &&
+        data == s_last_msg.data &&
+        msg.ticks == s_last_msg.ticks) {
+        return; // skip duplicate updates (legacy retries) to reduce flicker
     }
-    s_has_last_cmd = true;
-    s_last_cmd = cmd;
-    s_last_data_high = data_high;
-    s_last_data_low = data_low;
+    s_has_last_msg = true;
+    s_last_msg = msg;
 
     switch (cmd) {
         case DISP_IDLE:
@@ -303,7 +504,7 @@ static void update_state_from_packet(const uint8_t *pkt) {
             s_show_scores = false;
             for (int i = 0; i < 4; i++) {
                 s_pending_state.ready[i] = false;
-                s_pending_state.time_ms[i] = 0xFFFF;
+                s_pending_state.time_ticks[i] = RESULT_TICKS_NONE;
                 s_pending_state.score[i] = -1;
             }
             break;
@@ -324,8 +525,8 @@ static void update_state_from_packet(const uint8_t *pkt) {
                 player = data_low;
             }
             if (player >= 1 && player <= 4) {
-                // New protocol: data_low = joystick ID (1-4)
-                const uint8_t stick_id = (data_low >= 1 && data_low <= 4) ? data_low : player;
+                // New protocol: data_low = joystick ID (ID_STICK_FIRST..ID_STICK_LAST)
+                const uint8_t stick_id = isStickId(data_low) ? data_low : player;
                 const uint32_t color = stick_color(stick_id);
                 ESP_LOGI(kTag, "DISP_PLAYER_READY slot=%u stick=%u color=0x%06X (raw h=%u l=%u)",
                          player, stick_id, (unsigned)color, data_high, data_low);
@@ -375,7 +576,7 @@ static void update_state_from_packet(const uint8_t *pkt) {
             s_pending_state.winner = 0;
             s_show_scores = false;
             for (int i = 0; i < 4; i++) {
-                s_pending_state.time_ms[i] = 0xFFFF;
+                s_pending_state.time_ticks[i] = RESULT_TICKS_NONE;
                 s_pending_state.score[i] = -1;
             }
             break;
@@ -387,7 +588,7 @@ static void update_state_from_packet(const uint8_t *pkt) {
             s_show_scores = false;
             s_shake_number = data_low;
             for (int i = 0; i < 4; i++) {
-                s_pending_state.time_ms[i] = 0xFFFF;
+                s_pending_state.time_ticks[i] = RESULT_TICKS_NONE;
                 s_pending_state.score[i] = -1;
             }
             break;
@@ -395,16 +596,10 @@ static void update_state_from_packet(const uint8_t *pkt) {
             s_show_deuce = true;
             break;
         case DISP_TIME_P1:
-            s_pending_state.time_ms[0] = data;
-            break;
         case DISP_TIME_P2:
-            s_pending_state.time_ms[1] = data;
-            break;
         case DISP_TIME_P3:
-            s_pending_state.time_ms[2] = data;
-            break;
         case DISP_TIME_P4:
-            s_pending_state.time_ms[3] = data;
+            s_pending_state.time_ticks[cmd - DISP_TIME_P1] = msg.fine ? msg.ticks : resultTicksFromMs(data);
             break;
         case DISP_ROUND_WINNER:
             s_pending_state.mode = ScreenMode::WINNER;
@@ -472,6 +667,7 @@ static void apply_state(void) {
                 break;
         }
         s_applied_state.mode = s_pending_state.mode;
+        s_preload_done = false; // new screen, new likely successors
     }
 
     if (s_pending_state.mode == ScreenMode::COUNTDOWN &&
@@ -510,11 +706,11 @@ static void apply_state(void) {
     }
 
     for (int i = 0; i < 4; i++) {
-        if (s_pending_state.time_ms[i] != s_player_time_ms[i]) {
-            s_player_time_ms[i] = s_pending_state.time_ms[i];
+        if (s_pending_state.time_ticks[i] != s_player_time_ticks[i]) {
+            s_player_time_ticks[i] = s_pending_state.time_ticks[i];
             if (s_show_scores) {
-                if (s_pending_state.time_ms[i] != 0xFFFF) {
-                    set_player_time(i + 1, s_pending_state.time_ms[i]);
+                if (s_pending_state.time_ticks[i] != RESULT_TICKS_NONE) {
+                    set_player_time(i + 1, s_pending_state.time_ticks[i]);
                 } else {
                     update_player_label(i + 1);
                 }
@@ -531,45 +727,295 @@ static void apply_state(void) {
     s_applied_state = s_pending_state;
 }
 
+// Per-frame timing from lvgl_port (LVGL task, inside lv_refr_now / lv_timer_handler)
+static void on_frame(const lvgl_port_frame_stats_t* stats) {
+    s_render_hist.add(stats->last_render_us);
+    s_flush_hist.add(stats->last_flush_us);
+}
+
+static uint32_t frame_count() {
+    lvgl_port_frame_stats_t stats;
+    lvgl_port_get_frame_stats(&stats);
+    return stats.frames;
+}
+
+static void collect_telemetry(uint32_t* out) {
+    out[TELEM_FRAMES] = frame_count();
+    out[TELEM_VSYNCS] = lvgl_port_get_vsync_count();
+    out[TELEM_RENDER_P50_US] = s_render_hist.percentile(50);
+    out[TELEM_RENDER_P99_US] = s_render_hist.percentile(99);
+    out[TELEM_RENDER_MAX_US] = s_render_hist.max();
+    out[TELEM_FLUSH_P50_US] = s_flush_hist.percentile(50);
+    out[TELEM_FLUSH_P99_US] = s_flush_hist.percentile(99);
+    out[TELEM_FLUSH_MAX_US] = s_flush_hist.max();
+    out[TELEM_LATENCY_COUNT] = s_latency_hist.count();
+    out[TELEM_LATENCY_P50_US] = s_latency_hist.percentile(50);
+    out[TELEM_LATENCY_P99_US] = s_latency_hist.percentile(99);
+    out[TELEM_LATENCY_MAX_US] = s_latency_hist.max();
+    out[TELEM_QUEUE_MAX] = s_queue_max;
+    for (uint8_t i = 0; i < DISPLAY_DROP_COUNT; i++) {
+        out[TELEM_DROP_QUEUE_FULL + i] = s_drops[i];
+    }
+    out[TELEM_UPTIME_MS] = (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void update_hud(int64_t now_us) {
+    if (!s_hud_label) {
+        s_hud_label = lv_label_create(lv_layer_top());
+        lv_obj_set_style_bg_color(s_hud_label, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_hud_label, LV_OPA_70, LV_PART_MAIN);
+        lv_obj_set_style_text_color(s_hud_label, lv_color_hex(0x00FF00), LV_PART_MAIN);
+        lv_obj_set_style_pad_all(s_hud_label, 4, LV_PART_MAIN);
+        lv_obj_align(s_hud_label, LV_ALIGN_TOP_RIGHT, 0, 0);
+    }
+    uint32_t t[TELEM_FIELD_COUNT];
+    collect_telemetry(t);
+    uint32_t drops = 0;
+    for (uint8_t i = 0; i < DISPLAY_DROP_COUNT; i++) {
+        if (i != DROP_DUPLICATE) {
+            drops += t[TELEM_DROP_QUEUE_FULL + i];
+        }
+    }
+    const uint32_t fps = (uint32_t)((uint64_t)(t[TELEM_FRAMES] - s_hud_frames) * 1000000 / (now_us - s_hud_us));
+    s_hud_frames = t[TELEM_FRAMES];
+    lv_label_set_text_fmt(s_hud_label, "%lu fps  render %lu us  flush %lu us\nlatency p99 %lu us  queue %lu  drops %lu",
+                          (unsigned long)fps, (unsigned long)t[TELEM_RENDER_P99_US],
+                          (unsigned long)t[TELEM_FLUSH_P99_US], (unsigned long)t[TELEM_LATENCY_P99_US],
+                          (unsigned long)t[TELEM_QUEUE_MAX], (unsigned long)drops);
+}
+
+// One line per known arena; hidden outside IDLE/PROMPT or until another arena is known
+static void update_arena_label() {
+    bool others = false;
+    for (uint8_t a = 0; a < MAX_ARENAS; a++) {
+        others = others || (s_arena_known[a] && a != ARENA_ID);
+    }
+    const bool show = others && (s_applied_state.mode == ScreenMode::IDLE ||
+                                 s_applied_state.mode == ScreenMode::PROMPT);
+    if (show == s_arena_shown && !(show && s_arena_dirty)) {
+        return;
+    }
+    s_arena_shown = show;
+    s_arena_dirty = false;
+    if (!s_arena_label) {
+        s_arena_label = lv_label_create(lv_layer_top());
+        lv_obj_set_style_bg_color(s_arena_label, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_arena_label, LV_OPA_70, LV_PART_MAIN);
+        lv_obj_set_style_text_color(s_arena_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_set_style_pad_all(s_arena_label, 4, LV_PART_MAIN);
+        lv_obj_align(s_arena_label, LV_ALIGN_BOTTOM_MID, 0, 0);
+    }
+    if (!show) {
+        lv_obj_add_flag(s_arena_label, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    char text[MAX_ARENAS * 48];
+    size_t n = 0;
+    for (uint8_t a = 0; a < MAX_ARENAS; a++) {
+        if (!s_arena_known[a]) {
+            continue;
+        }
+        const uint32_t* v = s_arena_values[a];
+        const uint32_t best = v[ARENA_BEST_TICKS];
+        if (best == RESULT_TICKS_NONE) {
+            n += snprintf(text + n, sizeof(text) - n, "%sArena %u  %lu games  best -", n ? "\n" : "",
+                          (unsigned)a, (unsigned long)v[ARENA_GAMES]);
+        } else {
+            n += snprintf(text + n, sizeof(text) - n, "%sArena %u  %lu games  best %lu.%lu ms", n ? "\n" : "",
+                          (unsigned)a, (unsigned long)v[ARENA_GAMES], (unsigned long)(best / RESULT_TICKS_PER_MS),
+                          (unsigned long)(best % RESULT_TICKS_PER_MS / (RESULT_TICKS_PER_MS / 10)));
+        }
+        if (n >= sizeof(text)) {
+            break;
+        }
+    }
+    lv_label_set_text(s_arena_label, text);
+    lv_obj_clear_flag(s_arena_label, LV_OBJ_FLAG_HIDDEN);
+}
+
+// Next match's entrants; on the winner, idle and join screens until the match starts
+static void update_tour_label() {
+    const ScreenMode mode = s_applied_state.mode;
+    if (mode == ScreenMode::COUNTDOWN || mode == ScreenMode::GO || mode == ScreenMode::REACTION ||
+        mode == ScreenMode::SHAKE) {
+        s_tour_next = false;
+    }
+    bool any = false;
+    for (int i = 0; i < 4; i++) {
+        any = any || s_tour_entrant[i] != 0;
+    }
+    const bool show = any && s_tour_next &&
+                      (mode == ScreenMode::IDLE || mode == ScreenMode::PROMPT || mode == ScreenMode::WINNER);
+    if (show == s_tour_shown && !(show && s_tour_dirty)) {
+        return;
+    }
+    s_tour_shown = show;
+    s_tour_dirty = false;
+    if (!s_tour_label) {
+        s_tour_label = lv_label_create(lv_layer_top());
+        lv_obj_set_style_bg_color(s_tour_label, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_tour_label, LV_OPA_70, LV_PART_MAIN);
+        lv_obj_set_style_text_color(s_tour_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_set_style_pad_all(s_tour_label, 4, LV_PART_MAIN);
+        lv_obj_align(s_tour_label, LV_ALIGN_TOP_MID, 0, 0);
+    }
+    if (!show) {
+        lv_obj_add_flag(s_tour_label, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    char text[64];
+    size_t n = snprintf(text, sizeof(text), "Next match\n");
+    for (int i = 0; i < 4 && n < sizeof(text); i++) {
+        if (s_tour_entrant[i]) {
+            n += snprintf(text + n, sizeof(text) - n, "  P%d #%u", i + 1, (unsigned)s_tour_entrant[i]);
+        }
+    }
+    lv_label_set_text(s_tour_label, text);
+    lv_obj_clear_flag(s_tour_label, LV_OBJ_FLAG_HIDDEN);
+}
+
+// All-time top reactions; hidden outside IDLE/PROMPT, during a tournament or until one is known
+static void update_board_label() {
+    const bool show = s_board_stick[0] != 0 && !s_tour_shown &&
+                      (s_applied_state.mode == ScreenMode::IDLE ||
+                       s_applied_state.mode == ScreenMode::PROMPT);
+    if (show == s_board_shown && !(show && s_board_dirty)) {
+        return;
+    }
+    s_board_shown = show;
+    s_board_dirty = false;
+    if (!s_board_label) {
+        s_board_label = lv_label_create(lv_layer_top());
+        lv_obj_set_style_bg_color(s_board_label, lv_color_hex(0x000000), LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(s_board_label, LV_OPA_70, LV_PART_MAIN);
+        lv_obj_set_style_text_color(s_board_label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_set_style_pad_all(s_board_label, 4, LV_PART_MAIN);
+        lv_obj_align(s_board_label, LV_ALIGN_TOP_MID, 0, 0);
+    }
+    if (!show) {
+        lv_obj_add_flag(s_board_label, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    char text[16 + LEADERBOARD_SIZE * 32];
+    size_t n = snprintf(text, sizeof(text), "Fastest ever");
+    for (uint8_t r = 0; r < LEADERBOARD_SIZE && n < sizeof(text); r++) {
+        if (!s_board_stick[r]) {
+            break;
+        }
+        const uint32_t t = s_board_ticks[r];
+        n += snprintf(text + n, sizeof(text) - n, "\n%u. Stick %u  %lu.%lu ms", (unsigned)(r + 1),
+                      (unsigned)s_board_stick[r], (unsigned long)(t / RESULT_TICKS_PER_MS),
+                      (unsigned long)(t % RESULT_TICKS_PER_MS / (RESULT_TICKS_PER_MS / 10)));
+    }
+    lv_label_set_text(s_board_label, text);
+    lv_obj_clear_flag(s_board_label, LV_OBJ_FLAG_HIDDEN);
+}
+
+// Percentage in the time label of every player whose count moved; a result owns the label
+static void update_shake_labels() {
+    if (!s_shake_dirty) {
+        return;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        if (!(s_shake_dirty & (1 << i)) || !s_shake_target[i] ||
+            s_player_time_ticks[i] != RESULT_TICKS_NONE) {
+            continue;
+        }
+        lv_obj_t* label = player_time_label(i + 1);
+        if (!label) {
+            continue;
+        }
+        const unsigned pct = s_shake_count[i] >= s_shake_target[i] ? 99
+                           : (unsigned)s_shake_count[i] * 100 / s_shake_target[i];
+        lv_label_set_text_fmt(label, "%u%%", pct);
+        lv_obj_clear_flag(label, LV_OBJ_FLAG_HIDDEN);
+    }
+    s_shake_dirty = 0;
+}
+
+// Serial log + one unsequenced batch to the host, then start a new period
+static void report_telemetry() {
+    uint32_t t[TELEM_FIELD_COUNT];
+    collect_telemetry(t);
+    ESP_LOGI(kTag, "Telemetry: %lu frames, %lu vsyncs, render p50/p99/max %lu/%lu/%lu us, flush %lu/%lu/%lu us",
+             (unsigned long)t[TELEM_FRAMES], (unsigned long)t[TELEM_VSYNCS],
+             (unsigned long)t[TELEM_RENDER_P50_US], (unsigned long)t[TELEM_RENDER_P99_US],
+             (unsigned long)t[TELEM_RENDER_MAX_US], (unsigned long)t[TELEM_FLUSH_P50_US],
+             (unsigned long)t[TELEM_FLUSH_P99_US], (unsigned long)t[TELEM_FLUSH_MAX_US]);
+    ESP_LOGI(kTag, "Telemetry: %lu updates, latency p50/p99/max %lu/%lu/%lu us, queue max %lu, "
+             "drops full=%lu len=%lu start=%lu crc=%lu dest=%lu src=%lu dup=%lu",
+             (unsigned long)t[TELEM_LATENCY_COUNT], (unsigned long)t[TELEM_LATENCY_P50_US],
+             (unsigned long)t[TELEM_LATENCY_P99_US], (unsigned long)t[TELEM_LATENCY_MAX_US],
+             (unsigned long)t[TELEM_QUEUE_MAX],
+             (unsigned long)t[TELEM_DROP_QUEUE_FULL], (unsigned long)t[TELEM_DROP_BAD_LEN],
+             (unsigned long)t[TELEM_DROP_BAD_START], (unsigned long)t[TELEM_DROP_BAD_CRC],
+             (unsigned long)t[TELEM_DROP_WRONG_DEST], (unsigned long)t[TELEM_DROP_NOT_FROM_HOST],
+             (unsigned long)t[TELEM_DROP_DUPLICATE]);
+
+    if (kEnableEspNow && kEnableTelemetryReport) {
+        BatchWriter batch;
+        batch.begin(ID_HOST, ID_DISPLAY);
+        for (uint8_t f = 0; f < TELEM_FIELD_COUNT; f++) {
+            addTelemetry(batch, f, t[f]);
+        }
+        const uint8_t len = batch.seal(0, 0);
+        esp_err_t err = esp_now_send(kHostMac, batch.buf, len);
+        if (err != ESP_OK) {
+            ESP_LOGW(kTag, "Telemetry send failed err=%d", (int)err);
+        }
+    }
+
+    s_render_hist.reset();
+    s_flush_hist.reset();
+    s_latency_hist.reset();
+    s_queue_max = 0;
+}
+
 static void ui_timer_cb(lv_timer_t *t) {
     (void)t;
-    uint8_t pkt[PACKET_SIZE] = {};
-    bool has_pkt = false;
-    portENTER_CRITICAL(&s_ui_mux);
-    if (s_pkt_pending) {
-        memcpy(pkt, s_pending_pkt, PACKET_SIZE);
-        s_pkt_pending = false;
-        has_pkt = true;
-    }
-    portEXIT_CRITICAL(&s_ui_mux);
-
-    int64_t now_us = esp_timer_get_time();
-    if (has_pkt) {
-        update_state_from_packet(pkt);
-    }
-    if (s_state_dirty && (now_us - s_last_ui_update_us >= kUiApplyIntervalUs)) {
-        s_last_ui_update_us = now_us;
-        apply_state();
-        s_state_dirty = false;
+    const uint32_t depth = s_rx_queue.size();
+    if (depth > s_queue_max) {
+        s_queue_max = depth;
     }
-    if (s_ready_mask_dirty) {
-        for (int i = 0; i < 4; i++) {
-            bool on = (s_ready_mask >> i) & 0x1;
-            s_pending_state.ready[i] = on;
-            s_applied_state.ready[i] = on;
-            if (on) {
-                // Keep current color (set on ready) if already assigned.
-            } else {
-                set_panel_border_color(i + 1, kBorderDefault);
-            }
+    // Everything that arrived since the last tick, in arrival order
+    DisplayMsg msg;
+    bool popped = false;
+    uint32_t oldest_rx_us = 0;
+    while (s_rx_queue.pop(msg)) {
+        if (!popped) {
+            oldest_rx_us = msg.rx_us;
+            popped = true;
         }
-        s_ready_mask_dirty = false;
+        update_state_from_msg(msg);
+    }
+    const uint32_t drops = s_drops[DROP_QUEUE_FULL];
+    if (drops != s_rx_drops_logged) {
+        ESP_LOGW(kTag, "RX queue full, %lu command(s) dropped", (unsigned long)(drops - s_rx_drops_logged));
+        s_rx_drops_logged = drops;
     }
 
+    // Apply right away and render now rather than at the next refresh
+    // period, so GO and countdown digits reach the next vsync
+    if (s_state_dirty) {
+        apply_state();
+        s_state_dirty = false;
+        const uint32_t frames = frame_count();
+        lv_refr_now(NULL);
+        // Packet-to-pixel: oldest command of this update until its frame is on the panel
+        if (popped && frame_count() != frames) {
+            s_latency_hist.add((uint32_t)esp_timer_get_time() - oldest_rx_us);
+        }
+    } else if (!s_preload_done) {
+        preload_next_assets(s_applied_state.mode);
+    }
+    ota_update_set_idle(s_applied_state.mode == ScreenMode::IDLE);
+    update_arena_label();
+    update_tour_label();
+    update_board_label();
+    update_shake_labels();
     if (s_prompt_mask_dirty || s_prompt_mask) {
-        static uint8_t blink_phase = 0;
-        blink_phase = (blink_phase + 1) % 10; // 0..9
-        bool blink_on = (blink_phase < 5);
+        // From the clock: wake-ups run this callback more often than its period
+        bool blink_on = ((esp_timer_get_time() / kPromptBlinkHalfUs) & 1) == 0;
 
         uint8_t mask = s_prompt_mask;
         for (int i = 0; i < 4; i++) {
@@ -580,32 +1026,58 @@ static void ui_timer_cb(lv_timer_t *t) {
         }
         s_prompt_mask_dirty = false;
     }
+
+    const int64_t now_us = esp_timer_get_time();
+    if (kEnableHud && now_us - s_hud_us >= kHudPeriodUs) {
+        update_hud(now_us);
+        s_hud_us = now_us;
+    }
+    if (now_us - s_telemetry_us >= kTelemetryPeriodUs) {
+        report_telemetry();
+        s_telemetry_us = now_us;
+    }
 }
 
-static void on_data_recv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+// WiFi task: hand a command to the LVGL task and wake it
+static void queue_msg(uint8_t cmd, bool fine, uint16_t data, uint32_t ticks) {
+    DisplayMsg msg = {cmd, fine, data, ticks, (uint32_t)esp_timer_get_time()};
+    if (!s_rx_queue.push(msg)) {
+        count_drop(DROP_QUEUE_FULL);
+    }
+    lvgl_port_wake();
+}
+
+// acked = frame arrived as a ReliablePacket and was already ACKed by sequence
+static void handle_packet(const esp_now_recv_info_t* info, const uint8_t* data, int len, bool acked) {
     if (len != PACKET_SIZE || !data) {
+        count_drop(DROP_BAD_LEN);
         ESP_LOGW(kTag, "ESPNOW drop: bad len or null data");
         return;
     }
     if (data[0] != PACKET_START) {
+        count_drop(DROP_BAD_START);
         ESP_LOGW(kTag, "ESPNOW drop: bad start 0x%02X", data[0]);
         return;
     }
     uint8_t dest = data[1];
     if (dest != ID_DISPLAY && dest != ID_BROADCAST) {
+        count_drop(DROP_WRONG_DEST);
         ESP_LOGW(kTag, "ESPNOW drop: wrong dest 0x%02X", dest);
         return;
     }
     if (data[2] != ID_HOST) {
+        count_drop(DROP_NOT_FROM_HOST);
         ESP_LOGW(kTag, "ESPNOW drop: wrong src id 0x%02X", data[2]);
         return;
     }
     if (info && memcmp(info->src_addr, kHostMac, 6) != 0) {
+        count_drop(DROP_NOT_FROM_HOST);
         ESP_LOGW(kTag, "ESPNOW drop: unexpected MAC");
         return;
     }
     uint8_t crc = calcCRC8(data, 6);
     if (crc != data[6]) {
+        count_drop(DROP_BAD_CRC);
         ESP_LOGW(kTag, "ESPNOW drop: crc mismatch calc=0x%02X pkt=0x%02X", crc, data[6]);
         return;
     }
@@ -623,90 +1095,205 @@ static void on_data_recv(const esp_now_recv_info_t* info, const uint8_t* data, i
 
     // Send ACK for commands that the host retries.
     uint8_t cmd = data[3];
-    if (cmd >= DISP_IDLE && cmd <= DISP_PLAYER_PROMPT) {
+    if (!acked && is_display_cmd(cmd)) {
         if (!(cmd >= DISP_TIME_P1 && cmd <= DISP_TIME_P4) && cmd != DISP_SCORES) {
             send_ack(cmd);
         }
     }
-    // Fast-path time updates so they aren't lost when multiple packets arrive quickly.
-    if (data[3] >= DISP_TIME_P1 && data[3] <= DISP_TIME_P4) {
-        const uint8_t idx = data[3] - DISP_TIME_P1;
-        const uint16_t time_ms = ((uint16_t)data[4] << 8) | data[5];
-        portENTER_CRITICAL(&s_ui_mux);
-        s_pending_state.time_ms[idx] = time_ms;
-        s_state_dirty = true;
-        portEXIT_CRITICAL(&s_ui_mux);
-        ESP_LOGI(kTag, "FAST TIME p%u=%u", (unsigned)(idx + 1), (unsigned)time_ms);
+    queue_msg(cmd, false, packData(data[4], data[5]), 0);
+}
+
+// True if the frame comes from a host boot we haven't said hello to yet
+static bool is_new_host_epoch(uint8_t epoch) {
+    return !s_host_window.valid || s_host_window.epoch != epoch;
+}
+
+static void on_data_recv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+    if (info && data && memcmp(info->src_addr, kHostMac, 6) == 0) {
+        s_host_heard = true;
+        GamePacket pkt;
+        if (len == PACKET_SIZE && data[3] == CMD_CHANNEL_BEACON) {
+            memcpy(&pkt, data, sizeof(pkt));
+            if (validatePacket(&pkt) && pkt.src_id == ID_HOST && pkt.data_low == ARENA_ID) {
+                s_beacon_channel = pkt.data_high;
+            }
+            return;
+        }
+        // Firmware update frames: the ota task takes it from here
+        if (data && isOtaFrame(data, len)) {
+            ota_update_on_frame(data, len);
+            return;
+        }
+    }
+    if (data && isBatchFrame(data, len)) {
+        if (!validateBatch(data, len)) {
+            count_drop(DROP_BAD_CRC);
+            ESP_LOGW(kTag, "ESPNOW drop: bad batch len=%d", len);
+            return;
+        }
+        const BatchHeader* hdr = reinterpret_cast<const BatchHeader*>(data);
+        if (hdr->dest_id != ID_DISPLAY || hdr->src_id != ID_HOST ||
+            (info && memcmp(info->src_addr, kHostMac, 6) != 0)) {
+            count_drop(hdr->dest_id != ID_DISPLAY ? DROP_WRONG_DEST : DROP_NOT_FROM_HOST);
+            ESP_LOGW(kTag, "ESPNOW drop: batch not from host");
+            return;
+        }
+        // Shake progress stream: unsequenced, not ACKed, nothing else inside (SHAKE STREAM)
+        if (hdr->seq == 0 && hdr->epoch == 0 && hdr->count && data[BATCH_HEADER_SIZE] == DISP_SHAKE_PROGRESS) {
+            BatchReader reader(data);
+            BatchItem item;
+            uint8_t player, count, target;
+            while (reader.next(&item)) {
+                if (decodeShakeProgressItem(item, &player, &count, &target)) {
+                    queue_msg(item.cmd, false, packData(player, count), target);
+                }
+            }
+            return;
+        }
+        const bool new_host = is_new_host_epoch(hdr->epoch);
+        const bool fresh = s_host_window.accept(hdr->epoch, hdr->seq);
+        ReliablePacket ack;
+        buildSeqAck(&ack, ID_DISPLAY, ID_HOST, CMD_BATCH, hdr->seq, hdr->epoch, &s_host_window);
+        esp_now_send(kHostMac, reinterpret_cast<const uint8_t*>(&ack), sizeof(ack));
+        if (new_host) {
+            send_hello();
+        }
+        if (!fresh) {
+            count_drop(DROP_DUPLICATE);
+            ESP_LOGI(kTag, "ESPNOW dup batch seq=%u", hdr->seq);
+            return;
+        }
+        ESP_LOGI(kTag, "ESPNOW batch seq=%u items=%u", hdr->seq, hdr->count);
+        // Each item runs through the normal single-command path
+        BatchReader reader(data);
+        BatchItem item;
+        while (reader.next(&item)) {
+            // 4-byte result times don't fit a GamePacket (FINE RESULT TIMES)
+            if (item.cmd >= DISP_TIME_P1 && item.cmd <= DISP_TIME_P4 && item.len >= 4) {
+                queue_msg(item.cmd, true, 0, resultTicks(item));
+                continue;
+            }
+            uint8_t arena, field;
+            uint32_t value;
+            if (decodeArenaStanding(item, &arena, &field, &value)) {
+                queue_msg(item.cmd, false, packData(arena, field), value);
+                continue;
+            }
+            uint8_t rank, stick;
+            if (decodeLeaderboardEntry(item, &rank, &stick, &value)) {
+                queue_msg(item.cmd, false, packData(rank, stick), value);
+                continue;
+            }
+            GamePacket pkt;
+            buildPacket(&pkt, ID_DISPLAY, ID_HOST, item.cmd, item.data());
+            handle_packet(info, reinterpret_cast<const uint8_t*>(&pkt), PACKET_SIZE, true);
+        }
         return;
     }
-    if (data[3] == DISP_SCORES && data[4] >= 1 && data[4] <= 4) {
-        const uint8_t idx = data[4] - 1;
-        portENTER_CRITICAL(&s_ui_mux);
-        s_pending_state.score[idx] = data[5];
-        s_show_scores = true;
-        s_state_dirty = true;
-        portEXIT_CRITICAL(&s_ui_mux);
-        ESP_LOGI(kTag, "FAST SCORE p%u=%u", (unsigned)(idx + 1), (unsigned)data[5]);
+    if (data && len == (int)RELIABLE_PACKET_SIZE) {
+        ReliablePacket rp;
+        memcpy(&rp, data, sizeof(rp));
+        if (!validateReliablePacket(&rp)) {
+            count_drop(DROP_BAD_CRC);
+            ESP_LOGW(kTag, "ESPNOW drop: bad sequenced frame");
+            return;
+        }
+        if (rp.base.dest_id != ID_DISPLAY || rp.base.src_id != ID_HOST ||
+            (info && memcmp(info->src_addr, kHostMac, 6) != 0)) {
+            count_drop(rp.base.dest_id != ID_DISPLAY ? DROP_WRONG_DEST : DROP_NOT_FROM_HOST);
+            ESP_LOGW(kTag, "ESPNOW drop: sequenced frame not from host");
+            return;
+        }
+        const bool new_host = is_new_host_epoch(rp.epoch);
+        const bool fresh = s_host_window.accept(rp.epoch, rp.seq);
+        send_seq_ack(rp);  // every copy - the host may have lost our last ACK
+        if (new_host) {
+            send_hello();
+        }
+        if (!fresh) {
+            count_drop(DROP_DUPLICATE);
+            ESP_LOGI(kTag, "ESPNOW dup seq=%u cmd=0x%02X", rp.seq, rp.base.cmd);
+            return;
+        }
+        // GamePacket is the first PACKET_SIZE bytes of the frame
+        handle_packet(info, data, PACKET_SIZE, true);
         return;
     }
+    handle_packet(info, data, len, false);
+}
 
-    // Fast-path DISP_PLAYER_READY so it isn't lost when multiple packets arrive quickly.
-    if (data[3] == DISP_PLAYER_READY) {
-        uint8_t player = 0;
-        if (data[4] >= 1 && data[4] <= 4) {
-            // New protocol: data_high = player slot
-            player = data[4];
-        } else if (s_prompt_slot >= 1 && s_prompt_slot <= 4 &&
-                   !s_pending_state.ready[s_prompt_slot - 1]) {
-            player = s_prompt_slot;
-        } else if (data[5] >= 1 && data[5] <= 4) {
-            player = data[5];
-        }
-        if (player < 1 || player > 4) {
-            goto queue_packet;
-        }
-        // New protocol: data_low = joystick ID
-        const uint8_t stick_id = (data[5] >= 1 && data[5] <= 4) ? data[5] : player;
-        const uint32_t color = stick_color(stick_id);
-        portENTER_CRITICAL(&s_ui_mux);
-        s_ready_mask |= (1u << (player - 1));
-        s_ready_mask_dirty = true;
-        s_prompt_mask &= ~(1u << (player - 1));
-        s_prompt_mask_dirty = true;
-        if (s_prompt_slot == player) {
-            s_prompt_slot = 0;
-        }
-        s_pending_state.ready[player - 1] = true;
-        if (s_pending_state.mode == ScreenMode::NONE ||
-            s_pending_state.mode == ScreenMode::IDLE) {
-            s_pending_state.mode = ScreenMode::PROMPT;
+// esp_timer task: listen CHANNEL_LISTEN_MS per channel until the host's
+// beacon, follow the channel it names, start over once the host goes quiet
+static void channel_timer_cb(void* arg) {
+    (void)arg;
+    const int64_t now_us = esp_timer_get_time();
+    const uint8_t ch = s_beacon_channel;
+    if (ch >= CHANNEL_FIRST && ch <= CHANNEL_LAST) {
+        s_beacon_channel = 0;
+        s_last_host_us = now_us;
+        if (!s_channel_locked || ch != s_channel) {
+            ESP_LOGI(kTag, "Host on channel %u", ch);
         }
-        s_state_dirty = true;
-        portEXIT_CRITICAL(&s_ui_mux);
-        set_panel_border_color(player, color);
-        ESP_LOGI(kTag, "FAST READY slot=%u stick=%u color=0x%06X", player, stick_id, (unsigned)color);
-    }
-    if (data[3] == DISP_PLAYER_PROMPT && data[5] >= 1 && data[5] <= 4) {
-        const uint8_t player = data[5];
-        portENTER_CRITICAL(&s_ui_mux);
-        s_prompt_mask = (1u << (player - 1));
-        s_prompt_mask_dirty = true;
-        s_prompt_slot = player;
-        if (s_pending_state.mode == ScreenMode::NONE ||
-            s_pending_state.mode == ScreenMode::IDLE) {
-            s_pending_state.mode = ScreenMode::PROMPT;
+        s_channel_locked = true;
+        s_kept_channel = kKeptChannelMagic | ch;
+        ota_update_host_heard();
+        if (ch != s_channel) {
+            s_channel = ch;
+            esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
+        }
+        return;
+    }
+    if (s_host_heard) {
+        s_host_heard = false;
+        s_last_host_us = now_us;
+    }
+    if (s_channel_locked) {
+        if (now_us - s_last_host_us >= BEACON_LOST_MS * 1000LL) {
+            s_channel_locked = false;
+            s_listen_start_us = now_us;
+            ESP_LOGW(kTag, "Host lost on channel %u, listening", s_channel);
         }
-        s_state_dirty = true;
-        portEXIT_CRITICAL(&s_ui_mux);
+        return;
     }
-queue_packet:
-    portENTER_CRITICAL(&s_ui_mux);
-    memcpy(s_pending_pkt, data, PACKET_SIZE);
-    s_pkt_pending = true;
-    portEXIT_CRITICAL(&s_ui_mux);
+    if (now_us - s_listen_start_us >= CHANNEL_LISTEN_MS * 1000LL) {
+        s_listen_start_us = now_us;
+        s_channel = nextScanChannel(s_channel);
+        esp_wifi_set_channel(s_channel, WIFI_SECOND_CHAN_NONE);
+    }
+}
+
+// Boot profile: esp_timer_get_time() at the end of each app_main stage
+struct BootStage {
+    const char* name;
+    int64_t us;
+};
+static BootStage s_boot_stages[6];
+static uint8_t s_boot_count = 0;
+
+static void boot_mark(const char* name) {
+    if (s_boot_count >= sizeof(s_boot_stages) / sizeof(s_boot_stages[0])) return;
+    s_boot_stages[s_boot_count].name = name;
+    s_boot_stages[s_boot_count].us = esp_timer_get_time();
+    s_boot_count++;
+}
+
+static bool boot_is_warm() {
+    const esp_reset_reason_t r = esp_reset_reason();
+    return r != ESP_RST_POWERON && r != ESP_RST_UNKNOWN;
+}
+
+static void boot_report() {
+    int64_t last = 0;
+    for (uint8_t i = 0; i < s_boot_count; i++) {
+        ESP_LOGI(kTag, "Boot: %-7s %4lu ms", s_boot_stages[i].name, (unsigned long)((s_boot_stages[i].us - last) / 1000));
+        last = s_boot_stages[i].us;
+    }
+    ESP_LOGI(kTag, "Boot: %s, ready %lu ms after start", boot_is_warm() ? "warm" : "cold", (unsigned long)(last / 1000));
 }
 
 static void init_espnow() {
+    // Erase only when the partition can't be opened as it is (full, or
+    // written by a newer IDF): never on a normal boot
     esp_err_t err = nvs_flash_init();
     if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
@@ -724,14 +1311,19 @@ static void init_espnow() {
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
     ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
-    ESP_ERROR_CHECK(esp_wifi_set_channel(kEspnowChannel, WIFI_SECOND_CHAN_NONE));
+    const uint8_t kept = (uint8_t)(s_kept_channel & 0xFF);
+    if (boot_is_warm() && (s_kept_channel & 0xFFFFFF00) == kKeptChannelMagic &&
+        kept >= CHANNEL_FIRST && kept <= CHANNEL_LAST) {
+        s_channel = kept;
+    }
+    ESP_ERROR_CHECK(esp_wifi_set_channel(s_channel, WIFI_SECOND_CHAN_NONE));
 
     ESP_ERROR_CHECK(esp_now_init());
     ESP_ERROR_CHECK(esp_now_register_recv_cb(on_data_recv));
 
     esp_now_peer_info_t peerInfo = {};
     memcpy(peerInfo.peer_addr, kHostMac, 6);
-    peerInfo.channel = kEspnowChannel;
+    peerInfo.channel = 0;  // current channel: follows the host's
     peerInfo.encrypt = false;
     peerInfo.ifidx = WIFI_IF_STA;
     err = esp_now_add_peer(&peerInfo);
@@ -741,14 +1333,36 @@ static void init_espnow() {
         ESP_LOGW(kTag, "Host pair failed: %s", esp_err_to_name(err));
     }
 
-    ESP_LOGI(kTag, "ESP-NOW ready on channel %u", kEspnowChannel);
+    const esp_timer_create_args_t channel_timer_args = {
+        .callback = &channel_timer_cb,
+        .name = "channel"
+    };
+    esp_timer_handle_t channel_timer = NULL;
+    ESP_ERROR_CHECK(esp_timer_create(&channel_timer_args, &channel_timer));
+    s_listen_start_us = esp_timer_get_time();
+    ESP_ERROR_CHECK(esp_timer_start_periodic(channel_timer, kChannelTimerUs));
+
+    ESP_LOGI(kTag, "ESP-NOW ready, listening for the host from channel %u", s_channel);
+    send_hello();  // host may already be running; otherwise we repeat it on its first frame
 }
 
 extern "C" void app_main(void) {
-    // Waveshare demo base + full UI, then update one label to check flicker.
+    // Panel first (it has to show something), then the radio so the host
+    // pairs and queues its state while the UI is built: packets wait in
+    // s_rx_queue until ui_timer_cb runs
     waveshare_esp32_s3_rgb_lcd_init();
+    boot_mark("lcd");
+
+    if (kEnableEspNow) {
+        init_espnow();
+        ota_update_init();
+        boot_mark("espnow");
+    } else {
+        // ESP-NOW disabled
+    }
 
     if (lvgl_port_lock(-1)) {
+        asset_pack_init(); // before ui_init: the ui_img_* sources resolve through it
         ui_init();
         show_idle();
         reset_panel_borders();
@@ -756,17 +1370,16 @@ extern "C" void app_main(void) {
         //     lv_label_set_text(ui_labelCountDown, "0");
         //     lv_obj_clear_flag(ui_labelCountDown, LV_OBJ_FLAG_HIDDEN);
         // }
+        // 100 ms for the prompt blink; packets wake it immediately (queue_msg)
         lv_timer_t *state_timer = lv_timer_create(ui_timer_cb, 100, NULL);
-        (void)state_timer;
+        lvgl_port_set_wake_timer(state_timer);
+        lvgl_port_set_frame_cb(on_frame);
+        s_telemetry_us = s_hud_us = esp_timer_get_time();
         lvgl_port_unlock();
     } else {
         // LVGL lock failed
     }
-
-    if (kEnableEspNow) {
-        init_espnow();
-    } else {
-        // ESP-NOW disabled
-    }
+    boot_mark("ui");
+    boot_report();
 }
     
@@ -0,0 +1,311 @@
+#include "ota_update.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "Protocol.h"
+#include "OtaImage.h"
+
+static const char* TAG = "ota";
+static const uint8_t kHostMac[6] = {0x88, 0x57, 0x21, 0xB3, 0x05, 0xAC};
+static constexpr uint32_t kTickMs = 50;           // task wake-up without a frame
+static constexpr uint8_t kDoneRepeats = 3;        // OTA_BLOCK_DONE sends before the restart
+static constexpr uint32_t kRestartDelayMs = 200;  // for the last frames to leave
+
+static TaskHandle_t s_task = nullptr;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;   // offer and chunk state, WiFi task vs ota task
+static volatile bool s_idle = false;
+static volatile bool s_host_heard = false;
+
+// Offer waiting for the task
+static OtaOfferPacket s_offer;
+static bool s_offer_pending = false;
+
+// Session (the block fields are shared with the WiFi task under s_lock)
+static bool s_active = false;
+static bool s_decoding = false;   // chunks for the block are ignored while it is decoded
+static uint32_t s_image_crc = 0;
+static uint32_t s_image_size = 0;
+static uint16_t s_blocks = 0;
+static uint16_t s_block = 0;
+static uint16_t s_record_len = 0;
+static uint32_t s_have = 0;
+static int64_t s_progress_us = 0;
+static uint8_t s_record[OTA_RECORD_MAX];
+static uint8_t s_out[OTA_BLOCK_SIZE];
+
+// ota task only
+static uint32_t s_running_crc = 0;
+static uint32_t s_failed_crc = 0;
+static int64_t s_last_req_us = 0;
+static int64_t s_start_us = 0;
+static esp_ota_handle_t s_handle = 0;
+static const esp_partition_t* s_target = nullptr;
+static const esp_partition_t* s_running = nullptr;
+static bool s_verify_pending = false;
+
+static void send_req(uint16_t block, uint32_t have) {
+    OtaReqPacket r;
+    r.dest_id = ID_HOST;
+    r.src_id = ID_DISPLAY;
+    r.cmd = CMD_OTA_REQ;
+    r.imageCrc = s_image_crc;
+    r.block = block;
+    r.have = have;
+    sealOtaFrame(reinterpret_cast<uint8_t*>(&r), sizeof(r));
+    esp_now_send(kHostMac, reinterpret_cast<const uint8_t*>(&r), sizeof(r));
+}
+
+// OtaBaseRead: the app we run now, from the start of its partition
+static bool read_base(uint32_t offset, uint8_t* dst, uint16_t len) {
+    return offset + len <= s_running->size && esp_partition_read(s_running, offset, dst, len) == ESP_OK;
+}
+
+static void close_session(bool failed) {
+    if (failed) {
+        send_req(OTA_BLOCK_FAIL, 0);
+        s_failed_crc = s_image_crc;
+    }
+    if (s_handle) {
+        esp_ota_abort(s_handle);
+        s_handle = 0;
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_active = false;
+    s_decoding = false;
+    s_record_len = 0;
+    s_have = 0;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void start_session(const OtaOfferPacket& o, int64_t now_us) {
+    if (o.target != OTA_TARGET_DISPLAY || o.version <= FW_VERSION_DATA || o.imageCrc == s_failed_crc ||
+        (o.base && o.base != FW_VERSION_DATA) || o.blocks != (o.imageSize + OTA_BLOCK_SIZE - 1) / OTA_BLOCK_SIZE) {
+        return;
+    }
+    s_target = esp_ota_get_next_update_partition(nullptr);
+    s_image_crc = o.imageCrc;
+    const FwVersion v = decodeVersion(o.version);
+    if (!s_target || o.imageSize > s_target->size) {
+        ESP_LOGW(TAG, "No app slot for V%u.%u.%u (%lu bytes) - flash the A/B partition table once over USB",
+                 v.major, v.minor, v.patch, (unsigned long)o.imageSize);
+        send_req(OTA_BLOCK_FAIL, 0);
+        s_failed_crc = o.imageCrc;
+        return;
+    }
+    esp_err_t err = esp_ota_begin(s_target, OTA_WITH_SEQUENTIAL_WRITES, &s_handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_ota_begin: %s", esp_err_to_name(err));
+        s_handle = 0;
+        send_req(OTA_BLOCK_FAIL, 0);
+        s_failed_crc = o.imageCrc;
+        return;
+    }
+    ESP_LOGI(TAG, "V%u.%u.%u offered (%s, %lu bytes) -> %s", v.major, v.minor, v.patch,
+             o.base ? "delta" : "full image", (unsigned long)o.imageSize, s_target->label);
+    s_image_size = o.imageSize;
+    s_blocks = o.blocks;
+    s_running_crc = 0;
+    s_start_us = now_us;
+    portENTER_CRITICAL(&s_lock);
+    s_block = 0;
+    s_record_len = 0;
+    s_have = 0;
+    s_progress_us = now_us;
+    s_active = true;
+    portEXIT_CRITICAL(&s_lock);
+    send_req(0, 0);
+    s_last_req_us = now_us;
+}
+
+// Decode and write the complete block; false ends the session
+static bool write_block(uint16_t record_len) {
+    const uint16_t out_len = s_block + 1 < s_blocks ? OTA_BLOCK_SIZE
+                           : (uint16_t)(s_image_size - (uint32_t)s_block * OTA_BLOCK_SIZE);
+    if (!otaDecodeBlock(s_record, record_len, s_out, out_len, read_base)) {
+        ESP_LOGW(TAG, "Block %u does not decode - wrong base image?", s_block);
+        return false;
+    }
+    s_running_crc = calcCRC32(s_out, out_len, s_running_crc);
+    if (s_block + 1 == s_blocks && s_running_crc != s_image_crc) {
+        ESP_LOGW(TAG, "Image CRC mismatch - not written");
+        return false;
+    }
+    const esp_err_t err = esp_ota_write(s_handle, s_out, out_len);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_ota_write block %u: %s", s_block, esp_err_to_name(err));
+        return false;
+    }
+    if ((s_block & 63) == 63) {
+        ESP_LOGI(TAG, "%u/%u blocks", s_block + 1, s_blocks);
+    }
+    return true;
+}
+
+static void finish_session() {
+    esp_err_t err = esp_ota_end(s_handle);   // checks the image (and its SHA-256)
+    s_handle = 0;
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(s_target);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Image not taken: %s", esp_err_to_name(err));
+        close_session(true);
+        return;
+    }
+    ESP_LOGI(TAG, "%u blocks in %lu ms, booting %s", s_blocks,
+             (unsigned long)((esp_timer_get_time() - s_start_us) / 1000), s_target->label);
+    for (uint8_t i = 0; i < kDoneRepeats; i++) {
+        send_req(OTA_BLOCK_DONE, 0);
+    }
+    vTaskDelay(pdMS_TO_TICKS(kRestartDelayMs));
+    esp_restart();
+}
+
+// A new image either hears the host in time or goes back to the old one
+static void verify_pending(int64_t now_us) {
+    if (s_host_heard) {
+        s_verify_pending = false;
+        esp_ota_mark_app_valid_cancel_rollback();
+        ESP_LOGI(TAG, "Host heard: %s marked valid", s_running->label);
+    } else if (now_us >= (int64_t)OTA_VERIFY_MS * 1000) {
+        ESP_LOGE(TAG, "Host not heard in %u s - rolling back", (unsigned)(OTA_VERIFY_MS / 1000));
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+}
+
+static void ota_task(void* arg) {
+    (void)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(kTickMs));
+        const int64_t now_us = esp_timer_get_time();
+        if (s_verify_pending) {
+            verify_pending(now_us);
+        }
+
+        OtaOfferPacket offer;
+        bool offered = false;
+        portENTER_CRITICAL(&s_lock);
+        if (s_offer_pending) {
+            offer = s_offer;
+            offered = true;
+            s_offer_pending = false;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (offered && !s_active && s_idle && !s_verify_pending) {
+            start_session(offer, now_us);
+        }
+        if (!s_active) {
+            continue;
+        }
+
+        if (!s_idle) {
+            s_progress_us = now_us;   // a game pauses the session, it doesn't age it
+            continue;
+        }
+        if (now_us - s_progress_us >= (int64_t)OTA_STALL_MS * 1000) {
+            ESP_LOGW(TAG, "No data for %u s - session dropped at block %u", (unsigned)(OTA_STALL_MS / 1000), s_block);
+            close_session(false);
+            continue;
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        const uint16_t record_len = s_record_len;
+        const uint32_t have = s_have;
+        const uint8_t chunks = otaChunks(record_len);
+        const bool complete = record_len && have == (chunks >= 32 ? 0xFFFFFFFFUL : (1UL << chunks) - 1);
+        s_decoding = complete;
+        portEXIT_CRITICAL(&s_lock);
+
+        if (complete) {
+            if (!write_block(record_len)) {
+                close_session(true);
+                continue;
+            }
+            if (s_block + 1 == s_blocks) {
+                finish_session();
+                continue;
+            }
+            portENTER_CRITICAL(&s_lock);
+            s_block++;
+            s_record_len = 0;
+            s_have = 0;
+            s_decoding = false;
+            portEXIT_CRITICAL(&s_lock);
+            send_req(s_block, 0);
+            s_last_req_us = now_us;
+        } else if (now_us - s_last_req_us >= (int64_t)OTA_REQ_RETRY_MS * 1000) {
+            send_req(s_block, have);
+            s_last_req_us = now_us;
+        }
+    }
+}
+
+void ota_update_on_frame(const uint8_t* data, int len) {
+    if (!validateOtaFrame(data, len) || data[1] != ID_DISPLAY || data[2] != ID_HOST) {
+        return;
+    }
+    if (data[3] == CMD_OTA_OFFER) {
+        portENTER_CRITICAL(&s_lock);
+        if (!s_active) {
+            memcpy(&s_offer, data, sizeof(s_offer));
+            s_offer_pending = true;
+        }
+        portEXIT_CRITICAL(&s_lock);
+    } else if (data[3] == CMD_OTA_DATA) {
+        const OtaDataHeader* h = reinterpret_cast<const OtaDataHeader*>(data);
+        bool complete = false;
+        portENTER_CRITICAL(&s_lock);
+        if (s_active && !s_decoding && h->imageCrc == s_image_crc && h->block == s_block &&
+            (!s_have || h->recordLen == s_record_len)) {
+            s_record_len = h->recordLen;
+            memcpy(s_record + (uint16_t)h->chunk * OTA_CHUNK_BYTES, data + sizeof(OtaDataHeader),
+                   len - sizeof(OtaDataHeader) - 4);
+            s_have |= 1UL << h->chunk;
+            s_progress_us = esp_timer_get_time();
+            const uint8_t chunks = otaChunks(s_record_len);
+            complete = s_have == (chunks >= 32 ? 0xFFFFFFFFUL : (1UL << chunks) - 1);
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (!complete) {
+            return;
+        }
+    } else {
+        return;
+    }
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void ota_update_set_idle(bool idle) {
+    s_idle = idle;
+}
+
+void ota_update_host_heard(void) {
+    s_host_heard = true;
+}
+
+void ota_update_init(void) {
+    s_running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(s_running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+        s_verify_pending = true;
+        ESP_LOGW(TAG, "%s is a new image: waiting for the host before keeping it", s_running->label);
+    }
+    if (xTaskCreatePinnedToCore(ota_task, "ota", OTA_TASK_STACK, nullptr, OTA_TASK_PRIORITY,
+                                &s_task, OTA_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "ota task start failed - no firmware updates");
+        s_task = nullptr;
+        if (s_verify_pending) {
+            esp_ota_mark_app_valid_cancel_rollback();   // nothing would confirm it: keep what runs
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Firmware updates pulled from the host (FIRMWARE UPDATE in Protocol.h)
+ *
+ * The host offers a package for the display's version; while the screen
+ * is idle the "ota" task requests it block by block, decodes each one
+ * (OtaImage.h: base copies read from the running app partition) and
+ * writes it to the other app slot (partitions.csv: ota_0 / ota_1). The
+ * CRC-32 of the whole image is checked before its last block is written,
+ * then esp_ota_end() checks the image itself and the slot becomes the
+ * boot partition.
+ *
+ * Rollback (CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE): a new image boots as
+ * pending. ota_update_host_heard() - the channel locked on the host's
+ * beacon, so the radio works - marks it valid; without that within
+ * OTA_VERIFY_MS it is marked invalid and the bootloader goes back to the
+ * previous slot.
+ */
+#define OTA_VERIFY_MS       60000
+#define OTA_STALL_MS        30000   // idle this long without a chunk: host gone, give the session up
+#define OTA_TASK_PRIORITY   2       // below LVGL and the WiFi task
+#define OTA_TASK_CORE       0       // LVGL runs on core 1
+#define OTA_TASK_STACK      4096
+
+/**
+ * @brief Check for a pending image and start the ota task
+ *
+ * @note Call once ESP-NOW is up.
+ */
+void ota_update_init(void);
+
+/**
+ * @brief An OTA frame from the host (WiFi task): copies it, wakes the task
+ */
+void ota_update_on_frame(const uint8_t *data, int len);
+
+/**
+ * @brief The screen is idle (true) or a game is on: requests only while idle
+ */
+void ota_update_set_idle(bool idle);
+
+/**
+ * @brief The host was heard on its channel: a pending image is good
+ */
+void ota_update_host_heard(void);
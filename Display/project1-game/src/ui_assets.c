@@ -0,0 +1,101 @@
+// Generated by pack_assets.py from the SquareLine export - do not edit.
+// Pixels live in the "assets" partition; asset_pack.c decodes them by name.
+
+#include "ui.h"
+#include "asset_pack.h"
+
+const lv_img_dsc_t ui_img_img_ellipse_1_png = {
+   .header.always_zero = 0,
+   .header.w = 320,
+   .header.h = 320,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_ellipse_1_png"};
+
+const lv_img_dsc_t ui_img_img_start_png = {
+   .header.always_zero = 0,
+   .header.w = 274,
+   .header.h = 64,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_start_png"};
+
+const lv_img_dsc_t ui_img_725341252 = {
+   .header.always_zero = 0,
+   .header.w = 143,
+   .header.h = 64,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_725341252"};
+
+const lv_img_dsc_t ui_img_img_player1_png = {
+   .header.always_zero = 0,
+   .header.w = 124,
+   .header.h = 66,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_player1_png"};
+
+const lv_img_dsc_t ui_img_img_player2_png = {
+   .header.always_zero = 0,
+   .header.w = 124,
+   .header.h = 66,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_player2_png"};
+
+const lv_img_dsc_t ui_img_img_player3_png = {
+   .header.always_zero = 0,
+   .header.w = 124,
+   .header.h = 66,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_player3_png"};
+
+const lv_img_dsc_t ui_img_img_player4_png = {
+   .header.always_zero = 0,
+   .header.w = 124,
+   .header.h = 66,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_player4_png"};
+
+const lv_img_dsc_t ui_img_img_group_winner_png = {
+   .header.always_zero = 0,
+   .header.w = 431,
+   .header.h = 207,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_group_winner_png"};
+
+const lv_img_dsc_t ui_img_img_pressjoyn_png = {
+   .header.always_zero = 0,
+   .header.w = 250,
+   .header.h = 130,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_pressjoyn_png"};
+
+const lv_img_dsc_t ui_img_img_reactmode_png = {
+   .header.always_zero = 0,
+   .header.w = 263,
+   .header.h = 130,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_reactmode_png"};
+
+const lv_img_dsc_t ui_img_img_shakemode_png = {
+   .header.always_zero = 0,
+   .header.w = 276,
+   .header.h = 130,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_shakemode_png"};
+
+const lv_img_dsc_t ui_img_img_deucemode_png = {
+   .header.always_zero = 0,
+   .header.w = 266,
+   .header.h = 60,
+   .data_size = 0,
+   .header.cf = ASSET_PACK_CF,
+   .data = (const uint8_t *)"ui_img_img_deucemode_png"};
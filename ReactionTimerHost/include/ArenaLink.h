@@ -0,0 +1,252 @@
+/*
+ * ArenaLink.h - Arena registration and cross-arena standings (ARENAS in Protocol.h)
+ * ESP32 Host
+ *
+ * Arena host (ARENA_ID > 0): start() puts the radio on the control channel
+ * and run() repeats CMD_ARENA_HELLO until the coordinator's CMD_ARENA_ASSIGN
+ * or ARENA_JOIN_MS, then moves to the arena's channel. After every game
+ * (gameOver()) it waits ARENA_REPORT_DELAY_MS for the final screen's traffic
+ * to settle, hops to the control channel, broadcasts its standings batch
+ * and hops back after ARENA_HOP_MS.
+ *
+ * Coordinator (ARENA_COORDINATOR): answers CMD_ARENA_HELLO (one host per
+ * arena), keeps the last report of every arena plus its own (arena 0), and
+ * sets standingsChanged() when one completes so main.cpp can forward the
+ * table to the display.
+ *
+ * A host with neither flag never touches the channel: one table, as before.
+ * Owned by loop().
+ */
+
+#ifndef ARENA_LINK_H
+#define ARENA_LINK_H
+
+#include <Arduino.h>
+#include "Protocol.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define ARENA_HELLO_MS         250    // CMD_ARENA_HELLO repeat while waiting
+#define ARENA_JOIN_MS          3000   // no coordinator by then: run standalone on the arena's channel
+#define ARENA_REPORT_DELAY_MS  2000   // after game over, before hopping
+#define ARENA_HOP_MS           20     // time spent on the control channel per report
+#define ARENA_HOST_TIMEOUT_MS  600000 // coordinator frees an arena not heard from for this long
+
+typedef void (*ArenaChannelFn)(uint8_t channel);
+typedef void (*ArenaSendFn)(const uint8_t* data, size_t len);   // broadcast, current channel
+
+class ArenaLink {
+public:
+  // arena: this table's ARENA_ID; channel: where it plays unless the
+  // coordinator says otherwise. setChannel switches the radio, send broadcasts.
+  void start(uint8_t arena, bool coordinator, uint8_t channel, ArenaChannelFn setChannelFn,
+             ArenaSendFn sendFn, uint32_t nowMs) {
+    myArena = arena;
+    isCoordinator = coordinator;
+    setChannel = setChannelFn;
+    send = sendFn;
+    homeChannel = channel;
+    if (isCoordinator || myArena == 0) {
+      phase = ARENA_RUNNING;
+      return;
+    }
+    phase = ARENA_JOINING;
+    joinStartMs = nowMs;
+    lastHelloMs = nowMs - ARENA_HELLO_MS;
+    setChannel(ARENA_CONTROL_CHANNEL);
+    LOGI(LOG_NET, "[ARENA] Arena %d: looking for the coordinator on channel %d\n",
+         myArena, ARENA_CONTROL_CHANNEL);
+  }
+
+  // Job, every frame: registration, report hops
+  void run(uint32_t nowMs) {
+    switch (phase) {
+      case ARENA_JOINING:
+        if (nowMs - joinStartMs >= ARENA_JOIN_MS) {
+          LOGW(LOG_NET, "[ARENA] No coordinator - arena %d runs standalone on channel %d\n",
+               myArena, homeChannel);
+          goHome();
+          return;
+        }
+        if (nowMs - lastHelloMs >= ARENA_HELLO_MS) {
+          lastHelloMs = nowMs;
+          GamePacket pkt;
+          buildPacket(&pkt, ID_COORDINATOR, ID_HOST, CMD_ARENA_HELLO, myArena);
+          send((const uint8_t*)&pkt, sizeof(pkt));
+        }
+        break;
+
+      case ARENA_RUNNING:
+        if (!reportDue || (int32_t)(nowMs - reportAtMs) < 0 || isCoordinator || myArena == 0) return;
+        reportDue = false;
+        setChannel(ARENA_CONTROL_CHANNEL);
+        hopStartMs = nowMs;
+        phase = ARENA_HOPPING;
+        sendReport();
+        break;
+
+      case ARENA_HOPPING:
+        if (nowMs - hopStartMs >= ARENA_HOP_MS) {
+          setChannel(homeChannel);
+          phase = ARENA_RUNNING;
+        }
+        break;
+    }
+  }
+
+  // The table moves (CHANNEL SELECTION): report hops come back here
+  void moveHome(uint8_t channel) {
+    homeChannel = channel;
+    if (phase == ARENA_RUNNING) setChannel(homeChannel);
+  }
+
+  bool hopping() const { return phase == ARENA_HOPPING; }
+  bool joining() const { return phase == ARENA_JOINING; }
+  uint8_t arena() const { return myArena; }
+  uint8_t channel() const { return homeChannel; }
+
+  // ---------------------------------------------------------------------------
+  // This arena's standings (fed by main.cpp)
+  // ---------------------------------------------------------------------------
+  void roundPlayed() { own.value[ARENA_ROUNDS]++; }
+
+  void reaction(uint32_t ticks) {
+    if (ticks != RESULT_TICKS_NONE && ticks < own.value[ARENA_BEST_TICKS]) own.value[ARENA_BEST_TICKS] = ticks;
+  }
+
+  // resends = the ACK engine's total so far
+  void gameOver(uint32_t nowMs, uint32_t resends) {
+    own.value[ARENA_GAMES]++;
+    own.value[ARENA_RESENDS] = resends;
+    if (isCoordinator) {
+      reports[0] = own;
+      reports[0].valid = true;
+      changed = true;
+    } else {
+      reportDue = true;
+      reportAtMs = nowMs + ARENA_REPORT_DELAY_MS;
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // Packets from other hosts (handlePacket)
+  // ---------------------------------------------------------------------------
+  // Arena host: the coordinator's answer
+  void onAssign(uint8_t arena, uint8_t channel) {
+    if (phase != ARENA_JOINING || arena != myArena) return;
+    if (channel == 0) {
+      LOGE(LOG_NET, "[ARENA] Arena %d is already taken by another host - check ARENA_ID\n", myArena);
+    } else {
+      homeChannel = channel;
+      LOGI(LOG_NET, "[ARENA] Registered as arena %d, channel %d\n", myArena, homeChannel);
+    }
+    goHome();
+  }
+
+  // Coordinator: a host asks for an arena. Returns the CMD_ARENA_ASSIGN data.
+  uint16_t onHello(const uint8_t* mac, uint8_t arena, uint32_t nowMs) {
+    if (!isCoordinator || arena == 0 || arena >= MAX_ARENAS) return packData(arena, 0);
+    Host &h = hosts[arena];
+    bool taken = h.lastMs && memcmp(h.mac, mac, 6) != 0 && nowMs - h.lastMs < ARENA_HOST_TIMEOUT_MS;
+    if (taken) {
+      LOGW(LOG_NET, "[ARENA] Second host asked for arena %d - refused\n", arena);
+      return packData(arena, 0);
+    }
+    if (!h.lastMs) LOGI(LOG_NET, "[ARENA] Arena %d joined (channel %d)\n", arena, arenaChannel(arena));
+    memcpy(h.mac, mac, 6);
+    h.lastMs = nowMs;
+    return packData(arena, arenaChannel(arena));
+  }
+
+  // Coordinator: one item of an arena's report
+  void onStanding(uint8_t arena, uint8_t field, uint32_t value, uint32_t nowMs) {
+    if (!isCoordinator || arena == 0 || arena >= MAX_ARENAS || field >= ARENA_FIELD_COUNT) return;
+    pending[arena].value[field] = value;
+    hosts[arena].lastMs = nowMs;
+    if (field != ARENA_FIELD_COUNT - 1) return;
+    reports[arena] = pending[arena];
+    reports[arena].valid = true;
+    changed = true;
+    logReport(arena);
+  }
+
+  // Coordinator: a report completed since the last takeStandings()
+  bool standingsChanged() const { return changed; }
+
+  // Coordinator: every arena's last report, for the display
+  void takeStandings(BatchWriter &w) {
+    changed = false;
+    for (uint8_t a = 0; a < MAX_ARENAS; a++) {
+      if (!reports[a].valid) continue;
+      for (uint8_t f = 0; f < ARENA_FIELD_COUNT; f++) addArenaStanding(w, a, f, reports[a].value[f]);
+    }
+  }
+
+  void dump() const {
+    LOGI(LOG_NET, "[ARENA] Arena %d on channel %d%s\n", myArena, homeChannel,
+         isCoordinator ? " (coordinator)" : "");
+    for (uint8_t a = 0; a < MAX_ARENAS; a++) {
+      if (reports[a].valid) logReport(a);
+    }
+  }
+
+private:
+  enum Phase : uint8_t { ARENA_RUNNING, ARENA_JOINING, ARENA_HOPPING };
+
+  struct Report {
+    bool valid;
+    uint32_t value[ARENA_FIELD_COUNT];
+  };
+
+  struct Host {
+    uint8_t mac[6];
+    uint32_t lastMs;            // 0 = arena free
+  };
+
+  void goHome() {
+    setChannel(homeChannel);
+    phase = ARENA_RUNNING;
+  }
+
+  // Two copies: a lost item only costs the rest of its report
+  void sendReport() {
+    BatchWriter w;
+    w.begin(ID_COORDINATOR, ID_HOST);
+    for (uint8_t f = 0; f < ARENA_FIELD_COUNT; f++) addArenaStanding(w, myArena, f, own.value[f]);
+    uint8_t len = w.seal(0, 0);
+    send(w.buf, len);
+    send(w.buf, len);
+    LOGI(LOG_NET, "[ARENA] Standings sent: %lu games, %lu rounds\n",
+         (unsigned long)own.value[ARENA_GAMES], (unsigned long)own.value[ARENA_ROUNDS]);
+  }
+
+  void logReport(uint8_t a) const {
+    const uint32_t *v = reports[a].value;
+    LOGI(LOG_NET, "[ARENA] Arena %d: %lu games, %lu rounds, best %lu us, %lu resends\n", a,
+         (unsigned long)v[ARENA_GAMES], (unsigned long)v[ARENA_ROUNDS],
+         (unsigned long)(v[ARENA_BEST_TICKS] == RESULT_TICKS_NONE ? 0 : v[ARENA_BEST_TICKS] * RESULT_TICK_US),
+         (unsigned long)v[ARENA_RESENDS]);
+  }
+
+  uint8_t myArena = 0;
+  bool isCoordinator = false;
+  uint8_t homeChannel = ARENA_CONTROL_CHANNEL;
+  Phase phase = ARENA_RUNNING;
+  ArenaChannelFn setChannel = nullptr;
+  ArenaSendFn send = nullptr;
+  uint32_t joinStartMs = 0;
+  uint32_t lastHelloMs = 0;
+  uint32_t hopStartMs = 0;
+  bool reportDue = false;
+  uint32_t reportAtMs = 0;
+
+  Report own = {false, {0, 0, 0, RESULT_TICKS_NONE}};
+  Report reports[MAX_ARENAS] = {};   // coordinator: last complete report per arena
+  Report pending[MAX_ARENAS] = {};   // coordinator: report being received
+  Host hosts[MAX_ARENAS] = {};
+  bool changed = false;
+};
+
+#endif // ARENA_LINK_H
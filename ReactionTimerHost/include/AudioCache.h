@@ -0,0 +1,284 @@
+/*
+ * AudioCache.h - Pre-decoded PCM for short, timing-critical sounds
+ * ESP32 Host
+ *
+ * Countdown numbers, beep, click and error tone are decoded once into
+ * memory (PSRAM if the board has it, otherwise a small DRAM budget) and
+ * played from there: no filesystem lookup, no decoder warm-up, no
+ * allocation per play. Clips are stored mono 16-bit at their source rate.
+ *
+ * begin() reserves the whole budget as one arena, once. Each clip is
+ * decoded twice - once to count samples, once into an exactly-sized piece
+ * carved from the arena - so the heap is never touched per clip and can't
+ * fragment. Anything that doesn't fit the budget keeps streaming.
+ *
+ * With PSRAM, AUDIO_CACHE_SPARE_SLOTS more slots hold lookahead clips (the
+ * next round's announcements, AudioManager::prefetch()). Each owns one
+ * fixed buffer, also reserved by begin() and reused from then on; the clip
+ * wanted longest ago makes room.
+ */
+
+#ifndef AUDIO_CACHE_H
+#define AUDIO_CACHE_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "AudioFileSourceSPIFFS.h"
+#include "AudioGeneratorMP3.h"
+#include "AudioOutput.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define AUDIO_CACHE_SLOTS        6
+#define AUDIO_CACHE_DRAM_BYTES   49152UL          // no PSRAM: ~1.1 s at 22 kHz
+#define AUDIO_CACHE_PSRAM_BYTES  (1024UL * 1024)
+#define AUDIO_CACHE_SPARE_SLOTS  3                 // lookahead clips, PSRAM only
+#define AUDIO_CACHE_SPARE_BYTES  (192UL * 1024)    // per slot: ~4.4 s at 22 kHz
+
+// Mono sample encodings (values are the audio pack's on-flash codes)
+enum ClipFormat : uint8_t {
+  CLIP_PCM16 = 0,     // int16 little-endian
+  CLIP_PCM8  = 1,     // int8, scaled up by 256
+  CLIP_ADPCM = 2      // IMA-ADPCM, one stream from predictor 0 / index 0, low nibble first
+};
+
+struct PcmClip {
+  const char* name;   // SND_* path it was decoded from / packed under
+  const void* data;   // mono samples in `format` (RAM, or flash-mapped for the pack)
+  uint32_t samples;
+  uint32_t rate;      // Hz
+  ClipFormat format;
+};
+
+// =============================================================================
+// CLIP PLAYBACK
+// =============================================================================
+// Reads a clip one sample at a time. peek() decodes the current sample
+// once, so a sink that refuses it can be retried without stepping the
+// ADPCM state twice.
+class ClipVoice {
+public:
+  void start(const PcmClip* c) {
+    clip = c;
+    pos = 0;
+    ready = false;
+    pred = 0;
+    index = 0;
+  }
+
+  bool done() const { return pos >= clip->samples; }
+
+  int16_t peek() {
+    if (!ready) {
+      cur = decode();
+      ready = true;
+    }
+    return cur;
+  }
+
+  void advance() {
+    pos++;
+    ready = false;
+  }
+
+private:
+  int16_t decode() {
+    const uint8_t* b = (const uint8_t*)clip->data;
+    switch (clip->format) {
+      case CLIP_PCM16: return ((const int16_t*)b)[pos];
+      case CLIP_PCM8:  return (int16_t)((int8_t)b[pos] * 256);
+      case CLIP_ADPCM: break;
+    }
+    static const int16_t STEP[89] = {
+      7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+      50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+      253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+      1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+      3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+      11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+    };
+    static const int8_t INDEX[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+    uint8_t code = (b[pos >> 1] >> ((pos & 1) * 4)) & 0x0F;
+    int32_t step = STEP[index];
+    int32_t delta = step >> 3;
+    if (code & 4) delta += step;
+    if (code & 2) delta += step >> 1;
+    if (code & 1) delta += step >> 2;
+    pred += (code & 8) ? -delta : delta;
+    if (pred > 32767) pred = 32767;
+    if (pred < -32768) pred = -32768;
+    index += INDEX[code & 7];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    return (int16_t)pred;
+  }
+
+  const PcmClip* clip = nullptr;
+  uint32_t pos = 0;
+  int32_t pred = 0;
+  int8_t index = 0;
+  int16_t cur = 0;
+  bool ready = false;
+};
+
+// =============================================================================
+// CAPTURE OUTPUT (decoder -> memory)
+// =============================================================================
+// dst == nullptr only counts samples (sizing pass). Never refuses a sample,
+// so one generator loop() call decodes the whole file.
+class AudioOutputCapture : public AudioOutput {
+public:
+  void reset(int16_t* buf, uint32_t cap) {
+    dst = buf;
+    capacity = cap;
+    count = 0;
+  }
+
+  bool begin() override { return true; }
+  bool stop() override { return true; }
+
+  bool ConsumeSample(int16_t sample[2]) override {
+    if (dst && count < capacity) {
+      dst[count] = (channels == 2) ? (int16_t)(((int32_t)sample[0] + sample[1]) / 2) : sample[0];
+    }
+    count++;
+    return true;
+  }
+
+  uint32_t samples() const { return count; }
+  uint32_t rate() const { return hertz; }
+
+private:
+  int16_t* dst = nullptr;
+  uint32_t capacity = 0;
+  uint32_t count = 0;
+};
+
+// =============================================================================
+// CACHE
+// =============================================================================
+class AudioCache {
+public:
+  // Reserve the arena and the spare buffers (setup(), before any load).
+  // False if the arena can't be had: nothing is cached, everything streams.
+  bool begin() {
+    if (arena) return true;
+    psram = psramFound();
+    const uint32_t caps = psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT;
+    budget = psram ? AUDIO_CACHE_PSRAM_BYTES : AUDIO_CACHE_DRAM_BYTES;
+    arena = (uint8_t*)heap_caps_malloc(budget, caps);
+    if (!arena) {
+      budget = 0;
+      return false;
+    }
+    if (psram) {
+      for (uint8_t i = 0; i < AUDIO_CACHE_SPARE_SLOTS; i++) {
+        spares[i].pcm = (int16_t*)heap_caps_malloc(AUDIO_CACHE_SPARE_BYTES, MALLOC_CAP_SPIRAM);
+      }
+    }
+    return true;
+  }
+
+  // Decode name into memory using the caller's (idle) decoder and file source.
+  // False if the file is missing, the table is full or it doesn't fit the budget.
+  bool load(const char* name, AudioGeneratorMP3* mp3, AudioFileSourceSPIFFS* src) {
+    if (!arena || count >= AUDIO_CACHE_SLOTS || find(name)) return false;
+
+    uint32_t n = decode(name, mp3, src, nullptr, 0);
+    uint32_t bytes = (n * sizeof(int16_t) + 3) & ~3UL;   // keep the next clip word-aligned
+    if (n == 0 || used + bytes > budget) return false;
+
+    int16_t* pcm = (int16_t*)(arena + used);
+    n = decode(name, mp3, src, pcm, n);
+
+    PcmClip &c = clips[count++];
+    c.name = name;
+    c.data = pcm;
+    c.samples = n;
+    c.rate = capture.rate();
+    c.format = CLIP_PCM16;
+    used += bytes;
+    return true;
+  }
+
+  // Lookahead: decode name into a spare slot, replacing the clip wanted
+  // longest ago. Already in memory: only marked as wanted again.
+  // False without PSRAM, or if the file is missing or too long for a slot.
+  bool loadSpare(const char* name, AudioGeneratorMP3* mp3, AudioFileSourceSPIFFS* src) {
+    for (uint8_t i = 0; i < AUDIO_CACHE_SPARE_SLOTS; i++) {
+      if (spares[i].clip.name && sameName(spares[i].clip.name, name)) {
+        spares[i].wanted = ++wantTick;
+        return true;
+      }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+      if (sameName(clips[i].name, name)) return true;
+    }
+    Spare* s = nullptr;
+    for (uint8_t i = 0; i < AUDIO_CACHE_SPARE_SLOTS; i++) {
+      if (spares[i].pcm && (!s || spares[i].wanted < s->wanted)) s = &spares[i];
+    }
+    if (!s) return false;
+    s->clip.name = nullptr;   // stale from here until the new clip is in
+    const uint32_t cap = AUDIO_CACHE_SPARE_BYTES / sizeof(int16_t);
+    const uint32_t n = decode(name, mp3, src, s->pcm, cap);
+    if (n == 0 || capture.samples() > cap) return false;
+
+    s->clip.data = s->pcm;
+    s->clip.samples = n;
+    s->clip.rate = capture.rate();
+    s->clip.format = CLIP_PCM16;
+    s->clip.name = name;
+    s->wanted = ++wantTick;
+    return true;
+  }
+
+  const PcmClip* find(const char* name) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (sameName(clips[i].name, name)) return &clips[i];
+    }
+    for (uint8_t i = 0; i < AUDIO_CACHE_SPARE_SLOTS; i++) {
+      if (spares[i].clip.name && sameName(spares[i].clip.name, name)) return &spares[i].clip;
+    }
+    return nullptr;
+  }
+
+  uint8_t size() const { return count; }
+  uint32_t bytesUsed() const { return used; }
+  bool inPsram() const { return psram; }
+
+private:
+  static bool sameName(const char* a, const char* b) { return a == b || strcmp(a, b) == 0; }
+
+  uint32_t decode(const char* name, AudioGeneratorMP3* mp3, AudioFileSourceSPIFFS* src,
+                  int16_t* dst, uint32_t cap) {
+    if (!src->open(name)) return 0;
+    capture.reset(dst, cap);
+    if (mp3->begin(src, &capture)) {
+      while (mp3->isRunning() && mp3->loop()) {}
+      if (mp3->isRunning()) mp3->stop();
+    }
+    src->close();
+    uint32_t n = capture.samples();
+    return (dst && n > cap) ? cap : n;
+  }
+
+  AudioOutputCapture capture;
+  PcmClip clips[AUDIO_CACHE_SLOTS];
+  uint8_t count = 0;
+
+  struct Spare {
+    PcmClip clip = {};          // name == nullptr: empty
+    int16_t* pcm = nullptr;     // AUDIO_CACHE_SPARE_BYTES from begin(), nullptr = no PSRAM
+    uint32_t wanted = 0;        // wantTick when last asked for
+  };
+  Spare spares[AUDIO_CACHE_SPARE_SLOTS];
+  uint32_t wantTick = 0;
+  uint8_t* arena = nullptr;     // budget bytes, clips packed from the start
+  uint32_t used = 0;
+  uint32_t budget = 0;
+  bool psram = false;
+};
+
+#endif // AUDIO_CACHE_H
@@ -3,7 +3,44 @@
  * 
  * Uses SPIFFS for MP3 storage (no SD card needed)
  * Supports queuing multiple sounds for sequential playback
- * 
+ *
+ * With AUDIO_USE_TASK (default) the MP3 decoder runs in its own task on
+ * core 0 and decodes ahead into a PCM ring; the same task tops up I2S DMA
+ * from the ring every few ms. loop() only pushes commands (play/stop/gap)
+ * into a lock-free queue, so a slow frame on either side no longer stalls
+ * the other. Build with -DAUDIO_USE_TASK=0 to decode from update() in loop().
+ * The task also mounts SPIFFS and reads the clip lengths before its first
+ * command, so begin() returns without touching flash; until then clipMs()
+ * is 0 and commands wait in the queue.
+ *
+ * With the sound pack flashed (AudioPack.h, pack_audio.py) every clip
+ * plays straight from memory-mapped flash as PCM or IMA-ADPCM and the MP3
+ * decoder is never started. Without it, timing-critical clips
+ * (AUDIO_CACHED_SOUNDS) play from pre-decoded PCM (AudioCache.h) and
+ * everything else streams through one reused file source.
+ *
+ * The playlist is priority-ordered (critical > announcement > ambient,
+ * FIFO within one): a higher-priority clip cuts off a lower one that is
+ * playing, a clip already waiting is not queued twice, and when the table
+ * is full the newest lower-priority entry makes room. Every clip is tagged
+ * with the scene (game state) it was queued in; setScene() drops anything
+ * below critical left over from an earlier scene, so stale prompts never
+ * delay the next state. Drops, merges and expiries are counted and logged.
+ *
+ * queueSoundAt() plays a clip at a micros() instant, pre-empting the
+ * playlist. For cached clips the task pre-rolls exactly enough silence
+ * that the first sample leaves I2S on that instant. Clip lengths come from
+ * the MP3 headers (Mp3Info.h), so callers can plan around idleAtMs().
+ *
+ * prefetch() readies a clip that will be queued soon (the next round's
+ * announcements): in task mode the idle decoder puts it into a spare cache
+ * slot, so it starts from RAM.
+ *
+ * Nothing is allocated after begin(): the decoder works in one reserved
+ * block instead of mallocing its buffers per file, the cache reserves its
+ * arena and spare slots up front, and every SND_* length is read there
+ * (AUDIO_ALL_SOUNDS), so loop() never opens a file to plan a clip.
+ *
  * ACCESSIBILITY: Audio provides feedback for visually impaired players
  */
 
@@ -15,50 +52,35 @@
 #include "AudioFileSourceSPIFFS.h"
 #include "AudioGeneratorMP3.h"
 #include "AudioOutputI2S.h"
+#include "Log.h"
+#include "SpscQueue.h"
+#include "AudioCache.h"
+#include "AudioPack.h"
+#include "Mp3Info.h"
+#include "TaskLoad.h"
+#include "Sounds.h"
 
-// =============================================================================
-// SOUND FILE DEFINITIONS
-// =============================================================================
-// Files should be stored in SPIFFS at these paths
-// UI sounds
-#define SND_BUTTON_CLICK      "/click.mp3"
-#define SND_GET_READY         "/get_ready.mp3"
-#define SND_PRESS_TO_JOIN     "/press_join.mp3"
-#define SND_READY             "/ready.mp3"       // Player joined acknowledgment
-
-// Game mode announcements
-#define SND_REACTION_MODE     "/reaction.mp3"
-#define SND_REACTION_INSTRUCT "/react_inst.mp3"
-#define SND_SHAKE_IT          "/shake.mp3"
-#define SND_YOU_WILL_SHAKE    "/will_shake.mp3"
-
-// Numbers (for countdown and shake targets)
-#define SND_NUM_1             "/one.mp3"
-#define SND_NUM_2             "/two.mp3"
-#define SND_NUM_3             "/three.mp3"
-#define SND_NUM_10            "/ten.mp3"
-#define SND_NUM_15            "/fifteen.mp3"
-#define SND_NUM_20            "/twenty.mp3"
-#define SND_BEEP              "/beep.mp3"
-
-// Player announcements (combined "Player X" files)
-#define SND_PLAYER_1          "/player1.mp3"    // "Player One"
-#define SND_PLAYER_2          "/player2.mp3"    // "Player Two"
-#define SND_PLAYER_3          "/player3.mp3"    // "Player Three"
-#define SND_PLAYER_4          "/player4.mp3"    // "Player Four"
-
-// Result phrases
-#define SND_FASTEST           "/fastest.mp3"    // "Fastest"
-#define SND_WINS              "/wins.mp3"       // "Wins"
-#define SND_VICTORY_FANFARE   "/victory.mp3"
-#define SND_GAME_OVER         "/gameover.mp3"
-#define SND_ERROR_TONE        "/error.mp3"
+// Decoded into RAM (AudioCache.h), in load order - first come, first fit
+static const char* const AUDIO_CACHED_SOUNDS[] = {
+  SND_BEEP, SND_NUM_3, SND_NUM_2, SND_NUM_1, SND_BUTTON_CLICK, SND_ERROR_TONE
+};
+#define AUDIO_CACHED_COUNT (sizeof(AUDIO_CACHED_SOUNDS) / sizeof(AUDIO_CACHED_SOUNDS[0]))
+static_assert(AUDIO_CACHED_COUNT <= AUDIO_CACHE_SLOTS, "AUDIO_CACHE_SLOTS too small");
+
+// Every clip the game queues: lengths read once by begin() (no sound pack)
+static const char* const AUDIO_ALL_SOUNDS[] = {
+  SND_BUTTON_CLICK, SND_GET_READY, SND_PRESS_TO_JOIN, SND_READY,
+  SND_REACTION_MODE, SND_REACTION_INSTRUCT, SND_SHAKE_IT, SND_YOU_WILL_SHAKE,
+  SND_NUM_1, SND_NUM_2, SND_NUM_3, SND_NUM_10, SND_NUM_15, SND_NUM_20, SND_BEEP,
+  SND_PLAYER_1, SND_PLAYER_2, SND_PLAYER_3, SND_PLAYER_4,
+  SND_FASTEST, SND_WINS, SND_VICTORY_FANFARE, SND_GAME_OVER, SND_ERROR_TONE
+};
+#define AUDIO_ALL_COUNT (sizeof(AUDIO_ALL_SOUNDS) / sizeof(AUDIO_ALL_SOUNDS[0]))
 
 // =============================================================================
 // CONFIGURATION
 // =============================================================================
-#define AUDIO_QUEUE_SIZE      8
-#define DEFAULT_SOUND_GAP     250   // ms gap between queued sounds (adds natural pauses)
+#define AUDIO_QUEUE_SIZE      8     // playlist entries
 
 // I2S Pins (match schematic - GPIO25/26/27)
 #define I2S_DOUT_PIN          25    // Data out to DAC
@@ -70,6 +92,93 @@
 // Amplifier GAIN pin - grounded (LOW) for maximum volume
 #define AMP_GAIN_PIN          33
 
+// Decoder task
+#ifndef AUDIO_USE_TASK
+#define AUDIO_USE_TASK        1
+#endif
+#define AUDIO_TASK_STACK      6144
+#define AUDIO_TASK_PRIORITY   5     // above the log drain, below the renderer and WiFi
+#define AUDIO_TASK_CORE       0     // loop() owns core 1
+#define AUDIO_TASK_PERIOD     2     // ms between DMA top-ups
+#define AUDIO_CMD_QUEUE_SIZE  16    // loop() -> task commands (power of 2)
+#define AUDIO_PCM_FRAMES      4096  // stereo frames (power of 2): ~93 ms at 44.1 kHz, 16 KB
+#define AUDIO_MP3_FRAME       1152  // samples per MP3 frame - decode only with this much room
+
+// Scheduled cues (queueSoundAt)
+#define AUDIO_CUE_PREROLL_US  40000 // cached cue: start silence pre-roll this close to it
+#define AUDIO_DMA_LEAD_FRAMES 128   // one I2S DMA buffer: delay from write to DAC when idle
+#define AUDIO_CLIP_LEN_SLOTS  24    // memoised clip lengths (one per SND_* file)
+#define AUDIO_PREFETCH_QUEUE  4     // clips waiting for the idle decoder
+
+static_assert(AUDIO_ALL_COUNT <= AUDIO_CLIP_LEN_SLOTS, "AUDIO_CLIP_LEN_SLOTS too small");
+
+// =============================================================================
+// PCM RING (decoder -> I2S DMA)
+// =============================================================================
+// AudioOutput the generator writes into. Format changes go straight to the
+// sink: a new file only starts once the previous one has drained.
+class AudioOutputPcmRing : public AudioOutput {
+public:
+  explicit AudioOutputPcmRing(AudioOutput* s) : sink(s) {}
+
+  bool SetRate(int hz) override { return sink->SetRate(hz); }
+  bool SetBitsPerSample(int bits) override { return sink->SetBitsPerSample(bits); }
+  bool SetChannels(int ch) override { return sink->SetChannels(ch); }
+  bool begin() override { return sink->begin(); }
+
+  // Returns false when full; the generator keeps the sample and retries
+  bool ConsumeSample(int16_t sample[2]) override {
+    if (head - tail >= AUDIO_PCM_FRAMES) return false;
+    Frame &f = buf[head & (AUDIO_PCM_FRAMES - 1)];
+    f.l = sample[0];
+    f.r = sample[1];
+    head++;
+    return true;
+  }
+
+  // Generator finished: keep the sink running until the ring drains
+  bool stop() override { return true; }
+
+  // Move frames into I2S DMA until it's full or the ring is empty
+  void pump() {
+    int16_t s[2];
+    while (tail != head) {
+      const Frame &f = buf[tail & (AUDIO_PCM_FRAMES - 1)];
+      s[0] = f.l;
+      s[1] = f.r;
+      if (!sink->ConsumeSample(s)) break;
+      tail++;
+    }
+  }
+
+  void clear() { tail = head; }
+  uint32_t buffered() const { return head - tail; }
+  uint32_t space() const { return AUDIO_PCM_FRAMES - buffered(); }
+
+private:
+  struct Frame { int16_t l, r; };
+  AudioOutput* sink;
+  Frame buf[AUDIO_PCM_FRAMES];
+  uint32_t head = 0;   // both ends are used by the audio task only
+  uint32_t tail = 0;
+};
+
+enum AudioCmdOp : uint8_t {
+  AUDIO_CMD_PLAY,
+  AUDIO_CMD_PLAY_AT,
+  AUDIO_CMD_STOP,
+  AUDIO_CMD_GAP,
+  AUDIO_CMD_SCENE,
+  AUDIO_CMD_PREFETCH
+};
+
+struct AudioCmd {
+  AudioCmdOp op;
+  AudioPriority pri;  // AUDIO_CMD_PLAY
+  const char* file;   // AUDIO_CMD_PLAY(_AT), AUDIO_CMD_PREFETCH: string literal, never freed
+  uint32_t arg;       // AUDIO_CMD_PLAY_AT: micros() instant, AUDIO_CMD_GAP: ms, AUDIO_CMD_SCENE: scene
+};
+
 // =============================================================================
 // AUDIO MANAGER CLASS
 // =============================================================================
@@ -79,8 +188,10 @@ public:
     mp3(nullptr),
     file(nullptr),
     out(nullptr),
-    queueHead(0),
-    queueTail(0),
+    ring(nullptr),
+    sink(nullptr),
+    clip(nullptr),
+    queueCount(0),
     isPlaying(false),
     soundGap(DEFAULT_SOUND_GAP),
     lastSoundEndTime(0) {}
@@ -88,8 +199,10 @@ public:
   ~AudioManager() {
     stop();
     if (mp3) delete mp3;
+    if (mp3Space) heap_caps_free(mp3Space);
     if (file) delete file;
     if (out) delete out;
+    // ring is never freed: the task may still hold it
   }
   
   // Initialize audio system
@@ -100,12 +213,6 @@ public:
       return true;
     }
 
-    // Initialize SPIFFS
-    if (!SPIFFS.begin(true)) {
-      Serial.println(F("SPIFFS mount failed!"));
-      return false;
-    }
-
     // Use I2S port 1 to avoid conflicts with WiFi/ESP-NOW
     out = new AudioOutputI2S(I2S_PORT);
     if (!out) {
@@ -115,42 +222,123 @@ public:
     out->SetPinout(I2S_BCLK_PIN, I2S_LRC_PIN, I2S_DOUT_PIN);
     out->SetGain(1.0);
 
-    mp3 = new AudioGeneratorMP3();
-    if (!mp3) {
+    // Decoder buffers in one block for good: the default constructor mallocs them per begin()
+    mp3Space = heap_caps_malloc(AudioGeneratorMP3::preAllocSize(), MALLOC_CAP_8BIT);
+    mp3 = mp3Space ? new AudioGeneratorMP3(mp3Space, AudioGeneratorMP3::preAllocSize()) : nullptr;
+    file = new AudioFileSourceSPIFFS();  // reopened per sound, never reallocated
+    if (!mp3 || !file) {
       Serial.println(F("Failed to create AudioGeneratorMP3!"));
       delete out;
       out = nullptr;
       return false;
     }
+    sink = out;
 
     // Ground GAIN pin for maximum volume
     pinMode(AMP_GAIN_PIN, OUTPUT);
     digitalWrite(AMP_GAIN_PIN, LOW);
 
+#if AUDIO_USE_TASK
+    // The task fills the cache between sounds, so boot isn't held up
+    ring = new AudioOutputPcmRing(out);
+    sink = ring;
+    if (!ring || xTaskCreatePinnedToCore(taskEntry, "audio", AUDIO_TASK_STACK, this,
+                                         AUDIO_TASK_PRIORITY, &task, AUDIO_TASK_CORE) != pdPASS) {
+      Serial.println(F("Failed to start audio task!"));
+      return false;
+    }
+    Serial.printf("[AUDIO] Decoder task on core %d, %d-frame PCM ring\n", AUDIO_TASK_CORE, AUDIO_PCM_FRAMES);
+#else
+    if (!mountAssets()) return false;
+    while (cacheNext < AUDIO_CACHED_COUNT) cacheStep();
+#endif
+
     Serial.printf("[AUDIO] Initialized on I2S port %d (DOUT=%d, BCLK=%d, LRC=%d, GAIN=%d=GND)\n",
                   I2S_PORT, I2S_DOUT_PIN, I2S_BCLK_PIN, I2S_LRC_PIN, AMP_GAIN_PIN);
     return true;
   }
   
-  // Queue a sound to play
-  void queueSound(const char* filename) {
-    uint8_t nextTail = (queueTail + 1) % AUDIO_QUEUE_SIZE;
-    if (nextTail != queueHead) {  // Not full
-      queue[queueTail] = filename;
-      queueTail = nextTail;
+  // Queue a sound to play (after everything of equal or higher priority)
+  void queueSound(const char* filename, AudioPriority pri = AUDIO_PRI_ANNOUNCE) {
+    unsigned long now = millis();
+    prunePlan(now);
+    if ((long)(busyUntilMs - now) < 0) busyUntilMs = now;
+    busyUntilMs += plannedGap + clipMs(filename);
+    if (planCount < AUDIO_QUEUE_SIZE + 1) {
+      plan[planCount].endMs = busyUntilMs;
+      plan[planCount].pri = pri;
+      planCount++;
+    }
+#if AUDIO_USE_TASK
+    post(AUDIO_CMD_PLAY, filename, 0, pri);
+#else
+    enqueue(filename, pri);
+#endif
+  }
+
+  // New scene (game state): queued clips below critical from earlier scenes
+  // are dropped, and an ambient clip still playing is cut
+  void setScene(uint8_t scene) {
+    // What's left is at most the clip that is playing now
+    prunePlan(millis());
+    if (planCount && plan[0].pri >= AUDIO_PRI_ANNOUNCE) {
+      planCount = 1;
+      busyUntilMs = plan[0].endMs;
+    } else {
+      planCount = 0;
+      busyUntilMs = millis();
     }
+#if AUDIO_USE_TASK
+    post(AUDIO_CMD_SCENE, nullptr, scene);
+#else
+    enterScene(scene);
+#endif
   }
   
+  // Play at a micros() instant, cutting off whatever is playing (the queue
+  // resumes after it). Post at least AUDIO_CUE_LEAD_US ahead for cached clips
+  // to start on the exact sample; streamed clips start when due.
+  void queueSoundAt(const char* filename, uint32_t atUs) {
+    unsigned long end = millis() + (int32_t)(atUs - micros()) / 1000 + clipMs(filename);
+    if ((long)(end - busyUntilMs) > 0) busyUntilMs = end;
+#if AUDIO_USE_TASK
+    post(AUDIO_CMD_PLAY_AT, filename, atUs);
+#else
+    cueName = filename;
+    cueAtUs = atUs;
+#endif
+  }
+
+  // Clip length in ms from the pack index or the MP3 header (0 if unreadable);
+  // memoised, and read for all of AUDIO_ALL_SOUNDS by mountAssets()
+  uint32_t clipMs(const char* filename) {
+    return assetsReady ? clipLen(filename) : 0;   // boot: the task is still reading them
+  }
+
+  // SPIFFS mounted and the clips read: other files may be opened from here on
+  bool filesReady() const { return assetsReady; }
+
+  // millis() by which everything queued so far will have played (upper
+  // bound: every clip is counted with a gap in front of it)
+  unsigned long idleAtMs() const {
+    unsigned long now = millis();
+    return (long)(busyUntilMs - now) > 0 ? busyUntilMs : now;
+  }
+
+  // A clip that will be queued soon: (task mode, no sound pack) decode it
+  // into a spare cache slot while nothing plays. Without the task the
+  // decode would stall loop(), so it keeps streaming.
+  void prefetch(const char* filename) {
+    if (assetsReady && pack.find(filename)) return;   // already in memory
+#if AUDIO_USE_TASK
+    post(AUDIO_CMD_PREFETCH, filename, 0);
+#endif
+  }
+
   // Play a number (1-3 for countdown, 10/15/20 for shake)
   void playNumber(uint8_t num) {
-    switch (num) {
-      case 1:  queueSound(SND_NUM_1); break;
-      case 2:  queueSound(SND_NUM_2); break;
-      case 3:  queueSound(SND_NUM_3); break;
-      case 10: queueSound(SND_NUM_10); break;
-      case 15: queueSound(SND_NUM_15); break;
-      case 20: queueSound(SND_NUM_20); break;
-    }
+    const char* f = numberSound(num);
+    if (f) queueSound(f);
   }
 
   // Play countdown number (3, 2, 1)
@@ -179,99 +367,500 @@ public:
     playNumber(target);
   }
   
-  // Must be called frequently (in loop)
+  // Must be called frequently (in loop). Task mode: only reports ring underruns.
   void update() {
+#if AUDIO_USE_TASK
+    uint32_t u = underruns;
+    if (u != underrunsReported) {
+      LOGW(LOG_AUDIO, "[AUDIO] PCM ring ran dry %lu time(s), %lu total\n",
+           (unsigned long)(u - underrunsReported), (unsigned long)u);
+      underrunsReported = u;
+    }
+    if (cmdDrops != cmdDropsReported) {
+      LOGW(LOG_AUDIO, "[AUDIO] Command queue full, %lu dropped\n",
+           (unsigned long)(cmdDrops - cmdDropsReported));
+      cmdDropsReported = cmdDrops;
+    }
+    reportQueue();
+#else
+    reportQueue();
     if (!out || !mp3) return;  // Not initialized
 
+    if (cueName) serviceCue();
+
     // If currently playing, check if done
-    if (isPlaying) {
-      if (mp3->isRunning()) {
-        if (!mp3->loop()) {
-          mp3->stop();
-          isPlaying = false;
-          lastSoundEndTime = millis();  // Track when sound ended
-          if (file) {
-            delete file;
-            file = nullptr;
-          }
-        }
-      } else {
-        isPlaying = false;
-        lastSoundEndTime = millis();  // Track when sound ended
-        if (file) {
-          delete file;
-          file = nullptr;
-        }
+    if (isPlaying && !render()) {
+      endSound();
+      lastSoundEndTime = millis();  // Track when sound ended
+    }
+
+    if (!isPlaying) startNext();
+#endif
+  }
+
+  // Stop current playback and clear the queue
+  void stop() {
+    busyUntilMs = millis();
+    planCount = 0;
+#if AUDIO_USE_TASK
+    if (ring) post(AUDIO_CMD_STOP, nullptr, 0);
+#else
+    halt();
+#endif
+  }
+
+  // Check if playing (task mode: decoding or still draining the ring)
+  bool playing() const {
+    return isPlaying || draining;
+  }
+
+  // Set gap between sounds in ms (default 250ms)
+  void setSoundGap(unsigned long gapMs) {
+    plannedGap = gapMs;
+#if AUDIO_USE_TASK
+    post(AUDIO_CMD_GAP, nullptr, gapMs);
+#else
+    soundGap = gapMs;
+#endif
+  }
+
+  // Times the ring emptied while a sound was still decoding (task mode)
+  uint32_t underrunCount() const { return underruns; }
+
+  // Playlist outcomes since boot
+  uint32_t droppedCount() const { return qDropped; }
+  uint32_t expiredCount() const { return qExpired; }
+
+  // Decoder task and its busy time (TaskLoad.h); nullptr without AUDIO_USE_TASK
+  TaskHandle_t taskHandle() const { return task; }
+  const TaskMeter* meter() const { return &taskMeter; }
+
+private:
+  // ---- Playlist (owned by the audio task in task mode, by loop() otherwise) ----
+  void enqueue(const char* filename, AudioPriority pri) {
+    // Already waiting in this scene: merge, keeping the higher priority
+    for (uint8_t i = 0; i < queueCount; i++) {
+      QueueEntry &e = queue[i];
+      if (e.scene == scene && (e.file == filename || strcmp(e.file, filename) == 0)) {
+        if (pri > e.pri) e.pri = pri;
+        qMerged++;
+        return;
       }
     }
 
-    // If not playing and queue has items, wait for gap then start next
-    if (!isPlaying && queueHead != queueTail) {
-      // Wait for gap between sounds (creates natural pauses)
-      if (lastSoundEndTime > 0 && (millis() - lastSoundEndTime) < soundGap) {
-        return;  // Still waiting for gap
+    if (queueCount == AUDIO_QUEUE_SIZE) {
+      // Full: the newest entry of the lowest priority below pri makes room
+      int8_t victim = -1;
+      for (uint8_t i = 0; i < queueCount; i++) {
+        if (queue[i].pri >= pri) continue;
+        if (victim < 0 || queue[i].pri < queue[victim].pri ||
+            (queue[i].pri == queue[victim].pri && queue[i].seq > queue[victim].seq)) victim = i;
       }
+      qDropped++;
+      if (victim < 0) {
+        LOGW(LOG_AUDIO, "[AUDIO] Queue full, dropped %s\n", filename);
+        return;
+      }
+      LOGW(LOG_AUDIO, "[AUDIO] Queue full, %s replaces %s\n", filename, queue[victim].file);
+      removeAt(victim);
+    }
 
-      const char* filename = queue[queueHead];
-      queueHead = (queueHead + 1) % AUDIO_QUEUE_SIZE;
+    QueueEntry &e = queue[queueCount++];
+    e.file = filename;
+    e.pri = pri;
+    e.scene = scene;
+    e.seq = nextSeq++;
 
-      // Check if file exists
-      if (SPIFFS.exists(filename)) {
-        // Clean up any previous file object
-        if (file) {
-          delete file;
-          file = nullptr;
-        }
+    // Outranks what is playing: cut it, this one starts without a gap
+    if ((isPlaying || draining) && pri > playingPri) {
+      cut();
+      qPreempted++;
+      lastSoundEndTime = 0;
+    }
+  }
 
-        file = new AudioFileSourceSPIFFS(filename);
-        if (file && mp3->begin(file, out)) {
-          isPlaying = true;
-        } else {
-          Serial.printf("[AUDIO] Failed to play: %s\n", filename);
-          if (file) {
-            delete file;
-            file = nullptr;
-          }
-        }
+  void removeAt(uint8_t i) {
+    queue[i] = queue[--queueCount];
+  }
+
+  // Drop what an earlier scene left behind (critical clips stay)
+  void enterScene(uint8_t s) {
+    scene = s;
+    for (uint8_t i = 0; i < queueCount;) {
+      if (queue[i].scene != s && queue[i].pri < AUDIO_PRI_CRITICAL) {
+        removeAt(i);
+        qExpired++;
       } else {
-        Serial.printf("[AUDIO] File not found: %s\n", filename);
+        i++;
       }
     }
+    if ((isPlaying || draining) && playingScene != s && playingPri == AUDIO_PRI_AMBIENT) {
+      cut();
+      qExpired++;
+      lastSoundEndTime = 0;
+    }
   }
-  
-  // Stop current playback
-  void stop() {
-    if (mp3 && mp3->isRunning()) {
+
+  // Stop the sound playing now, including what DMA still holds
+  void cut() {
+    out->stop();
+    if (isPlaying) endSound();
+    draining = false;
+    if (ring) ring->clear();
+  }
+
+  // Start the highest-priority queued sound once the gap has passed
+  void startNext() {
+    if (queueCount == 0) return;
+    // Wait for gap between sounds (creates natural pauses)
+    if (lastSoundEndTime > 0 && (millis() - lastSoundEndTime) < soundGap) return;
+
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < queueCount; i++) {
+      if (queue[i].pri > queue[best].pri ||
+          (queue[i].pri == queue[best].pri && queue[i].seq < queue[best].seq)) best = i;
+    }
+    QueueEntry e = queue[best];
+    removeAt(best);
+    playingPri = e.pri;
+    playingScene = e.scene;
+    startSound(e.file);
+  }
+
+  // Log playlist drops/merges/expiries/pre-emptions since the last call
+  void reportQueue() {
+    uint32_t d = qDropped, m = qMerged, x = qExpired, p = qPreempted;
+    if (d == qDroppedReported && m == qMergedReported && x == qExpiredReported && p == qPreemptedReported) return;
+    LOGI(LOG_AUDIO, "[AUDIO] Queue: %lu dropped, %lu merged, %lu expired, %lu pre-empted\n",
+         (unsigned long)(d - qDroppedReported), (unsigned long)(m - qMergedReported),
+         (unsigned long)(x - qExpiredReported), (unsigned long)(p - qPreemptedReported));
+    qDroppedReported = d;
+    qMergedReported = m;
+    qExpiredReported = x;
+    qPreemptedReported = p;
+  }
+
+  // Loop-side plan for idleAtMs(): forget clips that should have ended
+  void prunePlan(unsigned long now) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < planCount; i++) {
+      if ((long)(plan[i].endMs - now) > 0) plan[n++] = plan[i];
+    }
+    planCount = n;
+  }
+
+  void startSound(const char* filename) {
+    // Packed or cached: straight from memory, first sample goes out this pass
+    const PcmClip* c = findClip(filename);
+    if (c) {
+      beginClip(c);
+      return;
+    }
+
+    // open() fails for a missing file - no separate exists() lookup
+    if (!file->open(filename)) {
+      LOGW(LOG_AUDIO, "[AUDIO] File not found: %s\n", filename);
+      return;
+    }
+    if (mp3->begin(file, sink)) {
+      isPlaying = true;
+    } else {
+      LOGW(LOG_AUDIO, "[AUDIO] Failed to play: %s\n", filename);
+      file->close();
+    }
+  }
+
+  const PcmClip* findClip(const char* filename) const {
+    const PcmClip* c = pack.find(filename);
+    return c ? c : cache.find(filename);
+  }
+
+  void beginClip(const PcmClip* c) {
+    clip = c;
+    voice.start(c);
+    padFrames = 0;
+    sink->SetRate(c->rate);
+    sink->SetBitsPerSample(16);
+    sink->SetChannels(1);
+    sink->begin();
+    isPlaying = true;
+  }
+
+  // Scheduled cue: pre-empt the current sound when the instant is close
+  void serviceCue() {
+    int32_t untilUs = (int32_t)(cueAtUs - micros());
+    const PcmClip* c = findClip(cueName);
+    if (untilUs > (c ? AUDIO_CUE_PREROLL_US : 0)) return;
+
+    if (isPlaying || draining) cut();
+
+    const char* name = cueName;
+    cueName = nullptr;
+    playingPri = AUDIO_PRI_CRITICAL;
+    playingScene = scene;
+    if (!c) {
+      startSound(name);
+      return;
+    }
+    beginClip(c);
+    // Silence up to the instant, minus what the idle DMA adds on its own
+    int32_t frames = untilUs > 0 ? (int32_t)((int64_t)untilUs * c->rate / 1000000) - AUDIO_DMA_LEAD_FRAMES : 0;
+    padFrames = frames > 0 ? frames : 0;
+  }
+
+  // Push the current sound into sink; false once it has finished
+  bool render() {
+    if (clip) {
+      int16_t s[2];
+      s[0] = s[1] = 0;
+      while (padFrames) {
+        if (!sink->ConsumeSample(s)) return true;
+        padFrames--;
+      }
+      while (!voice.done()) {
+        s[0] = s[1] = voice.peek();
+        if (!sink->ConsumeSample(s)) return true;
+        voice.advance();
+      }
+      return false;
+    }
+    return mp3->isRunning() && mp3->loop();
+  }
+
+  void endSound() {
+    if (clip) {
+      clip = nullptr;
+      sink->stop();
+    } else if (mp3->isRunning()) {
       mp3->stop();
     }
+    file->close();
     isPlaying = false;
+  }
+
+  // clipMs() without the boot check
+  uint32_t clipLen(const char* filename) {
+    const PcmClip* c = pack.find(filename);
+    if (c) return (uint32_t)((uint64_t)c->samples * 1000 / c->rate);
+    for (uint8_t i = 0; i < lenCount; i++) {
+      if (lens[i].name == filename || strcmp(lens[i].name, filename) == 0) return lens[i].ms;
+    }
+    Mp3Info info;
+    uint32_t ms = mp3ReadInfo(filename, info) ? info.durationMs : 0;
+    if (lenCount < AUDIO_CLIP_LEN_SLOTS) {
+      lens[lenCount].name = filename;
+      lens[lenCount].ms = ms;
+      lenCount++;
+    }
+    return ms;
+  }
+
+  // SPIFFS, then the sound pack or the PCM cache, and every clip's length.
+  // No format on a failed mount: it would take seconds and the sounds
+  // would be gone anyway.
+  bool mountAssets() {
+    const uint32_t startMs = millis();
+    if (!SPIFFS.begin(false)) {
+      LOGW(LOG_AUDIO, "[AUDIO] SPIFFS mount failed - no sounds\n");
+      cacheNext = AUDIO_CACHED_COUNT;
+      return false;
+    }
+    if (pack.begin()) {
+      cacheNext = AUDIO_CACHED_COUNT;  // nothing left to decode
+      LOGI(LOG_AUDIO, "[AUDIO] Sound pack: %d clips, %lu bytes mapped\n", pack.size(),
+           (unsigned long)pack.bytesMapped());
+    } else {
+      LOGI(LOG_AUDIO, "[AUDIO] No sound pack, streaming MP3 from SPIFFS\n");
+      if (!cache.begin()) LOGW(LOG_AUDIO, "[AUDIO] No memory for the PCM cache, every clip streams\n");
+      for (uint8_t i = 0; i < AUDIO_ALL_COUNT; i++) clipLen(AUDIO_ALL_SOUNDS[i]);
+    }
+    assetsReady = true;
+    LOGI(LOG_AUDIO, "[AUDIO] Assets ready in %lu ms\n", (unsigned long)(millis() - startMs));
+    return true;
+  }
+
+  // Decode the next AUDIO_CACHED_SOUNDS entry (decoder must be idle)
+  void cacheStep() {
+    const char* name = AUDIO_CACHED_SOUNDS[cacheNext++];
+    if (cache.load(name, mp3, file)) {
+      LOGI(LOG_AUDIO, "[AUDIO] Cached %s (%lu bytes used, %s)\n", name,
+           (unsigned long)cache.bytesUsed(), cache.inPsram() ? "PSRAM" : "DRAM");
+    } else {
+      LOGW(LOG_AUDIO, "[AUDIO] %s not cached, will stream\n", name);
+    }
+  }
+
+#if AUDIO_USE_TASK
+  void addPrefetch(const char* name) {
+    for (uint8_t i = 0; i < prefetchCount; i++) {
+      if (prefetchList[i] == name) return;
+    }
+    if (prefetchCount < AUDIO_PREFETCH_QUEUE) prefetchList[prefetchCount++] = name;
+  }
+
+  // Decode the oldest prefetch request into a spare slot (decoder must be idle)
+  void prefetchStep() {
+    const char* name = prefetchList[0];
+    prefetchCount--;
+    for (uint8_t i = 0; i < prefetchCount; i++) prefetchList[i] = prefetchList[i + 1];
+    if (cache.loadSpare(name, mp3, file)) {
+      LOGD(LOG_AUDIO, "[AUDIO] Prefetched %s\n", name);
+    } else {
+      LOGD(LOG_AUDIO, "[AUDIO] %s not prefetched, will stream\n", name);
+    }
+  }
+#endif
+
+  void halt() {
+    if (isPlaying) endSound();
+    cueName = nullptr;
     lastSoundEndTime = 0;  // Reset so next sound plays immediately
     // Clear queue
-    queueHead = queueTail = 0;
+    queueCount = 0;
   }
-  
-  // Check if playing
-  bool playing() const {
-    return isPlaying;
+
+#if AUDIO_USE_TASK
+  // ---- loop() side ----
+  void post(AudioCmdOp op, const char* filename, uint32_t arg, AudioPriority pri = AUDIO_PRI_ANNOUNCE) {
+    AudioCmd c;
+    c.op = op;
+    c.pri = pri;
+    c.file = filename;
+    c.arg = arg;
+    if (!cmds.push(c)) cmdDrops++;
   }
-  
-  // Set gap between sounds in ms (default 250ms)
-  void setSoundGap(unsigned long gapMs) {
-    soundGap = gapMs;
+
+  // ---- Audio task ----
+  static void taskEntry(void* arg) {
+    static_cast<AudioManager*>(arg)->taskRun();
   }
 
-private:
+  void taskRun() {
+    mountAssets();  // commands queue up meanwhile
+    bool dry = false;
+    for (;;) {
+      taskMeter.start();
+      AudioCmd c;
+      while (cmds.pop(c)) {
+        switch (c.op) {
+          case AUDIO_CMD_PLAY: enqueue(c.file, c.pri); break;
+          case AUDIO_CMD_SCENE: enterScene((uint8_t)c.arg); break;
+          case AUDIO_CMD_PLAY_AT:
+            cueName = c.file;
+            cueAtUs = c.arg;
+            break;
+          case AUDIO_CMD_GAP:  soundGap = c.arg; break;
+          case AUDIO_CMD_PREFETCH: addPrefetch(c.file); break;
+          case AUDIO_CMD_STOP:
+            if (isPlaying || draining) out->stop();  // silence what DMA still holds
+            halt();
+            ring->clear();
+            draining = false;
+            break;
+        }
+      }
+
+      if (cueName) serviceCue();
+      if (!isPlaying && !draining) {
+        startNext();
+        // Nothing to play: use the idle decoder to fill the cache, then for lookahead
+        if (!isPlaying && queueCount == 0 && !cueName) {
+          if (cacheNext < AUDIO_CACHED_COUNT) cacheStep();
+          else if (prefetchCount) prefetchStep();
+        }
+      }
+
+      ring->pump();
+      // Ring empty mid-sound: the decoder fell behind and DMA is running dry
+      bool empty = ring->buffered() == 0;
+      if (isPlaying && empty && !dry) underruns++;
+      dry = isPlaying && empty;
+
+      // One pass fills until the ring refuses a sample
+      if (isPlaying && ring->space() >= AUDIO_MP3_FRAME) {
+        if (!render()) {
+          endSound();
+          draining = true;
+        }
+        ring->pump();
+      }
+
+      // Last PCM handed to DMA: the sound has ended, start the gap
+      if (draining && ring->buffered() == 0) {
+        out->stop();
+        draining = false;
+        lastSoundEndTime = millis();
+      }
+
+      taskMeter.stop();
+      vTaskDelay(pdMS_TO_TICKS(AUDIO_TASK_PERIOD));
+    }
+  }
+#endif
+
   AudioGeneratorMP3 *mp3;
+  void* mp3Space = nullptr;      // AudioGeneratorMP3::preAllocSize(), the decoder's only buffers
   AudioFileSourceSPIFFS *file;
   AudioOutputI2S *out;
-  
-  const char* queue[AUDIO_QUEUE_SIZE];
-  uint8_t queueHead;
-  uint8_t queueTail;
-  
-  bool isPlaying;
+  AudioOutputPcmRing *ring;      // task mode only
+  AudioOutput *sink;             // where sounds are rendered: ring, or out directly
+
+  volatile bool assetsReady = false;  // mountAssets() done: pack, cache and lens[] are set
+  AudioPack pack;                // flash-mapped clips (all sounds when present)
+  AudioCache cache;              // MP3 fallback: decoded cues in RAM
+  const PcmClip *clip;           // packed/cached sound playing, or nullptr (MP3 / idle)
+  ClipVoice voice;
+  uint32_t padFrames = 0;        // silence still to send before clip (scheduled start)
+  uint8_t cacheNext = 0;         // next AUDIO_CACHED_SOUNDS entry to decode
+  const char* prefetchList[AUDIO_PREFETCH_QUEUE];  // task mode: waiting for the idle decoder
+  uint8_t prefetchCount = 0;
+
+  const char* cueName = nullptr; // pending queueSoundAt() clip
+  uint32_t cueAtUs = 0;
+
+  struct QueueEntry {
+    const char* file;
+    AudioPriority pri;
+    uint8_t scene;     // game state it was queued in
+    uint32_t seq;      // FIFO order within a priority
+  };
+  QueueEntry queue[AUDIO_QUEUE_SIZE];  // unordered; startNext() picks
+  uint8_t queueCount;
+  uint32_t nextSeq = 0;
+  uint8_t scene = 0;
+  AudioPriority playingPri = AUDIO_PRI_AMBIENT;
+  uint8_t playingScene = 0;
+  volatile uint32_t qDropped = 0;    // written by the playlist owner, read by update()
+  volatile uint32_t qMerged = 0;
+  volatile uint32_t qExpired = 0;
+  volatile uint32_t qPreempted = 0;
+  uint32_t qDroppedReported = 0;
+  uint32_t qMergedReported = 0;
+  uint32_t qExpiredReported = 0;
+  uint32_t qPreemptedReported = 0;
+
+  volatile bool isPlaying;
+  volatile bool draining = false; // decode finished, ring still playing (task mode)
   unsigned long soundGap;        // ms gap between queued sounds
   unsigned long lastSoundEndTime; // when the last sound finished
+
+  SpscQueue<AudioCmd, AUDIO_CMD_QUEUE_SIZE> cmds;  // loop() -> audio task
+  TaskHandle_t task = nullptr;
+  TaskMeter taskMeter;
+  volatile uint32_t underruns = 0;
+  uint32_t underrunsReported = 0;
+  uint32_t cmdDrops = 0;
+  uint32_t cmdDropsReported = 0;
+
+  // loop() side planning
+  struct ClipLen { const char* name; uint32_t ms; };
+  ClipLen lens[AUDIO_CLIP_LEN_SLOTS];
+  uint8_t lenCount = 0;
+  struct PlanItem { unsigned long endMs; AudioPriority pri; };
+  PlanItem plan[AUDIO_QUEUE_SIZE + 1];  // queued clips' estimated end times, in order
+  uint8_t planCount = 0;
+  unsigned long busyUntilMs = 0;
+  unsigned long plannedGap = DEFAULT_SOUND_GAP;
 };
 
 #endif // AUDIO_MANAGER_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+ * AudioPack.h - Pre-encoded sound pack in its own flash partition
+ * ESP32 Host
+ *
+ * pack_audio.py turns the MP3s in data/ into one image (16-bit PCM for the
+ * timing-critical cues, IMA-ADPCM for the rest) and `pio run -t
+ * uploadaudio` writes it to the "audio" partition (partitions.csv). At
+ * boot the partition is memory-mapped once; after that playing a clip is
+ * an index lookup by its SND_* path and a pointer into flash - no file
+ * open, no MP3 decoder.
+ *
+ * Layout (little-endian, every clip 4-byte aligned):
+ *   PackHeader | PackEntry[count] | clip data...
+ *
+ * No partition, wrong magic/version or a bad index CRC: begin() returns
+ * false and AudioManager streams the MP3s from SPIFFS as before.
+ */
+
+#ifndef AUDIO_PACK_H
+#define AUDIO_PACK_H
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#include <rom/crc.h>
+#include "AudioCache.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define AUDIO_PACK_LABEL     "audio"
+#define AUDIO_PACK_SUBTYPE   0x40         // custom data subtype (partitions.csv)
+#define AUDIO_PACK_MAGIC     0x4B505452UL // "RTPK"
+#define AUDIO_PACK_VERSION   1
+#define AUDIO_PACK_MAX_CLIPS 32
+#define AUDIO_PACK_NAME_LEN  24
+
+// =============================================================================
+// ON-FLASH FORMAT (must match pack_audio.py)
+// =============================================================================
+struct PackHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;       // entries
+  uint32_t size;        // whole image in bytes
+  uint32_t indexCrc;    // CRC32 (crc32_le, seed 0) of the entry table
+};
+
+struct PackEntry {
+  char name[AUDIO_PACK_NAME_LEN];  // SND_* path, NUL-padded
+  uint32_t offset;      // from the start of the image
+  uint32_t bytes;
+  uint32_t samples;
+  uint16_t rate;        // Hz
+  uint8_t format;       // ClipFormat
+  uint8_t reserved;
+};
+
+static_assert(sizeof(PackHeader) == 16, "PackHeader layout is shared with pack_audio.py");
+static_assert(sizeof(PackEntry) == 40, "PackEntry layout is shared with pack_audio.py");
+
+// =============================================================================
+// PACK
+// =============================================================================
+class AudioPack {
+public:
+  // Map the partition and check the index; false = no usable pack
+  bool begin() {
+    const esp_partition_t* part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)AUDIO_PACK_SUBTYPE, AUDIO_PACK_LABEL);
+    if (!part) return false;
+
+    const void* ptr = nullptr;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle) != ESP_OK) return false;
+#else
+    if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK) return false;
+#endif
+    base = (const uint8_t*)ptr;
+
+    const PackHeader* h = (const PackHeader*)base;
+    const PackEntry* e = (const PackEntry*)(base + sizeof(PackHeader));
+    uint32_t indexBytes = h->count * sizeof(PackEntry);
+    if (h->magic != AUDIO_PACK_MAGIC || h->version != AUDIO_PACK_VERSION ||
+        h->count > AUDIO_PACK_MAX_CLIPS || h->size > part->size ||
+        sizeof(PackHeader) + indexBytes > h->size ||
+        crc32_le(0, (const uint8_t*)e, indexBytes) != h->indexCrc) {
+      unmap();
+      return false;
+    }
+
+    for (uint16_t i = 0; i < h->count; i++) {
+      if (e[i].offset + e[i].bytes > h->size || e[i].format > CLIP_ADPCM || e[i].rate == 0 ||
+          e[i].name[AUDIO_PACK_NAME_LEN - 1] != '\0') continue;
+      PcmClip &c = clips[count++];
+      c.name = e[i].name;
+      c.data = base + e[i].offset;
+      c.samples = e[i].samples;
+      c.rate = e[i].rate;
+      c.format = (ClipFormat)e[i].format;
+    }
+    bytes = h->size;
+    return true;
+  }
+
+  const PcmClip* find(const char* name) const {
+    for (uint8_t i = 0; i < count; i++) {
+      if (strcmp(clips[i].name, name) == 0) return &clips[i];
+    }
+    return nullptr;
+  }
+
+  uint8_t size() const { return count; }
+  uint32_t bytesMapped() const { return bytes; }
+
+private:
+  void unmap() {
+    spi_flash_munmap(handle);
+    base = nullptr;
+  }
+
+  const uint8_t* base = nullptr;
+  spi_flash_mmap_handle_t handle = 0;
+  PcmClip clips[AUDIO_PACK_MAX_CLIPS];
+  uint8_t count = 0;
+  uint32_t bytes = 0;
+};
+
+#endif // AUDIO_PACK_H
@@ -0,0 +1,81 @@
+/*
+ * BootProfile.h - Time spent in each setup() stage, and why we booted
+ * ESP32 Host
+ *
+ * setup() calls mark() at the end of every stage; micros() counts from the
+ * app's start, so the first stage includes the core's own startup (not the
+ * ROM and the bootloader). report() prints each stage and the total once
+ * the scheduler is about to take over; `boot` on the serial console prints
+ * it again.
+ *
+ * warm() is false only after a power-on: a brownout, panic, watchdog or
+ * software reset leaves RTC memory as it was, so setup() may reuse what an
+ * earlier boot kept there (ChannelScan::keep()) instead of redoing it.
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define BOOT_STAGES_MAX   12
+
+class BootProfile {
+public:
+  void begin() { reason = esp_reset_reason(); }
+
+  // stage: string literal
+  void mark(const char* stage) {
+    if (count >= BOOT_STAGES_MAX) return;
+    stages[count].name = stage;
+    stages[count].us = micros();
+    count++;
+  }
+
+  bool warm() const { return reason != ESP_RST_POWERON && reason != ESP_RST_UNKNOWN; }
+
+  void report() const {
+    const uint32_t total = count ? stages[count - 1].us : 0;
+    LOGI(LOG_BOOT, "[BOOT] %s reset, %s boot, ready %lu.%lu ms after start\n", reasonName(),
+         warm() ? "warm" : "cold", (unsigned long)(total / 1000), (unsigned long)(total % 1000) / 100);
+    uint32_t last = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      const uint32_t us = stages[i].us - last;
+      last = stages[i].us;
+      LOGI(LOG_BOOT, "[BOOT]   %-8s %5lu.%lu ms\n", stages[i].name,
+           (unsigned long)(us / 1000), (unsigned long)(us % 1000) / 100);
+    }
+  }
+
+private:
+  const char* reasonName() const {
+    switch (reason) {
+      case ESP_RST_POWERON:  return "power-on";
+      case ESP_RST_EXT:      return "external";
+      case ESP_RST_SW:       return "software";
+      case ESP_RST_PANIC:    return "panic";
+      case ESP_RST_INT_WDT:
+      case ESP_RST_TASK_WDT:
+      case ESP_RST_WDT:      return "watchdog";
+      case ESP_RST_DEEPSLEEP: return "deep sleep";
+      case ESP_RST_BROWNOUT: return "brownout";
+      default:               return "unknown";
+    }
+  }
+
+  struct Stage {
+    const char* name;
+    uint32_t us;
+  };
+
+  Stage stages[BOOT_STAGES_MAX];
+  uint8_t count = 0;
+  esp_reset_reason_t reason = ESP_RST_UNKNOWN;
+};
+
+#endif // BOOT_PROFILE_H
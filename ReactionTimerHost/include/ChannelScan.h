@@ -0,0 +1,138 @@
+/*
+ * ChannelScan.h - Boot-time channel occupancy scan (CHANNEL SELECTION in Protocol.h)
+ * ESP32 Host
+ *
+ * start() begins one WiFi scan of CHANNEL_FIRST..CHANNEL_LAST; once it is
+ * done, poll() scores every channel by the access points heard on it and
+ * its neighbours: a 2.4 GHz channel is 20 MHz wide on a 5 MHz grid, so an
+ * AP on channel n is felt on n-3..n+3, less the further away. best() is the lowest score; penalize()
+ * pushes a channel we had to leave to the back so a move never picks it
+ * again straight away.
+ *
+ * The scan runs in the background for about CHANNEL_LAST *
+ * SCAN_MS_PER_CHANNEL ms and takes the radio off channel meanwhile, so the
+ * host starts it once it is up and idle, on the default channel, and
+ * moves there afterwards the way a loss move goes (beacons first). The
+ * radio may be left on the last channel scanned: put it back after poll().
+ *
+ * keep() copies the scores and the channel in use into RTC memory, which a
+ * reset other than power-on leaves alone; restore() takes them back so a
+ * warm boot (BootProfile.h) skips the scan and comes up where the sticks
+ * already are.
+ */
+
+#ifndef CHANNEL_SCAN_H
+#define CHANNEL_SCAN_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Protocol.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SCAN_MS_PER_CHANNEL  120    // active scan dwell per channel
+#define SCAN_RSSI_FLOOR      -95    // dBm: weaker APs don't count
+#define SCAN_SPREAD          4      // AP weight on channel n+k: (SCAN_SPREAD - |k|) / SCAN_SPREAD
+#define SCAN_MOVE_PENALTY    100000 // added to a channel left because of loss
+#define SCAN_KEPT_MAGIC      0x43534B31UL   // "CSK1"
+
+// Survives resets other than power-on (RTC slow memory)
+struct ChannelScanKept {
+  uint32_t magic;
+  uint32_t scores[CHANNEL_LAST + 1];
+  int16_t apCount;
+  uint8_t channel;
+  uint32_t check;
+};
+
+static RTC_NOINIT_ATTR ChannelScanKept channelScanKept;
+
+class ChannelScan {
+public:
+  // Returns at once; false when the scan could not start
+  bool start() {
+    return WiFi.scanNetworks(true, true, false, SCAN_MS_PER_CHANNEL) == WIFI_SCAN_RUNNING;
+  }
+
+  // False while the scan runs; then true once, with the scores set.
+  // A failed scan counts as no access points heard.
+  bool poll() {
+    const int16_t n = WiFi.scanComplete();
+    if (n == WIFI_SCAN_RUNNING) return false;
+    memset(scores, 0, sizeof(scores));
+    apCount = n > 0 ? n : 0;
+    for (int16_t i = 0; i < apCount; i++) addAp(WiFi.channel(i), WiFi.RSSI(i));
+    WiFi.scanDelete();
+    return true;
+  }
+
+  int16_t accessPoints() const { return apCount; }
+
+  // Quietest channel; ties go to ESPNOW_CHANNEL (the old fixed one), then the lower channel
+  uint8_t best() const {
+    uint8_t pick = ESPNOW_CHANNEL;
+    for (uint8_t ch = CHANNEL_FIRST; ch <= CHANNEL_LAST; ch++) {
+      if (scores[ch] < scores[pick]) pick = ch;
+    }
+    return pick;
+  }
+
+  void penalize(uint8_t ch) {
+    if (ch >= CHANNEL_FIRST && ch <= CHANNEL_LAST) scores[ch] += SCAN_MOVE_PENALTY;
+  }
+
+  uint32_t score(uint8_t ch) const {
+    return ch >= CHANNEL_FIRST && ch <= CHANNEL_LAST ? scores[ch] : UINT32_MAX;
+  }
+
+  // The channel we're on now, for the next warm boot
+  void keep(uint8_t channel) {
+    channelScanKept.magic = SCAN_KEPT_MAGIC;
+    memcpy(channelScanKept.scores, scores, sizeof(scores));
+    channelScanKept.apCount = apCount;
+    channelScanKept.channel = channel;
+    channelScanKept.check = checksum(channelScanKept);
+  }
+
+  // False (and nothing changed) when RTC memory holds no intact copy
+  bool restore(uint8_t &channel) {
+    const ChannelScanKept &k = channelScanKept;
+    if (k.magic != SCAN_KEPT_MAGIC || k.check != checksum(k)) return false;
+    if (k.channel < CHANNEL_FIRST || k.channel > CHANNEL_LAST) return false;
+    memcpy(scores, k.scores, sizeof(scores));
+    apCount = k.apCount;
+    channel = k.channel;
+    return true;
+  }
+
+  void dump() const {
+    LOGI(LOG_NET, "[CHAN] %d access points at boot, best channel %d\n", apCount, best());
+    for (uint8_t ch = CHANNEL_FIRST; ch <= CHANNEL_LAST; ch++) {
+      LOGI(LOG_NET, "[CHAN]   channel %2d: score %lu\n", ch, (unsigned long)scores[ch]);
+    }
+  }
+
+private:
+  static uint32_t checksum(const ChannelScanKept &k) {
+    uint32_t h = k.magic ^ ((uint32_t)(uint16_t)k.apCount << 8) ^ k.channel;
+    for (uint8_t ch = 0; ch <= CHANNEL_LAST; ch++) h = (h << 5 | h >> 27) ^ k.scores[ch];
+    return h;
+  }
+
+  void addAp(int32_t ch, int32_t rssi) {
+    if (rssi <= SCAN_RSSI_FLOOR) return;
+    const uint32_t w = (uint32_t)(rssi - SCAN_RSSI_FLOOR);
+    for (int32_t k = 1 - SCAN_SPREAD; k < SCAN_SPREAD; k++) {
+      int32_t c = ch + k;
+      if (c < CHANNEL_FIRST || c > CHANNEL_LAST) continue;
+      scores[c] += w * (SCAN_SPREAD - abs(k)) / SCAN_SPREAD;
+    }
+  }
+
+  uint32_t scores[CHANNEL_LAST + 1] = {};
+  int16_t apCount = 0;
+};
+
+#endif // CHANNEL_SCAN_H
@@ -0,0 +1,87 @@
+/*
+ * CollectPolicy.h - When a reaction round's COLLECT may end
+ * Part of GameCore: fed every valid reaction at results, asked every step.
+ *
+ *   COLLECT_FULL      wait for every active player, up to TIMEOUT_REACTION
+ *                     and as long again in the yellow warning
+ *   COLLECT_DECIDED   also end the round once nobody still out can win it
+ *   COLLECT_ADAPTIVE  also cut both waits to what the players still out
+ *                     have needed lately (default)
+ *
+ * Decided: a press is timed by the stick from GO, so once the leader's
+ * time plus COLLECT_SETTLE_MS (a result's worst trip, ResultLink.h
+ * retries included) has passed since GO, any result still to come is
+ * slower than the leader's. Those players are out of the round without a
+ * time; a penalty never leads.
+ *
+ * Adaptive: each slot keeps its last COLLECT_HISTORY valid reactions this
+ * game. Its timeout is twice the slowest of them plus the settle time,
+ * kept within COLLECT_MIN_TIMEOUT_MS..TIMEOUT_REACTION; with fewer than
+ * COLLECT_HISTORY_MIN it is the full TIMEOUT_REACTION. The round waits for
+ * the longest timeout among the players still out, and the yellow warning
+ * lasts as long again. History is per game: a tournament match has new
+ * people on the same sticks.
+ */
+
+#ifndef COLLECT_POLICY_H
+#define COLLECT_POLICY_H
+
+#include <stdint.h>
+#include "GameTypes.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define COLLECT_SETTLE_MS       250     // in flight after the press: radio + result retries
+#define COLLECT_HISTORY         8       // reactions remembered per slot
+#define COLLECT_HISTORY_MIN     2       // fewer: full timeout
+#define COLLECT_MIN_TIMEOUT_MS  1500    // adaptive floor (someone distracted once)
+
+enum CollectPolicy : uint8_t {
+  COLLECT_FULL,
+  COLLECT_DECIDED,
+  COLLECT_ADAPTIVE,
+  COLLECT_POLICY_COUNT
+};
+
+#ifndef COLLECT_POLICY
+#define COLLECT_POLICY          COLLECT_ADAPTIVE
+#endif
+
+static const char* const COLLECT_POLICY_NAMES[COLLECT_POLICY_COUNT] = {"full", "decided", "adaptive"};
+
+class ReactionHistory {
+public:
+  void reset() {
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      count[i] = 0;
+      next[i] = 0;
+    }
+  }
+
+  void add(uint8_t slot, uint32_t ms) {
+    if (slot >= MAX_PLAYERS) return;
+    recent[slot][next[slot]] = ms > 0xFFFF ? 0xFFFF : (uint16_t)ms;
+    next[slot] = (next[slot] + 1) % COLLECT_HISTORY;
+    if (count[slot] < COLLECT_HISTORY) count[slot]++;
+  }
+
+  // How long this slot's player gets to press after GO
+  uint32_t timeoutMs(uint8_t slot) const {
+    if (slot >= MAX_PLAYERS || count[slot] < COLLECT_HISTORY_MIN) return TIMEOUT_REACTION;
+    uint32_t slowest = 0;
+    for (uint8_t i = 0; i < count[slot]; i++) {
+      if (recent[slot][i] > slowest) slowest = recent[slot][i];
+    }
+    const uint32_t t = 2 * slowest + COLLECT_SETTLE_MS;
+    if (t < COLLECT_MIN_TIMEOUT_MS) return COLLECT_MIN_TIMEOUT_MS;
+    return t > TIMEOUT_REACTION ? TIMEOUT_REACTION : t;
+  }
+
+private:
+  uint16_t recent[MAX_PLAYERS][COLLECT_HISTORY];
+  uint8_t count[MAX_PLAYERS] = {};
+  uint8_t next[MAX_PLAYERS] = {};
+};
+
+#endif // COLLECT_POLICY_H
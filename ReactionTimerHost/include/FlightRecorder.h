@@ -0,0 +1,136 @@
+/*
+ * FlightRecorder.h - Always-on event ring in RTC memory (FlightLog.h)
+ * ESP32 Host
+ *
+ * record() is a micros(), an atomic increment and three word stores into
+ * RTC slow memory: cheap enough to leave on in every build, from loop()
+ * and from the WiFi task alike. What goes in: game state changes, every
+ * frame handed to the radio and every one the receive callback sees, MAC
+ * failures, ACK resends and give-ups, rx queue overflows and scheduler
+ * budget overruns - the trail a stall or a lost packet leaves.
+ *
+ * The ring needs no clearing and isn't cleared: a reset other than
+ * power-on (BootProfile::warm()) keeps it, and begin() copies what the
+ * last boot left into the heap before this one writes over it. `flight`
+ * on the serial console prints the ring (earlier boots' events follow on
+ * from a BOOT line), `flight prev` the copy; dumpJob() feeds a few lines
+ * per run to the async log so a dump never fills it.
+ *
+ * kept.head is stored after the record it counts; two cores recording at
+ * once can leave it one short, so a reset may lose the very last event.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "FlightLog.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define FLIGHT_RECORDS      512          // power of 2: 4 KB of the 8 KB RTC slow memory
+#define FLIGHT_DUMP_LINES   8            // per dumpJob() run, well inside LOG_DRAIN_BUDGET
+#define FLIGHT_KEPT_MAGIC   0x464C5231UL // "FLR1"
+
+// Survives resets other than power-on (RTC slow memory)
+struct FlightKept {
+  uint32_t magic;
+  uint32_t head;        // events recorded since the last cold boot
+  uint32_t boots;       // warm boots since then
+  FlightRecord rec[FLIGHT_RECORDS];
+};
+
+static RTC_NOINIT_ATTR FlightKept flightKept;
+
+class FlightRecorder {
+public:
+  // First thing in setup(); reason = esp_reset_reason()
+  void begin(bool warm, uint8_t reason) {
+    if (warm && flightKept.magic == FLIGHT_KEPT_MAGIC) {
+      keep();
+      flightKept.boots++;
+    } else {
+      flightKept.magic = FLIGHT_KEPT_MAGIC;
+      flightKept.head = 0;
+      flightKept.boots = 0;
+    }
+    head.store(flightKept.head, std::memory_order_relaxed);
+    record(FL_BOOT, reason, (uint16_t)flightKept.boots);
+  }
+
+  void record(uint8_t type, uint8_t a, uint16_t b) {
+    const uint32_t us = micros();
+    const uint32_t i = head.fetch_add(1, std::memory_order_relaxed);
+    FlightRecord &r = flightKept.rec[i & (FLIGHT_RECORDS - 1)];
+    r.us = us;
+    r.word = flightWord(type, a, b);
+    flightKept.head = i + 1;
+  }
+
+  // Frame header: [1] dest, [2] src, [3] cmd for every frame type
+  void frame(uint8_t type, const uint8_t* data, size_t len, bool outgoing) {
+    if (len < 4) return;
+    record(type, data[3], (uint16_t)(outgoing ? data[1] : data[2]) | (uint16_t)len << 8);   // ESP-NOW: len <= 250
+  }
+
+  // What begin() kept from before the reset
+  uint16_t keptCount() const { return prevCount; }
+
+  // Serial command: previous = the copy taken at boot
+  void startDump(bool previous) {
+    dumpPrev = previous;
+    if (previous) {
+      dumpNext = 0;
+      dumpEnd = prevCount;
+      if (!prevCount) {
+        LOGI(LOG_FLIGHT, "[FLIGHT] Nothing kept from before this boot\n");
+        return;
+      }
+    } else {
+      dumpEnd = head.load(std::memory_order_relaxed);
+      dumpNext = dumpEnd > FLIGHT_RECORDS ? dumpEnd - FLIGHT_RECORDS : 0;
+    }
+    LOGI(LOG_FLIGHT, "[FLIGHT] %lu events%s, oldest first\n", (unsigned long)(dumpEnd - dumpNext),
+         previous ? " from before the reset" : "");
+    dumping = true;
+  }
+
+  // Job: a few dump lines per run
+  void dumpJob() {
+    if (!dumping) return;
+    for (uint8_t n = 0; n < FLIGHT_DUMP_LINES && dumpNext != dumpEnd; n++, dumpNext++) {
+      const FlightRecord r = dumpPrev ? prev[dumpNext] : flightKept.rec[dumpNext & (FLIGHT_RECORDS - 1)];
+      unsigned args[3];
+      const char* fmt = flightDecode(r, args);
+      LOGI(LOG_FLIGHT, fmt, (unsigned long)r.us, args[0], args[1], args[2]);
+    }
+    if (dumpNext == dumpEnd) dumping = false;
+  }
+
+private:
+  // The last boot's ring, oldest first, before this boot overwrites it
+  void keep() {
+    const uint32_t end = flightKept.head;
+    const uint32_t start = end > FLIGHT_RECORDS ? end - FLIGHT_RECORDS : 0;
+    if (end == start) return;
+    prev = (FlightRecord*)malloc((end - start) * sizeof(FlightRecord));
+    if (!prev) return;
+    for (uint32_t i = start; i != end; i++) prev[i - start] = flightKept.rec[i & (FLIGHT_RECORDS - 1)];
+    prevCount = (uint16_t)(end - start);
+  }
+
+  std::atomic<uint32_t> head{0};   // DRAM: the RTC copy can't take an atomic
+  FlightRecord* prev = nullptr;    // begin(): the ring as the reset left it
+  uint16_t prevCount = 0;
+  bool dumping = false;
+  bool dumpPrev = false;
+  uint32_t dumpNext = 0;
+  uint32_t dumpEnd = 0;
+};
+
+extern FlightRecorder flightRecorder;  // defined in main.cpp
+
+#endif // FLIGHT_RECORDER_H
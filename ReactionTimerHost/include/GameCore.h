@@ -0,0 +1,1235 @@
+/*
+ * GameCore.h - Host game state machine, independent of the hardware
+ * ESP32 Host (and the native simulator, sim/)
+ *
+ * Join, rounds, results, scores and deuce all live here. The outside world
+ * comes in through four small interfaces:
+ *   GameClock  millis()/micros() time and random picks
+ *   GameRadio  commands to sticks and display (ACK'd, batched, the GO broadcast)
+ *   GameLeds   ring mode changes, the countdown flash, the GO freeze
+ *   GameAudio  AudioManager's queueing calls
+ * main.cpp implements them on the real peripherals; sim/GameSim.cpp on a
+ * virtual clock and scripted sticks, so whole games run in microseconds.
+ *
+ * step() is the game job and runCues() the timeline job. Received packets
+ * come in decoded by handlePacket(): onJoinRequest(), onShakeProgress(),
+ * onResult(). The ring view (neoMode, ringOverride, ...) is public for the
+ * LED renderer, colors as 0xRRGGBB. Owned by loop(): nothing here is
+ * thread-safe.
+ *
+ * With a tournament running (tour, Tournament.h) a game is one match:
+ * TOUR_MATCH_ROUNDS rounds, no deuce, and FINAL_WINNER goes back to JOIN
+ * without the idle screen. The sticks bound at the first join keep their
+ * slots; JOIN becomes a changeover that seats the next entrants and starts
+ * when every seated stick has pressed, or after TOUR_CHANGEOVER_MS.
+ *
+ * A reaction round's COLLECT ends by collectPolicy (CollectPolicy.h): as
+ * soon as the winner is certain, and after timeouts learned from the
+ * players' own recent reactions.
+ */
+
+#ifndef GAME_CORE_H
+#define GAME_CORE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "Protocol.h"
+#include "GameTypes.h"
+#include "Sounds.h"
+#include "Timeline.h"
+#include "ShakeTrack.h"
+#include "Tournament.h"
+#include "CollectPolicy.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define PROMPT_DURATION          5000   // ms per player slot prompt during JOIN
+#define COUNTDOWN_TICK_US        1000000UL  // 3, 2, 1, GO
+#define COUNTDOWN_START_GAP      DEFAULT_SOUND_GAP  // ms between the announcements and "3"
+#define STICK_CUE_LEAD_US        80000  // CMD_CUE_AT goes out this far ahead (< CUE_MAX_LEAD_US)
+
+enum HostGameState : uint8_t {
+  STATE_IDLE,
+  STATE_JOIN,
+  STATE_COUNTDOWN,
+  STATE_REACTION,       // waiting for random delay, then fires GO
+  STATE_SHAKE,          // GO already fired, waiting for shake results
+  STATE_COLLECT,        // polling joysticks for results
+  STATE_SHOW_RESULTS,
+  STATE_FINAL_WINNER
+};
+
+// One round of the game plan: picked when the join completes
+struct RoundPlan {
+  uint8_t mode;         // MODE_REACTION / MODE_SHAKE
+  uint8_t delayIdx;     // REACT_DELAYS (reaction)
+  uint8_t targetIdx;    // SHAKE_TARGETS (shake)
+};
+
+// Joystick identity colors (by joystick ID: 1=White, 2=Blue, 3=Red, 4=Yellow, ...),
+// repeating past the eighth stick
+inline uint32_t stickColor(uint8_t stickId) {
+  static const uint32_t palette[] = {COLOR_WHITE, COLOR_BLUE, COLOR_RED, COLOR_YELLOW,
+                                     COLOR_CYAN, COLOR_MAGENTA, COLOR_ORANGE, COLOR_PURPLE};
+  if (!isStickId(stickId)) return COLOR_GREEN;
+  return palette[stickIndex(stickId) % (sizeof(palette) / sizeof(palette[0]))];
+}
+
+// =============================================================================
+// INTERFACES
+// =============================================================================
+class GameClock {
+public:
+  virtual uint32_t nowMs() = 0;
+  virtual uint32_t nowUs() = 0;
+  virtual uint32_t random(uint32_t max) = 0;    // 0 .. max-1
+};
+
+class GameRadio {
+public:
+  virtual void broadcast(uint8_t cmd, uint16_t data) = 0;   // every stick, no ACK
+  virtual void sendWithRetry(uint8_t destId, uint8_t cmd, uint16_t data) = 0;
+  virtual void sendGO(uint32_t goUs) = 0;       // broadcast, tracked for every active stick
+  virtual bool timedCues(uint8_t stickId) = 0;  // stick holds CMD_CUE_AT pulses (TIMED CUES)
+  virtual void displayBatchBegin() = 0;
+  virtual void displayBatchAdd(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) = 0;
+  virtual void displayBatchAddTime(uint8_t cmd, uint32_t ticks) = 0;
+  virtual void displayBatchFlush() = 0;
+  virtual void resetLinks() = 0;                // new game: forget everything in flight
+};
+
+class GameLeds {
+public:
+  virtual void setMode(NeoMode mode) = 0;       // neoMode changed: restart its animation now
+  virtual void flash() = 0;                     // countdown tick: white flash on all rings
+  virtual void freeze() = 0;                    // GO: joined players' rings yellow on this instant
+};
+
+class GameAudio {
+public:
+  virtual void queueSound(const char* snd, AudioPriority pri = AUDIO_PRI_ANNOUNCE) = 0;
+  virtual void queueSoundAt(const char* snd, uint32_t atUs) = 0;
+  virtual void playPlayerNumber(uint8_t player) = 0;
+  virtual void playPlayerWins(uint8_t player) = 0;
+  virtual void playShakeTarget(uint8_t target) = 0;
+  virtual void prefetch(const char* snd) = 0;   // will be queued soon: get it ready
+  virtual void stop() = 0;
+  virtual void setScene(uint8_t scene) = 0;
+  virtual uint32_t idleAtMs() = 0;              // when everything queued has played (>= now)
+};
+
+// =============================================================================
+// GAME CORE
+// =============================================================================
+class GameCore {
+public:
+  GameCore(GameClock &clock, GameRadio &radio, GameLeds &leds, GameAudio &audio)
+      : clock(clock), radio(radio), leds(leds), audio(audio), timeline(this) {
+    for (int i = 0; i < MAX_PLAYERS; i++) slotToStick[i] = 0xFF;
+    for (int s = 0; s < MAX_STICKS; s++) stickToSlot[s] = 0xFF;
+    for (int i = 0; i < MAX_PLAYERS; i++) matchBest[i] = RESULT_TICKS_NONE;
+  }
+
+  // Game job: audio scene, then the current state's handler
+  void step() {
+    uint8_t scene = audioSceneFor(state);
+    if (scene != audioScene) {
+      audioScene = scene;
+      audio.setScene(scene);  // drop clips queued for the state we just left
+    }
+    switch (state) {
+      case STATE_IDLE:            handleIdle();           break;
+      case STATE_JOIN:            handleJoin();           break;
+      case STATE_COUNTDOWN:       handleCountdown();      break;
+      case STATE_REACTION:        handleReaction();       break;
+      case STATE_SHAKE:           handleShake();          break;
+      case STATE_COLLECT:         handleCollect();        break;
+      case STATE_SHOW_RESULTS:    handleShowResults();    break;
+      case STATE_FINAL_WINNER:    handleFinalWinner();    break;
+    }
+  }
+
+  // Timeline job: countdown ticks and GO
+  void runCues(uint32_t nowUs) { timeline.run(nowUs); }
+  // When the next cue fires (loop() mustn't sleep past it); false if none
+  bool nextCueUs(uint32_t* atUs) const { return timeline.nextFireUs(atUs); }
+
+  // IDLE again from its start, as a trace replay's time zero; IDLE only
+  bool restartIdle() {
+    if (state != STATE_IDLE) return false;
+    goTo(STATE_IDLE);
+    return true;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Received packets (handlePacket)
+  // ---------------------------------------------------------------------------
+  // CMD_REQ_ID during JOIN claims the prompted slot: returns it, or 0xFF
+  uint8_t onJoinRequest(uint8_t stickId) {
+    if (state != STATE_JOIN || !isStickId(stickId)) return 0xFF;
+    uint8_t stickIdx = stickIndex(stickId);
+    if (changeover) return onReadyPress(stickId);
+    if (stickToSlot[stickIdx] != 0xFF) {
+      LOGD(LOG_JOIN, "[JOIN] Joystick %d already claimed a slot, ignoring\n", stickIdx + 1);
+      return 0xFF;
+    }
+    uint8_t slot = currentPromptSlot;
+    if (slotToStick[slot] != 0xFF) {
+      LOGD(LOG_JOIN, "[JOIN] Slot %d already taken, ignoring\n", slot + 1);
+      return 0xFF;
+    }
+
+    slotToStick[slot] = stickId;
+    stickToSlot[stickIdx] = slot;
+    players[slot].joined = true;
+    joinedCount++;
+
+    // Turn this slot's ring to the joystick's identity color
+    ringOverride[playerToRing(slot)] = stickColor(stickId);
+
+    // Notify display that player is ready (data_high = player slot 1-4, data_low = joystick ID)
+    toDisplay(DISP_PLAYER_READY, slot + 1, stickId);
+
+    promptStartTime = 0;  // advance to the next slot on the next step()
+    return slot;
+  }
+
+  // slotToStick as "0x01,0x03,0xFF,0xFF", for logs
+  const char* slotMap() {
+    char *p = slotMapBuf;
+    for (int i = 0; i < MAX_PLAYERS; i++) p += snprintf(p, 6, i ? ",0x%02X" : "0x%02X", slotToStick[i]);
+    return slotMapBuf;
+  }
+
+  // Player slot for a stick ID, -1 if it hasn't joined (direct index, no scan)
+  int8_t playerForStick(uint8_t stickId) const {
+    if (!isStickId(stickId)) return -1;
+    uint8_t slot = stickToSlot[stickIndex(stickId)];
+    return slot == 0xFF ? -1 : slot;
+  }
+
+  void onShakeProgress(uint8_t slot, uint8_t count, uint8_t target) {
+    if (slot >= MAX_PLAYERS || state != STATE_SHAKE) return;
+    if (!shakeTrack.onProgress(slot, count, target, clock.nowUs())) return;
+    LOGD(LOG_SHAKE, "[SHAKE] Player %d progress: %d/%d\n", slot + 1, count, target);
+  }
+
+  // CMD_REACTION_DONE / CMD_SHAKE_DONE; false if it doesn't count (wrong state, repeat)
+  bool onResult(uint8_t slot, bool reaction, uint32_t ticks) {
+    if (state != STATE_COLLECT && state != STATE_SHAKE) {
+      LOGW(LOG_GAME, "[WARN] Got result in wrong state %d, ignoring\n", state);
+      return false;
+    }
+    if (players[slot].finished) {
+      LOGW(LOG_GAME, "[WARN] Player %d already finished, ignoring\n", slot + 1);
+      return false;
+    }
+    players[slot].resultTicks = ticks;
+    players[slot].finished = true;
+
+    if (ticks == RESULT_TICKS_NONE) {
+      LOGI(LOG_GAME, "[RECV] Player %d (stick %d): %s = PENALTY\n",
+                     slot + 1, stickIndex(slotToStick[slot]) + 1, reaction ? "REACTION" : "SHAKE");
+    } else {
+      LOGI(LOG_GAME, "[RECV] Player %d (stick %d): %s = %lu.%02lu ms\n",
+                     slot + 1, stickIndex(slotToStick[slot]) + 1, reaction ? "REACTION" : "SHAKE",
+                     (unsigned long)(ticks / RESULT_TICKS_PER_MS),
+                     (unsigned long)(ticks % RESULT_TICKS_PER_MS));
+    }
+
+    // Immediately turn that player's ring GREEN if valid, BLINK RED if penalty
+    uint8_t ring = playerToRing(slot);
+    if (ticks == RESULT_TICKS_NONE) {
+      ringOverride[ring] = COLOR_RED;
+      ringBlink[ring] = true;  // blink red for penalty
+      LOGD(LOG_NEO, "[NEO] Player %d ring %d -> BLINK RED (penalty)\n", slot + 1, ring);
+    } else {
+      ringOverride[ring] = COLOR_GREEN;
+      ringBlink[ring] = false;
+      LOGD(LOG_NEO, "[NEO] Player %d ring %d -> GREEN (time=%d ms)\n", slot + 1, ring,
+                    resultTicksToMs(ticks));
+    }
+    // If we were in NEO_FIXED_COLOR or NEO_RANDOM_FAST, switch to status mode
+    // so the ring override renders immediately
+    if (neoMode == NEO_FIXED_COLOR || neoMode == NEO_RANDOM_FAST) {
+      // During COLLECT: set non-finished players' rings to yellow so they stay visible
+      if (state == STATE_COLLECT) {
+        for (int j = 0; j < MAX_PLAYERS; j++) {
+          if (players[j].joined && !players[j].finished) {
+            uint8_t rj = playerToRing(j);
+            if (ringOverride[rj] == COLOR_OFF) {
+              ringOverride[rj] = COLOR_YELLOW;
+              ringBlink[rj] = false;
+            }
+          }
+        }
+      }
+      setNeo(NEO_STATUS);
+    }
+    return true;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Rules
+  // ---------------------------------------------------------------------------
+  // Is this player active in the current round? (filters for deuce)
+  bool isActivePlayer(uint8_t i) const {
+    if (!players[i].joined || slotToStick[i] == 0xFF) return false;
+    if (inDeuce) return (i == deucePlayer[0] || i == deucePlayer[1]);
+    return true;
+  }
+
+  uint8_t findRoundWinner() const {
+    uint8_t winner = 0xFF;
+    uint32_t best = RESULT_TICKS_NONE;  // full tick resolution: no ms ties decided by slot order
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i) && players[i].finished && players[i].resultTicks < best) {
+        best = players[i].resultTicks;
+        winner = i;
+      }
+    }
+    return winner;
+  }
+
+  uint8_t findFinalWinner() const {
+    uint8_t winner = 0xFF;
+    uint8_t best = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (players[i].joined && players[i].score > best) {
+        best = players[i].score;
+        winner = i;
+      }
+    }
+    return winner;
+  }
+
+  // Check if exactly 2 players share the highest score (deuce condition)
+  bool checkDeuce() {
+    uint8_t maxScore = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (players[i].joined && players[i].score > maxScore)
+        maxScore = players[i].score;
+    }
+    uint8_t count = 0;
+    uint8_t tied[2] = {0xFF, 0xFF};
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (players[i].joined && players[i].score == maxScore) {
+        if (count < 2) tied[count] = i;
+        count++;
+      }
+    }
+    if (count == 2) {
+      deucePlayer[0] = tied[0];
+      deucePlayer[1] = tied[1];
+      return true;
+    }
+    return false;
+  }
+
+  // Rounds in this game: a tournament match is shorter
+  uint8_t gameRounds() const { return tour.active() ? TOUR_MATCH_ROUNDS : TOTAL_ROUNDS; }
+
+  // ---------------------------------------------------------------------------
+  // Tournament (Tournament.h)
+  // ---------------------------------------------------------------------------
+  // From IDLE only; the next join binds the sticks for the whole tournament
+  bool startTournament(uint8_t entrants, const uint32_t* seedTicks) {
+    if (state != STATE_IDLE || tour.active()) return false;
+    return tour.start(entrants, seedTicks);
+  }
+
+  // Ends it mid-match too: back to IDLE
+  void stopTournament() {
+    if (!tour.active()) return;
+    tour.stop();
+    sendSeats();
+    if (state != STATE_IDLE) {
+      toDisplay(DISP_IDLE, 0, 0);
+      goTo(STATE_IDLE);
+    }
+  }
+
+  // Reaction round past its collect timeout: late presses still count until the warning ends
+  bool inYellowWarning() const { return state == STATE_COLLECT && collectYellowPhase; }
+
+  // Whether slot i's result this round goes into the stats: not when it was
+  // cut off by a decided round (it has no time, but it isn't a penalty either)
+  bool recordsResult(uint8_t i) const { return isActivePlayer(i) && !players[i].cutOff; }
+
+  // Audio scene per state: a round (countdown through collect) is one scene,
+  // so its announcements survive COUNTDOWN -> REACTION but not the move on
+  static uint8_t audioSceneFor(HostGameState s) {
+    switch (s) {
+      case STATE_REACTION:
+      case STATE_SHAKE:
+      case STATE_COLLECT:  return STATE_COUNTDOWN;
+      default:             return s;
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // State (read by the renderer, packet handler and simulator)
+  // ---------------------------------------------------------------------------
+  HostGameState state = STATE_IDLE;
+  Player players[MAX_PLAYERS] = {};
+  // slotToStick[slot] = joystick ID (isStickId()), or 0xFF if unclaimed
+  uint8_t slotToStick[MAX_PLAYERS];
+  uint8_t joinedCount = 0;
+  uint8_t currentRound = 0;
+  uint8_t gameMode = MODE_REACTION;   // current round mode
+  bool inDeuce = false;
+  uint8_t deucePlayer[2] = {0xFF, 0xFF};  // indices (0-3) of the two tied players
+
+  // Ring view
+  NeoMode neoMode = NEO_IDLE_RAINBOW;
+  uint32_t ringOverride[NUM_RINGS] = {};  // COLOR_OFF = use the mode's animation
+  bool ringBlink[NUM_RINGS] = {};         // true = blink this ring on/off
+  uint8_t blinkSlot = 0;                  // player slot blinking in NEO_BLINK_SLOT
+  uint32_t shakeStartMs = 0;              // for the center ring countdown
+  ShakeTrack shakeTrack;                  // per player, from CMD_SHAKE_PROGRESS (ShakeTrack.h)
+  uint8_t shakeTargetCount = 0;           // current round's shake target (10/15/20)
+
+  Tournament tour;                        // inactive unless started (startTournament())
+  CollectPolicy collectPolicy = (CollectPolicy)COLLECT_POLICY;  // when COLLECT may end
+
+private:
+  // ---------------------------------------------------------------------------
+  // Helpers
+  // ---------------------------------------------------------------------------
+  void setNeo(NeoMode m) {
+    neoMode = m;
+    leds.setMode(m);
+  }
+
+  void toDisplay(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) {
+    radio.sendWithRetry(ID_DISPLAY, cmd, packData(dataHigh, dataLow));
+    LOGD(LOG_DISP, "[DISP] cmd=0x%02X data=%d,%d\n", cmd, dataHigh, dataLow);
+  }
+
+  // Send a critical command to all active joysticks (respects deuce filtering)
+  void toActiveSticks(uint8_t cmd, uint16_t data) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i)) radio.sendWithRetry(slotToStick[i], cmd, data);
+    }
+  }
+
+  void clearRings() {
+    for (int i = 0; i < NUM_RINGS; i++) { ringOverride[i] = COLOR_OFF; ringBlink[i] = false; }
+  }
+
+  uint8_t getRandomIndex(uint8_t *last, uint8_t max) {
+    uint8_t idx;
+    do { idx = clock.random(max); } while (idx == *last && max > 1);
+    *last = idx;
+    return idx;
+  }
+
+  // Alternating game modes: REACTION, SHAKE, REACTION, SHAKE, ...
+  uint8_t getNextGameMode() {
+    uint8_t mode = modeBag[modeBagIdx % 2];
+    modeBagIdx++;
+    return mode;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Round plan: every round's mode, delay and target, picked ahead of time
+  // ---------------------------------------------------------------------------
+  // Slot for a round; deuce rounds reuse the slots of rounds long played
+  RoundPlan &planFor(uint8_t round) { return roundPlan[(round - 1) % TOTAL_ROUNDS]; }
+
+  // Same bag and no-repeat rules as picking at countdown time
+  void planRound(uint8_t round) {
+    RoundPlan &p = planFor(round);
+    p.mode = getNextGameMode();
+    if (p.mode == MODE_REACTION) p.delayIdx = getRandomIndex(&lastDelayIdx, NUM_REACT_DELAYS);
+    else p.targetIdx = getRandomIndex(&lastTargetIdx, NUM_SHAKE_TARGETS);
+    LOGD(LOG_GAME, "[PLAN] Round %d: %s, delay=%dms target=%d\n", round,
+                   p.mode == MODE_REACTION ? "REACT" : "SHAKE",
+                   p.mode == MODE_REACTION ? REACT_DELAYS[p.delayIdx] : 0,
+                   p.mode == MODE_SHAKE ? SHAKE_TARGETS[p.targetIdx] : 0);
+  }
+
+  void planGame() {
+    for (uint8_t r = 1; r <= gameRounds(); r++) planRound(r);
+    LOGI(LOG_GAME, "[PLAN] %d rounds planned\n", gameRounds());
+  }
+
+  // Lookahead while the screen still shows something else: the audio gets
+  // the round's announcements ready and the display decodes its banner,
+  // so handleCountdown() only has to queue and send
+  void prepareRound(uint8_t round) {
+    if (round > gameRounds()) planRound(round);   // deuce: one round at a time
+    const RoundPlan &p = planFor(round);
+    if (round == 1) audio.prefetch(SND_GET_READY);
+    uint8_t target = 0;
+    if (p.mode == MODE_REACTION) {
+      audio.prefetch(SND_REACTION_MODE);
+      if (!reactionInstructPlayed) audio.prefetch(SND_REACTION_INSTRUCT);
+    } else {
+      target = SHAKE_TARGETS[p.targetIdx];
+      audio.prefetch(SND_SHAKE_IT);
+      if (!shakeInstructPlayed) audio.prefetch(SND_YOU_WILL_SHAKE);
+      const char* num = numberSound(target);
+      if (num) audio.prefetch(num);
+    }
+    radio.displayBatchBegin();
+    radio.displayBatchAdd(DISP_NEXT_ROUND, p.mode, target);
+    radio.displayBatchFlush();
+  }
+
+  void goTo(HostGameState s) {
+    state = s;
+    stateStartTime = 0;
+  }
+
+  void resetPlayers() {
+    resetMatch();
+    for (int i = 0; i < MAX_PLAYERS; i++) slotToStick[i] = 0xFF;
+    for (int s = 0; s < MAX_STICKS; s++) stickToSlot[s] = 0xFF;
+    currentPromptSlot = 0;
+    reactionInstructPlayed = false;  // reset instruction flag for new game
+    shakeInstructPlayed = false;
+    radio.resetLinks();
+  }
+
+  // Scores and rounds only: a tournament changeover keeps the sticks in
+  // their slots (and the instructions played, the queue has heard them)
+  void resetMatch() {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      players[i].joined = false;
+      players[i].finished = false;
+      players[i].resultTicks = RESULT_TICKS_NONE;
+      players[i].cutOff = false;
+      players[i].score = 0;
+      matchBest[i] = RESULT_TICKS_NONE;
+    }
+    reactionHistory.reset();
+    joinedCount = 0;
+    currentRound = 0;
+    consecutiveTimeouts = 0;
+    modeBagIdx = 0;  // reset to start with REACTION
+    inDeuce = false;
+    deucePlayer[0] = 0xFF;
+    deucePlayer[1] = 0xFF;
+    clearRings();
+    timeline.clear();
+  }
+
+  void resetRound() {
+    timeline.clear();
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      players[i].finished = false;
+      players[i].resultTicks = RESULT_TICKS_NONE;
+      players[i].cutOff = false;
+    }
+    shakeTrack.reset();
+    clearRings();
+  }
+
+  bool allActiveFinished() const {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i) && !players[i].finished) return false;
+    }
+    return true;
+  }
+
+  // ---------------------------------------------------------------------------
+  // IDLE
+  // ---------------------------------------------------------------------------
+  void handleIdle() {
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+
+      // Broadcast IDLE to ALL joysticks before resetting player state
+      // (toActiveSticks won't reach them after resetPlayers clears slotToStick)
+      radio.broadcast(CMD_IDLE, 0);
+
+      resetPlayers();
+      currentRound = 0;
+      setNeo(NEO_IDLE_RAINBOW);
+
+      toDisplay(DISP_IDLE, 0, 0);
+      audio.queueSound(SND_PRESS_TO_JOIN, AUDIO_PRI_AMBIENT);
+      LOGI(LOG_GAME, "[STATE] IDLE\n");
+    }
+
+    // Auto-transition to JOIN after 3s
+    if (clock.nowMs() - stateStartTime > 3000) goTo(STATE_JOIN);
+  }
+
+  // ---------------------------------------------------------------------------
+  // JOIN
+  // Sequential player slot prompting: P1 -> P2 -> P3 -> P4
+  // Each slot blinks on NeoPixel ring and display. Any unclaimed joystick can press to claim.
+  // After all 4 prompts (5s each) or skip timeout, proceed if >= 2 players joined.
+  // ---------------------------------------------------------------------------
+  void startPromptSlot(uint8_t slot) {
+    currentPromptSlot = slot;
+    promptStartTime = clock.nowMs();
+    blinkSlot = slot;
+    setNeo(NEO_BLINK_SLOT);
+
+    // Send prompt to display (player number 1-4)
+    toDisplay(DISP_PLAYER_PROMPT, 0, slot + 1);
+
+    // Interrupt any currently playing audio, then play new player number
+    audio.stop();
+    audio.playPlayerNumber(slot + 1);
+
+    LOGI(LOG_JOIN, "[JOIN] Prompting Player %d slot...\n", slot + 1);
+  }
+
+  void completeJoin() {
+    // Tournament: this join only bound the sticks; the first match's entrants come to them
+    if (tour.active() && !tour.seated()) {
+      uint8_t mask = 0;
+      for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (slotToStick[i] != 0xFF) mask |= 1 << i;
+      }
+      tour.seat(mask);
+      startChangeover();
+      return;
+    }
+    // Show all joined player colors for 1s before starting
+    changeover = false;
+    setNeo(NEO_STATUS);
+    audio.stop();
+    joinComplete = true;
+    joinCompleteTime = clock.nowMs();
+    planGame();
+    prepareRound(1);
+  }
+
+  void handleJoin() {
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+      joinComplete = false;
+      clearRings();
+      if (tour.active() && tour.seated()) {
+        startChangeover();
+        return;
+      }
+
+      // Start with Player 1 prompt
+      startPromptSlot(0);
+      LOGI(LOG_GAME, "[STATE] JOIN - sequential player prompting\n");
+    }
+
+    // Waiting 1s after join complete so players can see their assigned colors
+    if (joinComplete) {
+      if (clock.nowMs() - joinCompleteTime > 1000) {
+        goTo(STATE_COUNTDOWN);  // "get ready" is queued there, in the round's audio scene
+      }
+      return;
+    }
+
+    if (changeover) {
+      handleChangeover();
+      return;
+    }
+
+    // Check if current slot has timed out or was just claimed (promptStartTime = 0)
+    bool shouldAdvance = (promptStartTime == 0) ||
+                         (clock.nowMs() - promptStartTime > PROMPT_DURATION);
+
+    if (shouldAdvance) {
+      // Find next unclaimed slot
+      uint8_t nextSlot = currentPromptSlot + 1;
+      while (nextSlot < MAX_PLAYERS && slotToStick[nextSlot] != 0xFF) {
+        nextSlot++;  // skip already-claimed slots
+      }
+
+      if (nextSlot >= MAX_PLAYERS) {
+        // All slots prompted - check if we have enough players
+        if (joinedCount < 2) {
+          LOGI(LOG_JOIN, "[JOIN] Not enough players, restarting join prompts\n");
+          // Silently cycle back to P1 without error sound or idle screen
+          startPromptSlot(0);
+          return;
+        }
+        LOGI(LOG_JOIN, "[JOIN] Starting with %d players. Map: [%s]\n", joinedCount, slotMap());
+        completeJoin();
+        return;
+      }
+
+      // Prompt next slot
+      startPromptSlot(nextSlot);
+    }
+
+    // If all 4 players joined, show colors for 1s before starting
+    if (joinedCount >= MAX_PLAYERS) {
+      LOGI(LOG_JOIN, "[JOIN] All %d players joined! Map: [%s]\n", joinedCount, slotMap());
+      completeJoin();
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // TOURNAMENT CHANGEOVER (JOIN between matches)
+  // The bound sticks keep their slots; each slot gets the next match's
+  // entrant (or sits out). The seated rings blink in the stick's color
+  // until the entrant presses; everyone pressed, or TOUR_CHANGEOVER_MS,
+  // starts the match.
+  // ---------------------------------------------------------------------------
+  void startChangeover() {
+    stateStartTime = clock.nowMs();
+    resetMatch();
+    changeover = true;
+    readyMask = 0;
+    audio.stop();
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (slotToStick[i] == 0xFF || tour.entrantAt(i) == TOUR_NONE) continue;
+      players[i].joined = true;
+      joinedCount++;
+      ringOverride[playerToRing(i)] = stickColor(slotToStick[i]);
+      ringBlink[playerToRing(i)] = true;
+      LOGI(LOG_JOIN, "[TOUR] Player %d: entrant #%d\n", i + 1, tour.entrantAt(i) + 1);
+    }
+    setNeo(NEO_STATUS);
+    toDisplay(DISP_IDLE, 0, 0);
+    toDisplay(DISP_PROMPT_JOIN, 0, 0);
+    sendSeats();
+    LOGI(LOG_GAME, "[STATE] JOIN - tournament match %d%s\n", tour.matches() + 1,
+                   tour.inFinal() ? " (final)" : "");
+  }
+
+  void handleChangeover() {
+    bool allReady = true;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (players[i].joined && !(readyMask & (1 << i))) allReady = false;
+    }
+    if (allReady) {
+      LOGI(LOG_JOIN, "[TOUR] Everyone seated\n");
+    } else if (clock.nowMs() - stateStartTime > TOUR_CHANGEOVER_MS) {
+      LOGI(LOG_JOIN, "[TOUR] Changeover timed out - starting anyway\n");
+    } else {
+      return;
+    }
+    completeJoin();
+  }
+
+  // A seated stick's press during the changeover: its entrant is here
+  uint8_t onReadyPress(uint8_t stickId) {
+    uint8_t slot = stickToSlot[stickIndex(stickId)];
+    if (slot == 0xFF || !players[slot].joined || (readyMask & (1 << slot))) return 0xFF;
+    readyMask |= 1 << slot;
+    ringBlink[playerToRing(slot)] = false;
+    toDisplay(DISP_PLAYER_READY, slot + 1, stickId);
+    LOGI(LOG_JOIN, "[TOUR] Entrant #%d ready on Player %d\n", tour.entrantAt(slot) + 1, slot + 1);
+    return slot;
+  }
+
+  // Next match's entrant per slot, one frame (all empty once the tournament is over)
+  void sendSeats() {
+    radio.displayBatchBegin();
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      const uint8_t e = tour.active() ? tour.entrantAt(i) : TOUR_NONE;
+      radio.displayBatchAdd(DISP_TOUR_SEAT, i + 1, e == TOUR_NONE ? 0 : e + 1);
+    }
+    radio.displayBatchFlush();
+  }
+
+  // Match placings (score, then the match's fastest reaction) to the table;
+  // the winner's slot, 0xFF if nobody scored or set a time
+  uint8_t reportMatch() {
+    uint8_t place[MAX_PLAYERS];
+    uint8_t winner = 0xFF;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      place[i] = 0;
+      if (!players[i].joined) continue;
+      for (int j = 0; j < MAX_PLAYERS; j++) {
+        if (j == i || !players[j].joined) continue;
+        if (players[j].score > players[i].score ||
+            (players[j].score == players[i].score && matchBest[j] < matchBest[i])) place[i]++;
+      }
+      if (place[i] == 0 && winner == 0xFF && (players[i].score || matchBest[i] != RESULT_TICKS_NONE)) winner = i;
+    }
+    tour.report(place, matchBest);
+    return winner;
+  }
+
+  // ---------------------------------------------------------------------------
+  // TIMELINE CUES (fn(instant, arg), see Timeline.h) - arg = countdown number, 0 = GO
+  // ---------------------------------------------------------------------------
+  void cueSound(uint32_t forUs, uint16_t n) {
+    audio.queueSoundAt(n ? numberSound(n) : SND_BEEP, forUs);
+  }
+
+  // Sticks on 4.2+ hold the pulse until forUs (TIMED CUES in Protocol.h)
+  void cueStickPulse(uint32_t forUs, uint16_t) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i) && radio.timedCues(slotToStick[i])) {
+        radio.sendWithRetry(slotToStick[i], CMD_CUE_AT, goTicks(forUs));
+      }
+    }
+  }
+
+  void cueCountdownTick(uint32_t forUs, uint16_t n) {
+    toDisplay(DISP_COUNTDOWN, 0, n);
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i) && !radio.timedCues(slotToStick[i])) {
+        radio.sendWithRetry(slotToStick[i], CMD_COUNTDOWN, n);
+      }
+    }
+    leds.flash();  // NeoPixel flash in sync with audio/vibe
+    LOGI(LOG_GAME, "[COUNTDOWN] %d (%lu us late)\n", n, (unsigned long)(clock.nowUs() - forUs));
+  }
+
+  void cueShakeGo(uint32_t forUs, uint16_t) {
+    toDisplay(DISP_GO, 0, 0);
+    radio.sendGO(forUs); // hardware sync - joysticks vibrate on hardware GO
+    LOGI(LOG_GAME, "[GO] Shake mode started!\n");
+    goTo(STATE_SHAKE);
+  }
+
+  void cueReactionGo(uint32_t forUs, uint16_t) {
+    // FREEZE neopixels - this is the visual "press now" cue
+    neoMode = NEO_FIXED_COLOR;
+    leds.freeze();
+
+    // Display GO - synced with neopixels and joysticks
+    toDisplay(DISP_GO, 0, 0);
+
+    // Hardware GO pulse to all joysticks (starts their timer + vibration);
+    // the beep was scheduled for the same instant
+    radio.sendGO(forUs);
+
+    LOGI(LOG_GAME, "[GO] Reaction GO fired! LEDs frozen.\n");
+    goTo(STATE_COLLECT);
+  }
+
+  // 3 at startUs, then 2, 1 and GO one tick apart: sound, stick pulse and
+  // LED flash/display each get the same instant
+  void scheduleCountdown(uint32_t startUs) {
+    for (uint8_t n = 3; n >= 1; n--) {
+      uint32_t t = startUs + (3 - n) * COUNTDOWN_TICK_US;
+      timeline.at(t, AUDIO_CUE_LEAD_US, &GameCore::cueSound, n);
+      timeline.at(t, STICK_CUE_LEAD_US, &GameCore::cueStickPulse, n);
+      timeline.at(t, 0, &GameCore::cueCountdownTick, n);
+    }
+    uint32_t go = startUs + 3 * COUNTDOWN_TICK_US;
+    timeline.at(go, AUDIO_CUE_LEAD_US, &GameCore::cueSound, 0);
+    timeline.at(go, 0, &GameCore::cueShakeGo, 0);
+  }
+
+  // ---------------------------------------------------------------------------
+  // COUNTDOWN
+  // ---------------------------------------------------------------------------
+  void handleCountdown() {
+    if (stateStartTime != 0) return;  // ticks and GO fire from the timeline; cueShakeGo() moves on
+    stateStartTime = clock.nowMs();
+    resetRound();
+    currentRound++;
+    if (currentRound == 1) audio.queueSound(SND_GET_READY);
+
+    // Mode, delay and target were planned at join (prepareRound() for deuce)
+    const RoundPlan &p = planFor(currentRound);
+    gameMode = p.mode;
+    if (gameMode == MODE_REACTION) {
+      delayIdx = p.delayIdx;
+      LOGI(LOG_GAME, "[COUNTDOWN] Round %d: REACTION, delay=%dms\n",
+                     currentRound, REACT_DELAYS[delayIdx]);
+      toDisplay(DISP_REACTION_MODE, 0, 0);
+      audio.queueSound(SND_REACTION_MODE);
+      // Only play instruction the first time reaction mode is played this game
+      if (!reactionInstructPlayed) {
+        audio.queueSound(SND_REACTION_INSTRUCT);
+        reactionInstructPlayed = true;
+        LOGI(LOG_GAME, "[COUNTDOWN] First reaction mode - playing instruction\n");
+      }
+      announceEndMs = audio.idleAtMs();
+      // NeoPixels: random cycling during reaction mode
+      setNeo(NEO_RANDOM_FAST);
+
+      // Send mode to joysticks
+      toActiveSticks(CMD_GAME_START, encodeGameStart(gameMode, 0));
+
+      // Reaction mode: NO countdown - wait for announcements then random delay
+      LOGI(LOG_GAME, "[REACTION] Waiting for announcements before random delay\n");
+      reactionAnnouncementDone = false;
+      goTo(STATE_REACTION);
+      return;
+    }
+
+    gameMode = MODE_SHAKE;
+    targetIdx = p.targetIdx;
+    shakeTargetCount = SHAKE_TARGETS[targetIdx];
+    LOGI(LOG_GAME, "[COUNTDOWN] Round %d: SHAKE, target=%d\n",
+                   currentRound, SHAKE_TARGETS[targetIdx]);
+    toDisplay(DISP_SHAKE_MODE, 0, SHAKE_TARGETS[targetIdx]);
+    audio.queueSound(SND_SHAKE_IT);
+    // Only play instruction the first time shake mode is played this game
+    if (!shakeInstructPlayed) {
+      audio.queueSound(SND_YOU_WILL_SHAKE);
+      shakeInstructPlayed = true;
+      LOGI(LOG_GAME, "[COUNTDOWN] First shake mode - playing instruction\n");
+    }
+    // Announce target number (plays "Ten", "Fifteen", or "Twenty")
+    audio.playShakeTarget(SHAKE_TARGETS[targetIdx]);
+    // NeoPixels: red blink during countdown for shake mode
+    setNeo(NEO_COUNTDOWN);
+
+    // Send mode+param to all joysticks so they know what to do after GO
+    toActiveSticks(CMD_GAME_START, encodeGameStart(gameMode, SHAKE_TARGETS[targetIdx]));
+
+    // 3, 2, 1, GO on the timeline, starting when the announcements end
+    uint32_t startUs = clock.nowUs() + (audio.idleAtMs() - clock.nowMs() + COUNTDOWN_START_GAP) * 1000UL;
+    scheduleCountdown(startUs);
+  }
+
+  // ---------------------------------------------------------------------------
+  // REACTION (random wait then GO) - waits for voice announcements, then random delay, then GO
+  // ---------------------------------------------------------------------------
+  void handleReaction() {
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+      // NeoPixels should already be in NEO_RANDOM_FAST (for reaction mode). If not, set it.
+      if (neoMode != NEO_RANDOM_FAST) setNeo(NEO_RANDOM_FAST);
+      LOGI(LOG_GAME, "[REACTION] Waiting for announcements...\n");
+    }
+
+    // Wait for voice announcements to finish, then put GO on the timeline
+    if (!reactionAnnouncementDone && (int32_t)(clock.nowMs() - announceEndMs) >= 0) {
+      reactionAnnouncementDone = true;
+      uint32_t goUs = clock.nowUs() + REACT_DELAYS[delayIdx] * 1000UL;
+      timeline.at(goUs, AUDIO_CUE_LEAD_US, &GameCore::cueSound, 0);
+      timeline.at(goUs, 0, &GameCore::cueReactionGo, 0);
+      LOGI(LOG_GAME, "[REACTION] Announcements done, random delay=%dms\n", REACT_DELAYS[delayIdx]);
+    }
+    // cueReactionGo() moves to STATE_COLLECT
+  }
+
+  // ---------------------------------------------------------------------------
+  // SHAKE (GO already fired, wait for shake results)
+  // ---------------------------------------------------------------------------
+  void handleShake() {
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+      shakeStartMs = stateStartTime;
+      setNeo(NEO_SHAKE_COUNTDOWN);  // random player rings + center countdown
+      LOGI(LOG_SHAKE, "[SHAKE] Waiting for shake results...\n");
+    }
+
+    // Timeout after 30s
+    if (clock.nowMs() - stateStartTime > TIMEOUT_SHAKE) {
+      LOGI(LOG_SHAKE, "[SHAKE] Timeout - moving to results\n");
+      // Mark any unfinished active players as penalty
+      for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (isActivePlayer(i) && !players[i].finished) {
+          players[i].finished = true;
+          players[i].resultTicks = RESULT_TICKS_NONE;
+          ringOverride[playerToRing(i)] = COLOR_RED;
+        }
+      }
+      setNeo(NEO_STATUS);
+      goTo(STATE_SHOW_RESULTS);
+      return;
+    }
+
+    if (allActiveFinished()) {
+      LOGI(LOG_SHAKE, "[SHAKE] All players done\n");
+      setNeo(NEO_STATUS);
+      goTo(STATE_SHOW_RESULTS);
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // COLLECT (reaction mode - wait for the results, with yellow warning;
+  // how long is collectPolicy's call, CollectPolicy.h)
+  // ---------------------------------------------------------------------------
+  void handleCollect() {
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+      collectYellowPhase = false;
+      LOGI(LOG_GAME, "[COLLECT] Waiting for reaction results (%s)...\n", COLLECT_POLICY_NAMES[collectPolicy]);
+    }
+    const uint32_t now = clock.nowMs();
+
+    // Results come in through onResult()
+    if (allActiveFinished()) {
+      // All responded (early-press penalties already blink red)
+      collectYellowPhase = false;
+      setNeo(NEO_STATUS);
+      goTo(STATE_SHOW_RESULTS);
+      return;
+    }
+
+    // Decided: whoever is still out would be slower than the leader
+    if (collectPolicy >= COLLECT_DECIDED) {
+      const uint8_t leader = findRoundWinner();
+      if (leader != 0xFF &&
+          now - stateStartTime > players[leader].resultTicks / RESULT_TICKS_PER_MS + COLLECT_SETTLE_MS) {
+        LOGI(LOG_GAME, "[COLLECT] Decided after %lu ms: nobody left can beat Player %d\n",
+             (unsigned long)(now - stateStartTime), leader + 1);
+        endCollect(false);
+        return;
+      }
+    }
+
+    // Yellow warning phase: players can still react during this time
+    if (collectYellowPhase) {
+      if (now - collectYellowStart > collectWaitMs) {
+        LOGI(LOG_GAME, "[COLLECT] Yellow warning done - disqualified remaining\n");
+        endCollect(true);
+      }
+      return;
+    }
+
+    // Timeout - start yellow warning
+    // Players are NOT marked as finished yet - they can still react!
+    collectWaitMs = collectTimeoutMs();
+    if (now - stateStartTime > collectWaitMs) {
+      for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (isActivePlayer(i) && !players[i].finished) {
+          uint8_t ring = playerToRing(i);
+          ringOverride[ring] = COLOR_YELLOW;
+          ringBlink[ring] = false;  // solid yellow during warning
+          LOGI(LOG_GAME, "[COLLECT] Player %d: yellow warning (can still react)\n", i + 1);
+        }
+      }
+      collectYellowPhase = true;
+      collectYellowStart = now;
+      setNeo(NEO_STATUS);
+      LOGI(LOG_GAME, "[COLLECT] Starting yellow warning phase (%lu ms)\n", (unsigned long)collectWaitMs);
+    }
+  }
+
+  // The longest wait any player still out gets (TIMEOUT_REACTION unless adaptive)
+  uint32_t collectTimeoutMs() const {
+    if (collectPolicy < COLLECT_ADAPTIVE) return TIMEOUT_REACTION;
+    uint32_t t = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i) && !players[i].finished) {
+        const uint32_t ti = reactionHistory.timeoutMs(i);
+        if (ti > t) t = ti;
+      }
+    }
+    return t;
+  }
+
+  // Round over: the rest are out without a time - blinking red when they
+  // timed out, solid red (and cutOff, no penalty) when the leader was
+  // already out of reach
+  void endCollect(bool timedOut) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+      if (isActivePlayer(i) && !players[i].finished) {
+        players[i].finished = true;
+        players[i].resultTicks = RESULT_TICKS_NONE;
+        players[i].cutOff = !timedOut;
+        uint8_t ring = playerToRing(i);
+        ringOverride[ring] = COLOR_RED;
+        ringBlink[ring] = timedOut;
+      }
+    }
+    collectYellowPhase = false;
+    setNeo(NEO_STATUS);
+    goTo(STATE_SHOW_RESULTS);
+  }
+
+  // ---------------------------------------------------------------------------
+  // SHOW RESULTS - 3 s of times, then 3 s of winner and scores
+  // ---------------------------------------------------------------------------
+  void handleShowResults() {
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+      resultsPhase2 = false;
+
+      // Phase 1: Send reaction times to display (only active players), one frame
+      const uint8_t timeCmds[] = {DISP_TIME_P1, DISP_TIME_P2, DISP_TIME_P3, DISP_TIME_P4};
+      static_assert(sizeof(timeCmds) >= MAX_PLAYERS, "the display shows four player times");
+      radio.displayBatchBegin();
+      for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (isActivePlayer(i)) {
+          radio.displayBatchAddTime(timeCmds[i], players[i].resultTicks);
+          if (gameMode == MODE_REACTION && players[i].resultTicks != RESULT_TICKS_NONE) {
+            if (players[i].resultTicks < matchBest[i]) matchBest[i] = players[i].resultTicks;
+            reactionHistory.add(i, players[i].resultTicks / RESULT_TICKS_PER_MS);
+          }
+        }
+      }
+      radio.displayBatchFlush();
+      LOGI(LOG_GAME, "[RESULTS] Phase 1: Showing reaction times\n");
+      // Phase 1 is silent: the audio task has time to decode the next round's clips.
+      // Only a regulation round follows for sure; deuce rounds are planned when
+      // the results decide there is one.
+      if (currentRound < gameRounds()) prepareRound(currentRound + 1);
+    }
+
+    // After 3 seconds, send winner and scores (Phase 2)
+    if (!resultsPhase2 && clock.nowMs() - stateStartTime > 3000) {
+      resultsPhase2 = true;
+
+      // Find and announce winner (winner + scores share one frame)
+      radio.displayBatchBegin();
+      uint8_t winner = findRoundWinner();
+      if (winner != 0xFF) {
+        players[winner].score++;
+        radio.displayBatchAdd(DISP_ROUND_WINNER, 0, winner + 1);
+        audio.playPlayerNumber(winner + 1);
+        audio.queueSound(SND_FASTEST);
+        LOGI(LOG_GAME, "[RESULTS] Round %d winner: Player %d\n", currentRound, winner+1);
+      } else {
+        radio.displayBatchAdd(DISP_ROUND_WINNER, 0, 0); // no winner
+        LOGI(LOG_GAME, "[RESULTS] No winner this round\n");
+      }
+
+      // Send scores
+      for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (players[i].joined) {
+          radio.displayBatchAdd(DISP_SCORES, i + 1, players[i].score);
+        }
+      }
+      radio.displayBatchFlush();
+
+      LOGI(LOG_GAME, "[RESULTS] Phase 2: Showing winner and scores\n");
+      for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (players[i].joined)
+          LOGI(LOG_GAME, "  Player %d: score=%d, time=%d ms\n", i+1, players[i].score,
+                         resultTicksToMs(players[i].resultTicks));
+      }
+    }
+
+    // After 6 seconds total (3s times + 3s scores), transition to next state
+    if (clock.nowMs() - stateStartTime <= 6000) return;
+    resultsPhase2 = false;
+
+    // Track consecutive all-timeout rounds; reset to join after 2 in a row
+    if (findRoundWinner() == 0xFF) {
+      consecutiveTimeouts++;
+      LOGI(LOG_GAME, "[RESULTS] All players timed out (%d consecutive)\n", consecutiveTimeouts);
+      if (consecutiveTimeouts >= 2 && !tour.active()) {   // a match plays out: no-shows just lose
+        LOGI(LOG_GAME, "[RESULTS] 2 consecutive timeouts - returning to join phase\n");
+        toActiveSticks(CMD_IDLE, 0);
+        toDisplay(DISP_IDLE, 0, 0);
+        goTo(STATE_IDLE);
+        return;
+      }
+    } else {
+      consecutiveTimeouts = 0;
+    }
+
+    if (inDeuce) {
+      // Check if either deuce player has enough lead
+      int diff = abs((int)players[deucePlayer[0]].score - (int)players[deucePlayer[1]].score);
+      if (diff >= DEUCE_LEAD) {
+        LOGI(LOG_GAME, "[DEUCE] Lead of %d reached - going to final winner\n", diff);
+        goTo(STATE_FINAL_WINNER);
+      } else {
+        LOGI(LOG_GAME, "[DEUCE] Score diff=%d, need %d - continuing\n", diff, DEUCE_LEAD);
+        prepareRound(currentRound + 1);
+        goTo(STATE_COUNTDOWN);
+      }
+    } else if (currentRound >= gameRounds()) {
+      if (!tour.active() && checkDeuce()) {
+        // Deuce detected — enter deuce mode
+        inDeuce = true;
+        LOGI(LOG_GAME, "[DEUCE] Deuce between Player %d and Player %d!\n",
+                       deucePlayer[0] + 1, deucePlayer[1] + 1);
+        toDisplay(DISP_DEUCE, deucePlayer[0] + 1, deucePlayer[1] + 1);
+        // Send CMD_IDLE to non-deuce joysticks
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+          if (players[i].joined && slotToStick[i] != 0xFF &&
+              i != deucePlayer[0] && i != deucePlayer[1]) {
+            radio.sendWithRetry(slotToStick[i], CMD_IDLE, 0);
+            LOGI(LOG_GAME, "[DEUCE] Sent CMD_IDLE to Player %d (out of deuce)\n", i + 1);
+          }
+        }
+        prepareRound(currentRound + 1);
+        goTo(STATE_COUNTDOWN);
+      } else {
+        goTo(STATE_FINAL_WINNER);
+      }
+    } else {
+      goTo(STATE_COUNTDOWN);
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+  // FINAL WINNER
+  // ---------------------------------------------------------------------------
+  void handleFinalWinner() {
+    const bool match = tour.active();
+    if (stateStartTime == 0) {
+      stateStartTime = clock.nowMs();
+      uint8_t winner = match ? reportMatch() : findFinalWinner();
+      // Between tournament matches: the winner only, and the next entrants on screen
+      const bool ceremony = !match || tour.finished();
+      setNeo(NEO_IDLE_RAINBOW);
+
+      if (winner != 0xFF) {
+        LOGI(LOG_GAME, "[FINAL] Winner: Player %d\n", winner + 1);
+        toDisplay(DISP_FINAL_WINNER, 0, winner + 1);
+        // Play winner announcement first, then victory music, then game over
+        audio.playPlayerWins(winner + 1);
+        if (ceremony) audio.queueSound(SND_VICTORY_FANFARE);
+      } else {
+        LOGI(LOG_GAME, "[FINAL] No winner (all scores 0)\n");
+        toDisplay(DISP_FINAL_WINNER, 0, 0);
+      }
+      if (ceremony) audio.queueSound(SND_GAME_OVER);
+      if (match) sendSeats();
+    }
+
+    if (match && !tour.finished()) {
+      if (clock.nowMs() - stateStartTime > TOUR_RESULT_MS) goTo(STATE_JOIN);   // changeover
+      return;
+    }
+    if (clock.nowMs() - stateStartTime > DURATION_FINAL) {
+      if (match) tour.stop();   // the seats went out empty with the champion
+      goTo(STATE_IDLE);
+    }
+  }
+
+  GameClock &clock;
+  GameRadio &radio;
+  GameLeds &leds;
+  GameAudio &audio;
+  Timeline<GameCore> timeline;  // countdown/GO cues at absolute instants
+
+  uint32_t stateStartTime = 0;          // 0 = the state's entry work hasn't run yet
+  uint8_t audioScene = STATE_IDLE;      // last scene given to audio.setScene()
+
+  // Join phase
+  uint8_t stickToSlot[MAX_STICKS];    // [stickIndex()] = slot it claimed, 0xFF = none
+  char slotMapBuf[MAX_PLAYERS * 5 + 1];
+  uint8_t currentPromptSlot = 0;      // which player slot we're currently prompting (0-3)
+  uint32_t promptStartTime = 0;       // when current prompt started, 0 = claimed, advance
+  bool joinComplete = false;          // true = enough players, waiting 1s before countdown
+  uint32_t joinCompleteTime = 0;
+  bool changeover = false;            // tournament JOIN: seating the next match
+  uint8_t readyMask = 0;              // changeover: slots whose entrant pressed (bit per slot)
+  uint32_t matchBest[MAX_PLAYERS];    // fastest reaction this game, ticks (tournament tie-break)
+
+  uint8_t consecutiveTimeouts = 0;    // how many rounds in a row all players timed out
+
+  // Round config
+  uint8_t delayIdx = 0;               // index into REACT_DELAYS
+  uint8_t targetIdx = 0;              // index into SHAKE_TARGETS
+  uint8_t lastDelayIdx  = 0xFF;       // prevent repeat
+  uint8_t lastTargetIdx = 0xFF;
+
+  RoundPlan roundPlan[TOTAL_ROUNDS] = {};  // planFor(); filled by planGame() at join
+
+  // Mode shuffle bag: ensures both modes are played before repeating
+  uint8_t modeBag[2] = {MODE_REACTION, MODE_SHAKE};
+  uint8_t modeBagIdx = 0;  // alternates: 0=REACTION, 1=SHAKE, 2=REACTION, ...
+
+  // First-time instruction tracking (only show instructions first time each mode is played)
+  bool reactionInstructPlayed = false;
+  bool shakeInstructPlayed = false;
+
+  // Reaction announcement tracking
+  bool reactionAnnouncementDone = false;  // wait for voice before random delay
+  uint32_t announceEndMs = 0;             // when the queued announcements finish
+
+  // Collect phase
+  bool collectYellowPhase = false;    // yellow warning before disqualification
+  uint32_t collectYellowStart = 0;
+  uint32_t collectWaitMs = TIMEOUT_REACTION;  // timeout, and then the warning's length
+  ReactionHistory reactionHistory;    // this game's reactions per slot (adaptive timeouts)
+
+  bool resultsPhase2 = false;         // false = showing times, true = showing winner/scores
+};
+
+#endif // GAME_CORE_H
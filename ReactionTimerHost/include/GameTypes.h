@@ -11,7 +11,8 @@
 // =============================================================================
 // GAME CONSTANTS
 // =============================================================================
-#define MAX_PLAYERS       4
+#define MAX_PLAYERS       4     // seats per game: one ring and one display column each
+                                // (any of the MAX_STICKS registered sticks can take one)
 #define TOTAL_ROUNDS      5
 #define DEUCE_LEAD        3     // Points lead required to win in deuce
 
@@ -35,12 +36,6 @@
 #define NUM_REACT_DELAYS  3
 static const uint16_t REACT_DELAYS[NUM_REACT_DELAYS] = {3000, 5000, 7000};
 
-// Reaction announcement delays (based on audio file lengths + 250ms gaps)
-// Subsequent: get_ready(0.99s) + gap + reaction(1.22s) = ~2.5s
-#define REACT_ANNOUNCE_DELAY        3000   // ms - subsequent rounds
-// First time: + react_inst(4.70s) + gap = ~7.4s
-#define REACT_ANNOUNCE_DELAY_FIRST  8000   // ms - first round with instructions
-
 // =============================================================================
 // SHAKE TARGETS
 // =============================================================================
@@ -67,7 +62,8 @@ typedef enum {
 typedef struct {
   bool joined;
   bool finished;
-  uint16_t reactionTime;
+  uint32_t resultTicks;       // RESULT_TICK_US units (reaction and shake), RESULT_TICKS_NONE = none/penalty
+  bool cutOff;                // no time because the round was already decided: not a penalty
   uint8_t score;
   uint8_t mac[6];
 } Player;
@@ -96,10 +92,12 @@ typedef enum {
 #define NEO_BRIGHTNESS    50
 
 // Ring mapping: Player order left-to-right: P1=Ring4, P2=Ring3, P3=Ring1, P4=Ring0
+static_assert(MAX_PLAYERS <= NUM_RINGS - 1, "every player needs a ring besides CENTER_RING");
+
 inline uint8_t playerToRing(uint8_t player) {
   // Reverse order: player 0->ring 4, player 1->ring 3, player 2->ring 1, player 3->ring 0
-  static const uint8_t mapping[4] = {4, 3, 1, 0};
-  return mapping[player & 0x03];
+  static const uint8_t mapping[MAX_PLAYERS] = {4, 3, 1, 0};
+  return mapping[player % MAX_PLAYERS];
 }
 
 // =============================================================================
@@ -109,6 +107,12 @@ inline uint8_t playerToRing(uint8_t player) {
 #define COLOR_RED         0xFF0000
 #define COLOR_GREEN       0x00FF00
 #define COLOR_YELLOW      0xFFFF00
+#define COLOR_BLUE        0x0000FF
+#define COLOR_WHITE       0xFFFFFF
+#define COLOR_CYAN        0x00FFFF
+#define COLOR_MAGENTA     0xFF00FF
+#define COLOR_ORANGE      0xFF6000
+#define COLOR_PURPLE      0x8000FF
 
 // =============================================================================
 // NO WINNER INDICATOR
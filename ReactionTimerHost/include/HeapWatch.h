@@ -0,0 +1,144 @@
+/*
+ * HeapWatch.h - Heap headroom over time, and allocations made by loop()
+ * ESP32 Host
+ *
+ * After setup() the host is meant to run without touching the heap: the
+ * MP3 decoder, the file source, the PCM cache and its spare slots are all
+ * allocated once in AudioManager::begin(), and everything else is static.
+ * sample() (a best-effort job) keeps the lowest free heap and the smallest
+ * largest-free-block seen since boot: fragmentation shows as the second
+ * shrinking while the first holds.
+ *
+ * Built with -DHEAP_WATCH=1 (env:heapwatch, which also links with
+ * --wrap=malloc,calloc,realloc) every allocation loop()'s task makes after
+ * arm() - the end of setup() - is counted with its size, and sample()
+ * warns about new ones. HEAP_WATCH=2 aborts on the first one, so the panic
+ * backtrace names the caller. Operator work is exempt (HeapWatchAllow:
+ * serial commands, the NVS stats flush). The WiFi stack and IDF drivers
+ * allocate through heap_caps_*() and aren't seen; what loop(), Arduino
+ * and newlib allocate is. Without a sound pack and with AUDIO_USE_TASK=0
+ * the SPIFFS file opens show up here: that build streams from loop().
+ *
+ * Defines the __wrap_ functions: include from main.cpp only.
+ */
+
+#ifndef HEAP_WATCH_H
+#define HEAP_WATCH_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "Log.h"
+
+#ifndef HEAP_WATCH
+#define HEAP_WATCH  0     // 1 = count loop() allocations, 2 = abort on the first
+#endif
+
+// =============================================================================
+// ALLOCATION HOOK (HEAP_WATCH builds)
+// =============================================================================
+struct HeapWatchHits {
+  volatile TaskHandle_t task;   // loop()'s task once armed, nullptr = not watching
+  volatile uint32_t count;
+  volatile uint32_t lastBytes;
+  volatile uint8_t allowDepth;  // HeapWatchAllow scopes open
+};
+
+static HeapWatchHits heapWatchHits = {};
+
+#if HEAP_WATCH
+#include <rom/ets_sys.h>   // ets_printf: no heap, no locks
+
+extern "C" void* __real_malloc(size_t n);
+extern "C" void* __real_calloc(size_t n, size_t size);
+extern "C" void* __real_realloc(void* p, size_t n);
+
+static inline void heapWatchHit(size_t n) {
+  if (!heapWatchHits.task || heapWatchHits.allowDepth || xTaskGetCurrentTaskHandle() != heapWatchHits.task) return;
+  heapWatchHits.count++;
+  heapWatchHits.lastBytes = n;
+#if HEAP_WATCH >= 2
+  ets_printf("[HEAP] loop() allocated %u bytes after setup()\n", (unsigned)n);
+  abort();
+#endif
+}
+
+extern "C" void* __wrap_malloc(size_t n) {
+  heapWatchHit(n);
+  return __real_malloc(n);
+}
+
+extern "C" void* __wrap_calloc(size_t n, size_t size) {
+  heapWatchHit(n * size);
+  return __real_calloc(n, size);
+}
+
+extern "C" void* __wrap_realloc(void* p, size_t n) {
+  heapWatchHit(n);
+  return __real_realloc(p, n);
+}
+#endif
+
+// Operator work that may allocate (serial commands, flash writes between games)
+struct HeapWatchAllow {
+  HeapWatchAllow() { heapWatchHits.allowDepth++; }
+  ~HeapWatchAllow() { heapWatchHits.allowDepth--; }
+};
+
+// =============================================================================
+// HEADROOM
+// =============================================================================
+class HeapWatch {
+public:
+  // End of setup(), from loop()'s task: from here on loop() should not allocate
+  void arm() {
+    heapWatchHits.task = xTaskGetCurrentTaskHandle();
+    sample();
+    LOGI(LOG_HEAP, "[HEAP] Armed: %lu bytes free, largest block %lu%s\n", (unsigned long)freeNow,
+         (unsigned long)largestNow, HEAP_WATCH ? ", watching loop() allocations" : "");
+  }
+
+  void sample() {
+    freeNow = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    largestNow = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (freeNow < minFree) minFree = freeNow;
+    if (largestNow < minLargest) {
+      if (minLargest != UINT32_MAX) {
+        LOGD(LOG_HEAP, "[HEAP] Largest free block down to %lu bytes\n", (unsigned long)largestNow);
+      }
+      minLargest = largestNow;
+    }
+    samples++;
+    const uint32_t hits = heapWatchHits.count;
+    if (hits != hitsReported) {
+      LOGW(LOG_HEAP, "[HEAP] loop() allocated %lu time(s) since the last check, last %lu bytes\n",
+           (unsigned long)(hits - hitsReported), (unsigned long)heapWatchHits.lastBytes);
+      hitsReported = hits;
+    }
+  }
+
+  void dump() const {
+    LOGI(LOG_HEAP, "[HEAP] Free %lu bytes now, %lu lowest seen, %lu lowest ever (IDF)\n",
+         (unsigned long)freeNow, (unsigned long)minFree,
+         (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    LOGI(LOG_HEAP, "[HEAP] Largest free block %lu bytes now, %lu smallest seen (%lu samples)\n",
+         (unsigned long)largestNow, (unsigned long)minLargest, (unsigned long)samples);
+    if (psramFound()) {
+      LOGI(LOG_HEAP, "[HEAP] PSRAM free %lu bytes, largest block %lu\n",
+           (unsigned long)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+           (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+    }
+    if (HEAP_WATCH) {
+      LOGI(LOG_HEAP, "[HEAP] loop() allocations after setup(): %lu\n", (unsigned long)heapWatchHits.count);
+    }
+  }
+
+private:
+  uint32_t freeNow = 0;
+  uint32_t largestNow = 0;
+  uint32_t minFree = UINT32_MAX;
+  uint32_t minLargest = UINT32_MAX;
+  uint32_t samples = 0;
+  uint32_t hitsReported = 0;
+};
+
+#endif // HEAP_WATCH_H
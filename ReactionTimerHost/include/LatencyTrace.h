@@ -0,0 +1,159 @@
+/*
+ * LatencyTrace.h - GO round-trip timing and MAC-layer send counts
+ * ESP32 Host
+ *
+ * Every GO is timed per stick from the moment sendGO() starts (micros(),
+ * the GO instant itself):
+ *   send    esp_now_send() for the broadcast returned
+ *   mac     OnDataSent reported the first MAC-layer outcome after the GO
+ *   ack     the stick's ACK for CMD_GO was received (RxEvent::rxUs)
+ *   result  CMD_REACTION_DONE received, minus the GO instant and the
+ *           reaction time it carries: button press -> host, including
+ *           the stick's repeats and queueing
+ * Each stage is a LogHistogram per stick; penalties and shake rounds only
+ * get the first three. OnDataSent also counts MAC-layer successes and
+ * failures per peer. It runs on the WiFi task and only pushes into an SPSC
+ * ring; drainTx() folds the events in from loop().
+ *
+ * dump() prints everything under LOG_LAT (serial "lat" command).
+ * Everything but onSent() is owned by loop().
+ */
+
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <Arduino.h>
+#include "Protocol.h"
+#include "Histogram.h"
+#include "SpscQueue.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define TRACE_STICKS       MAX_STICKS
+#define TRACE_PEER_DISPLAY TRACE_STICKS // trace peer index: sticks by stickIndex(), then these
+#define TRACE_PEER_BCAST   (TRACE_STICKS + 1)
+#define TRACE_PEERS        (TRACE_STICKS + 2)
+#define TRACE_TX_QUEUE     32     // OnDataSent events between two drains (power of 2)
+
+enum TraceStage : uint8_t {
+  STAGE_SEND,
+  STAGE_MAC,
+  STAGE_ACK,
+  STAGE_RESULT,
+  STAGE_COUNT
+};
+
+class LatencyTrace {
+public:
+  // WiFi task (OnDataSent); peer < 0 = not one of ours
+  void onSent(int8_t peer, bool ok) {
+    if (peer < 0) return;
+    TxEvent ev = {(uint8_t)peer, ok, (uint32_t)micros()};
+    if (!txQueue.push(ev)) txDropped = txDropped + 1;
+  }
+
+  // sendGO() entry: goUs is the GO instant, stickMask bit n = stick n gets a GO
+  void goStart(uint32_t goUs, uint16_t stickMask) {
+    for (uint8_t s = 0; s < TRACE_STICKS; s++) {
+      StickTrace &t = sticks[s];
+      t.pending = (stickMask >> s) & 1 ? (uint8_t)((1 << STAGE_COUNT) - 1) : 0;
+      t.goUs = goUs;
+    }
+  }
+
+  // Right after the GO broadcast's esp_now_send() returned
+  void goSent() { stageAll(STAGE_SEND, micros()); }
+
+  void onGoAck(uint8_t stick, uint32_t rxUs) {
+    if (stick < TRACE_STICKS) stage(sticks[stick], STAGE_ACK, rxUs);
+  }
+
+  // ticks = the reported reaction time; RESULT_TICKS_NONE (penalty) isn't timed
+  void onResult(uint8_t stick, uint32_t rxUs, uint32_t ticks) {
+    if (stick >= TRACE_STICKS) return;
+    StickTrace &t = sticks[stick];
+    if (ticks == RESULT_TICKS_NONE) {
+      t.pending &= ~(1 << STAGE_RESULT);
+      return;
+    }
+    uint32_t pressUs = t.goUs + ticks * RESULT_TICK_US;
+    if (!(t.pending & (1 << STAGE_RESULT)) || (int32_t)(rxUs - pressUs) < 0) return;
+    t.pending &= ~(1 << STAGE_RESULT);
+    t.hist[STAGE_RESULT].add(rxUs - pressUs);
+  }
+
+  // loop(): OnDataSent events since the last call
+  void drainTx() {
+    TxEvent ev;
+    while (txQueue.pop(ev)) {
+      if (ev.ok) txOk[ev.peer]++;
+      else txFail[ev.peer]++;
+      if (ev.peer == TRACE_PEER_BCAST) stageAll(STAGE_MAC, ev.us);
+      else if (ev.peer < TRACE_STICKS) stage(sticks[ev.peer], STAGE_MAC, ev.us);
+    }
+  }
+
+  void reset() {
+    for (uint8_t s = 0; s < TRACE_STICKS; s++) {
+      for (uint8_t g = 0; g < STAGE_COUNT; g++) sticks[s].hist[g].reset();
+    }
+    for (uint8_t p = 0; p < TRACE_PEERS; p++) txOk[p] = txFail[p] = 0;
+    txDropped = 0;
+  }
+
+  void dump() const {
+    static const char* const kStage[STAGE_COUNT] = {"send", "mac", "ack", "press->host"};
+    for (uint8_t s = 0; s < TRACE_STICKS; s++) {
+      for (uint8_t g = 0; g < STAGE_COUNT; g++) {
+        const LogHistogram &h = sticks[s].hist[g];
+        if (!h.count()) continue;
+        LOGI(LOG_LAT, "[LAT] Stick %d %s: n=%lu p50/p99/max %lu/%lu/%lu us\n", s + 1, kStage[g],
+             (unsigned long)h.count(), (unsigned long)h.percentile(50),
+             (unsigned long)h.percentile(99), (unsigned long)h.max());
+      }
+    }
+    for (uint8_t p = 0; p < TRACE_PEERS; p++) {
+      if (!txOk[p] && !txFail[p]) continue;
+      char name[12];
+      if (p < TRACE_STICKS) snprintf(name, sizeof(name), "stick %d", p + 1);
+      else snprintf(name, sizeof(name), "%s", p == TRACE_PEER_DISPLAY ? "display" : "broadcast");
+      LOGI(LOG_LAT, "[LAT] MAC %s: %lu ok, %lu failed\n", name,
+           (unsigned long)txOk[p], (unsigned long)txFail[p]);
+    }
+    if (txDropped) LOGW(LOG_LAT, "[LAT] %lu send events lost (queue full)\n", (unsigned long)txDropped);
+  }
+
+private:
+  struct TxEvent {
+    uint8_t peer;
+    bool ok;
+    uint32_t us;
+  };
+
+  struct StickTrace {
+    uint32_t goUs;
+    uint8_t pending;            // bit per TraceStage still to be timed this GO
+    LogHistogram hist[STAGE_COUNT];
+  };
+
+  // First occurrence per GO only (retries, repeats and later frames don't count)
+  void stage(StickTrace &t, TraceStage g, uint32_t us) {
+    if (!(t.pending & (1 << g))) return;
+    t.pending &= ~(1 << g);
+    t.hist[g].add(us - t.goUs);
+  }
+
+  void stageAll(TraceStage g, uint32_t us) {
+    for (uint8_t s = 0; s < TRACE_STICKS; s++) stage(sticks[s], g, us);
+  }
+
+  StickTrace sticks[TRACE_STICKS] = {};
+  uint32_t txOk[TRACE_PEERS] = {};
+  uint32_t txFail[TRACE_PEERS] = {};
+  SpscQueue<TxEvent, TRACE_TX_QUEUE> txQueue;
+  volatile uint32_t txDropped = 0;
+};
+
+#endif // LATENCY_TRACE_H
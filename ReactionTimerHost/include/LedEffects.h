@@ -0,0 +1,128 @@
+/*
+ * LedEffects.h - Lookup-table LED effects for the game rings and ambient strip
+ * ESP32 Host
+ *
+ * The colour wheel, gamma curve and fire palette are 256-entry tables built
+ * at compile time from the formulas the effects used to evaluate per pixel.
+ * LedCanvas renders straight into a NeoPixelBus pixel buffer: per-pixel hue
+ * phases (i * 256 / N) are computed once, and the bus brightness is folded
+ * into a 256-entry dimming table, so a frame is table lookups and byte
+ * stores - no divides, no branches per channel, no RgbColor round trips.
+ *
+ * Both buses use NeoGrbFeature; the buffer is G,R,B per pixel. Bytes in the
+ * buffer are already brightness-scaled, so fade() dims them in place without
+ * re-applying the brightness (GetPixelColor/SetPixelColor did).
+ */
+
+#ifndef LEDEFFECTS_H
+#define LEDEFFECTS_H
+
+#include <stdint.h>
+
+struct LedRgb {
+  uint8_t r, g, b;
+};
+
+// =============================================================================
+// TABLE FORMULAS (evaluated at compile time only)
+// =============================================================================
+// Colour wheel: red -> blue -> green -> red, same as the old wheel()/stripWheel()
+constexpr uint8_t wheelR(int p) { return p < 85 ? 255 - p * 3 : p < 170 ? 0 : (p - 170) * 3; }
+constexpr uint8_t wheelG(int p) { return p < 85 ? 0 : p < 170 ? (p - 85) * 3 : 255 - (p - 170) * 3; }
+constexpr uint8_t wheelB(int p) { return p < 85 ? p * 3 : p < 170 ? 255 - (p - 85) * 3 : 0; }
+constexpr LedRgb ledHue(int pos) { return LedRgb{wheelR(255 - pos), wheelG(255 - pos), wheelB(255 - pos)}; }
+
+// Perceptual brightness: gamma 2.0 (level^2 / 255)
+constexpr uint8_t ledGamma(int i) { return (uint8_t)(i * i / 255); }
+
+// Fire: black -> red -> yellow -> white
+constexpr LedRgb ledHeat(int t) {
+  return t < 85  ? LedRgb{(uint8_t)(t * 3), 0, 0}
+       : t < 170 ? LedRgb{255, (uint8_t)((t - 85) * 3), 0}
+       :           LedRgb{255, 255, (uint8_t)((t - 170) * 3)};
+}
+
+#define LED_T4(f, n)   f(n), f((n) + 1), f((n) + 2), f((n) + 3)
+#define LED_T16(f, n)  LED_T4(f, n), LED_T4(f, (n) + 4), LED_T4(f, (n) + 8), LED_T4(f, (n) + 12)
+#define LED_T64(f, n)  LED_T16(f, n), LED_T16(f, (n) + 16), LED_T16(f, (n) + 32), LED_T16(f, (n) + 48)
+#define LED_T256(f)    LED_T64(f, 0x00), LED_T64(f, 0x40), LED_T64(f, 0x80), LED_T64(f, 0xC0)
+
+// =============================================================================
+// TABLES
+// =============================================================================
+static constexpr LedRgb HUE_LUT[256] = { LED_T256(ledHue) };
+static constexpr uint8_t GAMMA_LUT[256] = { LED_T256(ledGamma) };
+static constexpr LedRgb HEAT_LUT[256] = { LED_T256(ledHeat) };
+
+static_assert(HUE_LUT[0].r == 255 && HUE_LUT[0].g == 0 && HUE_LUT[0].b == 0, "hue table broken");
+static_assert(HUE_LUT[85].g == 255 && HUE_LUT[170].b == 255 && HUE_LUT[170].r == 0, "hue table broken");
+static_assert(GAMMA_LUT[255] == 255 && GAMMA_LUT[128] == 64, "gamma table broken");
+static_assert(HEAT_LUT[255].b == 255 && HEAT_LUT[84].g == 0, "heat table broken");
+
+// Same rounding as NeoPixelBus RgbColor::Dim(): (v * (s + 1)) >> 8
+inline uint8_t scale8(uint8_t v, uint8_t s) { return (uint8_t)(((uint16_t)v * (s + 1)) >> 8); }
+
+// =============================================================================
+// CANVAS (one NeoPixelBus output, N pixels, GRB)
+// =============================================================================
+template <typename Bus, uint16_t N>
+class LedCanvas {
+public:
+  explicit LedCanvas(Bus &b) : bus(b) {}
+
+  // Call after bus.Begin()/SetBrightness(); again if the brightness changes
+  void begin() {
+    for (uint16_t i = 0; i < N; i++) phase[i] = (uint8_t)((uint32_t)i * 256 / N);
+    uint8_t bright = bus.GetBrightness();
+    for (uint16_t v = 0; v < 256; v++) dim[v] = scale8((uint8_t)v, bright);
+  }
+
+  void set(uint16_t i, LedRgb c) {
+    uint8_t* p = bus.Pixels() + i * 3;
+    p[0] = dim[c.g];
+    p[1] = dim[c.r];
+    p[2] = dim[c.b];
+  }
+
+  // c scaled by level (0-255) before the bus brightness
+  void set(uint16_t i, LedRgb c, uint8_t level) {
+    set(i, LedRgb{scale8(c.r, level), scale8(c.g, level), scale8(c.b, level)});
+  }
+
+  void fill(uint16_t start, uint16_t n, LedRgb c) {
+    for (uint16_t i = start; i < start + n; i++) set(i, c);
+  }
+  void fill(LedRgb c) { fill(0, N, c); }
+
+  // Whole output as one wheel, rotated by offset
+  void rainbow(uint8_t offset) {
+    for (uint16_t i = 0; i < N; i++) set(i, HUE_LUT[(uint8_t)(phase[i] + offset)]);
+  }
+
+  // Dim everything already in the buffer (trails, sparkle decay)
+  void fade(uint8_t keep) {
+    uint8_t* p = bus.Pixels();
+    for (uint16_t i = 0; i < N * 3; i++) p[i] = scale8(p[i], keep);
+  }
+
+  void fadePixel(uint16_t i, uint8_t keep) {
+    uint8_t* p = bus.Pixels() + i * 3;
+    p[0] = scale8(p[0], keep);
+    p[1] = scale8(p[1], keep);
+    p[2] = scale8(p[2], keep);
+  }
+
+  void heat(const uint8_t* cells) {
+    for (uint16_t i = 0; i < N; i++) set(i, HEAT_LUT[cells[i]]);
+  }
+
+  // Raw buffer writes bypass SetPixelColor: flag the bus so Show() sends them
+  void commit() { bus.Dirty(); }
+
+private:
+  Bus &bus;
+  uint8_t phase[N];
+  uint8_t dim[256];
+};
+
+#endif // LEDEFFECTS_H
@@ -0,0 +1,194 @@
+/*
+ * Log.h - Asynchronous binary logging for the ESP32 Host
+ *
+ * LOGE/LOGW/LOGI/LOGD(category, fmt, args...) never touch the UART. They copy
+ * a timestamp, the format string pointer (the format id) and up to
+ * LOG_MAX_ARGS integer/pointer args into a ring buffer; a low-priority task
+ * on core 0 formats and prints them at a bounded rate. When the ring is full
+ * the message is counted as dropped instead of stalling the caller.
+ *
+ * Filtering is compile-time: messages above LOG_LEVEL or outside
+ * LOG_CATEGORIES compile to nothing. Override from platformio.ini, e.g.
+ *   -DLOG_LEVEL=LOG_LEVEL_INFO -DLOG_CATEGORIES="(LOG_ALL & ~LOG_NEO)"
+ *
+ * Rules for callers: args must be integers, enums or pointers (no float),
+ * and %s args must point at strings that live forever (literals).
+ *
+ * Native builds (no ARDUINO, e.g. the env:native simulator) have no log
+ * task: the same macros printf() straight to stdout.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "SpscQueue.h"
+#else
+#include <stdio.h>
+#endif
+
+// =============================================================================
+// LEVELS + CATEGORIES
+// =============================================================================
+#define LOG_LEVEL_NONE    0
+#define LOG_LEVEL_ERROR   1
+#define LOG_LEVEL_WARN    2
+#define LOG_LEVEL_INFO    3
+#define LOG_LEVEL_DEBUG   4
+
+#define LOG_ACK           0x0001  // ACK tracking, retries
+#define LOG_NEO           0x0002  // NeoPixel rings
+#define LOG_JOIN          0x0004  // Join phase
+#define LOG_SHAKE         0x0008  // Shake mode
+#define LOG_DISP          0x0010  // Display commands
+#define LOG_NET           0x0020  // ESP-NOW receive path
+#define LOG_GAME          0x0040  // State machine, rounds, results
+#define LOG_SYNC          0x0080  // Clock sync
+#define LOG_AUDIO         0x0100  // Audio queue
+#define LOG_STRIP         0x0200  // Ambient strip
+#define LOG_SCHED         0x0400  // Frame scheduler stats
+#define LOG_LAT           0x0800  // GO round-trip and link latency dumps
+#define LOG_HEAP          0x1000  // Heap headroom, allocations after setup()
+#define LOG_BOOT          0x2000  // Boot stages and reset reason
+#define LOG_FLIGHT        0x4000  // Flight recorder dumps
+#define LOG_ALL           0xFFFF
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL         LOG_LEVEL_DEBUG
+#endif
+#ifndef LOG_CATEGORIES
+#define LOG_CATEGORIES    LOG_ALL
+#endif
+
+#ifdef ARDUINO
+
+// =============================================================================
+// BUFFER CONFIGURATION
+// =============================================================================
+#define LOG_MAX_ARGS      6
+#define LOG_QUEUE_SIZE    64      // records (power of 2), ~2.5 KB
+#define LOG_LINE_MAX      160     // formatted line buffer
+#define LOG_TASK_STACK    3072
+#define LOG_TASK_PRIORITY 1       // just above idle
+#define LOG_TASK_CORE     0       // keep UART formatting off the loop() core
+#define LOG_DRAIN_PERIOD  10      // ms between drain passes
+#define LOG_DRAIN_BUDGET  12      // max lines per pass (~1.1 KB = 10 ms of UART at 115200)
+
+typedef uintptr_t LogArg;
+
+struct LogRecord {
+  uint32_t ts;                    // micros() at log call
+  const char* fmt;                // format id (string literal address)
+  uint8_t level;
+  uint8_t nargs;
+  uint16_t cat;
+  LogArg args[LOG_MAX_ARGS];
+};
+
+class AsyncLog {
+public:
+  // Start the drain task. Messages logged before begin() are buffered.
+  void begin() {
+    xTaskCreatePinnedToCore(taskEntry, "log", LOG_TASK_STACK, this,
+                            LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE);
+  }
+
+  // Producer side - any task. The spinlock only covers the slot copy.
+  void push(uint8_t level, uint16_t cat, const char* fmt, uint8_t nargs, const LogArg* args) {
+    LogRecord rec;
+    rec.ts = micros();
+    rec.fmt = fmt;
+    rec.level = level;
+    rec.nargs = nargs;
+    rec.cat = cat;
+    for (uint8_t i = 0; i < LOG_MAX_ARGS; i++) rec.args[i] = (i < nargs) ? args[i] : 0;
+
+    portENTER_CRITICAL(&mux);
+    bool ok = queue.push(rec);
+    if (!ok) dropped++;
+    portEXIT_CRITICAL(&mux);
+  }
+
+  uint32_t droppedCount() const { return dropped; }
+
+private:
+  static void taskEntry(void* arg) {
+    static_cast<AsyncLog*>(arg)->run();
+  }
+
+  void run() {
+    uint32_t droppedReported = 0;
+    for (;;) {
+      LogRecord rec;
+      for (uint8_t n = 0; n < LOG_DRAIN_BUDGET && queue.pop(rec); n++) print(rec);
+
+      uint32_t d = dropped;
+      if (d != droppedReported) {
+        Serial.printf("[LOG] dropped %lu message(s)\n", (unsigned long)(d - droppedReported));
+        droppedReported = d;
+      }
+      vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD));
+    }
+  }
+
+  void print(const LogRecord& rec) {
+    static const char levelChar[] = {'-', 'E', 'W', 'I', 'D'};
+    char line[LOG_LINE_MAX];
+    // Every arg is passed; printf ignores the ones the format doesn't consume
+    snprintf(line, sizeof(line), rec.fmt,
+             rec.args[0], rec.args[1], rec.args[2], rec.args[3], rec.args[4], rec.args[5]);
+    Serial.printf("%lu.%03lu %c %s", (unsigned long)(rec.ts / 1000000),
+                  (unsigned long)((rec.ts / 1000) % 1000),
+                  levelChar[rec.level < sizeof(levelChar) ? rec.level : 0], line);
+  }
+
+  SpscQueue<LogRecord, LOG_QUEUE_SIZE> queue;
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  volatile uint32_t dropped = 0;
+};
+
+extern AsyncLog asyncLog;  // defined in main.cpp
+
+// =============================================================================
+// MACROS
+// =============================================================================
+template <typename T>
+inline LogArg logArg(T v) { return (LogArg)v; }
+template <typename T>
+inline LogArg logArg(T* p) { return (LogArg)(uintptr_t)p; }
+
+template <typename... Args>
+inline void logPush(uint8_t level, uint16_t cat, const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  const LogArg a[] = {logArg(args)..., 0};
+  asyncLog.push(level, cat, fmt, sizeof...(Args), a);
+}
+
+// Never called - lets the compiler check format strings against their args
+inline void logFormatCheck(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void logFormatCheck(const char*, ...) {}
+
+#define LOG_AT(level, cat, fmt, ...) do {                                   \
+    if ((level) <= LOG_LEVEL && ((cat) & (LOG_CATEGORIES))) {              \
+      if (false) logFormatCheck(fmt, ##__VA_ARGS__);                       \
+      logPush((level), (cat), fmt, ##__VA_ARGS__);                         \
+    }                                                                       \
+  } while (0)
+
+#else  // native
+
+#define LOG_AT(level, cat, fmt, ...) do {                                   \
+    if ((level) <= LOG_LEVEL && ((cat) & (LOG_CATEGORIES))) {              \
+      printf(fmt, ##__VA_ARGS__);                                           \
+    }                                                                       \
+  } while (0)
+
+#endif // ARDUINO
+
+#define LOGE(cat, fmt, ...) LOG_AT(LOG_LEVEL_ERROR, cat, fmt, ##__VA_ARGS__)
+#define LOGW(cat, fmt, ...) LOG_AT(LOG_LEVEL_WARN,  cat, fmt, ##__VA_ARGS__)
+#define LOGI(cat, fmt, ...) LOG_AT(LOG_LEVEL_INFO,  cat, fmt, ##__VA_ARGS__)
+#define LOGD(cat, fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, cat, fmt, ##__VA_ARGS__)
+
+#endif // LOG_H
@@ -0,0 +1,94 @@
+/*
+ * Mp3Info.h - Clip length and format from MP3 headers
+ * ESP32 Host
+ *
+ * Skips an ID3v2 tag, finds the first MPEG Layer III frame header and
+ * reads sample rate and channel mode. Length comes from the Xing/Info
+ * frame count when present (VBR), otherwise from file size / bitrate (CBR).
+ * Only the first few KB are read; nothing is decoded.
+ */
+
+#ifndef MP3INFO_H
+#define MP3INFO_H
+
+#include <Arduino.h>
+#include "SPIFFS.h"
+
+#define MP3_SCAN_BYTES  4096   // give up looking for a frame header after this
+
+struct Mp3Info {
+  uint32_t rate;        // Hz
+  uint8_t channels;
+  uint32_t durationMs;
+};
+
+// Layer III bitrates (kbps) by index 1-14
+static const uint16_t MP3_KBPS_V1[15]  = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+static const uint16_t MP3_KBPS_V2[15]  = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160};
+static const uint16_t MP3_RATE_V1[3]   = {44100, 48000, 32000};
+
+inline uint32_t mp3Be32(const uint8_t* b) {
+  return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+inline bool mp3ReadInfo(const char* path, Mp3Info &info) {
+  File f = SPIFFS.open(path, "r");
+  if (!f) return false;
+  uint32_t fileSize = f.size();
+
+  // ID3v2: 10-byte header, syncsafe size, optional 10-byte footer
+  uint8_t h[10];
+  uint32_t pos = 0;
+  if (f.read(h, 10) == 10 && h[0] == 'I' && h[1] == 'D' && h[2] == '3') {
+    pos = 10 + (((uint32_t)h[6] & 0x7F) << 21 | ((uint32_t)h[7] & 0x7F) << 14 |
+                ((uint32_t)h[8] & 0x7F) << 7 | (h[9] & 0x7F));
+    if (h[5] & 0x10) pos += 10;
+  }
+
+  // First valid Layer III frame header, plus enough after it for a Xing tag
+  uint8_t buf[256];
+  uint32_t limit = pos + MP3_SCAN_BYTES;
+  bool found = false;
+  uint8_t frame[4 + 32 + 12];  // header + largest side info + tag, flags, frames
+  while (!found && pos < limit && f.seek(pos)) {
+    size_t n = f.read(buf, sizeof(buf));
+    if (n < sizeof(frame)) break;
+    for (size_t i = 0; i + sizeof(frame) <= n; i++) {
+      const uint8_t* b = &buf[i];
+      if (b[0] != 0xFF || (b[1] & 0xE0) != 0xE0) continue;
+      uint8_t ver = (b[1] >> 3) & 3;      // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+      uint8_t layer = (b[1] >> 1) & 3;    // 1 = Layer III
+      uint8_t brIdx = b[2] >> 4;
+      uint8_t srIdx = (b[2] >> 2) & 3;
+      if (ver == 1 || layer != 1 || brIdx == 0 || brIdx == 15 || srIdx == 3) continue;
+      memcpy(frame, b, sizeof(frame));
+      pos += i;
+      found = true;
+      break;
+    }
+    if (!found) pos += n - sizeof(frame) + 1;
+  }
+  f.close();
+  if (!found) return false;
+
+  uint8_t ver = (frame[1] >> 3) & 3;
+  bool mpeg1 = (ver == 3);
+  uint8_t brIdx = frame[2] >> 4;
+  bool mono = (frame[3] >> 6) == 3;
+  uint32_t kbps = mpeg1 ? MP3_KBPS_V1[brIdx] : MP3_KBPS_V2[brIdx];
+  info.rate = MP3_RATE_V1[(frame[2] >> 2) & 3] >> (ver == 3 ? 0 : ver == 2 ? 1 : 2);
+  info.channels = mono ? 1 : 2;
+
+  // Xing/Info tag sits right after the side info
+  uint8_t side = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+  const uint8_t* x = &frame[4 + side];
+  uint32_t samplesPerFrame = mpeg1 ? 1152 : 576;
+  if ((memcmp(x, "Xing", 4) == 0 || memcmp(x, "Info", 4) == 0) && (mp3Be32(x + 4) & 1)) {
+    info.durationMs = (uint32_t)((uint64_t)mp3Be32(x + 8) * samplesPerFrame * 1000 / info.rate);
+  } else {
+    info.durationMs = (uint32_t)((uint64_t)(fileSize - pos) * 8 / kbps);
+  }
+  return true;
+}
+
+#endif // MP3INFO_H
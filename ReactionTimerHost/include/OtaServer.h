@@ -0,0 +1,295 @@
+/*
+ * OtaServer.h - Firmware update packages served to sticks and display
+ * ESP32 Host (FIRMWARE UPDATE in Protocol.h)
+ *
+ * ota_pack.py builds /ota/stick.pkg and /ota/display.pkg into the SPIFFS
+ * image; load() opens them once SPIFFS is mounted and keeps them open.
+ * Package layout (little-endian):
+ *   OtaPackageHeader | OtaPackageEntry[blocks] | records (OtaImage.h)
+ *
+ * main.cpp calls offer() for every known device each OTA_OFFER_MS while
+ * the table is idle: a device hears about a package only if it runs OTA
+ * firmware older than the package and, for a delta, exactly its base.
+ * Devices pull: onFrame() (WiFi task) queues their CMD_OTA_REQ, run()
+ * (loop()) turns each into the chunks the device is missing and sends
+ * them round robin, OTA_CHUNKS_PER_RUN per pass. Nothing is sent outside
+ * STATE_IDLE; a device that got no data asks again, so a game that starts
+ * mid-block only pauses the transfer. A device that answers OTA_BLOCK_FAIL
+ * is not offered that package again until the host reboots.
+ */
+
+#ifndef OTA_SERVER_H
+#define OTA_SERVER_H
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include "Protocol.h"
+#include "SpscQueue.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define OTA_STICK_FILE       "/ota/stick.pkg"
+#define OTA_DISPLAY_FILE     "/ota/display.pkg"
+#define OTA_PKG_MAGIC        0x414F5452UL   // "RTOA"
+#define OTA_PKG_FORMAT       1
+#define OTA_CHUNKS_PER_RUN   3       // CMD_OTA_DATA per run(), all devices together
+#define OTA_REQ_QUEUE        8       // requests waiting for loop() (power of 2)
+#define OTA_SLOTS            (MAX_STICKS + 1)   // sticks by stickIndex(), then the display
+
+typedef void (*OtaSendFn)(const uint8_t* mac, const uint8_t* data, size_t len);
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint8_t format;
+  uint8_t target;       // OtaTarget
+  uint16_t version;     // encodeVersion()
+  uint16_t base;        // 0 = full image
+  uint16_t blocks;
+  uint32_t imageSize;
+  uint32_t imageCrc;
+  uint32_t baseCrc;     // of the base image, 0 for a full one (information only)
+} OtaPackageHeader;
+
+typedef struct __attribute__((packed)) {
+  uint32_t offset;      // from the start of the file
+  uint16_t len;
+  uint16_t reserved;
+} OtaPackageEntry;
+
+static_assert(sizeof(OtaPackageHeader) == 24 && sizeof(OtaPackageEntry) == 8,
+              "OtaServer.h: package layout must match ota_pack.py");
+
+class OtaServer {
+public:
+  void begin(OtaSendFn sendFn) { send = sendFn; }
+
+  // Once SPIFFS is mounted (opens allocate: main.cpp allows it)
+  void load() {
+    loaded = true;
+    open(pkgs[0], OTA_STICK_FILE, OTA_TARGET_STICK);
+    open(pkgs[1], OTA_DISPLAY_FILE, OTA_TARGET_DISPLAY);
+  }
+  bool isLoaded() const { return loaded; }
+
+  // WiFi task (receiveFrame): the requests for loop()
+  void onFrame(const uint8_t* data, int len) {
+    if (!validateOtaFrame(data, len) || data[3] != CMD_OTA_REQ || data[1] != ID_HOST) return;
+    OtaReqPacket req;
+    memcpy(&req, data, sizeof(req));
+    if (!requests.push(req)) dropped = dropped + 1;
+  }
+
+  // True when offers are due (every OTA_OFFER_MS, idle, a package loaded)
+  bool offersDue(uint32_t nowMs, bool idle) {
+    if (!idle || !(pkgs[0].ready || pkgs[1].ready) || nowMs - lastOfferMs < OTA_OFFER_MS) return false;
+    lastOfferMs = nowMs;
+    return true;
+  }
+
+  // id: stick ID or ID_DISPLAY; mac: where its frames go; fw: what it runs
+  void offer(uint8_t id, const uint8_t* mac, FwVersion fw) {
+    const int8_t slot = slotFor(id);
+    if (slot < 0 || !supportsOta(fw)) return;
+    Package &p = pkgs[id == ID_DISPLAY ? 1 : 0];
+    const uint16_t running = encodeVersion(fw.major, fw.minor, fw.patch);
+    if (!p.ready || running >= p.h.version || (p.h.base && p.h.base != running)) return;
+    Session &s = sessions[slot];
+    if (s.refusedCrc == p.h.imageCrc) return;
+    memcpy(s.mac, mac, 6);
+    s.known = true;
+
+    OtaOfferPacket o;
+    o.dest_id = id;
+    o.src_id = ID_HOST;
+    o.cmd = CMD_OTA_OFFER;
+    o.target = p.h.target;
+    o.version = p.h.version;
+    o.base = p.h.base;
+    o.imageSize = p.h.imageSize;
+    o.imageCrc = p.h.imageCrc;
+    o.blocks = p.h.blocks;
+    sealOtaFrame((uint8_t*)&o, sizeof(o));
+    send(mac, (const uint8_t*)&o, sizeof(o));
+  }
+
+  // Job: requests in, chunks out. Outside idle the requests are dropped
+  // (the devices repeat them) and nothing is sent.
+  void run(bool idle) {
+    OtaReqPacket req;
+    while (requests.pop(req)) {
+      if (idle) take(req);
+      else if (req.block >= OTA_BLOCK_FAIL) take(req);   // outcomes still count
+    }
+    if (!idle) {
+      for (uint8_t i = 0; i < OTA_SLOTS; i++) sessions[i].pending = 0;
+      return;
+    }
+    uint8_t sent = 0;
+    for (uint8_t n = 0; n < OTA_SLOTS && sent < OTA_CHUNKS_PER_RUN; n++) {
+      next = (next + 1) % OTA_SLOTS;
+      Session &s = sessions[next];
+      while (s.pending && sent < OTA_CHUNKS_PER_RUN) {
+        const uint8_t chunk = (uint8_t)__builtin_ctz(s.pending);
+        s.pending &= ~(1UL << chunk);
+        if (!sendChunk(s, next, chunk)) {
+          s.pending = 0;
+          break;
+        }
+        sent++;
+      }
+    }
+  }
+
+  void dump() const {
+    for (uint8_t i = 0; i < 2; i++) {
+      const Package &p = pkgs[i];
+      if (!p.ready) {
+        LOGI(LOG_NET, "[OTA] %s: no package\n", i ? "Display" : "Sticks");
+        continue;
+      }
+      const FwVersion v = decodeVersion(p.h.version), b = decodeVersion(p.h.base);
+      LOGI(LOG_NET, "[OTA] %s: V%d.%d.%d, %lu bytes in %d blocks\n", i ? "Display" : "Sticks",
+           v.major, v.minor, v.patch, (unsigned long)p.h.imageSize, p.h.blocks);
+      if (p.h.base) LOGI(LOG_NET, "[OTA]   delta from V%d.%d.%d\n", b.major, b.minor, b.patch);
+      else LOGI(LOG_NET, "[OTA]   full image\n");
+    }
+    for (uint8_t i = 0; i < OTA_SLOTS; i++) {
+      const Session &s = sessions[i];
+      if (!s.known) continue;
+      const char* state = s.refusedCrc ? "failed" : s.doneCrc ? "rebooting" : s.blocksSent ? "updating" : "offered";
+      if (i == OTA_SLOTS - 1) LOGI(LOG_NET, "[OTA]   Display: %s, block %d\n", state, s.block);
+      else LOGI(LOG_NET, "[OTA]   Stick %d: %s, block %d\n", i + 1, state, s.block);
+    }
+    if (dropped) LOGW(LOG_NET, "[OTA] %lu requests dropped (loop() behind)\n", (unsigned long)dropped);
+  }
+
+private:
+  struct Package {
+    File f;
+    OtaPackageHeader h;
+    bool ready = false;
+  };
+
+  struct Session {
+    uint8_t mac[6];
+    bool known = false;         // offered at least once
+    uint32_t imageCrc = 0;
+    uint16_t block = 0;
+    uint32_t recordOffset = 0;
+    uint16_t recordLen = 0;
+    uint32_t pending = 0;       // chunks still to send for block
+    uint16_t blocksSent = 0;
+    uint32_t doneCrc = 0;
+    uint32_t refusedCrc = 0;
+  };
+
+  void open(Package &p, const char* path, uint8_t target) {
+    if (!SPIFFS.exists(path)) return;
+    p.f = SPIFFS.open(path, "r");
+    if (!p.f) return;
+    const size_t size = p.f.size();
+    if (p.f.read((uint8_t*)&p.h, sizeof(p.h)) != sizeof(p.h) || p.h.magic != OTA_PKG_MAGIC ||
+        p.h.format != OTA_PKG_FORMAT || p.h.target != target || p.h.blocks == 0 ||
+        (uint32_t)p.h.blocks * OTA_BLOCK_SIZE < p.h.imageSize ||
+        size < sizeof(p.h) + (size_t)p.h.blocks * sizeof(OtaPackageEntry)) {
+      LOGW(LOG_NET, "[OTA] %s is not a package for this firmware - ignored\n", path);
+      p.f.close();
+      return;
+    }
+    p.ready = true;
+    const FwVersion v = decodeVersion(p.h.version);
+    LOGI(LOG_NET, "[OTA] %s: V%d.%d.%d, %lu bytes to send\n", path, v.major, v.minor, v.patch, (unsigned long)size);
+  }
+
+  static int8_t slotFor(uint8_t id) {
+    if (id == ID_DISPLAY) return OTA_SLOTS - 1;
+    return isStickId(id) ? stickIndex(id) : -1;
+  }
+
+  Package* packageFor(uint32_t imageCrc) {
+    for (uint8_t i = 0; i < 2; i++) {
+      if (pkgs[i].ready && pkgs[i].h.imageCrc == imageCrc) return &pkgs[i];
+    }
+    return nullptr;
+  }
+
+  void take(const OtaReqPacket &req) {
+    const int8_t slot = slotFor(req.src_id);
+    Package* p = packageFor(req.imageCrc);
+    if (slot < 0 || !p || !sessions[slot].known) return;
+    Session &s = sessions[slot];
+    if (req.block == OTA_BLOCK_DONE || req.block == OTA_BLOCK_FAIL) {
+      s.pending = 0;
+      if (req.block == OTA_BLOCK_DONE && s.doneCrc != req.imageCrc) {
+        s.doneCrc = req.imageCrc;
+        logSlot(slot, "image checked out, rebooting into it");
+      } else if (req.block == OTA_BLOCK_FAIL && s.refusedCrc != req.imageCrc) {
+        s.refusedCrc = req.imageCrc;
+        logSlot(slot, "update failed - not offered again");
+      }
+      return;
+    }
+    if (req.block >= p->h.blocks) return;
+
+    OtaPackageEntry e;
+    if (!p->f.seek(sizeof(OtaPackageHeader) + (uint32_t)req.block * sizeof(OtaPackageEntry)) ||
+        p->f.read((uint8_t*)&e, sizeof(e)) != sizeof(e) || e.len == 0 || e.len > OTA_RECORD_MAX) {
+      LOGE(LOG_NET, "[OTA] Package entry %d unreadable\n", req.block);
+      return;
+    }
+    if (s.imageCrc != req.imageCrc || s.block != req.block) {
+      if (req.block == 0 || s.imageCrc != req.imageCrc) logSlot(slot, "sending update");
+      s.blocksSent++;
+    }
+    s.imageCrc = req.imageCrc;
+    s.block = req.block;
+    s.recordOffset = e.offset;
+    s.recordLen = e.len;
+    const uint8_t chunks = otaChunks(e.len);
+    const uint32_t all = chunks >= 32 ? 0xFFFFFFFFUL : (1UL << chunks) - 1;
+    s.pending = all & ~req.have;
+  }
+
+  bool sendChunk(const Session &s, uint8_t slot, uint8_t chunk) {
+    Package* p = packageFor(s.imageCrc);
+    if (!p) return false;
+    const uint16_t len = otaChunkLen(s.recordLen, chunk);
+    OtaDataHeader* h = (OtaDataHeader*)frame;
+    h->dest_id = slot == OTA_SLOTS - 1 ? ID_DISPLAY : (uint8_t)(ID_STICK_FIRST + slot);
+    h->src_id = ID_HOST;
+    h->cmd = CMD_OTA_DATA;
+    h->imageCrc = s.imageCrc;
+    h->block = s.block;
+    h->recordLen = s.recordLen;
+    h->chunk = chunk;
+    if (!p->f.seek(s.recordOffset + (uint32_t)chunk * OTA_CHUNK_BYTES) ||
+        p->f.read(frame + sizeof(OtaDataHeader), len) != len) {
+      LOGE(LOG_NET, "[OTA] Package read failed at block %d\n", s.block);
+      return false;
+    }
+    const uint32_t frameLen = sizeof(OtaDataHeader) + len + 4;
+    sealOtaFrame(frame, frameLen);
+    send(s.mac, frame, frameLen);
+    return true;
+  }
+
+  // what: string literal
+  void logSlot(uint8_t slot, const char* what) const {
+    if (slot == OTA_SLOTS - 1) LOGI(LOG_NET, "[OTA] Display: %s\n", what);
+    else LOGI(LOG_NET, "[OTA] Stick %d: %s\n", slot + 1, what);
+  }
+
+  OtaSendFn send = nullptr;
+  Package pkgs[2];              // sticks, display
+  Session sessions[OTA_SLOTS];
+  SpscQueue<OtaReqPacket, OTA_REQ_QUEUE> requests;
+  uint8_t frame[OTA_DATA_MAX_BYTES];
+  uint8_t next = 0;
+  uint32_t lastOfferMs = 0;
+  volatile uint32_t dropped = 0;
+  bool loaded = false;
+};
+
+#endif // OTA_SERVER_H
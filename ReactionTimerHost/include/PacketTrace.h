@@ -0,0 +1,239 @@
+/*
+ * PacketTrace.h - Record received ESP-NOW traffic, replay it into the RX path
+ * ESP32 Host (and the env:native simulator)
+ *
+ * Recording: OnDataRecv hands every frame (MAC, bytes, callback time) to
+ * record() while armed; frames are packed back to back into one RAM
+ * buffer until it is full. TraceFile.h keeps a trace in SPIFFS across
+ * reboots; sim/GameSim.cpp reads the same file from disk. Either way a
+ * loaded trace goes through adopt(), which walks every frame once and
+ * rejects a file whose frame count or lengths don't add up.
+ *
+ * Replay: run() (a loop() job) feeds each recorded frame to the normal
+ * receive entry point at its original offset divided by the speed
+ * (1x, 10x, 100x), stamped with the replay time as its rxUs. While a
+ * replay runs, live radio frames are ignored and the host's sends are
+ * swallowed (mutesRadio()), so the trace is the only producer for the RX
+ * queue and nothing reaches real sticks. A replay starts only in IDLE and
+ * restarts it, as a recording made from IDLE does: at 1x the state
+ * changes line up with the original game. At 10x/100x the game's own
+ * timers don't speed up: it stresses the packet path only.
+ *
+ * Measured per replay (hooks called from loop()): RX queue time
+ * (callback -> handlePacket), deepest RX queue, RX drops, and every state
+ * transition with its replay time and the time since the last frame was
+ * handled. The summary is logged under LOG_LAT when the trace runs out.
+ *
+ * No Arduino calls here: times come in as arguments.
+ * record() is the WiFi task's; everything else is owned by loop().
+ */
+
+#ifndef PACKET_TRACE_H
+#define PACKET_TRACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "Histogram.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define TRACE_BUF_BYTES   16384         // ~1500 GamePackets, a few full games
+#define TRACE_MAGIC       0x43525452UL  // "RTRC"
+
+// File layout: this header, then `bytes` of frames exactly as recorded
+struct TraceFileHeader {
+  uint32_t magic;
+  uint32_t frames;
+  uint32_t bytes;
+};
+
+typedef void (*TraceFrameFn)(const uint8_t* mac, const uint8_t* data, int len, uint32_t rxUs);
+
+class PacketTrace {
+public:
+  enum Mode : uint8_t { TRACE_IDLE, TRACE_RECORDING, TRACE_REPLAYING };
+
+  // ---------------------------------------------------------------------------
+  // Recording
+  // ---------------------------------------------------------------------------
+  void startRecording(uint32_t nowUs) {
+    if (mode != TRACE_IDLE) return;
+    used.store(0, std::memory_order_relaxed);
+    frames = 0;
+    lost = 0;
+    recStartUs = nowUs;
+    mode = TRACE_RECORDING;
+    LOGI(LOG_LAT, "[TRACE] Recording (%u bytes of buffer)\n", TRACE_BUF_BYTES);
+  }
+
+  void stopRecording() {
+    if (mode != TRACE_RECORDING) return;
+    mode = TRACE_IDLE;
+    LOGI(LOG_LAT, "[TRACE] Recorded %lu frames, %lu bytes, %lu lost (buffer full)\n",
+         (unsigned long)frames, (unsigned long)used.load(std::memory_order_acquire),
+         (unsigned long)lost);
+  }
+
+  // WiFi task (OnDataRecv entry)
+  void record(const uint8_t* mac, const uint8_t* data, int len, uint32_t rxUs) {
+    if (mode != TRACE_RECORDING || len <= 0 || len > 255) return;
+    uint32_t at = used.load(std::memory_order_relaxed);
+    if (at + sizeof(Header) + len > TRACE_BUF_BYTES) {
+      lost++;
+      return;
+    }
+    Header h;
+    h.offsetUs = rxUs - recStartUs;
+    memcpy(h.mac, mac, 6);
+    h.len = (uint8_t)len;
+    memcpy(buf + at, &h, sizeof(h));
+    memcpy(buf + at + sizeof(h), data, len);
+    frames++;
+    used.store(at + sizeof(h) + len, std::memory_order_release);
+  }
+
+  // ---------------------------------------------------------------------------
+  // Replay
+  // ---------------------------------------------------------------------------
+  bool startReplay(uint16_t speed, TraceFrameFn fn, uint32_t nowUs, uint32_t rxDropped) {
+    if (mode != TRACE_IDLE || !frames || !speed || !fn) return false;
+    replaySpeed = speed;
+    deliver = fn;
+    pos = 0;
+    replayed = 0;
+    replayStartUs = nowUs;
+    lastFrameUs = replayStartUs;
+    dropsAtStart = rxDropped;
+    queueUs.reset();
+    queueMax = 0;
+    transitions = 0;
+    mode = TRACE_REPLAYING;
+    LOGI(LOG_LAT, "[TRACE] Replaying %lu frames at %ux\n", (unsigned long)frames, speed);
+    return true;
+  }
+
+  // Replay job: deliver every frame that is due. Ends the replay after the
+  // last one, or at a frame that would run past the recorded bytes.
+  void run(uint32_t nowUs, uint32_t rxDropped) {
+    if (mode != TRACE_REPLAYING) return;
+    const uint32_t end = used.load(std::memory_order_acquire);
+    while (pos < end) {
+      Header h;
+      if (pos + sizeof(h) > end) break;
+      memcpy(&h, buf + pos, sizeof(h));
+      if (pos + sizeof(h) + h.len > end) break;
+      uint32_t dueUs = replayStartUs + h.offsetUs / replaySpeed;
+      if ((int32_t)(nowUs - dueUs) < 0) return;
+      deliver(h.mac, buf + pos + sizeof(h), h.len, dueUs);
+      pos += sizeof(h) + h.len;
+      replayed++;
+    }
+    pos = end;
+    // Wait a moment for the last frames to drain through the RX queue
+    if ((int32_t)(nowUs - lastFrameUs) < 50000) return;
+    mode = TRACE_IDLE;
+    logSummary(nowUs, rxDropped);
+  }
+
+  void abortReplay(uint32_t nowUs, uint32_t rxDropped) {
+    if (mode != TRACE_REPLAYING) return;
+    mode = TRACE_IDLE;
+    logSummary(nowUs, rxDropped);
+  }
+
+  bool replaying() const { return mode == TRACE_REPLAYING; }
+  bool mutesRadio() const { return mode == TRACE_REPLAYING; }
+  uint32_t frameCount() const { return frames; }
+
+  // processRxQueue(): one event handled, queued for queuedUs, depth before draining
+  void onHandled(uint32_t nowUs, uint32_t queuedUs, uint32_t depth) {
+    if (mode != TRACE_REPLAYING) return;
+    queueUs.add(queuedUs);
+    if (depth > queueMax) queueMax = depth;
+    lastFrameUs = nowUs;
+  }
+
+  void onTransition(uint8_t from, uint8_t to, uint32_t nowUs) {
+    if (mode != TRACE_REPLAYING) return;
+    transitions++;
+    LOGI(LOG_LAT, "[TRACE] +%lu ms: state %d -> %d, %lu us after the last frame\n",
+         (unsigned long)((nowUs - replayStartUs) / 1000), from, to,
+         (unsigned long)(nowUs - lastFrameUs));
+  }
+
+  // ---------------------------------------------------------------------------
+  // Files (TraceFile.h, GameSim.cpp): fh and then `bytes` from frameBytes()
+  // ---------------------------------------------------------------------------
+  bool fileHeader(TraceFileHeader* fh) const {
+    if (mode != TRACE_IDLE || !frames) return false;
+    fh->magic = TRACE_MAGIC;
+    fh->frames = frames;
+    fh->bytes = used.load(std::memory_order_acquire);
+    return true;
+  }
+
+  const uint8_t* frameBytes() const { return buf; }
+
+  // Loading: read fh.bytes into loadBuffer() (room for TRACE_BUF_BYTES),
+  // then adopt() checks it and makes it the trace; false leaves none.
+  uint8_t* loadBuffer() { return mode == TRACE_IDLE ? buf : nullptr; }
+
+  bool adopt(const TraceFileHeader& fh) {
+    if (mode != TRACE_IDLE) return false;
+    bool ok = fh.magic == TRACE_MAGIC && fh.bytes <= TRACE_BUF_BYTES;
+    uint32_t at = 0;
+    uint32_t n = 0;
+    while (ok && at < fh.bytes) {
+      Header h;
+      if (at + sizeof(h) > fh.bytes) break;
+      memcpy(&h, buf + at, sizeof(h));
+      if (!h.len) break;
+      at += sizeof(h) + h.len;
+      n++;
+    }
+    ok = ok && at == fh.bytes && n == fh.frames && n > 0;
+    frames = ok ? n : 0;
+    used.store(ok ? at : 0, std::memory_order_release);
+    return ok;
+  }
+
+private:
+  struct __attribute__((packed)) Header {
+    uint32_t offsetUs;          // since startRecording()
+    uint8_t mac[6];
+    uint8_t len;
+  };
+
+  void logSummary(uint32_t nowUs, uint32_t rxDropped) {
+    LOGI(LOG_LAT, "[TRACE] Replay at %ux: %lu/%lu frames in %lu ms, %lu state changes\n",
+         replaySpeed, (unsigned long)replayed, (unsigned long)frames,
+         (unsigned long)((nowUs - replayStartUs) / 1000), (unsigned long)transitions);
+    LOGI(LOG_LAT, "[TRACE]   RX queue time p50/p99/max %lu/%lu/%lu us, depth max %lu, %lu drops\n",
+         (unsigned long)queueUs.percentile(50), (unsigned long)queueUs.percentile(99),
+         (unsigned long)queueUs.max(), (unsigned long)queueMax,
+         (unsigned long)(rxDropped - dropsAtStart));
+  }
+
+  uint8_t buf[TRACE_BUF_BYTES];
+  std::atomic<uint32_t> used{0};  // bytes recorded, published by record()
+  volatile Mode mode = TRACE_IDLE;
+  uint32_t frames = 0;
+  uint32_t lost = 0;
+  uint32_t recStartUs = 0;
+
+  TraceFrameFn deliver = nullptr;
+  uint16_t replaySpeed = 1;
+  uint32_t pos = 0;
+  uint32_t replayed = 0;
+  uint32_t replayStartUs = 0;
+  uint32_t lastFrameUs = 0;
+  uint32_t dropsAtStart = 0;
+  LogHistogram queueUs;
+  uint32_t queueMax = 0;
+  uint32_t transitions = 0;
+};
+
+#endif // PACKET_TRACE_H
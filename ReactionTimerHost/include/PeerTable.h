@@ -0,0 +1,142 @@
+/*
+ * PeerTable.h - Runtime MAC -> joystick ID registry
+ * ESP32 Host
+ *
+ * Sticks are no longer compiled in: a stick is registered the first time
+ * it is heard, either from CMD_HELLO (assign(): the host picks its ID, see
+ * ID ASSIGNMENT in Protocol.h) or from any packet of a fixed-ID stick
+ * (learn()). A registered MAC keeps its ID until the host reboots.
+ *
+ * Each stick is added as an ESP-NOW peer while there is room
+ * (PEER_STICK_LIMIT, below ESP-NOW's own total so the display and the
+ * broadcast address always fit). Past that, or if the driver refuses,
+ * the stick is reached through broadcast and picks its frames out by
+ * dest_id, as every stick already does: addrFor() hides the difference.
+ *
+ * Written by loop() only. addrFor()/indexForMac() are also called from the
+ * WiFi task (sync replies, send callbacks): an entry is published with a
+ * release store of its ID after its MAC is in place.
+ */
+
+#ifndef PEER_TABLE_H
+#define PEER_TABLE_H
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <atomic>
+#include "Protocol.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define PEER_RESERVED     2       // display + broadcast
+#define PEER_STICK_LIMIT  (ESP_NOW_MAX_TOTAL_PEER_NUM - PEER_RESERVED)
+
+class PeerTable {
+public:
+  // loop(): fixed-ID stick heard from mac. false = refuse the frame (the ID
+  // belongs to another MAC, or this MAC is registered under another ID);
+  // *added = it was registered just now
+  bool learn(uint8_t id, const uint8_t* mac, bool* added) {
+    *added = false;
+    if (!isStickId(id)) return false;
+    int8_t known = indexForMac(mac);
+    if (known >= 0) return known == stickIndex(id);
+    if (registered(id)) return false;
+    add(id, mac);
+    *added = true;
+    return true;
+  }
+
+  // loop(): ID for a stick asking for one (CMD_HELLO, or a conflict found by
+  // learn()). Known MACs keep their ID. 0 = the table is full.
+  uint8_t assign(const uint8_t* mac, bool* added) {
+    *added = false;
+    int8_t known = indexForMac(mac);
+    if (known >= 0) return ID_STICK_FIRST + known;
+    for (uint8_t i = 0; i < MAX_STICKS; i++) {
+      if (sticks[i].id.load(std::memory_order_acquire)) continue;
+      add(ID_STICK_FIRST + i, mac);
+      *added = true;
+      return ID_STICK_FIRST + i;
+    }
+    LOGW(LOG_NET, "[PEER] Table full (%d sticks) - ignoring %06lX%06lX\n",
+         MAX_STICKS, macHigh(mac), macLow(mac));
+    return 0;
+  }
+
+  bool registered(uint8_t id) const {
+    return isStickId(id) && sticks[stickIndex(id)].id.load(std::memory_order_acquire) == id;
+  }
+
+  // true = an ESP-NOW peer of its own; false = reached through broadcast
+  bool unicast(uint8_t id) const {
+    return registered(id) && sticks[stickIndex(id)].unicast;
+  }
+
+  // Where frames for this stick go: its MAC if it is an ESP-NOW peer, else broadcast
+  const uint8_t* addrFor(uint8_t id) const {
+    return unicast(id) ? sticks[stickIndex(id)].mac : kBroadcast;
+  }
+
+  // Stick index (0 .. MAX_STICKS-1) registered for mac, -1 = unknown
+  int8_t indexForMac(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < MAX_STICKS; i++) {
+      const Entry &e = sticks[i];
+      if (e.id.load(std::memory_order_acquire) && memcmp(e.mac, mac, 6) == 0) return i;
+    }
+    return -1;
+  }
+
+  uint8_t count() const { return stickCount; }
+
+  void dump() const {
+    for (uint8_t i = 0; i < MAX_STICKS; i++) {
+      const Entry &e = sticks[i];
+      if (!e.id.load(std::memory_order_acquire)) continue;
+      LOGI(LOG_NET, "[PEER] Stick %d: %06lX%06lX (%s)\n", i + 1, macHigh(e.mac), macLow(e.mac),
+           e.unicast ? "peer" : "broadcast");
+    }
+  }
+
+private:
+  struct Entry {
+    std::atomic<uint8_t> id{0};   // 0 = free; published last
+    bool unicast;
+    uint8_t mac[6];
+  };
+
+  void add(uint8_t id, const uint8_t* mac) {
+    Entry &e = sticks[stickIndex(id)];
+    memcpy(e.mac, mac, 6);
+    e.unicast = false;
+    if (unicastCount < PEER_STICK_LIMIT) {
+      esp_now_peer_info_t p = {};
+      memcpy(p.peer_addr, mac, 6);
+      p.channel = 0;              // current channel: follows an arena move (ArenaLink.h)
+      p.encrypt = false;
+      p.ifidx = WIFI_IF_STA;
+      e.unicast = esp_now_add_peer(&p) == ESP_OK;
+      if (e.unicast) unicastCount++;
+    }
+    e.id.store(id, std::memory_order_release);
+    stickCount++;
+    LOGI(LOG_NET, "[PEER] Stick %d registered: %06lX%06lX (%s, %d known)\n",
+         stickIndex(id) + 1, macHigh(mac), macLow(mac), e.unicast ? "peer" : "via broadcast", stickCount);
+  }
+
+  // A MAC as two 24-bit halves: the async logger takes at most LOG_MAX_ARGS args
+  static unsigned long macHigh(const uint8_t* m) { return ((unsigned long)m[0] << 16) | (m[1] << 8) | m[2]; }
+  static unsigned long macLow(const uint8_t* m) { return ((unsigned long)m[3] << 16) | (m[4] << 8) | m[5]; }
+
+  static constexpr uint8_t kBroadcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+  Entry sticks[MAX_STICKS];
+  uint8_t stickCount = 0;
+  uint8_t unicastCount = 0;
+};
+
+constexpr uint8_t PeerTable::kBroadcast[6];
+
+#endif // PEER_TABLE_H
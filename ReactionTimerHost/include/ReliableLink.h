@@ -0,0 +1,312 @@
+/*
+ * ReliableLink.h - Sliding-window ACK/retry engine for ESP-NOW peers
+ * ESP32 Host
+ *
+ * Every peer (joysticks, display) gets its own sequence space and a window
+ * of up to ACK_WINDOW in-flight ReliablePackets, so back-to-back commands
+ * pipeline instead of overwriting each other. Unacked packets are resent
+ * with exponential backoff (ACK_RTO_INITIAL doubling up to ACK_RTO_MAX).
+ * Sequenced ACKs clear their own seq plus everything up to the cumulative
+ * seq; legacy 7-byte ACKs (answers to broadcasts) clear by command.
+ * A BatchWriter frame occupies one window entry like any other command.
+ *
+ * Per peer, LinkStats counts deliveries by how many resends they needed,
+ * resends and give-ups, and keeps a histogram of first send -> ACK time;
+ * logStats() prints them (serial "lat" command), resetStats() clears them.
+ *
+ * Owned by loop(): call send/track/update/onAck from one task only.
+ */
+
+#ifndef RELIABLE_LINK_H
+#define RELIABLE_LINK_H
+
+#include <Arduino.h>
+#include "Protocol.h"
+#include "Histogram.h"
+#include "Log.h"
+#include "FlightRecorder.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define ACK_PEER_COUNT     (MAX_STICKS + 1)  // every joystick + the display
+#define ACK_WINDOW         8      // max in-flight packets per peer
+#define ACK_MAX_RETRIES    4      // resends before giving up
+#define ACK_RTO_INITIAL    30     // ms before first resend
+#define ACK_RTO_MAX        240    // ms, backoff cap (30 -> 60 -> 120 -> 240)
+#define ACK_BATCH_SLOTS    2      // batches in flight per peer (each holds a full frame)
+
+typedef void (*LinkSendFn)(const uint8_t* mac, const uint8_t* data, size_t len);
+
+static_assert(ACK_MAX_RETRIES == 4, "LinkStats log prints retriesNeeded[0..4]");
+
+struct LinkStats {
+  uint32_t delivered;
+  uint32_t resends;
+  uint32_t gaveUp;                              // out of retries, or pushed out of a full window
+  uint32_t retriesNeeded[ACK_MAX_RETRIES + 1];  // [n] = delivered after n resends
+  LogHistogram ackUs;                           // first send -> ACK processed (micros)
+};
+
+class ReliableLink {
+public:
+  void begin(uint8_t bootEpoch, LinkSendFn sendFn) {
+    epoch = bootEpoch;
+    tx = sendFn;
+    peerCount = 0;
+  }
+
+  void addPeer(uint8_t id, const uint8_t* mac) {
+    if (peerCount >= ACK_PEER_COUNT || findPeer(id)) return;
+    Peer &p = peers[peerCount++];
+    p = Peer();
+    p.id = id;
+    memcpy(p.mac, mac, 6);
+  }
+
+  // Forget everything in flight (new game). Sequence numbers keep counting.
+  void reset() {
+    for (uint8_t i = 0; i < peerCount; i++) {
+      for (uint8_t w = 0; w < ACK_WINDOW; w++) peers[i].win[w].used = false;
+    }
+  }
+
+  // Send now and retry until ACKed
+  bool send(uint8_t id, uint8_t cmd, uint16_t data) {
+    Entry* e = allocate(id, cmd, data);
+    if (!e) return false;
+    Peer* p = findPeer(id);
+    transmit(*p, *e);
+    LOGD(LOG_ACK, "[ACK] Sent cmd=0x%02X to 0x%02X seq=%u (in flight=%u)\n",
+         cmd, id, e->seq, inFlight(id));
+    return true;
+  }
+
+  // Send a batch frame (CMD_BATCH) and retry it as one unit until ACKed
+  bool sendBatch(uint8_t id, const BatchWriter &batch) {
+    Peer* p = findPeer(id);
+    if (!p || batch.empty()) return false;
+    int8_t slot = freeBatchSlot(*p);
+    if (slot < 0) {
+      LOGW(LOG_ACK, "[ACK] No free batch slot for 0x%02X - batch of %u dropped\n", id, batch.count());
+      return false;
+    }
+    Entry* e = allocate(id, CMD_BATCH, slot);
+    if (!e) return false;
+    p->batches[slot] = batch;
+    transmit(*p, *e);
+    LOGD(LOG_ACK, "[ACK] Sent batch of %u (%u bytes) to 0x%02X seq=%u\n",
+         batch.count(), batch.len + 1, id, e->seq);
+    return true;
+  }
+
+  // Already delivered some other way (e.g. one broadcast to everyone):
+  // only track it, so a missing ACK triggers unicast resends with the same data
+  bool track(uint8_t id, uint8_t cmd, uint16_t data) {
+    return allocate(id, cmd, data) != nullptr;
+  }
+
+  // Call every loop() pass
+  void update(unsigned long now) {
+    for (uint8_t i = 0; i < peerCount; i++) {
+      Peer &p = peers[i];
+      for (uint8_t w = 0; w < ACK_WINDOW; w++) {
+        Entry &e = p.win[w];
+        if (!e.used || now - e.lastSend < e.rto) continue;
+
+        if (e.retries > 0) {
+          e.retries--;
+          e.rto = (e.rto * 2 > ACK_RTO_MAX) ? ACK_RTO_MAX : e.rto * 2;
+          p.stats.resends++;
+          transmit(p, e);
+          flightRecorder.record(FL_RETRY, e.cmd, (uint16_t)p.id | (uint16_t)(ACK_MAX_RETRIES - e.retries + 1) << 8);
+          LOGD(LOG_ACK, "[ACK] Retry cmd=0x%02X to 0x%02X seq=%u (retries=%d, next in %u ms)\n",
+               e.cmd, p.id, e.seq, e.retries, e.rto);
+        } else {
+          e.used = false;
+          p.stats.gaveUp++;
+          flightRecorder.record(FL_GIVE_UP, e.cmd, (uint16_t)p.id | (uint16_t)(ACK_MAX_RETRIES + 1) << 8);
+          LOGW(LOG_ACK, "[ACK] GAVE UP cmd=0x%02X to 0x%02X seq=%u\n", e.cmd, p.id, e.seq);
+        }
+      }
+    }
+  }
+
+  // Sequenced ACK (ReliablePacket with base.cmd == CMD_ACK)
+  void onAck(uint8_t id, const ReliablePacket &ack) {
+    Peer* p = findPeer(id);
+    if (!p || ack.epoch != epoch) return;
+    uint8_t cum = ack.base.data_high;
+    for (uint8_t w = 0; w < ACK_WINDOW; w++) {
+      Entry &e = p->win[w];
+      if (!e.used) continue;
+      // seq <= cum in 8-bit serial arithmetic
+      if (e.seq == ack.seq || (uint8_t)(cum - e.seq) < 128) {
+        delivered(*p, e);
+        LOGD(LOG_ACK, "[ACK] Received ACK for cmd=0x%02X seq=%u from 0x%02X (cum=%u)\n",
+             e.cmd, e.seq, id, cum);
+      }
+    }
+  }
+
+  // Legacy ACK (7-byte GamePacket, data_low = cmd): clear the oldest matching entry
+  void onLegacyAck(uint8_t id, uint8_t ackedCmd) {
+    Peer* p = findPeer(id);
+    if (!p) return;
+    Entry* oldest = nullptr;
+    for (uint8_t w = 0; w < ACK_WINDOW; w++) {
+      Entry &e = p->win[w];
+      if (e.used && e.cmd == ackedCmd &&
+          (!oldest || (int8_t)(e.seq - oldest->seq) < 0)) oldest = &e;
+    }
+    if (oldest) {
+      delivered(*p, *oldest);
+      LOGD(LOG_ACK, "[ACK] Received ACK for cmd=0x%02X from 0x%02X\n", ackedCmd, id);
+    }
+  }
+
+  uint8_t inFlight(uint8_t id) const {
+    const Peer* p = findPeer(id);
+    if (!p) return 0;
+    uint8_t n = 0;
+    for (uint8_t w = 0; w < ACK_WINDOW; w++) if (p->win[w].used) n++;
+    return n;
+  }
+
+  const LinkStats* stats(uint8_t id) const {
+    const Peer* p = findPeer(id);
+    return p ? &p->stats : nullptr;
+  }
+
+  // All peers' resends since boot (or the last resetStats())
+  uint32_t totalResends() const {
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < peerCount; i++) n += peers[i].stats.resends;
+    return n;
+  }
+
+  uint32_t totalDelivered() const {
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < peerCount; i++) n += peers[i].stats.delivered;
+    return n;
+  }
+
+  void resetStats() {
+    for (uint8_t i = 0; i < peerCount; i++) peers[i].stats = LinkStats();
+  }
+
+  void logStats() const {
+    for (uint8_t i = 0; i < peerCount; i++) {
+      const LinkStats &s = peers[i].stats;
+      LOGI(LOG_LAT, "[LAT] Link 0x%02X: %lu delivered, %lu resends, %lu gave up\n",
+           peers[i].id, (unsigned long)s.delivered, (unsigned long)s.resends, (unsigned long)s.gaveUp);
+      LOGI(LOG_LAT, "[LAT]   ACK p50/p99/max %lu/%lu/%lu us\n", (unsigned long)s.ackUs.percentile(50),
+           (unsigned long)s.ackUs.percentile(99), (unsigned long)s.ackUs.max());
+      LOGI(LOG_LAT, "[LAT]   after 0/1/2/3/4 resends: %lu/%lu/%lu/%lu/%lu\n",
+           (unsigned long)s.retriesNeeded[0], (unsigned long)s.retriesNeeded[1],
+           (unsigned long)s.retriesNeeded[2], (unsigned long)s.retriesNeeded[3],
+           (unsigned long)s.retriesNeeded[4]);
+    }
+  }
+
+private:
+  struct Entry {
+    bool used;
+    uint8_t seq;
+    uint8_t cmd;
+    uint16_t data;              // CMD_BATCH: index into Peer::batches
+    uint8_t retries;
+    uint16_t rto;               // current retransmit timeout (ms)
+    unsigned long lastSend;
+    uint32_t firstUs;           // micros() when the entry was claimed
+  };
+
+  struct Peer {
+    uint8_t id;
+    uint8_t mac[6];
+    uint8_t nextSeq;
+    LinkStats stats;
+    Entry win[ACK_WINDOW];
+    BatchWriter batches[ACK_BATCH_SLOTS];
+  };
+
+  Peer* findPeer(uint8_t id) {
+    for (uint8_t i = 0; i < peerCount; i++) if (peers[i].id == id) return &peers[i];
+    return nullptr;
+  }
+  const Peer* findPeer(uint8_t id) const {
+    for (uint8_t i = 0; i < peerCount; i++) if (peers[i].id == id) return &peers[i];
+    return nullptr;
+  }
+
+  // A batch slot is busy while a window entry still refers to it
+  int8_t freeBatchSlot(const Peer &p) const {
+    for (uint8_t b = 0; b < ACK_BATCH_SLOTS; b++) {
+      bool busy = false;
+      for (uint8_t w = 0; w < ACK_WINDOW; w++) {
+        const Entry &e = p.win[w];
+        if (e.used && e.cmd == CMD_BATCH && e.data == b) busy = true;
+      }
+      if (!busy) return b;
+    }
+    return -1;
+  }
+
+  // Claim a window slot; if the window is full the oldest entry is dropped
+  Entry* allocate(uint8_t id, uint8_t cmd, uint16_t data) {
+    Peer* p = findPeer(id);
+    if (!p) return nullptr;
+
+    Entry* slot = nullptr;
+    Entry* oldest = nullptr;
+    for (uint8_t w = 0; w < ACK_WINDOW; w++) {
+      Entry &e = p->win[w];
+      if (!e.used) { slot = &e; break; }
+      if (!oldest || (int8_t)(e.seq - oldest->seq) < 0) oldest = &e;
+    }
+    if (!slot) {
+      LOGW(LOG_ACK, "[ACK] Window full for 0x%02X - dropping cmd=0x%02X seq=%u\n",
+           id, oldest->cmd, oldest->seq);
+      p->stats.gaveUp++;
+      flightRecorder.record(FL_GIVE_UP, oldest->cmd, (uint16_t)id | (uint16_t)(ACK_MAX_RETRIES - oldest->retries + 1) << 8);
+      slot = oldest;
+    }
+
+    slot->used = true;
+    slot->seq = p->nextSeq++;
+    slot->cmd = cmd;
+    slot->data = data;
+    slot->retries = ACK_MAX_RETRIES;
+    slot->rto = ACK_RTO_INITIAL;
+    slot->lastSend = millis();
+    slot->firstUs = micros();
+    return slot;
+  }
+
+  void delivered(Peer &p, Entry &e) {
+    e.used = false;
+    p.stats.delivered++;
+    p.stats.retriesNeeded[ACK_MAX_RETRIES - e.retries]++;
+    p.stats.ackUs.add(micros() - e.firstUs);
+  }
+
+  void transmit(Peer &p, Entry &e) {
+    e.lastSend = millis();
+    if (e.cmd == CMD_BATCH) {
+      BatchWriter &b = p.batches[e.data];
+      uint8_t len = b.seal(e.seq, epoch);
+      if (tx) tx(p.mac, b.buf, len);
+      return;
+    }
+    ReliablePacket pkt;
+    buildReliablePacket(&pkt, p.id, ID_HOST, e.cmd, e.data, e.seq, epoch);
+    if (tx) tx(p.mac, (const uint8_t*)&pkt, sizeof(pkt));
+  }
+
+  Peer peers[ACK_PEER_COUNT];
+  uint8_t peerCount = 0;
+  uint8_t epoch = 0;
+  LinkSendFn tx = nullptr;
+};
+
+#endif // RELIABLE_LINK_H
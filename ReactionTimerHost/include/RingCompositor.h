@@ -0,0 +1,152 @@
+/*
+ * RingCompositor.h - Layered, dirty-tracked frames for the game rings
+ * ESP32 Host
+ *
+ * Each ring is composed from up to three layers, top first:
+ *   flash     all rings white until flashUntil (countdown tick)
+ *   override  one colour per ring, optionally blinking (GameCore's ringOverride)
+ *   base      the mode's animation, drawn by updateNeoPixels() into base()
+ * present() composes the next frame into its own buffer and compares it
+ * ring by ring with the last frame the bus actually sent. Unchanged rings
+ * are not rewritten and an unchanged frame is not sent at all. When the
+ * RMT is still busy (CanShow() false) the difference stays pending and
+ * present() returns false; the next call sends the newest composition, so
+ * a skipped Show() is never lost or left stale.
+ *
+ * Bytes reach the bus through the LedCanvas (brightness LUT, LedEffects.h).
+ * Owned by loop().
+ */
+
+#ifndef RING_COMPOSITOR_H
+#define RING_COMPOSITOR_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "LedEffects.h"
+#include "Log.h"
+
+#define RING_BLINK_MS  300   // override blink half period
+
+template <typename Bus, uint8_t RINGS, uint8_t PER_RING>
+class RingCompositor {
+public:
+  static const uint16_t N = (uint16_t)RINGS * PER_RING;
+
+  RingCompositor(Bus &b, LedCanvas<Bus, N> &c) : bus(b), canvas(c) {}
+
+  // After canvas.begin(): the bus shows black, so does our copy
+  void begin() {
+    for (uint16_t i = 0; i < N; i++) phase[i] = (uint8_t)((uint32_t)i * 256 / N);
+    memset(shown, 0, sizeof(shown));
+    memset(base, 0, sizeof(base));
+    clearOverrides();
+    flashUntilMs = 0;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Base layer
+  // ---------------------------------------------------------------------------
+  void fill(LedRgb c) { for (uint16_t i = 0; i < N; i++) base[i] = c; }
+  void fillRing(uint8_t ring, LedRgb c) { for (uint8_t i = 0; i < PER_RING; i++) base[ring * PER_RING + i] = c; }
+  void set(uint8_t ring, uint8_t led, LedRgb c) { base[ring * PER_RING + led] = c; }
+
+  // All rings as one wheel, rotated by offset
+  void rainbow(uint8_t offset) {
+    for (uint16_t i = 0; i < N; i++) base[i] = HUE_LUT[(uint8_t)(phase[i] + offset)];
+  }
+
+  // ---------------------------------------------------------------------------
+  // Override and flash layers
+  // ---------------------------------------------------------------------------
+  void setOverride(uint8_t ring, LedRgb c, bool blink) {
+    over[ring].on = true;
+    over[ring].blink = blink;
+    over[ring].color = c;
+  }
+  void clearOverride(uint8_t ring) { over[ring].on = false; }
+  void clearOverrides() { for (uint8_t r = 0; r < RINGS; r++) over[r].on = false; }
+
+  void flash(uint32_t untilMs) { flashUntilMs = untilMs; }
+  bool flashing(uint32_t nowMs) const { return flashUntilMs && (int32_t)(flashUntilMs - nowMs) > 0; }
+
+  // ---------------------------------------------------------------------------
+  // Output
+  // ---------------------------------------------------------------------------
+  // Show the composed frame if it differs from the last one sent.
+  // False = a change is waiting for the RMT; call again soon.
+  bool present(uint32_t nowMs) {
+    if (flashUntilMs && !flashing(nowMs)) flashUntilMs = 0;
+    const bool flashOn = flashUntilMs != 0;
+    const bool blinkOn = ((nowMs / RING_BLINK_MS) & 1) == 0;
+
+    uint8_t dirty = 0;
+    for (uint8_t r = 0; r < RINGS; r++) {
+      LedRgb* out = &next[r * PER_RING];
+      if (flashOn) {
+        for (uint8_t i = 0; i < PER_RING; i++) out[i] = LED_WHITE;
+      } else if (over[r].on) {
+        const LedRgb c = over[r].blink && !blinkOn ? LED_BLACK : over[r].color;
+        for (uint8_t i = 0; i < PER_RING; i++) out[i] = c;
+      } else {
+        memcpy(out, &base[r * PER_RING], PER_RING * sizeof(LedRgb));
+      }
+      if (memcmp(out, &shown[r * PER_RING], PER_RING * sizeof(LedRgb)) != 0) dirty |= 1 << r;
+    }
+
+    if (!dirty) {
+      unchangedCount++;
+      return true;
+    }
+    if (!bus.CanShow()) {
+      deferredCount++;
+      return false;
+    }
+    for (uint8_t r = 0; r < RINGS; r++) {
+      if (!(dirty & (1 << r))) continue;
+      for (uint8_t i = 0; i < PER_RING; i++) canvas.set(r * PER_RING + i, next[r * PER_RING + i]);
+      memcpy(&shown[r * PER_RING], &next[r * PER_RING], PER_RING * sizeof(LedRgb));
+      ringWrites++;
+    }
+    canvas.commit();
+    bus.Show();
+    showCount++;
+    return true;
+  }
+
+  void dump() const {
+    LOGI(LOG_NEO, "[NEO] %lu frames shown (%lu ring writes), %lu unchanged, %lu waited for the RMT\n",
+         (unsigned long)showCount, (unsigned long)ringWrites, (unsigned long)unchangedCount,
+         (unsigned long)deferredCount);
+  }
+
+private:
+  static constexpr LedRgb LED_WHITE = {255, 255, 255};
+  static constexpr LedRgb LED_BLACK = {0, 0, 0};
+
+  struct Override {
+    bool on;
+    bool blink;
+    LedRgb color;
+  };
+
+  Bus &bus;
+  LedCanvas<Bus, N> &canvas;
+  uint8_t phase[N];
+  LedRgb base[N];               // mode animation
+  LedRgb next[N];               // composed, not sent yet
+  LedRgb shown[N];              // last frame handed to the bus
+  Override over[RINGS];
+  uint32_t flashUntilMs = 0;    // 0 = no flash
+
+  uint32_t showCount = 0;
+  uint32_t ringWrites = 0;
+  uint32_t unchangedCount = 0;
+  uint32_t deferredCount = 0;
+};
+
+template <typename Bus, uint8_t RINGS, uint8_t PER_RING>
+constexpr LedRgb RingCompositor<Bus, RINGS, PER_RING>::LED_WHITE;
+template <typename Bus, uint8_t RINGS, uint8_t PER_RING>
+constexpr LedRgb RingCompositor<Bus, RINGS, PER_RING>::LED_BLACK;
+
+#endif // RING_COMPOSITOR_H
@@ -0,0 +1,184 @@
+/*
+ * Scheduler.h - Cooperative frame scheduler for loop()
+ * ESP32 Host
+ *
+ * Every job has a period, a run-time budget and a class:
+ *   JOB_HARD         always runs when due, first (game state, GO, ACK retries)
+ *   JOB_SOFT         runs when due if the frame still has room (audio decode, rings)
+ *   JOB_BEST_EFFORT  runs only with room to spare; skipped frames are counted
+ * Within a class, jobs run in the order they were added. A frame is one
+ * run() call; non-hard jobs don't start once the frame has used
+ * SCHED_FRAME_BUDGET_US, they wait for the next frame instead.
+ *
+ * Periods are drift-free (next due = previous due + period), so a job that
+ * is 3 ms late once doesn't shift every later frame. Period 0 = every frame.
+ * Between frames loop() sleeps for usUntilDue(), the wait for the next
+ * periodic job; period-0 jobs don't keep it awake, they run in whichever
+ * frame comes next (a due job, or the task woken for a received frame).
+ *
+ * Per-job stats (runs, worst/average run time, budget overruns, worst
+ * lateness, deferrals) are logged every SCHED_REPORT_MS and reset. The
+ * jobs' total run time is the loop() task's load (TaskLoad.h).
+ *
+ * Owned by loop(): add/run/setPeriod from one task only.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "Log.h"
+#include "TaskLoad.h"
+#include "FlightRecorder.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SCHED_MAX_JOBS         20
+#define SCHED_FRAME_BUDGET_US  4000    // soft/best-effort jobs don't start past this
+#define SCHED_REPORT_MS        10000   // stats window
+#define SCHED_MAX_WAIT_US      100000  // usUntilDue() with no periodic job
+
+enum JobClass : uint8_t {
+  JOB_HARD,
+  JOB_SOFT,
+  JOB_BEST_EFFORT,
+  JOB_CLASS_COUNT
+};
+
+typedef void (*JobFn)();
+
+class Scheduler {
+public:
+  // Returns the job id, or -1 if the table is full
+  int8_t add(const char* name, JobFn fn, JobClass cls, uint32_t periodUs, uint32_t budgetUs) {
+    if (jobCount >= SCHED_MAX_JOBS) {
+      LOGE(LOG_SCHED, "[SCHED] Job table full - %s not added\n", name);
+      return -1;
+    }
+    Job &j = jobs[jobCount];
+    j = Job();
+    j.name = name;
+    j.fn = fn;
+    j.cls = cls;
+    j.periodUs = periodUs;
+    j.budgetUs = budgetUs;
+    j.nextDue = micros();
+    return jobCount++;
+  }
+
+  // Called from inside the job, sets the gap to its next run; otherwise applies after the next run
+  void setPeriod(int8_t id, uint32_t periodUs) {
+    if (id >= 0 && id < jobCount) jobs[id].periodUs = periodUs;
+  }
+
+  // Make a job due now (e.g. a cue that must show this frame)
+  void kick(int8_t id) {
+    if (id >= 0 && id < jobCount) jobs[id].nextDue = micros();
+  }
+
+  // One frame: every due job, hard first
+  void run() {
+    uint32_t frameStart = micros();
+    for (uint8_t cls = JOB_HARD; cls < JOB_CLASS_COUNT; cls++) {
+      for (uint8_t i = 0; i < jobCount; i++) {
+        Job &j = jobs[i];
+        if (j.cls != cls) continue;
+        uint32_t now = micros();
+        int32_t late = (int32_t)(now - j.nextDue);
+        if (late < 0) continue;
+        if (cls != JOB_HARD && now - frameStart + j.budgetUs > SCHED_FRAME_BUDGET_US) {
+          j.deferred++;
+          continue;
+        }
+
+        j.fn();
+        uint32_t ran = micros() - now;
+        busy.add(ran);
+
+        j.runs++;
+        j.totalUs += ran;
+        if (ran > j.maxUs) j.maxUs = ran;
+        if (ran > j.budgetUs) {
+          j.overruns++;
+          flightRecorder.record(FL_OVERRUN, i, ran < 0xFFFF ? (uint16_t)ran : 0xFFFF);
+        }
+        if ((uint32_t)late > j.maxLateUs) j.maxLateUs = late;
+
+        // Drift-free; if we fell a whole period behind, resync instead of bursting
+        j.nextDue += j.periodUs;
+        if ((int32_t)(now - j.nextDue) >= (int32_t)j.periodUs) j.nextDue = now + j.periodUs;
+      }
+    }
+    uint32_t frame = micros() - frameStart;
+    if (frame > maxFrameUs) maxFrameUs = frame;
+    frames++;
+
+    unsigned long nowMs = millis();
+    if (nowMs - lastReportMs >= SCHED_REPORT_MS) {
+      report();
+      lastReportMs = nowMs;
+    }
+  }
+
+  // Until the next periodic job is due, 0 if one is (or was deferred)
+  uint32_t usUntilDue() const {
+    const uint32_t now = micros();
+    uint32_t wait = SCHED_MAX_WAIT_US;
+    for (uint8_t i = 0; i < jobCount; i++) {
+      if (!jobs[i].periodUs) continue;
+      const int32_t d = (int32_t)(jobs[i].nextDue - now);
+      if (d <= 0) return 0;
+      if ((uint32_t)d < wait) wait = d;
+    }
+    return wait;
+  }
+
+  uint8_t count() const { return jobCount; }
+  const TaskMeter* meter() const { return &busy; }
+
+private:
+  struct Job {
+    const char* name = nullptr;
+    JobFn fn = nullptr;
+    JobClass cls = JOB_BEST_EFFORT;
+    uint32_t periodUs = 0;
+    uint32_t budgetUs = 0;
+    uint32_t nextDue = 0;
+    // Stats for the current window
+    uint32_t runs = 0;
+    uint32_t totalUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t maxLateUs = 0;
+    uint16_t overruns = 0;
+    uint16_t deferred = 0;
+  };
+
+  void report() {
+    LOGI(LOG_SCHED, "[SCHED] %lu frames, worst frame %lu us\n",
+         (unsigned long)frames, (unsigned long)maxFrameUs);
+    for (uint8_t i = 0; i < jobCount; i++) {
+      Job &j = jobs[i];
+      LOGI(LOG_SCHED, "[SCHED] %-6s runs=%lu avg=%lu max=%lu us late=%lu us over=%u\n",
+           j.name, (unsigned long)j.runs, (unsigned long)(j.runs ? j.totalUs / j.runs : 0),
+           (unsigned long)j.maxUs, (unsigned long)j.maxLateUs, j.overruns);
+      if (j.overruns || j.deferred) {
+        LOGW(LOG_SCHED, "[SCHED] %s: %u run(s) over the %lu us budget, %u deferred\n",
+             j.name, j.overruns, (unsigned long)j.budgetUs, j.deferred);
+      }
+      j.runs = j.totalUs = j.maxUs = j.maxLateUs = 0;
+      j.overruns = j.deferred = 0;
+    }
+    frames = 0;
+    maxFrameUs = 0;
+  }
+
+  Job jobs[SCHED_MAX_JOBS];
+  uint8_t jobCount = 0;
+  TaskMeter busy;
+  uint32_t frames = 0;
+  uint32_t maxFrameUs = 0;
+  unsigned long lastReportMs = 0;
+};
+
+#endif // SCHEDULER_H
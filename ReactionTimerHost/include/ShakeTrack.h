@@ -0,0 +1,88 @@
+/*
+ * ShakeTrack.h - Per-player shake progress with interpolation (SHAKE STREAM in Protocol.h)
+ * Part of GameCore: fed by onShakeProgress(), read by the ring renderer
+ * and the display relay.
+ *
+ * Every CMD_SHAKE_PROGRESS is a (count, arrival time) point. The rate
+ * between the last two points (smoothed over updates) lets level() run the
+ * ring on between updates instead of jumping one step per packet. The
+ * estimate never gets more than SHAKE_INTERP_MAX_MS ahead of the last
+ * count and stops one count short of the target: only CMD_SHAKE_DONE
+ * fills a ring. An older or repeated count is ignored, so reordering
+ * and duplicates can't pull a ring back.
+ */
+
+#ifndef SHAKE_TRACK_H
+#define SHAKE_TRACK_H
+
+#include <stdint.h>
+#include "GameTypes.h"
+
+#define SHAKE_INTERP_MAX_MS  250   // run on at most this far past the last update
+#define SHAKE_RATE_SMOOTH    2     // new rate weight 1/2^n
+
+class ShakeTrack {
+public:
+  void reset() {
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) players[i] = Player();
+    dirty = 0;
+  }
+
+  // False if the update is stale (not above what we already have)
+  bool onProgress(uint8_t slot, uint8_t count, uint8_t target, uint32_t nowUs) {
+    if (slot >= MAX_PLAYERS || target == 0) return false;
+    Player &p = players[slot];
+    if (p.target == target && count <= p.count) return false;
+    if (p.target == target && p.lastUs) {
+      const uint32_t dtUs = nowUs - p.lastUs;
+      if (dtUs >= 1000) {   // a burst in one loop pass says nothing about the rate
+        // counts per second, Q8
+        const uint32_t rate = (uint32_t)(((uint64_t)(count - p.count) * 1000000UL << 8) / dtUs);
+        p.rateQ8 = p.rateQ8 ? p.rateQ8 + ((int32_t)(rate - p.rateQ8) >> SHAKE_RATE_SMOOTH) : rate;
+      }
+    } else {
+      p.rateQ8 = 0;
+    }
+    p.count = count;
+    p.target = target;
+    p.lastUs = nowUs;
+    dirty |= 1 << slot;
+    return true;
+  }
+
+  uint8_t count(uint8_t slot) const { return slot < MAX_PLAYERS ? players[slot].count : 0; }
+  uint8_t target(uint8_t slot) const { return slot < MAX_PLAYERS ? players[slot].target : 0; }
+
+  // Interpolated progress in 0..scale (0 until the first update)
+  uint32_t level(uint8_t slot, uint32_t nowUs, uint32_t scale) const {
+    if (slot >= MAX_PLAYERS || !players[slot].target) return 0;
+    const Player &p = players[slot];
+    uint32_t aheadUs = nowUs - p.lastUs;
+    if (aheadUs > SHAKE_INTERP_MAX_MS * 1000UL) aheadUs = SHAKE_INTERP_MAX_MS * 1000UL;
+    // counts, Q8
+    uint32_t posQ8 = ((uint32_t)p.count << 8) + (uint32_t)(((uint64_t)p.rateQ8 * aheadUs) / 1000000UL);
+    const uint32_t capQ8 = (uint32_t)(p.target - 1) << 8;
+    if (posQ8 > capQ8) posQ8 = capQ8 > ((uint32_t)p.count << 8) ? capQ8 : (uint32_t)p.count << 8;
+    return (uint32_t)(((uint64_t)posQ8 * scale) / ((uint32_t)p.target << 8));
+  }
+
+  // Players with new counts since the last call, bit per slot
+  uint8_t takeDirty() {
+    uint8_t d = dirty;
+    dirty = 0;
+    return d;
+  }
+
+private:
+  struct Player {
+    uint8_t count = 0;
+    uint8_t target = 0;         // 0 = nothing heard this round
+    uint32_t lastUs = 0;
+    uint32_t rateQ8 = 0;
+  };
+
+  Player players[MAX_PLAYERS];
+  uint8_t dirty = 0;
+};
+
+#endif // SHAKE_TRACK_H
@@ -0,0 +1,78 @@
+/*
+ * Sounds.h - Sound file names, priorities and the timing callers plan with
+ * ESP32 Host
+ *
+ * What the game needs to ask AudioManager for, without pulling in the
+ * audio stack: GameCore.h (and the native simulator) only include this.
+ */
+
+#ifndef SOUNDS_H
+#define SOUNDS_H
+
+#include <stdint.h>
+
+// =============================================================================
+// SOUND FILE DEFINITIONS
+// =============================================================================
+// Files should be stored in SPIFFS at these paths
+// UI sounds
+#define SND_BUTTON_CLICK      "/click.mp3"
+#define SND_GET_READY         "/get_ready.mp3"
+#define SND_PRESS_TO_JOIN     "/press_join.mp3"
+#define SND_READY             "/ready.mp3"       // Player joined acknowledgment
+
+// Game mode announcements
+#define SND_REACTION_MODE     "/reaction.mp3"
+#define SND_REACTION_INSTRUCT "/react_inst.mp3"
+#define SND_SHAKE_IT          "/shake.mp3"
+#define SND_YOU_WILL_SHAKE    "/will_shake.mp3"
+
+// Numbers (for countdown and shake targets)
+#define SND_NUM_1             "/one.mp3"
+#define SND_NUM_2             "/two.mp3"
+#define SND_NUM_3             "/three.mp3"
+#define SND_NUM_10            "/ten.mp3"
+#define SND_NUM_15            "/fifteen.mp3"
+#define SND_NUM_20            "/twenty.mp3"
+#define SND_BEEP              "/beep.mp3"
+
+// Player announcements (combined "Player X" files)
+#define SND_PLAYER_1          "/player1.mp3"    // "Player One"
+#define SND_PLAYER_2          "/player2.mp3"    // "Player Two"
+#define SND_PLAYER_3          "/player3.mp3"    // "Player Three"
+#define SND_PLAYER_4          "/player4.mp3"    // "Player Four"
+
+// Result phrases
+#define SND_FASTEST           "/fastest.mp3"    // "Fastest"
+#define SND_WINS              "/wins.mp3"       // "Wins"
+#define SND_VICTORY_FANFARE   "/victory.mp3"
+#define SND_GAME_OVER         "/gameover.mp3"
+#define SND_ERROR_TONE        "/error.mp3"
+
+// =============================================================================
+// PRIORITIES + TIMING
+// =============================================================================
+// Higher pre-empts lower; queueSoundAt() cues always count as critical
+enum AudioPriority : uint8_t {
+  AUDIO_PRI_AMBIENT,    // prompts that may be cut or skipped ("press to join")
+  AUDIO_PRI_ANNOUNCE,   // mode, player and result announcements
+  AUDIO_PRI_CRITICAL    // countdown / GO - never expired by a scene change
+};
+
+#define DEFAULT_SOUND_GAP     250   // ms gap between queued sounds (adds natural pauses)
+#define AUDIO_CUE_LEAD_US     60000 // queueSoundAt(): post this far ahead of the instant
+
+// File for a number (1-3 for countdown, 10/15/20 for shake), nullptr if none
+inline const char* numberSound(uint8_t num) {
+  switch (num) {
+    case 1:  return SND_NUM_1;
+    case 2:  return SND_NUM_2;
+    case 3:  return SND_NUM_3;
+    case 10: return SND_NUM_10;
+    case 15: return SND_NUM_15;
+    case 20: return SND_NUM_20;
+  }
+  return nullptr;
+}
+
+#endif // SOUNDS_H
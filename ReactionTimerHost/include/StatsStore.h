@@ -0,0 +1,329 @@
+/*
+ * StatsStore.h - All-time results, per-stick averages and the leaderboard in NVS
+ * ESP32 Host
+ *
+ * Every counted result, and every finished game, becomes one 8-byte
+ * StatRecord in a RAM buffer; adding one never touches flash. flush() -
+ * called by main.cpp only in IDLE, a tournament changeover or SHOW_RESULTS,
+ * never in a timed phase -
+ * appends the buffer to an append-only log and then rewrites the summary,
+ * which is the commit point: a flush cut short by a reset leaves the log
+ * as the last summary describes it.
+ *
+ * The log is a ring of STATS_LOG_CHUNKS blobs, each STATS_CHUNK_RECORDS
+ * records (256 bytes = eight whole 32-byte NVS entries, no padding
+ * entries). New records top up the open chunk; a full chunk is left alone
+ * and the next one (the oldest) is started. NVS itself only ever appends
+ * and wear-levels its pages, so the cost of a flush is the chunk bytes
+ * written, and the buffer makes that one flush per game.
+ *
+ * The summary (top reaction times, per-stick totals, counts and the log
+ * head) is one fixed-size blob, read at boot with the open chunk: the
+ * leaderboard is there at once, without reading the log.
+ *
+ * Tournament entrants (Tournament.h) keep their best reaction by ticket in
+ * one more blob, written by the same flush when it changed; a new
+ * tournament is seeded from it.
+ * Owned by loop().
+ */
+
+#ifndef STATS_STORE_H
+#define STATS_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
+#include "Protocol.h"
+#include "Tournament.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define STATS_NAMESPACE       "stats"
+#define STATS_VERSION         1       // summary layout: another version starts over
+#define STATS_BUFFER_RECORDS  32      // RAM, between flushes
+#define STATS_FLUSH_AT        24      // in SHOW_RESULTS, flush only once this many wait
+#define STATS_CHUNK_RECORDS   32
+#define STATS_LOG_CHUNKS      8       // ~2 KB of log, the last ~12 games of four
+
+enum StatKind : uint8_t {
+  STAT_REACTION = 1,    // ticks = result
+  STAT_SHAKE,           // ticks = result
+  STAT_GAME             // ticks = rounds played, stick = winner (0xFF = none), round = 1 if deuce
+};
+
+struct StatRecord {
+  uint32_t ticks;       // RESULT_TICKS_NONE = penalty / timeout
+  uint8_t kind;         // StatKind
+  uint8_t stick;        // stickIndex()
+  uint8_t round;
+  uint8_t game;         // all-time game number (low byte): groups a game's records
+};
+
+static_assert(sizeof(StatRecord) == 8, "StatRecord is packed into 32-byte NVS entries");
+static_assert(STATS_CHUNK_RECORDS * sizeof(StatRecord) % 32 == 0, "a chunk should fill whole NVS entries");
+static_assert(STATS_FLUSH_AT + MAX_PLAYERS + 1 <= STATS_BUFFER_RECORDS, "room for a round after the flush mark");
+
+class StatsStore {
+public:
+  // Boot: the summary and the open chunk, two blob reads
+  void begin() {
+    ready = prefs.begin(STATS_NAMESPACE, false);
+    if (!ready) {
+      LOGW(LOG_GAME, "[STATS] NVS not available - stats are RAM only\n");
+      resetSummary();
+      resetEntrants();
+      return;
+    }
+    if (prefs.getBytes("ent", entrantBest, sizeof(entrantBest)) != sizeof(entrantBest)) resetEntrants();
+    if (prefs.getBytes("sum", &sum, sizeof(sum)) != sizeof(sum) || sum.version != STATS_VERSION ||
+        sum.logChunk >= STATS_LOG_CHUNKS || sum.logRecords > STATS_CHUNK_RECORDS) {
+      resetSummary();
+      LOGI(LOG_GAME, "[STATS] No stats yet, starting fresh\n");
+    } else {
+      char key[4];
+      chunkKey(sum.logChunk, key);
+      memset(chunk, 0, sizeof(chunk));
+      if (sum.logRecords) prefs.getBytes(key, chunk, sum.logRecords * sizeof(StatRecord));
+      LOGI(LOG_GAME, "[STATS] %lu games, %lu rounds on record\n",
+           (unsigned long)sum.games, (unsigned long)sum.rounds);
+    }
+    boardDirty = true;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Recording (RAM)
+  // ---------------------------------------------------------------------------
+  void addResult(bool reaction, uint8_t stick, uint8_t round, uint32_t ticks) {
+    if (stick >= MAX_STICKS) return;
+    push(reaction ? STAT_REACTION : STAT_SHAKE, stick, round, ticks);
+    StickTotals &t = sum.sticks[stick];
+    sessionResults++;
+    if (ticks == RESULT_TICKS_NONE) {
+      t.penalties++;
+      return;
+    }
+    if (!reaction) {
+      t.shakes++;
+      t.shakeTicks += ticks;
+      return;
+    }
+    t.reactions++;
+    t.reactionTicks += ticks;
+    if (ticks < t.bestTicks) t.bestTicks = ticks;
+    insertBest(stick, ticks);
+  }
+
+  void addRound() {
+    sum.rounds++;
+    sessionRounds++;
+  }
+
+  void addGame(uint8_t winnerStick, uint8_t rounds, bool deuce) {
+    push(STAT_GAME, winnerStick, deuce ? 1 : 0, rounds);
+    sum.games++;
+    if (deuce) sum.deuces++;
+    sessionGames++;
+  }
+
+  // Tournament entrant (0-based ticket): a valid reaction time
+  void addEntrantResult(uint8_t entrant, uint32_t ticks) {
+    if (entrant >= TOUR_MAX_ENTRANTS || ticks >= entrantBest[entrant]) return;
+    entrantBest[entrant] = ticks;
+    entrantsDirty = true;
+  }
+
+  // Seeds for Tournament::start(), by ticket (RESULT_TICKS_NONE = never played)
+  const uint32_t* entrantBests() const { return entrantBest; }
+
+  // Records waiting in RAM; main.cpp flushes in IDLE, or in SHOW_RESULTS past STATS_FLUSH_AT
+  uint8_t pending() const { return count; }
+
+  // ---------------------------------------------------------------------------
+  // Flash
+  // ---------------------------------------------------------------------------
+  // Append the buffer to the log, then commit the summary
+  void flush() {
+    if (!count && !entrantsDirty) return;
+    if (!ready) {
+      count = 0;
+      entrantsDirty = false;
+      return;
+    }
+    const uint32_t t0 = micros();
+    uint8_t written = 0;
+    if (entrantsDirty) {
+      prefs.putBytes("ent", entrantBest, sizeof(entrantBest));
+      entrantsDirty = false;
+      written++;
+    }
+    if (!count) return;
+    char key[4];
+    for (uint8_t i = 0; i < count; i++) {
+      if (sum.logRecords == STATS_CHUNK_RECORDS) {   // full: it stays, the oldest goes
+        chunkKey(sum.logChunk, key);
+        prefs.putBytes(key, chunk, sizeof(chunk));
+        written++;
+        sum.logChunk = (sum.logChunk + 1) % STATS_LOG_CHUNKS;
+        if (sum.logChunksUsed < STATS_LOG_CHUNKS) sum.logChunksUsed++;
+        sum.logRecords = 0;
+      }
+      chunk[sum.logRecords++] = buffer[i];
+    }
+    chunkKey(sum.logChunk, key);
+    prefs.putBytes(key, chunk, sum.logRecords * sizeof(StatRecord));
+    written++;
+    prefs.putBytes("sum", &sum, sizeof(sum));
+    flushes++;
+    LOGD(LOG_GAME, "[STATS] %d records flushed (%d chunk writes) in %lu us\n", count, written,
+         (unsigned long)(micros() - t0));
+    count = 0;
+  }
+
+  // Forget everything, in flash too
+  void clear() {
+    if (ready) prefs.clear();
+    resetSummary();
+    resetEntrants();
+    count = 0;
+    boardDirty = true;
+    LOGI(LOG_GAME, "[STATS] Cleared\n");
+  }
+
+  // ---------------------------------------------------------------------------
+  // Leaderboard
+  // ---------------------------------------------------------------------------
+  // True once after the table changed (or at boot)
+  bool takeBoardChanged() {
+    bool d = boardDirty;
+    boardDirty = false;
+    return d;
+  }
+
+  void markBoardChanged() { boardDirty = true; }
+
+  void addLeaderboard(BatchWriter &w) const {
+    for (uint8_t r = 0; r < LEADERBOARD_SIZE; r++) {
+      const Best &b = sum.top[r];
+      addLeaderboardEntry(w, r, b.ticks == RESULT_TICKS_NONE ? 0 : b.stick + 1, b.ticks);
+    }
+  }
+
+  void dump() const {
+    LOGI(LOG_GAME, "[STATS] Session: %lu games, %lu rounds, %lu results\n",
+         (unsigned long)sessionGames, (unsigned long)sessionRounds, (unsigned long)sessionResults);
+    LOGI(LOG_GAME, "[STATS] All time: %lu games (%lu deuces), %lu rounds, %d flushes this boot\n",
+         (unsigned long)sum.games, (unsigned long)sum.deuces, (unsigned long)sum.rounds, flushes);
+    for (uint8_t r = 0; r < LEADERBOARD_SIZE; r++) {
+      const Best &b = sum.top[r];
+      if (b.ticks == RESULT_TICKS_NONE) break;
+      LOGI(LOG_GAME, "  #%d  stick %d  %lu.%02lu ms\n", r + 1, b.stick + 1,
+           (unsigned long)(b.ticks / RESULT_TICKS_PER_MS), (unsigned long)(b.ticks % RESULT_TICKS_PER_MS));
+    }
+    for (uint8_t s = 0; s < MAX_STICKS; s++) {
+      const StickTotals &t = sum.sticks[s];
+      if (!t.reactions && !t.shakes && !t.penalties) continue;
+      const uint32_t avg = t.reactions ? (uint32_t)(t.reactionTicks / t.reactions) : 0;
+      const uint32_t shakeAvg = t.shakes ? (uint32_t)(t.shakeTicks / t.shakes) : 0;
+      LOGI(LOG_GAME, "  stick %d: %lu reactions avg %lu ms, %lu shakes avg %lu ms, %lu penalties\n",
+           s + 1, (unsigned long)t.reactions, (unsigned long)(avg / RESULT_TICKS_PER_MS),
+           (unsigned long)t.shakes, (unsigned long)(shakeAvg / RESULT_TICKS_PER_MS),
+           (unsigned long)t.penalties);
+    }
+    LOGI(LOG_GAME, "[STATS] Log: chunk %d of %d, %d records in it, %d waiting in RAM, %lu dropped\n",
+         sum.logChunk, STATS_LOG_CHUNKS, sum.logRecords, count, (unsigned long)dropped);
+  }
+
+private:
+  struct Best {
+    uint32_t ticks;             // RESULT_TICKS_NONE = empty
+    uint8_t stick;
+    uint8_t pad[3];
+  };
+
+  struct StickTotals {
+    uint32_t reactions;         // valid reaction results
+    uint32_t penalties;         // either mode
+    uint32_t shakes;            // valid shake results
+    uint32_t bestTicks;
+    uint64_t reactionTicks;     // sums, for the averages
+    uint64_t shakeTicks;
+  };
+
+  // Fixed layout, stored as one blob; STATS_VERSION guards changes
+  struct Summary {
+    uint16_t version;
+    uint8_t logChunk;           // open chunk
+    uint8_t logChunksUsed;      // full chunks behind it
+    uint16_t logRecords;        // records in the open chunk
+    uint16_t pad;
+    uint32_t games;
+    uint32_t rounds;
+    uint32_t deuces;
+    Best top[LEADERBOARD_SIZE];
+    StickTotals sticks[MAX_STICKS];
+  };
+
+  static void chunkKey(uint8_t idx, char key[4]) {
+    key[0] = 'c';
+    key[1] = (char)('0' + idx / 10);
+    key[2] = (char)('0' + idx % 10);
+    key[3] = '\0';
+  }
+
+  void resetSummary() {
+    memset(&sum, 0, sizeof(sum));
+    sum.version = STATS_VERSION;
+    for (uint8_t r = 0; r < LEADERBOARD_SIZE; r++) sum.top[r].ticks = RESULT_TICKS_NONE;
+    for (uint8_t s = 0; s < MAX_STICKS; s++) sum.sticks[s].bestTicks = RESULT_TICKS_NONE;
+    memset(chunk, 0, sizeof(chunk));
+  }
+
+  void resetEntrants() {
+    for (uint8_t e = 0; e < TOUR_MAX_ENTRANTS; e++) entrantBest[e] = RESULT_TICKS_NONE;
+    entrantsDirty = false;
+  }
+
+  void push(StatKind kind, uint8_t stick, uint8_t round, uint32_t ticks) {
+    if (count >= STATS_BUFFER_RECORDS) {   // shouldn't happen: main.cpp flushes well before
+      dropped++;
+      return;
+    }
+    StatRecord &r = buffer[count++];
+    r.ticks = ticks;
+    r.kind = kind;
+    r.stick = stick;
+    r.round = round;
+    r.game = (uint8_t)sum.games;
+  }
+
+  void insertBest(uint8_t stick, uint32_t ticks) {
+    uint8_t pos = LEADERBOARD_SIZE;
+    while (pos > 0 && ticks < sum.top[pos - 1].ticks) pos--;
+    if (pos == LEADERBOARD_SIZE) return;
+    memmove(&sum.top[pos + 1], &sum.top[pos], (LEADERBOARD_SIZE - 1 - pos) * sizeof(Best));
+    sum.top[pos].ticks = ticks;
+    sum.top[pos].stick = stick;
+    boardDirty = true;
+    LOGI(LOG_GAME, "[STATS] New #%d all-time reaction: stick %d\n", pos + 1, stick + 1);
+  }
+
+  Preferences prefs;
+  bool ready = false;
+  Summary sum;
+  StatRecord chunk[STATS_CHUNK_RECORDS];     // open chunk, as in flash after a flush
+  StatRecord buffer[STATS_BUFFER_RECORDS];   // not flushed yet
+  uint8_t count = 0;
+  bool boardDirty = false;
+  uint32_t entrantBest[TOUR_MAX_ENTRANTS];   // "ent" blob
+  bool entrantsDirty = false;
+
+  uint32_t sessionGames = 0;
+  uint32_t sessionRounds = 0;
+  uint32_t sessionResults = 0;
+  uint16_t flushes = 0;
+  uint32_t dropped = 0;
+};
+
+#endif // STATS_STORE_H
@@ -0,0 +1,235 @@
+/*
+ * StripEngine.h - Time-based ambient strip animations with cross-fades
+ * ESP32 Host
+ *
+ * Every effect is a function of the time since it started, not of how
+ * often it was called: smooth ones (rainbow, chase, breathing, the meteor
+ * head) compute their frame straight from elapsed microseconds; stochastic
+ * ones (sparkle, meteor trail, fire) advance a fixed-step simulation by as
+ * many steps as the elapsed time holds (at most STRIP_MAX_SIM_STEPS per
+ * frame). A busy frame therefore drops frames, never speed.
+ *
+ * Effects draw into a slot's own pixel and heat buffers. Two slots exist so
+ * a switch can cross-fade for STRIP_XFADE_MS: both run, and the output is
+ * blended from the old one into the new one. Frames are rendered at
+ * STRIP_TARGET_FPS and reach the bus through the LedCanvas (LedEffects.h).
+ *
+ * Whoever calls run() owns the strip bus: the host's render task on core 0
+ * (main.cpp, RENDER_USE_TASK), or a scheduler job without it.
+ */
+
+#ifndef STRIP_ENGINE_H
+#define STRIP_ENGINE_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "LedEffects.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define STRIP_TARGET_FPS      50
+#define STRIP_ANIM_MS         15000   // switch animation this often
+#define STRIP_XFADE_MS        1000
+#define STRIP_MAX_SIM_STEPS   4       // catch-up cap after a long gap
+
+static const uint32_t STRIP_FRAME_US = 1000000UL / STRIP_TARGET_FPS;
+
+enum StripAnim : uint8_t {
+  ANIM_RAINBOW_CYCLE,
+  ANIM_SPARKLE,
+  ANIM_METEOR,
+  ANIM_COLOR_CHASE,
+  ANIM_BREATHING,
+  ANIM_FIRE,
+  ANIM_COUNT  // total number of animations
+};
+
+// Pace of each animation: one hue / position / simulation step per this many us
+static const uint32_t STRIP_STEP_US[ANIM_COUNT] = {30000, 50000, 25000, 60000, 20000, 30000};
+
+template <typename Bus, uint16_t N>
+class StripEngine {
+public:
+  StripEngine(Bus &b, LedCanvas<Bus, N> &c) : bus(b), canvas(c) {}
+
+  // After the bus and canvas are up, before the first run()
+  void begin(uint32_t nowUs) {
+    for (uint16_t i = 0; i < N; i++) phase[i] = (uint8_t)((uint32_t)i * 256 / N);
+    rnd = (uint32_t)esp_random() | 1;
+    cur = 0;
+    fading = false;
+    startSlot(slots[cur], ANIM_RAINBOW_CYCLE, nowUs);
+    switchUs = nowUs;
+  }
+
+  // One frame: switch when due, render, blend, show
+  void run(uint32_t nowUs) {
+    if (!fading && nowUs - switchUs >= STRIP_ANIM_MS * 1000UL) {
+      StripAnim next;
+      do { next = (StripAnim)(nextRandom() % ANIM_COUNT); } while (next == slots[cur].anim && ANIM_COUNT > 1);
+      startSlot(slots[cur ^ 1], next, nowUs);
+      fading = true;
+      switchUs = nowUs;
+      LOGD(LOG_STRIP, "[STRIP] Cross-fading to animation %d\n", next);
+    }
+
+    Slot &a = slots[cur];
+    render(a, nowUs);
+    if (!fading) {
+      for (uint16_t i = 0; i < N; i++) canvas.set(i, a.px[i]);
+    } else {
+      Slot &b = slots[cur ^ 1];
+      render(b, nowUs);
+      const uint32_t t = nowUs - switchUs;
+      const uint8_t mix = t >= STRIP_XFADE_MS * 1000UL ? 255 : (uint8_t)(t * 255 / (STRIP_XFADE_MS * 1000UL));
+      for (uint16_t i = 0; i < N; i++) canvas.set(i, blend(a.px[i], b.px[i], mix));
+      if (mix == 255) {
+        cur ^= 1;
+        fading = false;
+      }
+    }
+    canvas.commit();
+    if (bus.CanShow()) bus.Show();   // busy: the next frame is as current as this one
+    frames++;
+  }
+
+  StripAnim animation() const { return slots[cur].anim; }
+  uint32_t frameCount() const { return frames; }
+
+private:
+  struct Slot {
+    StripAnim anim;
+    uint32_t startUs;
+    uint32_t stepsDone;       // simulation steps taken (stepped effects)
+    LedRgb px[N];             // this effect's frame (also its trail memory)
+    uint8_t heat[N];          // fire cells
+  };
+
+  void startSlot(Slot &s, StripAnim anim, uint32_t nowUs) {
+    s.anim = anim;
+    s.startUs = nowUs;
+    s.stepsDone = 0;
+    memset(s.px, 0, sizeof(s.px));
+    memset(s.heat, 0, sizeof(s.heat));
+  }
+
+  // Stepped effects: steps owed for the elapsed time, capped
+  uint32_t stepsDue(Slot &s, uint32_t steps) {
+    uint32_t owed = steps - s.stepsDone;
+    if (owed > STRIP_MAX_SIM_STEPS) owed = STRIP_MAX_SIM_STEPS;
+    s.stepsDone = steps;
+    return owed;
+  }
+
+  void render(Slot &s, uint32_t nowUs) {
+    const uint32_t steps = (nowUs - s.startUs) / STRIP_STEP_US[s.anim];
+    switch (s.anim) {
+      case ANIM_RAINBOW_CYCLE:
+        for (uint16_t i = 0; i < N; i++) s.px[i] = HUE_LUT[(uint8_t)(phase[i] + steps)];
+        break;
+
+      case ANIM_SPARKLE:
+        for (uint32_t k = stepsDue(s, steps); k; k--) {
+          fadeAll(s, 200);
+          for (int j = 0; j < 3; j++) s.px[nextRandom() % N] = HUE_LUT[nextRandom() & 0xFF];
+        }
+        break;
+
+      case ANIM_METEOR: {
+        for (uint32_t k = stepsDue(s, steps); k; k--) {
+          for (uint16_t i = 0; i < N; i++) {
+            if (nextRandom() % 10 > 4) s.px[i] = dim(s.px[i], 160);
+          }
+        }
+        const int head = steps % (N + 20);
+        for (int j = 0; j < 6; j++) {
+          const int pos = head - j;
+          if (pos >= 0 && pos < (int)N) s.px[pos] = dim(LedRgb{200, 80, 255}, 255 - j * 40);
+        }
+        break;
+      }
+
+      case ANIM_COLOR_CHASE: {
+        static const LedRgb chase[3] = {{255, 0, 0}, {0, 255, 0}, {0, 0, 255}};
+        uint8_t seg = steps % 18;
+        for (uint16_t i = 0; i < N; i++) {
+          s.px[i] = chase[seg / 6];
+          if (++seg == 18) seg = 0;
+        }
+        break;
+      }
+
+      case ANIM_BREATHING: {
+        const uint8_t ph = steps & 0xFF;
+        const uint8_t level = ph < 128 ? ph * 2 : (255 - ph) * 2;   // triangle 0->255->0
+        const LedRgb c = dim(HUE_LUT[(steps / 4) & 0xFF], GAMMA_LUT[level]);
+        for (uint16_t i = 0; i < N; i++) s.px[i] = c;
+        break;
+      }
+
+      case ANIM_FIRE:
+        for (uint32_t k = stepsDue(s, steps); k; k--) fireStep(s);
+        for (uint16_t i = 0; i < N; i++) s.px[i] = HEAT_LUT[s.heat[i]];
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  void fireStep(Slot &s) {
+    // Cool down every cell a little
+    for (uint16_t i = 0; i < N; i++) {
+      const uint8_t cooldown = nextRandom() % 20;
+      s.heat[i] = s.heat[i] > cooldown ? s.heat[i] - cooldown : 0;
+    }
+    // Heat drifts up and diffuses
+    for (int i = N - 1; i >= 2; i--) {
+      s.heat[i] = (s.heat[i - 1] + s.heat[i - 2] + s.heat[i - 2]) / 3;
+    }
+    // Randomly ignite new sparks near the bottom
+    if (nextRandom() % 255 < 160) {
+      const uint8_t pos = nextRandom() % 7;
+      const uint16_t h = s.heat[pos] + 160 + nextRandom() % 95;
+      s.heat[pos] = h > 255 ? 255 : h;
+    }
+  }
+
+  void fadeAll(Slot &s, uint8_t keep) {
+    for (uint16_t i = 0; i < N; i++) s.px[i] = dim(s.px[i], keep);
+  }
+
+  static LedRgb dim(LedRgb c, uint8_t keep) {
+    return LedRgb{scale8(c.r, keep), scale8(c.g, keep), scale8(c.b, keep)};
+  }
+
+  static uint8_t mix8(uint8_t a, uint8_t b, uint8_t t) {
+    return (uint8_t)(a + (((int16_t)b - a) * (t + 1) >> 8));
+  }
+
+  static LedRgb blend(LedRgb a, LedRgb b, uint8_t t) {
+    return LedRgb{mix8(a.r, b.r, t), mix8(a.g, b.g, t), mix8(a.b, b.b, t)};
+  }
+
+  // xorshift32: the renderer has its own stream, no shared RNG state with loop()
+  uint32_t nextRandom() {
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 17;
+    rnd ^= rnd << 5;
+    return rnd;
+  }
+
+  Bus &bus;
+  LedCanvas<Bus, N> &canvas;
+  uint8_t phase[N];
+  Slot slots[2];
+  uint8_t cur = 0;              // slot on screen (fading out during a cross-fade)
+  bool fading = false;
+  uint32_t switchUs = 0;        // last switch (or cross-fade start)
+  uint32_t rnd = 1;
+  uint32_t frames = 0;
+};
+
+#endif // STRIP_ENGINE_H
@@ -0,0 +1,115 @@
+/*
+ * TaskLoad.h - Per-task CPU use and stack headroom
+ * ESP32 Host
+ *
+ * Each task the host owns measures its own busy time: a TaskMeter is
+ * started and stopped around every unit of work, by that task only, into
+ * a free-running microsecond total. report() turns the totals' growth
+ * since the previous report into percent of one core, per task and per
+ * core, with each task's stack low-water mark.
+ *
+ * That covers our tasks, not WiFi, esp_timer or the idle tasks. Built with
+ * FreeRTOS run-time stats (configGENERATE_RUN_TIME_STATS), report() also
+ * lists every task from uxTaskGetSystemState(), counted by the kernel.
+ *
+ * Tasks are added from setup(); report() runs on loop()'s task.
+ */
+
+#ifndef TASK_LOAD_H
+#define TASK_LOAD_H
+
+#include <Arduino.h>
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define TASK_LOAD_MAX       6
+#define TASK_LOAD_MAX_ALL   24      // kernel task list (run-time stats builds)
+
+// Busy time of one task, written by that task only
+struct TaskMeter {
+  volatile uint32_t busyUs = 0;     // total, wraps
+  uint32_t startUs = 0;
+
+  void start() { startUs = micros(); }
+  void stop() { busyUs += micros() - startUs; }
+  void add(uint32_t us) { busyUs += us; }
+};
+
+class TaskLoad {
+public:
+  // handle may be nullptr (task not started: reported as such)
+  void add(const char* name, TaskHandle_t handle, uint8_t core, const TaskMeter* meter) {
+    if (count >= TASK_LOAD_MAX || !meter) return;
+    Entry &e = tasks[count++];
+    e.name = name;
+    e.handle = handle;
+    e.core = core;
+    e.meter = meter;
+    e.lastBusyUs = meter->busyUs;
+  }
+
+  void report() {
+    const uint32_t now = micros();
+    const uint32_t windowUs = now - lastUs;
+    lastUs = now;
+    if (!windowUs) return;
+    uint32_t coreBusy[2] = {0, 0};
+    LOGI(LOG_SCHED, "[CPU] Last %lu ms:\n", (unsigned long)(windowUs / 1000));
+    for (uint8_t i = 0; i < count; i++) {
+      Entry &e = tasks[i];
+      const uint32_t busy = e.meter->busyUs;
+      const uint32_t used = busy - e.lastBusyUs;
+      e.lastBusyUs = busy;
+      if (e.core < 2) coreBusy[e.core] += used;
+      if (!e.handle) {
+        LOGI(LOG_SCHED, "  %-7s core %d  not running\n", e.name, e.core);
+        continue;
+      }
+      LOGI(LOG_SCHED, "  %-7s core %d  %3lu.%lu%%  stack %lu bytes free\n", e.name, e.core,
+           (unsigned long)permille(used, windowUs) / 10, (unsigned long)permille(used, windowUs) % 10,
+           (unsigned long)uxTaskGetStackHighWaterMark(e.handle));
+    }
+    LOGI(LOG_SCHED, "  ours: core 0 %lu%%, core 1 %lu%%\n",
+         (unsigned long)permille(coreBusy[0], windowUs) / 10, (unsigned long)permille(coreBusy[1], windowUs) / 10);
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    reportKernel();
+#endif
+  }
+
+private:
+  struct Entry {
+    const char* name;
+    TaskHandle_t handle;
+    uint8_t core;
+    const TaskMeter* meter;
+    uint32_t lastBusyUs;
+  };
+
+  static uint32_t permille(uint32_t part, uint32_t whole) {
+    return (uint32_t)((uint64_t)part * 1000 / whole);
+  }
+
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+  // Every task, by the kernel's counters since boot (percent of one core)
+  void reportKernel() {
+    uint32_t total = 0;
+    const UBaseType_t n = uxTaskGetSystemState(all, TASK_LOAD_MAX_ALL, &total);
+    if (!n || !total) return;
+    LOGI(LOG_SCHED, "[CPU] All tasks since boot:\n");
+    for (UBaseType_t i = 0; i < n; i++) {
+      LOGI(LOG_SCHED, "  %-12s prio %2lu  %3lu%%\n", all[i].pcTaskName, (unsigned long)all[i].uxCurrentPriority,
+           (unsigned long)permille(all[i].ulRunTimeCounter, total) / 10);
+    }
+  }
+
+  TaskStatus_t all[TASK_LOAD_MAX_ALL];
+#endif
+
+  Entry tasks[TASK_LOAD_MAX];
+  uint8_t count = 0;
+  uint32_t lastUs = 0;
+};
+
+#endif // TASK_LOAD_H
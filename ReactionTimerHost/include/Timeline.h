@@ -0,0 +1,101 @@
+/*
+ * Timeline.h - Cues scheduled for absolute future instants
+ * ESP32 Host
+ *
+ * at(forUs, leadUs, fn, arg) calls owner->fn(forUs, arg) at forUs - leadUs
+ * (host micros()). The lead lets a cue hand its instant to something that needs
+ * time to land on it - the audio task pre-rolls silence so the clip starts
+ * on the right I2S sample, a stick gets CMD_CUE_AT over the radio - while
+ * lead 0 cues (LED flash, display) fire on the instant itself.
+ *
+ * run() is a scheduler job; due cues fire in deadline order. Owned by
+ * loop(): schedule and run from one task only. No Arduino dependency, so
+ * the game core builds natively too.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+
+#define TIMELINE_SLOTS  16
+
+template <class Owner>
+class Timeline {
+public:
+  typedef void (Owner::*CueFn)(uint32_t forUs, uint16_t arg);
+
+  explicit Timeline(Owner* owner) : owner(owner) {}
+
+  // False if every slot is taken
+  bool at(uint32_t forUs, uint32_t leadUs, CueFn fn, uint16_t arg) {
+    for (uint8_t i = 0; i < TIMELINE_SLOTS; i++) {
+      Cue &c = cues[i];
+      if (c.fn) continue;
+      c.fireUs = forUs - leadUs;
+      c.forUs = forUs;
+      c.fn = fn;
+      c.arg = arg;
+      return true;
+    }
+    return false;
+  }
+
+  // Fire every due cue, earliest first (a cue may schedule more)
+  void run(uint32_t nowUs) {
+    for (;;) {
+      int8_t next = -1;
+      for (uint8_t i = 0; i < TIMELINE_SLOTS; i++) {
+        if (!cues[i].fn || (int32_t)(nowUs - cues[i].fireUs) < 0) continue;
+        if (next < 0 || (int32_t)(cues[i].fireUs - cues[next].fireUs) < 0) next = i;
+      }
+      if (next < 0) return;
+      Cue c = cues[next];
+      cues[next].fn = nullptr;
+      uint32_t late = nowUs - c.fireUs;
+      if (late > maxLate) maxLate = late;
+      (owner->*c.fn)(c.forUs, c.arg);
+    }
+  }
+
+  void clear() {
+    for (uint8_t i = 0; i < TIMELINE_SLOTS; i++) cues[i].fn = nullptr;
+  }
+
+  // The earliest cue's fire time; false if none is pending
+  bool nextFireUs(uint32_t* fireUs) const {
+    int8_t next = -1;
+    for (uint8_t i = 0; i < TIMELINE_SLOTS; i++) {
+      if (!cues[i].fn) continue;
+      if (next < 0 || (int32_t)(cues[i].fireUs - cues[next].fireUs) < 0) next = i;
+    }
+    if (next < 0) return false;
+    *fireUs = cues[next].fireUs;
+    return true;
+  }
+
+  bool idle() const {
+    for (uint8_t i = 0; i < TIMELINE_SLOTS; i++) if (cues[i].fn) return false;
+    return true;
+  }
+
+  // Worst fire delay since the last call
+  uint32_t takeMaxLateUs() {
+    uint32_t l = maxLate;
+    maxLate = 0;
+    return l;
+  }
+
+private:
+  struct Cue {
+    uint32_t fireUs;
+    uint32_t forUs;
+    CueFn fn;
+    uint16_t arg;
+  };
+  Owner* owner;
+  Cue cues[TIMELINE_SLOTS] = {};
+  uint32_t maxLate = 0;
+};
+
+#endif // TIMELINE_H
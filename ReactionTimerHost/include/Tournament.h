@@ -0,0 +1,260 @@
+/*
+ * Tournament.h - Swiss rounds and a final for a queue of entrants
+ * ESP32 Host (and the native simulator, sim/)
+ *
+ * Entrants are numbers 1..N (a ticket each); the sticks stay in their seats
+ * and the people change between matches. A match is a short game of
+ * TOUR_MATCH_ROUNDS rounds between the entrants GameCore seats on the
+ * bound sticks, at most one per seat.
+ *
+ * TOUR_SWISS_ROUNDS Swiss rounds come first. Every entrant plays once per
+ * round: the lineup is cut into evenly sized matches of at most the seat
+ * count, so nobody waits for an odd match out. Round 1 deals the seeds
+ * out snake-wise (the fastest seeds meet late); later rounds group by
+ * standing, so close records play each other. A match of one (two seats,
+ * an odd count) is a bye worth a win: the top seed's in round 1, the
+ * last-placed entrant's after that. Then the top entrants by standing
+ * meet in one final, and its winner is the champion.
+ *
+ * Standing is points (opponents beaten, by match placing), then the best
+ * reaction time, seeded from earlier events (StatsStore.h), then ticket.
+ * Rematch avoidance is left out: within three rounds of groups of four it
+ * rarely matters, and it costs the "next match is known" property.
+ * Owned by GameCore: nothing here is thread-safe.
+ */
+
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <stdint.h>
+#include "Protocol.h"
+#include "GameTypes.h"
+#include "Log.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define TOUR_MAX_ENTRANTS   64
+#define TOUR_SWISS_ROUNDS   3
+#define TOUR_MATCH_ROUNDS   3       // rounds per match (a normal game is TOTAL_ROUNDS)
+#define TOUR_CHANGEOVER_MS  15000   // seats the next entrants; every seated stick pressing ends it early
+#define TOUR_RESULT_MS      6000    // match result on screen, next match's entrants named
+#define TOUR_NONE           0xFF    // no entrant (empty seat)
+
+static_assert(TOUR_MATCH_ROUNDS <= TOTAL_ROUNDS, "GameCore plans at most TOTAL_ROUNDS rounds");
+static_assert(TOUR_MAX_ENTRANTS <= 254, "entrants travel in one byte, 0 = empty seat");
+
+class Tournament {
+public:
+  // seedTicks[entrant - 1] = best earlier reaction (RESULT_TICKS_NONE or nullptr = unseeded)
+  bool start(uint8_t entrants, const uint32_t* seedTicks) {
+    if (entrants < 2 || entrants > TOUR_MAX_ENTRANTS) return false;
+    count = entrants;
+    for (uint8_t i = 0; i < count; i++) {
+      table[i].points = 0;
+      table[i].played = 0;
+      table[i].bestTicks = seedTicks ? seedTicks[i] : RESULT_TICKS_NONE;
+    }
+    seatMask = 0;
+    seatCount = 0;
+    swissRound = 0;
+    finalMatch = false;
+    done = false;
+    champ = TOUR_NONE;
+    played = 0;
+    clearMatch();
+    LOGI(LOG_GAME, "[TOUR] %d entrants: %d Swiss rounds, then a final\n", count, TOUR_SWISS_ROUNDS);
+    return true;
+  }
+
+  void stop() {
+    if (count) LOGI(LOG_GAME, "[TOUR] Over after %d matches\n", played);
+    count = 0;
+    seatMask = 0;
+    clearMatch();
+  }
+
+  bool active() const { return count != 0; }
+  bool seated() const { return seatMask != 0; }
+  bool inFinal() const { return finalMatch; }
+  bool finished() const { return done; }
+  uint8_t champion() const { return champ; }       // 0-based entrant
+  uint16_t matches() const { return played; }
+  uint8_t entrants() const { return count; }
+
+  // The first join bound sticks to these slots (bit per slot); they stay for the tournament
+  void seat(uint8_t slotMask) {
+    seatMask = slotMask;
+    seatCount = 0;
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      if (slotMask & (1 << i)) seatCount++;
+    }
+    LOGI(LOG_GAME, "[TOUR] %d seats\n", seatCount);
+    if (count <= seatCount) {   // everyone fits one match: that is the final
+      beginFinal();
+      return;
+    }
+    beginRound();
+    nextMatch();
+  }
+
+  // 0-based entrant seated at the slot for the current match, or TOUR_NONE
+  uint8_t entrantAt(uint8_t slot) const { return slot < MAX_PLAYERS ? match[slot] : TOUR_NONE; }
+
+  // Match over. place[slot]: 0 = won, ties share a place; best[slot]: fastest reaction
+  void report(const uint8_t* place, const uint32_t* best) {
+    if (!active() || done) return;
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      if (match[i] != TOUR_NONE) n++;
+    }
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      if (match[i] == TOUR_NONE) continue;
+      Entrant &e = table[match[i]];
+      e.points += place[i] < n ? n - 1 - place[i] : 0;
+      e.played++;
+      if (best[i] < e.bestTicks) e.bestTicks = best[i];
+      if (finalMatch && place[i] == 0 && champ == TOUR_NONE) champ = match[i];
+    }
+    played++;
+    if (finalMatch) {
+      done = true;
+      clearMatch();
+      LOGI(LOG_GAME, "[TOUR] Champion: #%d after %d matches\n", champ + 1, played);
+      return;
+    }
+    matchInRound++;
+    nextMatch();
+  }
+
+  void dump() const {
+    if (!active()) {
+      LOGI(LOG_GAME, "[TOUR] No tournament\n");
+      return;
+    }
+    LOGI(LOG_GAME, "[TOUR] %d entrants, %d matches played, %s\n", count, played,
+         done ? "finished" : finalMatch ? "final" : "Swiss");
+    uint8_t order[TOUR_MAX_ENTRANTS];
+    rank(order);
+    for (uint8_t r = 0; r < count; r++) {
+      const Entrant &e = table[order[r]];
+      LOGI(LOG_GAME, "  %2d. #%-2d  %2d pts  %d played  best %lu ms\n", r + 1, order[r] + 1, e.points, e.played,
+           (unsigned long)(e.bestTicks == RESULT_TICKS_NONE ? 0 : e.bestTicks / RESULT_TICKS_PER_MS));
+    }
+  }
+
+private:
+  struct Entrant {
+    uint8_t points;
+    uint8_t played;
+    uint32_t bestTicks;         // RESULT_TICKS_NONE = no valid reaction (or seed) yet
+  };
+
+  bool ahead(uint8_t a, uint8_t b) const {
+    if (table[a].points != table[b].points) return table[a].points > table[b].points;
+    if (table[a].bestTicks != table[b].bestTicks) return table[a].bestTicks < table[b].bestTicks;
+    return a < b;
+  }
+
+  // Standing order, insertion sort (N is small)
+  void rank(uint8_t* order) const {
+    for (uint8_t i = 0; i < count; i++) {
+      uint8_t j = i;
+      while (j > 0 && ahead(i, order[j - 1])) {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = i;
+    }
+  }
+
+  // Cut this round's lineup into matches of at most seatCount
+  void beginRound() {
+    uint8_t order[TOUR_MAX_ENTRANTS];
+    rank(order);
+    matchCount = (count + seatCount - 1) / seatCount;
+    matchInRound = 0;
+    if (swissRound > 0) {
+      // By standing, in even slices cut from the bottom: a bye goes to the last
+      for (uint8_t i = 0; i < count; i++) lineup[i] = order[i];
+      for (uint8_t k = 0; k <= matchCount; k++) {
+        bound[k] = count - (uint8_t)((uint16_t)(matchCount - k) * count / matchCount);
+      }
+    } else {
+      // Snake: the seeds are dealt to matches 0..M-1, then back M-1..0, and so on
+      uint8_t n = 0;
+      bound[0] = 0;
+      for (uint8_t k = 0; k < matchCount; k++) {
+        for (uint8_t i = 0; i < count; i++) {
+          const uint8_t lap = i / matchCount;
+          const uint8_t pos = i % matchCount;
+          if ((lap & 1 ? matchCount - 1 - pos : pos) == k) lineup[n++] = order[i];
+        }
+        bound[k + 1] = n;
+      }
+    }
+    LOGI(LOG_GAME, "[TOUR] Swiss round %d: %d matches\n", swissRound + 1, matchCount);
+  }
+
+  // Seat the next match of the round, past byes; the last round leads to the final
+  void nextMatch() {
+    for (;;) {
+      if (matchInRound >= matchCount) {
+        if (++swissRound >= TOUR_SWISS_ROUNDS) {
+          beginFinal();
+          return;
+        }
+        beginRound();
+      }
+      const uint8_t from = bound[matchInRound];
+      const uint8_t size = bound[matchInRound + 1] - from;
+      if (size >= 2) {
+        seatEntrants(&lineup[from], size);
+        return;
+      }
+      if (size == 1) {
+        table[lineup[from]].points++;
+        LOGI(LOG_GAME, "[TOUR] #%d has a bye\n", lineup[from] + 1);
+      }
+      matchInRound++;
+    }
+  }
+
+  void beginFinal() {
+    uint8_t order[TOUR_MAX_ENTRANTS];
+    rank(order);
+    finalMatch = true;
+    seatEntrants(order, count < seatCount ? count : seatCount);
+    LOGI(LOG_GAME, "[TOUR] Final: the top %d\n", count < seatCount ? count : seatCount);
+  }
+
+  // One entrant per bound slot, in slot order; the rest sit out
+  void seatEntrants(const uint8_t* who, uint8_t n) {
+    clearMatch();
+    uint8_t k = 0;
+    for (uint8_t i = 0; i < MAX_PLAYERS && k < n; i++) {
+      if (seatMask & (1 << i)) match[i] = who[k++];
+    }
+  }
+
+  void clearMatch() {
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) match[i] = TOUR_NONE;
+  }
+
+  Entrant table[TOUR_MAX_ENTRANTS];
+  uint8_t count = 0;                    // 0 = no tournament
+  uint8_t seatMask = 0;                 // slots with a bound stick, 0 = not seated yet
+  uint8_t seatCount = 0;
+  uint8_t swissRound = 0;               // 0-based
+  uint8_t lineup[TOUR_MAX_ENTRANTS];    // this round's entrants, match by match
+  uint8_t bound[TOUR_MAX_ENTRANTS / 2 + 1];  // match k is lineup[bound[k] .. bound[k+1])
+  uint8_t matchCount = 0;               // matches this round (byes included)
+  uint8_t matchInRound = 0;
+  uint8_t match[MAX_PLAYERS];           // [slot] = entrant, TOUR_NONE = empty seat
+  bool finalMatch = false;
+  bool done = false;
+  uint8_t champ = TOUR_NONE;
+  uint16_t played = 0;                  // matches, byes not counted
+};
+
+#endif // TOURNAMENT_H
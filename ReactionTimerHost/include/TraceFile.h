@@ -0,0 +1,49 @@
+/*
+ * TraceFile.h - A PacketTrace in SPIFFS
+ * ESP32 Host
+ *
+ * TRACE_FILE holds one trace in PacketTrace.h's file layout, so a copy
+ * pulled off the flash runs in the simulator as is (GameSim.cpp replay).
+ * SPIFFS.begin() is done by AudioManager. Owned by loop().
+ */
+
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include "PacketTrace.h"
+#include "Log.h"
+
+#define TRACE_FILE        "/trace.bin"
+
+inline bool saveTrace(const PacketTrace &trace) {
+  TraceFileHeader fh;
+  if (!trace.fileHeader(&fh)) return false;
+  File f = SPIFFS.open(TRACE_FILE, "w");
+  if (!f) return false;
+  bool ok = f.write((const uint8_t*)&fh, sizeof(fh)) == sizeof(fh) &&
+            f.write(trace.frameBytes(), fh.bytes) == fh.bytes;
+  f.close();
+  LOGI(LOG_LAT, "[TRACE] %s %lu frames to " TRACE_FILE "\n", ok ? "Saved" : "FAILED saving",
+       (unsigned long)fh.frames);
+  return ok;
+}
+
+inline bool loadTrace(PacketTrace &trace) {
+  uint8_t *dst = trace.loadBuffer();
+  if (!dst) return false;
+  File f = SPIFFS.open(TRACE_FILE, "r");
+  if (!f) return false;
+  TraceFileHeader fh;
+  bool ok = f.read((uint8_t*)&fh, sizeof(fh)) == sizeof(fh) && fh.bytes <= TRACE_BUF_BYTES &&
+            f.read(dst, fh.bytes) == fh.bytes;
+  f.close();
+  if (!ok) fh.magic = 0;        // adopt() then leaves no trace
+  ok = trace.adopt(fh);
+  LOGI(LOG_LAT, "[TRACE] %s " TRACE_FILE ": %lu frames\n", ok ? "Loaded" : "Bad",
+       (unsigned long)trace.frameCount());
+  return ok;
+}
+
+#endif // TRACE_FILE_H
@@ -0,0 +1,218 @@
+"""
+Firmware update package builder - new image (+ the image it replaces) -> data/ota/*.pkg
+
+The host serves these from SPIFFS (include/OtaServer.h, FIRMWARE UPDATE in
+Protocol.h). Layout must match OtaServer.h:
+  PackageHeader (24 B) | PackageEntry[blocks] (8 B each) | records
+and each record the block format in lib/ReactionProtocol/src/OtaImage.h.
+
+With --base the blocks are encoded against the image the devices run now
+(copies from anywhere in it, so code that only moved costs a few bytes);
+without it the package is a full image, compressed inside each block.
+Every record is decoded again here before the package is written.
+
+  python ota_pack.py stick  .pio/build/stick/firmware.bin  --version 4.13.1 \\
+         --base old_stick.bin --base-version 4.13.0
+  python ota_pack.py display ../Display/project1-game/.pio/build/esp32s3/firmware.bin --version 4.13.1
+then `pio run -t uploadfs` on the host.
+"""
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+PKG_MAGIC = 0x414F5452    # "RTOA"
+PKG_FORMAT = 1
+BLOCK_SIZE = 4096         # OTA_BLOCK_SIZE
+RECORD_MAX = 32 * 200     # OTA_RECORD_MAX
+TARGETS = {"stick": 1, "display": 2}
+
+OP_COPY_BASE, OP_COPY_BACK, OP_LONG = 0x80, 0xC0, 0x3F
+MIN_BASE, MIN_BACK = 4, 3
+CHAIN_BASE, CHAIN_BACK = 24, 16   # match candidates tried per position
+
+HERE = os.path.dirname(os.path.abspath(__file__)) if "__file__" in globals() else os.getcwd()
+
+
+def encode_version(text):
+    """'4.13.1' -> encodeVersion() in Protocol.h"""
+    major, minor, patch = (int(p) for p in text.lstrip("Vv").split("."))
+    if major > 15 or minor > 15 or patch > 255:
+        sys.exit("version %s does not fit the 4.4.8-bit encoding" % text)
+    return ((major << 4 | minor) << 8) | patch
+
+
+def match_len(a, ai, b, bi, limit):
+    n = 0
+    while n + 32 <= limit and a[ai + n:ai + n + 32] == b[bi + n:bi + n + 32]:
+        n += 32
+    while n < limit and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+class BaseIndex:
+    """Hash chains over every 4-byte position of the base image"""
+
+    def __init__(self, data):
+        self.data = data
+        self.head = {}
+        self.prev = [-1] * len(data)
+        for i in range(len(data) - MIN_BASE + 1):
+            key = data[i:i + MIN_BASE]
+            self.prev[i] = self.head.get(key, -1)
+            self.head[key] = i
+
+    def candidates(self, key):
+        pos = self.head.get(key, -1)
+        for _ in range(CHAIN_BASE):
+            if pos < 0:
+                return
+            yield pos
+            pos = self.prev[pos]
+
+
+def put_len(out, op, length, short_min):
+    if length - short_min < OP_LONG:
+        out.append(op | (length - short_min))
+    else:
+        out.append(op | OP_LONG)
+        out += struct.pack("<H", length)
+
+
+def encode_block(block, base, index):
+    out = bytearray(struct.pack("<I", zlib.crc32(block) & 0xFFFFFFFF))
+    literal = bytearray()
+    back = {}                     # 3-byte key -> positions in this block, newest last
+    cursor = -1                   # base offset the last base copy ended at
+
+    def flush():
+        for k in range(0, len(literal), 128):
+            part = literal[k:k + 128]
+            out.append(len(part) - 1)
+            out.extend(part)
+        literal.clear()
+
+    i = 0
+    while i < len(block):
+        left = len(block) - i
+        best, kind, src = 0, None, 0
+        if base is not None and left >= MIN_BASE:
+            tries = []
+            if cursor >= 0:
+                tries += [cursor + len(literal), cursor]   # same place, after a changed run or an insertion
+            tries += index.candidates(bytes(block[i:i + MIN_BASE]))
+            for pos in tries:
+                if pos < 0 or pos + MIN_BASE > len(base):
+                    continue
+                n = match_len(block, i, base, pos, min(left, len(base) - pos))
+                if n > best:
+                    best, kind, src = n, "base", pos
+        if left >= MIN_BACK:
+            for pos in reversed(back.get(bytes(block[i:i + MIN_BACK]), [])[-CHAIN_BACK:]):
+                n = match_len(block, i, block, pos, left)
+                if n > best + 1:                     # a back copy is a byte cheaper
+                    best, kind, src = n, "back", pos
+        if kind == "base" and best >= MIN_BASE:
+            flush()
+            put_len(out, OP_COPY_BASE, best, MIN_BASE)
+            out += struct.pack("<I", src)[:3]
+            cursor = src + best
+        elif kind == "back" and best >= MIN_BACK:
+            flush()
+            put_len(out, OP_COPY_BACK, best, MIN_BACK)
+            out += struct.pack("<H", i - src)
+        else:
+            best = 1
+            literal.append(block[i])
+        for k in range(i, min(i + best, len(block) - MIN_BACK + 1)):
+            back.setdefault(bytes(block[k:k + MIN_BACK]), []).append(k)
+        i += best
+    flush()
+    return bytes(out)
+
+
+def decode_block(rec, out_len, base):
+    """Mirror of otaDecodeBlock()"""
+    out = bytearray()
+    pos = 4
+    while len(out) < out_len:
+        op = rec[pos]
+        pos += 1
+        if op < OP_COPY_BASE:
+            out += rec[pos:pos + op + 1]
+            pos += op + 1
+            continue
+        is_base = op < OP_COPY_BACK
+        length = (op & OP_LONG) + (MIN_BASE if is_base else MIN_BACK)
+        if op & OP_LONG == OP_LONG:
+            length = struct.unpack_from("<H", rec, pos)[0]
+            pos += 2
+        if is_base:
+            src = rec[pos] | rec[pos + 1] << 8 | rec[pos + 2] << 16
+            pos += 3
+            out += base[src:src + length]
+        else:
+            dist = struct.unpack_from("<H", rec, pos)[0]
+            pos += 2
+            for _ in range(length):
+                out.append(out[-dist])
+    assert pos == len(rec) and len(out) == out_len, "record does not decode to its block"
+    assert zlib.crc32(out) & 0xFFFFFFFF == struct.unpack_from("<I", rec)[0], "block CRC mismatch"
+    return bytes(out)
+
+
+def build(target, image, version, base=None, base_version=0):
+    index = BaseIndex(base) if base is not None else None
+    blocks = [image[k:k + BLOCK_SIZE] for k in range(0, len(image), BLOCK_SIZE)]
+    records = []
+    for n, block in enumerate(blocks):
+        rec = encode_block(block, base, index)
+        if len(rec) > RECORD_MAX:
+            sys.exit("block %d encodes to %d bytes (max %d)" % (n, len(rec), RECORD_MAX))
+        if decode_block(rec, len(block), base) != block:
+            sys.exit("block %d does not decode back" % n)
+        records.append(rec)
+
+    header_len = 24 + 8 * len(records)
+    entries, offset = bytearray(), header_len
+    for rec in records:
+        entries += struct.pack("<IHH", offset, len(rec), 0)
+        offset += len(rec)
+    header = struct.pack("<IBBHHHIII", PKG_MAGIC, PKG_FORMAT, TARGETS[target], version, base_version,
+                         len(records), len(image), zlib.crc32(image) & 0xFFFFFFFF,
+                         zlib.crc32(base) & 0xFFFFFFFF if base is not None else 0)
+    return header + bytes(entries) + b"".join(records)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Build a firmware update package for the host to serve")
+    ap.add_argument("target", choices=sorted(TARGETS))
+    ap.add_argument("image", help="new firmware .bin")
+    ap.add_argument("--version", required=True, help="new firmware version, e.g. 4.13.1")
+    ap.add_argument("--base", help="firmware .bin the devices run now (delta package)")
+    ap.add_argument("--base-version", help="its version (required with --base)")
+    ap.add_argument("-o", "--output", help="default: data/ota/<target>.pkg")
+    args = ap.parse_args()
+    if bool(args.base) != bool(args.base_version):
+        ap.error("--base and --base-version go together")
+
+    image = open(args.image, "rb").read()
+    base = open(args.base, "rb").read() if args.base else None
+    if base is not None and len(base) >= 1 << 24:
+        sys.exit("base image over 16 MB: offsets are 24 bits")
+    pkg = build(args.target, image, encode_version(args.version), base,
+                encode_version(args.base_version) if base is not None else 0)
+
+    out = args.output or os.path.join(HERE, "data", "ota", args.target + ".pkg")
+    os.makedirs(os.path.dirname(out) or ".", exist_ok=True)
+    with open(out, "wb") as f:
+        f.write(pkg)
+    print("%s: %d-byte image in %d blocks -> %d bytes (%.1f%%)%s" % (
+        out, len(image), (len(image) + BLOCK_SIZE - 1) // BLOCK_SIZE, len(pkg), 100.0 * len(pkg) / len(image),
+        ", delta from %s" % args.base_version if base is not None else ", full image"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+"""
+Sound pack builder - data/*.mp3 -> one image for the "audio" flash partition
+
+Layout must match include/AudioPack.h:
+  PackHeader (16 B) | PackEntry[count] (40 B each) | clip data, 4-byte aligned
+
+Cues that must start instantly stay 16-bit PCM; everything else is
+IMA-ADPCM (4 bits/sample). MP3s are decoded with ffmpeg, mono at PACK_RATE.
+
+PlatformIO:  pio run -t uploadaudio     (builds the pack, flashes the partition)
+Standalone:  python pack_audio.py [out.pak]
+"""
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import zlib
+
+PACK_MAGIC = 0x4B505452   # "RTPK"
+PACK_VERSION = 1
+PACK_RATE = 22050
+PACK_NAME_LEN = 24
+PACK_MAX_CLIPS = 32
+PACK_PARTITION = "audio"
+
+CLIP_PCM16, CLIP_PCM8, CLIP_ADPCM = 0, 1, 2
+
+# SND_* cues that must start on an exact sample (AUDIO_CACHED_SOUNDS)
+PCM16_CLIPS = {"beep.mp3", "three.mp3", "two.mp3", "one.mp3", "click.mp3", "error.mp3"}
+
+ADPCM_STEP = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+]
+ADPCM_INDEX = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+HERE = os.path.dirname(os.path.abspath(__file__)) if "__file__" in globals() else os.getcwd()
+
+
+def decode_mp3(path):
+    """Mono int16 samples at PACK_RATE"""
+    raw = subprocess.run(
+        ["ffmpeg", "-v", "error", "-i", path, "-f", "s16le", "-ac", "1", "-ar", str(PACK_RATE), "-"],
+        check=True, stdout=subprocess.PIPE).stdout
+    return list(struct.unpack("<%dh" % (len(raw) // 2), raw[:len(raw) // 2 * 2]))
+
+
+def adpcm_encode(samples):
+    """IMA-ADPCM from predictor 0 / index 0, low nibble first (ClipVoice::decode)"""
+    pred, index = 0, 0
+    out = bytearray((len(samples) + 1) // 2)
+    for i, s in enumerate(samples):
+        step = ADPCM_STEP[index]
+        diff = s - pred
+        code = 0
+        if diff < 0:
+            code = 8
+            diff = -diff
+        # code from the encoder's own reconstruction, so both sides agree exactly
+        delta = step >> 3
+        if diff >= step:
+            code |= 4
+            diff -= step
+            delta += step
+        if diff >= step >> 1:
+            code |= 2
+            diff -= step >> 1
+            delta += step >> 1
+        if diff >= step >> 2:
+            code |= 1
+            delta += step >> 2
+        pred = max(-32768, min(32767, pred - delta if code & 8 else pred + delta))
+        index = max(0, min(88, index + ADPCM_INDEX[code & 7]))
+        out[i >> 1] |= code << ((i & 1) * 4)
+    return bytes(out)
+
+
+def build_pack(data_dir):
+    names = sorted(f for f in os.listdir(data_dir) if f.endswith(".mp3"))
+    if len(names) > PACK_MAX_CLIPS:
+        raise RuntimeError("%d clips, pack holds %d" % (len(names), PACK_MAX_CLIPS))
+
+    clips = []
+    for name in names:
+        key = "/" + name   # SND_* path
+        if len(key) >= PACK_NAME_LEN:
+            raise RuntimeError("%s: name longer than %d" % (key, PACK_NAME_LEN - 1))
+        pcm = decode_mp3(os.path.join(data_dir, name))
+        if name in PCM16_CLIPS:
+            fmt, blob = CLIP_PCM16, struct.pack("<%dh" % len(pcm), *pcm)
+        else:
+            fmt, blob = CLIP_ADPCM, adpcm_encode(pcm)
+        clips.append((key, fmt, len(pcm), blob))
+
+    offset = 16 + 40 * len(clips)
+    index = b""
+    body = b""
+    for key, fmt, samples, blob in clips:
+        pad = (-offset) % 4
+        body += b"\0" * pad
+        offset += pad
+        index += struct.pack("<%dsIIIHBB" % PACK_NAME_LEN, key.encode(), offset, len(blob),
+                             samples, PACK_RATE, fmt, 0)
+        body += blob
+        offset += len(blob)
+
+    header = struct.pack("<IHHII", PACK_MAGIC, PACK_VERSION, len(clips), offset,
+                         zlib.crc32(index) & 0xFFFFFFFF)
+    return header + index + body, clips
+
+
+def write_pack(out_path, data_dir):
+    if not shutil.which("ffmpeg"):
+        raise RuntimeError("ffmpeg not found - needed to decode the MP3s")
+    image, clips = build_pack(data_dir)
+    os.makedirs(os.path.dirname(out_path) or ".", exist_ok=True)
+    with open(out_path, "wb") as f:
+        f.write(image)
+    for key, fmt, samples, blob in clips:
+        print("  %-18s %-5s %6.2f s %7d B" % (key, ("pcm16", "pcm8", "adpcm")[fmt],
+                                             samples / PACK_RATE, len(blob)))
+    print("Sound pack: %d clips, %d bytes -> %s" % (len(clips), len(image), out_path))
+    return len(image)
+
+
+def partition(csv_path, label):
+    """(offset, size) of a partition in partitions.csv"""
+    with open(csv_path) as f:
+        for line in f:
+            cols = [c.strip() for c in line.split("#")[0].split(",")]
+            if len(cols) >= 5 and cols[0] == label:
+                return int(cols[3], 0), int(cols[4], 0)
+    raise RuntimeError("no '%s' partition in %s" % (label, csv_path))
+
+
+try:
+    Import("env")   # noqa: F821 - PlatformIO extra script
+except NameError:
+    env = None
+
+if env is not None:
+    PAK = os.path.join(env.subst("$BUILD_DIR"), "sounds.pak")
+    CSV = os.path.join(env.subst("$PROJECT_DIR"), env.GetProjectOption("board_build.partitions"))
+
+    def build_action(target, source, env):
+        offset, size = partition(CSV, PACK_PARTITION)
+        if write_pack(PAK, env.subst("$PROJECT_DATA_DIR")) > size:
+            raise RuntimeError("sound pack does not fit the %d-byte partition" % size)
+
+    def upload_action(target, source, env):
+        offset, _ = partition(CSV, PACK_PARTITION)
+        env.Execute(env.VerboseAction(
+            '"$PYTHONEXE" "$UPLOADER" --chip esp32 --port "$UPLOAD_PORT" --baud $UPLOAD_SPEED '
+            'write_flash 0x%x "%s"' % (offset, PAK), "Writing sound pack at 0x%x" % offset))
+
+    env.AddCustomTarget(
+        name="buildaudio", dependencies=None, actions=[build_action],
+        title="Build sound pack", description="Encode data/*.mp3 into sounds.pak")
+    env.AddCustomTarget(
+        name="uploadaudio", dependencies=None,
+        actions=[build_action, env.VerboseAction(env.AutodetectUploadPort, "Looking for upload port..."),
+                 upload_action],
+        title="Upload sound pack", description="Build sounds.pak and flash the audio partition")
+
+elif __name__ == "__main__":
+    out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(HERE, ".pio", "sounds.pak")
+    write_pack(out, os.path.join(HERE, "data"))
@@ -0,0 +1,556 @@
+/*
+ * GameSim.cpp - Native simulation of the host game (env:native)
+ *
+ * Runs GameCore.h on a virtual clock with scripted sticks: each game picks
+ * 2-4 players who join from the slot prompts, then every GO gets one
+ * scripted press per stick - normal, early (penalty), late into the
+ * yellow warning, or never - with random radio delay, duplicated and
+ * reordered deliveries, and shake progress. Audio is modelled only as far
+ * as idleAtMs() (announcement lengths); LEDs and the display are counters.
+ *
+ * Every state change is checked against the rules: results only after
+ * every active player finished and never before a scripted press that
+ * would have won, no penalty in the stats for a player that round cut
+ * off, final winner only after gameRounds() or a deuce lead, no game longer
+ * than SIM_GAME_LIMIT_MS. A violation prints the game's seed and exits 1.
+ * The summary gives the average COLLECT time; build with
+ * -DCOLLECT_POLICY=0 to compare with waiting out every timeout.
+ *
+ *   .pio/build/native/program [games] [seed] [step_ms] [entrants]
+ * step_ms (default 1) is how far virtual time moves per game job; larger
+ * steps run faster and coarsen every timeout accordingly. With entrants
+ * (2..TOUR_MAX_ENTRANTS) every "game" is a whole tournament (Tournament.h)
+ * on all SIM_STICKS sticks instead, each entrant pressing in most
+ * changeovers, and the summary adds matches per hour. Build with
+ * -DLOG_LEVEL=LOG_LEVEL_INFO and run one game for a transcript.
+ *
+ *   .pio/build/native/program replay trace.bin [speed] [step_ms]
+ * replays a host recording (`trace save`, TRACE_FILE in TraceFile.h,
+ * copied off SPIFFS) instead: the frames go through receiveFrame()'s
+ * unpacking into GameCore at their recorded offsets / speed, nothing is
+ * scripted, and every state change is printed and checked as above.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include "GameCore.h"
+#include "PacketTrace.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define SIM_STICKS          4
+#define SIM_EVENTS          32          // pending stick -> host deliveries
+#define SIM_GAME_LIMIT_MS   (30UL * 60 * 1000)  // a game this long is stuck
+#define SIM_CLIP_MS         900         // modelled length of every announcement
+
+// =============================================================================
+// WORLD: virtual time, randomness, pending deliveries
+// =============================================================================
+uint64_t simUs = 1000000;               // virtual micros(); never 0 (stateStartTime sentinel)
+uint32_t rngState = 1;
+
+uint32_t rng() {                        // xorshift32
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+uint32_t rngRange(uint32_t lo, uint32_t hi) { return lo + rng() % (hi - lo + 1); }
+
+enum SimEventKind : uint8_t { EV_NONE, EV_JOIN, EV_PROGRESS, EV_REACTION, EV_SHAKE };
+
+struct SimEvent {
+  uint64_t atUs;
+  SimEventKind kind;
+  uint8_t stickId;
+  uint32_t value;                       // ticks, or count << 8 | target for EV_PROGRESS
+};
+
+SimEvent events[SIM_EVENTS];
+
+void schedule(uint64_t atUs, SimEventKind kind, uint8_t stickId, uint32_t value) {
+  for (uint8_t i = 0; i < SIM_EVENTS; i++) {
+    if (events[i].kind != EV_NONE) continue;
+    events[i].atUs = atUs;
+    events[i].kind = kind;
+    events[i].stickId = stickId;
+    events[i].value = value;
+    return;
+  }
+}
+
+struct SimStats {
+  uint32_t games;
+  uint32_t rounds;
+  uint32_t sends;
+  uint32_t displayItems;
+  uint32_t results;
+  uint32_t rejected;                    // wrong state or repeat
+  uint32_t penalties;
+  uint32_t lateSaves;                   // accepted during the yellow warning
+  uint32_t cutOffs;                     // out of a round already decided, no penalty
+  uint32_t deuces;
+  uint32_t timeoutResets;
+  uint32_t violations;
+  uint32_t matches;                     // tournament mode
+  uint64_t changeoverUs;                // FINAL_WINNER -> JOIN -> COUNTDOWN, all of them
+  uint32_t changeovers;
+  uint64_t collectUs;                   // GO -> results, reaction rounds
+  uint32_t collects;
+};
+
+SimStats stats = {};
+uint8_t tourEntrants = 0;               // 0 = plain games
+uint32_t scriptedTicks[MAX_PLAYERS];    // this round's press per slot, RESULT_TICKS_NONE = none or early
+bool reportedPenalty[MAX_PLAYERS];      // this round, per slot: the stick's own penalty got in
+bool roundYellow = false;               // this round reached the yellow warning
+bool replayMode = false;                // a trace is the only stick: nothing scripted
+
+// =============================================================================
+// INTERFACES
+// =============================================================================
+class SimClock : public GameClock {
+public:
+  uint32_t nowMs() override { return (uint32_t)(simUs / 1000); }
+  uint32_t nowUs() override { return (uint32_t)simUs; }
+  uint32_t random(uint32_t max) override { return max ? rng() % max : 0; }
+};
+
+class SimAudio : public GameAudio {
+public:
+  void queueSound(const char*, AudioPriority) override { queue(1); }
+  void queueSoundAt(const char*, uint32_t) override {}
+  void playPlayerNumber(uint8_t) override { queue(1); }
+  void playPlayerWins(uint8_t) override { queue(2); }
+  void playShakeTarget(uint8_t) override { queue(1); }
+  void prefetch(const char*) override {}
+  void stop() override { busyUntilMs = simUs / 1000; }
+  void setScene(uint8_t) override { busyUntilMs = simUs / 1000; }
+  uint32_t idleAtMs() override {
+    uint64_t now = simUs / 1000;
+    return (uint32_t)(busyUntilMs > now ? busyUntilMs : now);
+  }
+
+private:
+  void queue(uint8_t clips) {
+    uint64_t now = simUs / 1000;
+    if (busyUntilMs < now) busyUntilMs = now;
+    busyUntilMs += clips * (DEFAULT_SOUND_GAP + SIM_CLIP_MS);
+  }
+  uint64_t busyUntilMs = 0;
+};
+
+class SimLeds : public GameLeds {
+public:
+  void setMode(NeoMode) override { modeChanges++; }
+  void flash() override { flashes++; }
+  void freeze() override { freezes++; }
+  uint32_t modeChanges = 0;
+  uint32_t flashes = 0;
+  uint32_t freezes = 0;
+};
+
+class SimRadio : public GameRadio {
+public:
+  void broadcast(uint8_t cmd, uint16_t) override {
+    stats.sends++;
+    if (cmd == CMD_IDLE) newGame();
+  }
+
+  void sendWithRetry(uint8_t destId, uint8_t cmd, uint16_t) override {
+    stats.sends++;
+    if (replayMode) return;
+    if (destId == ID_DISPLAY && cmd == DISP_PLAYER_PROMPT) onPrompt();
+    if (destId == ID_DISPLAY && cmd == DISP_PROMPT_JOIN) onChangeover();
+  }
+
+  void sendGO(uint32_t) override;
+
+  bool timedCues(uint8_t stickId) override { return stickId != ID_STICK4; }  // one old stick
+  void displayBatchBegin() override {}
+  void displayBatchAdd(uint8_t, uint8_t, uint8_t) override { stats.displayItems++; }
+  void displayBatchAddTime(uint8_t, uint32_t) override { stats.displayItems++; }
+  void displayBatchFlush() override { stats.sends++; }
+  void resetLinks() override {}
+
+private:
+  void newGame() {
+    wantPlayers = tourEntrants ? SIM_STICKS : (uint8_t)rngRange(2, SIM_STICKS);
+    for (uint8_t s = 0; s < SIM_STICKS; s++) joinPending[s] = false;
+  }
+
+  // A slot is prompted: maybe one more stick presses, possibly too late for it
+  void onPrompt();
+
+  // Tournament changeover: most seated entrants press, some late, some never
+  void onChangeover();
+
+  uint8_t wantPlayers = 2;
+  bool joinPending[SIM_STICKS] = {};
+  friend void deliver(const SimEvent &ev);
+};
+
+SimClock simClock;
+SimRadio simRadio;
+SimLeds simLeds;
+SimAudio simAudio;
+GameCore game(simClock, simRadio, simLeds, simAudio);
+
+// =============================================================================
+// SCRIPTED STICKS
+// =============================================================================
+void SimRadio::onPrompt() {
+  uint8_t joined = 0;
+  for (uint8_t s = 0; s < SIM_STICKS; s++) {
+    if (joinPending[s] || game.playerForStick(ID_STICK1 + s) >= 0) joined++;
+  }
+  // Now and then a stick that already joined presses again
+  if (joined && rng() % 20 == 0) {
+    schedule(simUs + rngRange(50, 2000) * 1000ULL, EV_JOIN, ID_STICK1 + rng() % SIM_STICKS, 0);
+  }
+  if (joined >= wantPlayers) return;
+  uint8_t s = rng() % SIM_STICKS;
+  while (joinPending[s] || game.playerForStick(ID_STICK1 + s) >= 0) s = (s + 1) % SIM_STICKS;
+  joinPending[s] = true;
+  schedule(simUs + rngRange(200, PROMPT_DURATION + 1500) * 1000ULL, EV_JOIN, ID_STICK1 + s, 0);
+}
+
+void SimRadio::onChangeover() {
+  for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+    if (!game.players[i].joined || rng() % 10 == 0) continue;
+    schedule(simUs + rngRange(1000, TOUR_CHANGEOVER_MS + 3000) * 1000ULL, EV_JOIN, game.slotToStick[i], 0);
+  }
+}
+
+// One press per active stick, and its result's trip back (sometimes twice, out of order)
+void SimRadio::sendGO(uint32_t) {
+  stats.sends++;
+  roundYellow = false;
+  for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+    scriptedTicks[i] = RESULT_TICKS_NONE;
+    reportedPenalty[i] = false;
+    if (replayMode || !game.isActivePlayer(i)) continue;
+    uint8_t stickId = game.slotToStick[i];
+    uint32_t r = rng() % 100;
+    uint64_t atUs;
+    uint32_t ticks;
+    SimEventKind kind = game.gameMode == MODE_REACTION ? EV_REACTION : EV_SHAKE;
+    if (r < 10) continue;                               // never answers
+    if (kind == EV_REACTION && r < 18) {
+      atUs = simUs + rngRange(0, 40000);                // early press: penalty
+      ticks = RESULT_TICKS_NONE;
+    } else if (kind == EV_REACTION && r < 28) {
+      uint32_t ms = rngRange(TIMEOUT_REACTION, 2 * TIMEOUT_REACTION + 500);  // into the yellow warning
+      atUs = simUs + ms * 1000ULL;
+      ticks = ms * RESULT_TICKS_PER_MS;
+    } else {
+      uint32_t ms = kind == EV_REACTION ? rngRange(140, 900) : rngRange(2000, TIMEOUT_SHAKE - 2000);
+      ticks = ms * RESULT_TICKS_PER_MS + rng() % RESULT_TICKS_PER_MS;
+      atUs = simUs + ms * 1000ULL;
+      if (kind == EV_SHAKE) {
+        uint8_t target = game.shakeTargetCount;
+        for (uint8_t k = 1; k <= 3; k++) {
+          schedule(simUs + ms * 250ULL * k, EV_PROGRESS, stickId, (uint32_t)(target * k / 4) << 8 | target);
+        }
+      }
+    }
+    if (kind == EV_REACTION) scriptedTicks[i] = ticks;
+    atUs += rngRange(1000, 30000);                      // radio, retries
+    schedule(atUs, kind, stickId, ticks);
+    if (rng() % 10 == 0) schedule(atUs + rngRange(0, 50000), kind, stickId, ticks);  // repeat
+  }
+}
+
+// What handlePacket() does with each of these
+void deliver(const SimEvent &ev) {
+  if (ev.kind == EV_JOIN) {
+    simRadio.joinPending[ev.stickId - ID_STICK1] = false;
+    game.onJoinRequest(ev.stickId);
+    return;
+  }
+  int8_t slot = game.playerForStick(ev.stickId);
+  if (slot < 0) return;
+  if (ev.kind == EV_PROGRESS) {
+    game.onShakeProgress(slot, ev.value >> 8, ev.value & 0xFF);
+    return;
+  }
+  bool inYellow = game.inYellowWarning();
+  stats.results++;
+  if (!game.onResult(slot, ev.kind == EV_REACTION, ev.value)) {
+    stats.rejected++;
+    return;
+  }
+  if (ev.value == RESULT_TICKS_NONE) {
+    stats.penalties++;
+    reportedPenalty[slot] = true;
+  }
+  if (inYellow) stats.lateSaves++;
+}
+
+// =============================================================================
+// RULE CHECKS (on every state change)
+// =============================================================================
+void violation(const char *what, uint32_t seed) {
+  printf("VIOLATION in game %lu (seed %lu), round %d: %s\n",
+         (unsigned long)stats.games, (unsigned long)seed, game.currentRound, what);
+  stats.violations++;
+}
+
+void checkTransition(HostGameState from, HostGameState to, uint32_t seed) {
+  if (to == STATE_SHOW_RESULTS) {
+    stats.rounds++;
+    if (from != STATE_SHAKE && from != STATE_COLLECT) violation("results without a round", seed);
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      if (game.isActivePlayer(i) && !game.players[i].finished) violation("results with a player unfinished", seed);
+    }
+    // An early end (CollectPolicy.h) may only drop presses that would have lost
+    const uint8_t w = game.findRoundWinner();
+    for (uint8_t i = 0; from == STATE_COLLECT && w != 0xFF && i < MAX_PLAYERS; i++) {
+      if (game.isActivePlayer(i) && game.players[i].resultTicks == RESULT_TICKS_NONE &&
+          scriptedTicks[i] < game.players[w].resultTicks) {
+        violation("round ended before a winning press arrived", seed);
+      }
+    }
+    // ...and those it dropped are no penalty: only an early press or a
+    // warning run out puts one in the stats (main.cpp recordRound())
+    for (uint8_t i = 0; from == STATE_COLLECT && i < MAX_PLAYERS; i++) {
+      if (!game.isActivePlayer(i)) continue;
+      if (game.players[i].cutOff) stats.cutOffs++;
+      if (game.recordsResult(i) && game.players[i].resultTicks == RESULT_TICKS_NONE &&
+          !reportedPenalty[i] && !roundYellow) {
+        violation("penalty recorded for a player the decided round cut off", seed);
+      }
+    }
+  }
+  if (to == STATE_FINAL_WINNER) {
+    if (game.inDeuce) {
+      int diff = abs((int)game.players[game.deucePlayer[0]].score - (int)game.players[game.deucePlayer[1]].score);
+      if (diff < DEUCE_LEAD) violation("deuce ended without the lead", seed);
+    } else if (game.currentRound < game.gameRounds()) {
+      violation("final winner before the last round", seed);
+    }
+    if (game.tour.active()) {
+      stats.matches++;
+      if (game.inDeuce) violation("deuce in a tournament match", seed);
+      if (game.tour.finished() && game.tour.champion() == TOUR_NONE) violation("tournament without a champion", seed);
+    }
+    uint8_t w = game.findFinalWinner();
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+      total += game.players[i].score;
+      if (w != 0xFF && game.players[i].score > game.players[w].score) violation("winner isn't top score", seed);
+    }
+    if (total > game.currentRound) violation("more points than rounds", seed);
+  }
+  if (from == STATE_SHOW_RESULTS && to == STATE_COUNTDOWN && game.inDeuce && game.currentRound == game.gameRounds()) {
+    stats.deuces++;
+  }
+  if (from == STATE_SHOW_RESULTS && to == STATE_IDLE) {
+    stats.timeoutResets++;
+    if (tourEntrants) violation("tournament reset by timeouts", seed);
+  }
+  if (from == STATE_FINAL_WINNER && to == STATE_JOIN && !game.tour.active()) violation("match after the tournament", seed);
+  if (to == STATE_REACTION && game.joinedCount < 2) violation("round with fewer than 2 players", seed);
+}
+
+// =============================================================================
+// DRIVER
+// =============================================================================
+// One job pass at the current virtual time, as the scheduler runs them
+void runFrame() {
+  for (uint8_t i = 0; i < SIM_EVENTS; i++) {
+    if (events[i].kind != EV_NONE && events[i].atUs <= simUs) {
+      SimEvent ev = events[i];
+      events[i].kind = EV_NONE;
+      deliver(ev);
+    }
+  }
+  game.runCues((uint32_t)simUs);
+  game.step();
+  if (game.inYellowWarning()) roundYellow = true;
+}
+
+// From IDLE through FINAL_WINNER (or an all-timeout reset) back to IDLE
+void runGame(uint32_t seed, uint32_t stepUs) {
+  rngState = seed ? seed : 1;
+  uint64_t startUs = simUs;
+  uint64_t changeoverStartUs = 0;
+  uint64_t collectStartUs = 0;
+  HostGameState last = game.state;
+  bool leftIdle = false;
+  if (tourEntrants && !game.startTournament(tourEntrants, nullptr)) violation("tournament didn't start", seed);
+  for (;;) {
+    runFrame();
+    if (game.state != last) {
+      checkTransition(last, game.state, seed);
+      if (last == STATE_REACTION && game.state == STATE_COLLECT) collectStartUs = simUs;
+      if (last == STATE_COLLECT && game.state == STATE_SHOW_RESULTS) {
+        stats.collectUs += simUs - collectStartUs;
+        stats.collects++;
+      }
+      if (last == STATE_FINAL_WINNER && game.state == STATE_JOIN) {
+        startUs = simUs;                // the time limit is per match
+        changeoverStartUs = simUs;
+      }
+      if (last == STATE_JOIN && game.state == STATE_COUNTDOWN && changeoverStartUs) {
+        stats.changeoverUs += simUs - changeoverStartUs;
+        stats.changeovers++;
+        changeoverStartUs = 0;
+      }
+      if (game.state == STATE_IDLE && leftIdle) return;
+      if (game.state != STATE_IDLE) leftIdle = true;
+      last = game.state;
+    }
+    if (simUs - startUs > SIM_GAME_LIMIT_MS * 1000ULL) {
+      violation("game never ended", seed);
+      return;
+    }
+    simUs += stepUs;
+  }
+}
+
+// =============================================================================
+// TRACE REPLAY (a PacketTrace file pulled off the host, TraceFile.h)
+// =============================================================================
+PacketTrace packetTrace;
+
+// handlePacket() for the stick commands GameCore takes
+void replayCommand(uint8_t src, uint8_t cmd, uint16_t val, uint32_t ticks) {
+  if (!isStickId(src)) return;
+  if (cmd == CMD_REQ_ID) {
+    game.onJoinRequest(src);
+    return;
+  }
+  SimEvent ev = {simUs, EV_NONE, src, ticks};
+  if (cmd == CMD_SHAKE_PROGRESS) {
+    ev.kind = EV_PROGRESS;
+    ev.value = val;                     // count << 8 | target, as the packet has it
+  } else if (cmd == CMD_REACTION_DONE) {
+    ev.kind = EV_REACTION;
+  } else if (cmd == CMD_SHAKE_DONE) {
+    ev.kind = EV_SHAKE;
+  } else {
+    return;                             // sync, OTA, ACKs and reports have no part here
+  }
+  deliver(ev);
+}
+
+// receiveFrame(): the replay entry point, frames unpacked as the host does
+void replayFrame(const uint8_t*, const uint8_t *data, int len, uint32_t) {
+  packetTrace.onHandled((uint32_t)simUs, 0, 0);
+  if (isBatchFrame(data, len)) {
+    if (!validateBatch(data, len)) return;
+    const BatchHeader *h = (const BatchHeader*)data;
+    BatchReader reader(data);
+    BatchItem item;
+    while (reader.next(&item)) replayCommand(h->src_id, item.cmd, item.data(), resultTicks(item));
+    return;
+  }
+  GamePacket pkt;
+  if (len == (int)RELIABLE_PACKET_SIZE) {
+    ReliablePacket rp;
+    memcpy(&rp, data, sizeof(rp));
+    if (!validateReliablePacket(&rp)) return;
+    pkt = rp.base;
+  } else if (len == (int)sizeof(GamePacket)) {
+    memcpy(&pkt, data, sizeof(pkt));
+    if (!validatePacket(&pkt)) return;
+  } else {
+    return;
+  }
+  replayCommand(pkt.src_id, pkt.cmd, packetData(&pkt), resultTicksFromMs(packetData(&pkt)));
+}
+
+// The trace at speed x from a fresh IDLE, as `trace play` runs it, with the
+// same rule checks; state changes print in the host's [TRACE] form
+int replayTrace(const char *path, uint16_t speed, uint32_t stepUs) {
+  TraceFileHeader fh = {};
+  uint8_t *dst = packetTrace.loadBuffer();
+  FILE *f = fopen(path, "rb");
+  bool ok = f && fread(&fh, sizeof(fh), 1, f) == 1 && fh.bytes <= TRACE_BUF_BYTES &&
+            fread(dst, 1, fh.bytes, f) == fh.bytes;
+  if (f) fclose(f);
+  if (!ok) fh.magic = 0;
+  if (!packetTrace.adopt(fh)) {
+    printf("%s: not a trace, or a damaged one\n", path);
+    return 2;
+  }
+
+  replayMode = true;
+  const uint64_t startUs = simUs;
+  HostGameState last = game.state;
+  packetTrace.startReplay(speed, replayFrame, (uint32_t)simUs, 0);
+  while (packetTrace.replaying()) {
+    packetTrace.run((uint32_t)simUs, 0);
+    runFrame();
+    if (game.state != last) {
+      printf("+%lu ms: state %d -> %d\n", (unsigned long)((simUs - startUs) / 1000), last, game.state);
+      checkTransition(last, game.state, 0);
+      last = game.state;
+    }
+    simUs += stepUs;
+  }
+
+  printf("%lu frames at %ux in %.1f s of game time: %lu rounds, results %lu (rejected %lu, penalties %lu)\n",
+         (unsigned long)packetTrace.frameCount(), speed, (simUs - startUs) / 1e6, (unsigned long)stats.rounds,
+         (unsigned long)stats.results, (unsigned long)stats.rejected, (unsigned long)stats.penalties);
+  if (stats.violations) {
+    printf("%lu rule violation(s)\n", (unsigned long)stats.violations);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2 && strcmp(argv[1], "replay") == 0) {
+    int speed = argc > 3 ? atoi(argv[3]) : 1;
+    uint32_t stepMs = argc > 4 ? (uint32_t)strtoul(argv[4], nullptr, 0) : 1;
+    return replayTrace(argv[2], speed > 0 ? speed : 1, (stepMs ? stepMs : 1) * 1000);
+  }
+  uint32_t games = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 0) : 1000;
+  uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 1;
+  uint32_t stepMs = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 0) : 1;
+  if (!stepMs) stepMs = 1;
+  uint32_t entrants = argc > 4 ? (uint32_t)strtoul(argv[4], nullptr, 0) : 0;
+  if (entrants && (entrants < 2 || entrants > TOUR_MAX_ENTRANTS)) {
+    printf("entrants: 2 to %d\n", TOUR_MAX_ENTRANTS);
+    return 2;
+  }
+  tourEntrants = (uint8_t)entrants;
+
+  auto wallStart = std::chrono::steady_clock::now();
+  uint64_t simStartUs = simUs;
+  for (uint32_t g = 0; g < games; g++) {
+    stats.games++;
+    runGame(seed * 2654435761UL + g, stepMs * 1000);
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double simS = (simUs - simStartUs) / 1e6;
+
+  printf("%lu games, %lu rounds, %.0f s of game time in %.3f s (%.0f rounds/s, %.0fx real time)\n",
+         (unsigned long)stats.games, (unsigned long)stats.rounds, simS, wallS,
+         wallS > 0 ? stats.rounds / wallS : 0.0, wallS > 0 ? simS / wallS : 0.0);
+  printf("results %lu (rejected %lu, penalties %lu, saved in yellow %lu, cut off %lu), deuces %lu, timeout resets %lu\n",
+         (unsigned long)stats.results, (unsigned long)stats.rejected, (unsigned long)stats.penalties,
+         (unsigned long)stats.lateSaves, (unsigned long)stats.cutOffs, (unsigned long)stats.deuces, (unsigned long)stats.timeoutResets);
+  printf("collect policy %s: %.2f s from GO to results on average\n", COLLECT_POLICY_NAMES[game.collectPolicy],
+         stats.collects ? stats.collectUs / 1e6 / stats.collects : 0.0);
+  printf("sends %lu, display items %lu, LED modes %lu, flashes %lu, freezes %lu\n",
+         (unsigned long)stats.sends, (unsigned long)stats.displayItems, (unsigned long)simLeds.modeChanges,
+         (unsigned long)simLeds.flashes, (unsigned long)simLeds.freezes);
+  if (tourEntrants) {
+    printf("%lu matches of %d entrants, %.1f matches/hour, changeover %.1f s on average\n",
+           (unsigned long)stats.matches, tourEntrants, simS > 0 ? stats.matches * 3600.0 / simS : 0.0,
+           stats.changeovers ? stats.changeoverUs / 1e6 / stats.changeovers : 0.0);
+  }
+  if (stats.violations) {
+    printf("%lu rule violation(s)\n", (unsigned long)stats.violations);
+    return 1;
+  }
+  return 0;
+}
@@ -16,10 +16,20 @@
  *   Joysticks <-> Host : ESP-NOW (wireless)
  *   Host     -> Display: ESP-NOW (wireless)
  *
- * Game flow (5 rounds):
+ * Game flow (5 rounds, GameCore.h - this file runs it on the hardware):
  *   IDLE -> JOIN -> COUNTDOWN -> REACTION/SHAKE -> COLLECT -> SHOW_RESULTS -> loop
  *   After 5 rounds: FINAL_WINNER -> IDLE
  *
+ * Tasks (core, priority):
+ *   game    1  GAME_TASK_PRIORITY    loop() itself: RX drain, state machine, cues, ACK retries;
+ *                                    sleeps until a job is due or a frame arrives
+ *   render  0  RENDER_TASK_PRIORITY  rings and strip, from RingScene messages (RENDER_USE_TASK)
+ *   audio   0  AUDIO_TASK_PRIORITY   MP3 decode, PCM ring into I2S DMA (AudioManager.h)
+ *   log     0  LOG_TASK_PRIORITY     LOGx() ring to the UART (Log.h)
+ *   WiFi and the ESP-NOW callbacks run on core 0 above all of them.
+ * Nothing is shared between them but lock-free queues (SpscQueue.h);
+ * `cpu` on the serial console reports each one's load (TaskLoad.h).
+ *
  * NeoPixel ring layout (left-to-right): [P1][P2][Center][P3][P4]
  *   Player 1 = Ring 4
  *   Player 2 = Ring 3
@@ -36,7 +46,45 @@
 #include <NeoPixelBrightnessBus.h>
 #include "Protocol.h"
 #include "GameTypes.h"
+#include "Log.h"
 #include "AudioManager.h"
+#include "SpscQueue.h"
+#include "ReliableLink.h"
+#include "LedEffects.h"
+#include "RingCompositor.h"
+#include "StripEngine.h"
+#include "Scheduler.h"
+#include "GameCore.h"
+#include "LatencyTrace.h"
+#include "PacketTrace.h"
+#include "TraceFile.h"
+#include "PeerTable.h"
+#include "ArenaLink.h"
+#include "ChannelScan.h"
+#include "StatsStore.h"
+#include "HeapWatch.h"
+#include "TaskLoad.h"
+#include "BootProfile.h"
+#include "OtaServer.h"
+#include "FlightRecorder.h"
+
+// =============================================================================
+// ARENA (ArenaLink.h, ARENAS in Protocol.h)
+// Every device of a table is built with the same -DARENA_ID; exactly one
+// arena 0 host may add -DARENA_COORDINATOR=1 to collect everyone's standings.
+// =============================================================================
+#ifndef ARENA_ID
+#define ARENA_ID 0
+#endif
+#ifndef ARENA_COORDINATOR
+#define ARENA_COORDINATOR 0
+#endif
+static_assert(ARENA_ID < MAX_ARENAS, "ARENA_ID out of range");
+static_assert(!ARENA_COORDINATOR || ARENA_ID == 0, "the coordinator runs arena 0");
+
+// A table on its own picks its channel (CHANNEL SELECTION in Protocol.h);
+// arena hosts keep the coordinator's plan and the coordinator the control channel
+#define CHANNEL_AUTO (ARENA_ID == 0 && !ARENA_COORDINATOR)
 
 // =============================================================================
 // PIN DEFINITIONS
@@ -46,641 +94,410 @@
 #define STRIP_LED_COUNT   89
 #define STRIP_BRIGHTNESS  80
 
+// =============================================================================
+// TASKS (see the map at the top)
+// =============================================================================
+#ifndef RENDER_USE_TASK
+#define RENDER_USE_TASK       1     // 0: rings and strip are scheduler jobs in loop()
+#endif
+// loop() sleeps between frames until a job or cue is due or a frame arrives
+// (queueRx() notifies it), so core 1 stays free below this priority too
+#define GAME_TASK_PRIORITY    10    // raised from Arduino's 1: nothing unpinned preempts the game
+#define GAME_TICK_US          (portTICK_PERIOD_MS * 1000UL)  // the sleep's resolution
+#define RENDER_TASK_STACK     4096
+#define RENDER_TASK_PRIORITY  6     // above audio (its PCM ring rides out a frame), below WiFi
+#define RENDER_TASK_CORE      0
+#define RING_SCENE_QUEUE      8     // game -> renderer (power of 2)
+
 // =============================================================================
 // ESP-NOW MAC ADDRESSES
+// Joysticks register at runtime (PeerTable.h, ID ASSIGNMENT in Protocol.h)
 // =============================================================================
 uint8_t displayMac[6]  = {0xD0, 0xCF, 0x13, 0x01, 0xD1, 0xA4};
-uint8_t stick1Mac[6]   = {0xBC, 0xFF, 0x4D, 0xF9, 0xF3, 0x91};
-uint8_t stick2Mac[6]   = {0xBC, 0xFF, 0x4D, 0xF9, 0xAE, 0x29};
-uint8_t stick3Mac[6]   = {0xBC, 0xFF, 0x4D, 0xF9, 0xAC, 0x42};
-uint8_t stick4Mac[6]   = {0xBC, 0xFF, 0x4D, 0xF9, 0xBE, 0x62};
 uint8_t broadcastMac[6]= {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
+PeerTable stickPeers;
+
 // =============================================================================
 // HARDWARE
 // =============================================================================
 // Both use ESP32 RMT with DMA — Show() is non-blocking (no interrupt disable)
 NeoPixelBrightnessBus<NeoGrbFeature, NeoEsp32Rmt0800KbpsMethod> pixels(NEOPIXEL_COUNT, PIN_NEOPIXEL);
 NeoPixelBrightnessBus<NeoGrbFeature, NeoEsp32Rmt1800KbpsMethod> strip(STRIP_LED_COUNT, PIN_STRIP);
+LedCanvas<decltype(pixels), NEOPIXEL_COUNT> ringFx(pixels);   // LUT effects (LedEffects.h)
+RingCompositor<decltype(pixels), NUM_RINGS, LEDS_PER_RING> rings(pixels, ringFx);  // ring layers (RingCompositor.h)
+LedCanvas<decltype(strip), STRIP_LED_COUNT> stripFx(strip);
 AudioManager audio;
+AsyncLog asyncLog;  // LOGx() sink - drained by a low-priority task (Log.h)
+ReliableLink ackLink; // per-peer sliding-window ACK/retry (ReliableLink.h)
+Scheduler scheduler; // loop() jobs, periods and budgets (Scheduler.h)
+int8_t ringJob = -1;
+LatencyTrace latency; // GO round-trip histograms, MAC send counts (LatencyTrace.h)
+PacketTrace packetTrace; // record/replay of received frames (PacketTrace.h)
+ArenaLink arena;      // arena registration and standings (ArenaLink.h)
+ChannelScan channelScan; // boot-time channel scores (ChannelScan.h)
+bool channelScanPending = false;  // cold boot: scanJob() still to scan
+bool channelScanRunning = false;  // radio away scanning, no beacons or OTA
+StatsStore stats;     // all-time results and leaderboard in NVS (StatsStore.h)
+HeapWatch heapWatch;  // free heap, fragmentation, loop() allocations (HeapWatch.h)
+TaskLoad taskLoad;    // per-task CPU use (TaskLoad.h)
+BootProfile bootProfile;  // setup() stage times, warm or cold boot (BootProfile.h)
+OtaServer ota;        // firmware update packages for sticks and display (OtaServer.h)
+FlightRecorder flightRecorder;  // last events before a reset, in RTC memory (FlightRecorder.h)
 
 // =============================================================================
-// GAME STATE
+// NEOPIXEL STATE (what to show comes from GameCore, as RingScene messages)
 // =============================================================================
-enum HostGameState : uint8_t {
-  STATE_IDLE,
-  STATE_JOIN,
-  STATE_COUNTDOWN,
-  STATE_REACTION,       // waiting for random delay, then fires GO
-  STATE_SHAKE,          // GO already fired, waiting for shake results
-  STATE_COLLECT,        // polling joysticks for results
-  STATE_SHOW_RESULTS,
-  STATE_FINAL_WINNER
-};
-
-HostGameState gameState = STATE_IDLE;
-unsigned long stateStartTime = 0;
-
-// Players
-Player players[MAX_PLAYERS];
-uint8_t joinedCount = 0;
-uint8_t currentRound = 0;
-
-// Deuce mode
-bool inDeuce = false;
-uint8_t deucePlayer[2] = {0xFF, 0xFF};  // indices (0-3) of the two tied players
-
-// Join phase: slot-to-joystick mapping (which joystick claimed which player slot)
-// slotToStick[slot] = joystick ID (ID_STICK1-4), or 0xFF if unclaimed
-uint8_t slotToStick[MAX_PLAYERS] = {0xFF, 0xFF, 0xFF, 0xFF};
-uint8_t stickClaimed[MAX_PLAYERS] = {0, 0, 0, 0};  // which joysticks have already claimed a slot
-uint8_t currentPromptSlot = 0;      // which player slot we're currently prompting (0-3)
-unsigned long promptStartTime = 0;  // when current prompt started
-bool joinComplete = false;          // true = enough players, waiting 1s before countdown
-unsigned long joinCompleteTime = 0; // when join completed (for 1s color-display delay)
-
-// Consecutive all-timeout tracking
-uint8_t consecutiveTimeouts = 0;    // how many rounds in a row all players timed out
-
-// Round config
-uint8_t gameMode = MODE_REACTION;   // current round mode
-uint8_t delayIdx = 0;               // index into REACT_DELAYS
-uint8_t targetIdx = 0;              // index into SHAKE_TARGETS
-uint8_t lastDelayIdx  = 0xFF;       // prevent repeat
-uint8_t lastTargetIdx = 0xFF;
-
-// Mode shuffle bag: ensures both modes are played before repeating
-uint8_t modeBag[2] = {MODE_REACTION, MODE_SHAKE};
-uint8_t modeBagIdx = 0;  // alternates: 0=REACTION, 1=SHAKE, 2=REACTION, ...
-
-// First-time instruction tracking (only show instructions first time each mode is played)
-bool reactionInstructPlayed = false;
-bool shakeInstructPlayed = false;
-
-// Reaction announcement tracking
-bool reactionAnnouncementDone = false;  // wait for voice before random delay
-bool reactionFirstInstruct = false;     // true when instructions were queued this round
-
-// Shake countdown tracking
-unsigned long shakeStartTime = 0;   // for center ring countdown
-uint8_t shakeProgress[MAX_PLAYERS] = {0,0,0,0};      // current shake count per player (from CMD_SHAKE_PROGRESS)
-uint8_t shakeProgressTarget[MAX_PLAYERS] = {0,0,0,0}; // per-player shake target (from CMD_SHAKE_PROGRESS)
-uint8_t shakeTargetCount = 0;       // current round's displayed shake target (10/15/20)
-
-// Countdown
-uint8_t countdownNum = 3;
-unsigned long countdownFlashStart = 0;  // for sync flash on countdown
-#define COUNTDOWN_FLASH_DURATION 200    // ms - matches slave vibration duration
-bool shakeAnnouncementDone = false;     // tracks if shake announcement phase is complete
-bool shakeFirstInstruct = false;       // true when shake instructions were queued this round
-// Shake announcement delays (based on audio file lengths + 250ms gaps)
-// Subsequent: get_ready(0.99s) + gap + shake(0.82s) + gap + target(≤1.27s) = ~3.6s
-#define SHAKE_ANNOUNCE_DELAY        4000    // ms - subsequent rounds
-// First time: + will_shake(4.30s) + gap = ~8.1s
-#define SHAKE_ANNOUNCE_DELAY_FIRST  8500    // ms - first round with instructions
-
-// Collect phase
-uint8_t collectPlayer = 0;          // which player we're waiting on next
-unsigned long collectTimeout = 0;
-bool collectYellowPhase = false;     // yellow warning before disqualification
-unsigned long collectYellowStart = 0;
-
-// =============================================================================
-// NEOPIXEL STATE (uses NeoMode from GameTypes.h)
-// =============================================================================
-// Mapping: NEO_IDLE_RAINBOW, NEO_RANDOM_FAST, NEO_FIXED_COLOR, NEO_COUNTDOWN, NEO_STATUS, NEO_BLINK_SLOT
-NeoMode neoState = NEO_IDLE_RAINBOW;
 uint32_t neoOffset = 0;
-unsigned long neoLastUpdate = 0;
+// Ring redraw period per NeoMode (ms) - the renderer runs updateNeoPixels() at this rate
+static const uint16_t NEO_PERIOD_MS[] = {
+  50,   // NEO_OFF
+  50,   // NEO_IDLE_RAINBOW
+  50,   // NEO_STATUS
+  30,   // NEO_RANDOM_FAST
+  50,   // NEO_FIXED_COLOR
+  250,  // NEO_COUNTDOWN
+  300,  // NEO_BLINK_SLOT
+  30,   // NEO_SHAKE_COUNTDOWN
+};
+static_assert(sizeof(NEO_PERIOD_MS) / sizeof(NEO_PERIOD_MS[0]) == NEO_SHAKE_COUNTDOWN + 1, "one period per NeoMode");
+#define NEO_FLASH_PERIOD_MS 10  // while the countdown flash is up (so it ends on time) or a frame waits for the RMT
 bool neoBlink = false;
-uint8_t blinkSlot = 0;  // which player slot to blink (0-3) for NEO_BLINK_SLOT mode
-// Per-ring color overrides (black = use default animation). Set during COLLECT/RESULTS.
-RgbColor ringOverride[5];  // default-constructs to black (0,0,0)
-bool ringBlink[5] = {false,false,false,false,false};  // true = blink this ring on/off
-static const RgbColor RGB_OFF(0);
-static const RgbColor RGB_RED(255, 0, 0);
-static const RgbColor RGB_GREEN(0, 255, 0);
-static const RgbColor RGB_BLUE(0, 0, 255);
-static const RgbColor RGB_YELLOW(255, 255, 0);
-static const RgbColor RGB_WHITE(255, 255, 255);
-
-// Joystick identity colors (by joystick ID: 1=White, 2=Blue, 3=Red, 4=Yellow)
-RgbColor stickColor(uint8_t stickId) {
-  switch (stickId) {
-    case ID_STICK1: return RGB_WHITE;
-    case ID_STICK2: return RGB_BLUE;
-    case ID_STICK3: return RGB_RED;
-    case ID_STICK4: return RGB_YELLOW;
-    default:        return RGB_GREEN;
-  }
+#define COUNTDOWN_FLASH_DURATION 200    // ms - matches slave vibration duration
+static constexpr LedRgb LED_OFF = {0, 0, 0};
+static constexpr LedRgb LED_RED = {255, 0, 0};
+static constexpr LedRgb LED_GREEN = {0, 255, 0};
+static constexpr LedRgb LED_YELLOW = {255, 255, 0};
+static constexpr LedRgb LED_WHITE = {255, 255, 255};
+
+// GameCore colors are 0xRRGGBB
+LedRgb ledRgb(uint32_t c) {
+  return LedRgb{(uint8_t)((c >> 16) & 0xFF), (uint8_t)((c >> 8) & 0xFF), (uint8_t)(c & 0xFF)};
 }
 
 // =============================================================================
-// HELPERS (playerToRing is in GameTypes.h)
+// GAME CORE (GameCore.h) - the adapters below run it on this hardware
 // =============================================================================
-uint8_t getRandomIndex(uint8_t *last, uint8_t max) {
-  uint8_t idx;
-  do { idx = random(max); } while (idx == *last && max > 1);
-  *last = idx;
-  return idx;
-}
+class HostClock : public GameClock {
+public:
+  uint32_t nowMs() override { return millis(); }
+  uint32_t nowUs() override { return micros(); }
+  uint32_t random(uint32_t max) override { return ::random(max); }
+};
 
-// Alternating game modes: REACTION, SHAKE, REACTION, SHAKE, ...
-uint8_t getNextGameMode() {
-  uint8_t mode = modeBag[modeBagIdx % 2];
-  Serial.printf("[MODE] Round mode: %s\n", mode == MODE_REACTION ? "REACT" : "SHAKE");
-  modeBagIdx++;
-  return mode;
-}
+class HostRadio : public GameRadio {
+public:
+  void broadcast(uint8_t cmd, uint16_t data) override;
+  void sendWithRetry(uint8_t destId, uint8_t cmd, uint16_t data) override;
+  void sendGO(uint32_t goUs) override;
+  bool timedCues(uint8_t stickId) override;
+  void displayBatchBegin() override;
+  void displayBatchAdd(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) override;
+  void displayBatchAddTime(uint8_t cmd, uint32_t ticks) override;
+  void displayBatchFlush() override;
+  void resetLinks() override;
+};
 
-// Is this player active in the current round? (filters for deuce)
-bool isActivePlayer(uint8_t i) {
-  if (!players[i].joined || slotToStick[i] == 0xFF) return false;
-  if (inDeuce) return (i == deucePlayer[0] || i == deucePlayer[1]);
-  return true;
-}
+class HostLeds : public GameLeds {
+public:
+  void setMode(NeoMode mode) override;
+  void flash() override;
+  void freeze() override;
+};
 
-// Check if exactly 2 players share the highest score (deuce condition)
-bool checkDeuce() {
-  uint8_t maxScore = 0;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (players[i].joined && players[i].score > maxScore)
-      maxScore = players[i].score;
-  }
-  uint8_t count = 0;
-  uint8_t tied[2] = {0xFF, 0xFF};
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (players[i].joined && players[i].score == maxScore) {
-      if (count < 2) tied[count] = i;
-      count++;
-    }
-  }
-  if (count == 2) {
-    deucePlayer[0] = tied[0];
-    deucePlayer[1] = tied[1];
-    return true;
-  }
-  return false;
-}
+class HostAudio : public GameAudio {
+public:
+  void queueSound(const char* snd, AudioPriority pri) override { audio.queueSound(snd, pri); }
+  void queueSoundAt(const char* snd, uint32_t atUs) override { audio.queueSoundAt(snd, atUs); }
+  void playPlayerNumber(uint8_t player) override { audio.playPlayerNumber(player); }
+  void playPlayerWins(uint8_t player) override { audio.playPlayerWins(player); }
+  void playShakeTarget(uint8_t target) override { audio.playShakeTarget(target); }
+  void prefetch(const char* snd) override { audio.prefetch(snd); }
+  void stop() override { audio.stop(); }
+  void setScene(uint8_t scene) override { audio.setScene(scene); }
+  uint32_t idleAtMs() override { return audio.idleAtMs(); }
+};
 
-// Forward declaration for ACK tracking (full implementation below ESP-NOW send section)
-#define ACK_MAX_RETRIES    3
-#define ACK_RETRY_INTERVAL 50   // ms
-#define ACK_SLOT_COUNT     5    // 4 joysticks + 1 display
+HostClock hostClock;
+HostRadio hostRadio;
+HostLeds hostLeds;
+HostAudio hostAudio;
+GameCore game(hostClock, hostRadio, hostLeds, hostAudio);
 
-struct PendingAck {
-  bool waiting;
-  uint8_t dest;
-  uint8_t cmd;
-  uint16_t data;
-  uint8_t mac[6];
-  uint8_t retries;
-  unsigned long lastSend;
+// =============================================================================
+// CLOCK SYNC + STICK FIRMWARE
+// =============================================================================
+// Clock sync: sticks ping us (CMD_SYNC_REQ), we answer from the receive callback.
+// Each ping also carries the stick's own offset/RTT estimate for diagnostics,
+// queued to loop() like any other command (SYNC REPORT in the RX queue).
+#define SYNC_STALE_MS 5000      // stick hasn't pinged for this long = not synced
+
+struct StickSync {
+  int32_t offsetUs;             // stick's estimate of (host - stick) clock offset
+  uint16_t rttUs;               // stick's best RTT (0xFFFF = no estimate yet)
+  int32_t lastOffsetUs;         // previous report, for drift between reports
+  unsigned long lastReport;     // millis() of last ping
+  unsigned long prevReport;
 };
 
-PendingAck pendingAcks[ACK_SLOT_COUNT];
+StickSync stickSync[MAX_STICKS];  // by stickIndex()
+FwVersion stickFw[MAX_STICKS];    // per physical stick, from CMD_HELLO/CMD_REQ_ID (0.0.0 = not heard)
+uint32_t stickPower[MAX_STICKS][POWER_FIELD_COUNT];  // last STICK POWER report, by stickIndex()
+bool stickPowerValid[MAX_STICKS];
 
-void resetPlayers() {
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    players[i].joined = false;
-    players[i].finished = false;
-    players[i].reactionTime = 0xFFFF;
-    players[i].score = 0;
-    slotToStick[i] = 0xFF;
-    stickClaimed[i] = 0;
-  }
-  joinedCount = 0;
-  currentPromptSlot = 0;
-  consecutiveTimeouts = 0;
-  modeBagIdx = 0;  // reset to start with REACTION
-  reactionInstructPlayed = false;  // reset instruction flag for new game
-  shakeInstructPlayed = false;
-  inDeuce = false;
-  deucePlayer[0] = 0xFF;
-  deucePlayer[1] = 0xFF;
-  for (int i = 0; i < 5; i++) { ringOverride[i] = RGB_OFF; ringBlink[i] = false; }
-  for (int i = 0; i < ACK_SLOT_COUNT; i++) pendingAcks[i].waiting = false;
-}
+// =============================================================================
+// RING SCENE (game task -> renderer)
+// What the rings should show, copied out of GameCore by the game task, so
+// the renderer never reads game state while it changes. Events travel as
+// sequence numbers: a scene the renderer skips loses none of them.
+// =============================================================================
+struct RingScene {
+  NeoMode mode;
+  uint8_t modeSeq;                    // bumped by setMode(): restart the animation
+  uint8_t freezeSeq;                  // bumped at GO: show the frozen rings now
+  uint8_t blinkSlot;                  // GameCore::blinkSlot
+  uint8_t joined;                     // bit per player slot
+  uint8_t active;                     // bit per player slot, GameCore::isActivePlayer()
+  uint32_t flashUntilMs;              // countdown flash, 0 = none yet
+  uint32_t shakeStartMs;
+  uint32_t override[NUM_RINGS];       // GameCore::ringOverride
+  bool blink[NUM_RINGS];              // GameCore::ringBlink
+  ShakeTrack shake;                   // copied whole: level() interpolates on the renderer's clock
+};
 
-void resetRound() {
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    players[i].finished = false;
-    players[i].reactionTime = 0xFFFF;
-    shakeProgress[i] = 0;
-    shakeProgressTarget[i] = 0;
+RingScene ringScene;                  // game task: being built
+RingScene ringSent;                   // game task: last one queued
+RingScene view;                       // renderer: what the rings show
+SpscQueue<RingScene, RING_SCENE_QUEUE> ringScenes;
+uint32_t ringSceneDrops = 0;
+TaskHandle_t renderTask = nullptr;
+TaskMeter renderMeter;
+TaskHandle_t gameTask = nullptr;      // loop(), woken by queueRx()
+
+// Game task: copy the ring view out of GameCore and queue it if it changed
+void publishRingScene() {
+  RingScene &s = ringScene;
+  s.mode = game.neoMode;
+  s.blinkSlot = game.blinkSlot;
+  s.shakeStartMs = game.shakeStartMs;
+  s.joined = 0;
+  s.active = 0;
+  for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+    if (game.players[i].joined) s.joined |= 1 << i;
+    if (game.isActivePlayer(i)) s.active |= 1 << i;
   }
-  for (int i = 0; i < 5; i++) { ringOverride[i] = RGB_OFF; ringBlink[i] = false; }
-}
-
-uint8_t findRoundWinner() {
-  uint8_t winner = 0xFF;
-  uint16_t best = 0xFFFF;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (isActivePlayer(i) && players[i].finished && players[i].reactionTime < best) {
-      best = players[i].reactionTime;
-      winner = i;
-    }
+  for (uint8_t r = 0; r < NUM_RINGS; r++) {
+    s.override[r] = game.ringOverride[r];
+    s.blink[r] = game.ringBlink[r];
   }
-  return winner;
-}
-
-uint8_t findFinalWinner() {
-  uint8_t winner = 0xFF;
-  uint8_t best = 0;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (players[i].joined && players[i].score > best) {
-      best = players[i].score;
-      winner = i;
-    }
+  s.shake = game.shakeTrack;
+  if (memcmp(&s, &ringSent, sizeof(s)) == 0) return;
+  if (!ringScenes.push(s)) {   // renderer behind: the next pass offers it again
+    ringSceneDrops++;
+    return;
   }
-  return winner;
+  ringSent = s;
+#if RENDER_USE_TASK
+  if (renderTask) xTaskNotifyGive(renderTask);
+#else
+  scheduler.kick(ringJob);
+#endif
 }
 
 // =============================================================================
-// NEOPIXEL FUNCTIONS (NeoPixelBus — non-blocking RMT DMA)
+// NEOPIXEL FUNCTIONS (NeoPixelBus — non-blocking RMT DMA, frames via RingCompositor.h)
+// Renderer side: everything here reads `view`, never GameCore.
 // =============================================================================
-void setRingColor(uint8_t ring, RgbColor color) {
-  uint8_t start = ring * LEDS_PER_RING;
-  for (uint8_t i = 0; i < LEDS_PER_RING; i++)
-    pixels.SetPixelColor(start + i, color);
-}
-
-RgbColor wheel(uint8_t pos) {
-  pos = 255 - pos;
-  if (pos < 85)  return RgbColor(255 - pos*3, 0, pos*3);
-  if (pos < 170) { pos -= 85; return RgbColor(0, pos*3, 255 - pos*3); }
-  pos -= 170;
-  return RgbColor(pos*3, 255 - pos*3, 0);
+bool ringsPending = false;  // a composed change is waiting for the RMT
+uint32_t ringDueMs = 0;     // next ring frame
+
+// Player progress on white, the leading LED fading in with the interpolated level
+void drawShakeProgress(uint8_t ring, uint8_t player, uint32_t nowUs) {
+  uint32_t level = view.shake.level(player, nowUs, LEDS_PER_RING * 256);
+  uint8_t ledsLit = level >> 8;
+  uint8_t frac = level & 0xFF;
+  for (uint8_t i = 0; i < LEDS_PER_RING; i++) {
+    if (i < ledsLit) rings.set(ring, i, LED_GREEN);
+    else if (i == ledsLit) rings.set(ring, i, LedRgb{(uint8_t)(255 - frac), 255, (uint8_t)(255 - frac)});
+    else rings.set(ring, i, LED_WHITE);
+  }
 }
 
-// Non-blocking show for game rings
-void pixelsShow() {
-  if (pixels.CanShow()) pixels.Show();
+// Joined players' rings yellow, the rest off (GO freeze, NEO_FIXED_COLOR)
+void drawFrozen() {
+  rings.clearOverrides();
+  rings.fill(LED_OFF);
+  for (int i = 0; i < MAX_PLAYERS; i++) {
+    if (view.joined & (1 << i)) rings.fillRing(playerToRing(i), LED_YELLOW);
+  }
 }
 
-void updateNeoPixels() {
-  unsigned long now = millis();
-
-  // Countdown flash overlay: shows bright white on all rings, synced with audio/vibration
-  if (countdownFlashStart > 0 && (now - countdownFlashStart) < COUNTDOWN_FLASH_DURATION) {
-    pixels.ClearTo(RGB_WHITE);
-    pixelsShow();
-    return;
-  } else if (countdownFlashStart > 0 && (now - countdownFlashStart) >= COUNTDOWN_FLASH_DURATION) {
-    countdownFlashStart = 0;
+// GameCore's ring overrides onto the override layer
+void applyRingOverrides(bool withBlink) {
+  for (int r = 0; r < NUM_RINGS; r++) {
+    if (view.override[r] != COLOR_OFF) rings.setOverride(r, ledRgb(view.override[r]), withBlink && view.blink[r]);
   }
+}
 
-  switch (neoState) {
+// Base and override layers for the current mode
+void drawRingLayers(unsigned long now) {
+  rings.clearOverrides();
+  switch (view.mode) {
     case NEO_IDLE_RAINBOW:
-      if (now - neoLastUpdate > 50) {
-        neoLastUpdate = now;
-        for (int i = 0; i < NEOPIXEL_COUNT; i++)
-          pixels.SetPixelColor(i, wheel((i * 256 / NEOPIXEL_COUNT + neoOffset) & 255));
-        neoOffset++;
-        pixelsShow();
-      }
+      rings.rainbow(neoOffset);
+      neoOffset++;
       break;
 
     case NEO_RANDOM_FAST:
-      if (now - neoLastUpdate > 30) {
-        neoLastUpdate = now;
-        for (int r = 0; r < NUM_RINGS; r++) {
-          uint8_t ringHue = (neoOffset + r * 51) & 255;
-          setRingColor(r, wheel(ringHue));
-        }
-        neoOffset += 3;
-        pixelsShow();
-      }
+      for (int r = 0; r < NUM_RINGS; r++) rings.fillRing(r, HUE_LUT[(neoOffset + r * 51) & 255]);
+      neoOffset += 3;
       break;
 
     case NEO_FIXED_COLOR:
-      // Re-render frozen yellow until pixels actually update on screen
-      // (handles case where initial Show() was skipped due to RMT DMA busy)
-      if (now - neoLastUpdate > 50) {
-        neoLastUpdate = now;
-        pixels.ClearTo(RGB_OFF);
-        for (int i = 0; i < MAX_PLAYERS; i++) {
-          if (players[i].joined) {
-            setRingColor(playerToRing(i), RGB_YELLOW);
-          }
-        }
-        pixelsShow();
-      }
+      drawFrozen();
       break;
 
     case NEO_COUNTDOWN:
-      if (now - neoLastUpdate > 250) {
-        neoLastUpdate = now;
-        neoBlink = !neoBlink;
-        RgbColor c = neoBlink ? RGB_RED : RGB_OFF;
-        pixels.ClearTo(c);
-        pixelsShow();
-      }
+      neoBlink = !neoBlink;
+      rings.fill(neoBlink ? LED_RED : LED_OFF);
       break;
 
-    case NEO_STATUS: {
-      if (now - neoLastUpdate > 50) {
-        neoLastUpdate = now;
-        bool blinkOn = ((now / 300) % 2) == 0;
-        for (int r = 0; r < 5; r++) {
-          if (ringOverride[r] != RGB_OFF) {
-            if (ringBlink[r] && !blinkOn)
-              setRingColor(r, RGB_OFF);
-            else
-              setRingColor(r, ringOverride[r]);
-          } else {
-            setRingColor(r, RGB_OFF);
-          }
-        }
-        pixelsShow();
-      }
+    case NEO_STATUS:
+      rings.fill(LED_OFF);
+      applyRingOverrides(true);
       break;
-    }
 
     case NEO_BLINK_SLOT:
-      if (now - neoLastUpdate > 300) {
-        neoLastUpdate = now;
-        neoBlink = !neoBlink;
-
-        for (int r = 0; r < 5; r++) {
-          if (ringOverride[r] != RGB_OFF)
-            setRingColor(r, ringOverride[r]);
-          else
-            setRingColor(r, RGB_OFF);
-        }
-
-        uint8_t blinkRing = playerToRing(blinkSlot);
-        setRingColor(blinkRing, neoBlink ? RGB_GREEN : RGB_OFF);
-        pixelsShow();
-      }
+      neoBlink = !neoBlink;
+      rings.fill(LED_OFF);
+      applyRingOverrides(false);
+      rings.setOverride(playerToRing(view.blinkSlot), neoBlink ? LED_GREEN : LED_OFF, false);
       break;
 
-    case NEO_SHAKE_COUNTDOWN:
-      if (now - neoLastUpdate > 30) {
-        neoLastUpdate = now;
-
-        // Player rings: show green progress bar based on shake count
-        for (int r = 0; r < NUM_RINGS; r++) {
-          if (r == CENTER_RING) continue;
-          if (ringOverride[r] != RGB_OFF) {
-            // Player finished: solid green or blinking red (handled by ringOverride)
-            if (ringBlink[r] && !((now / 300) % 2))
-              setRingColor(r, RGB_OFF);
-            else
-              setRingColor(r, ringOverride[r]);
-          } else {
-            // Find which player maps to this ring and show progress
-            int8_t player = -1;
-            for (int p = 0; p < MAX_PLAYERS; p++) {
-              if (players[p].joined && playerToRing(p) == r) {
-                player = p;
-                break;
-              }
-            }
-            if (player >= 0 && isActivePlayer(player)) {
-              uint8_t pTarget = shakeProgressTarget[player];
-              if (pTarget > 0) {
-                // White background with green progress overlay
-                uint8_t ledsLit = (uint8_t)((uint16_t)shakeProgress[player] * LEDS_PER_RING / pTarget);
-                if (ledsLit > LEDS_PER_RING) ledsLit = LEDS_PER_RING;
-                int startIdx = r * LEDS_PER_RING;
-                for (int i = 0; i < LEDS_PER_RING; i++) {
-                  pixels.SetPixelColor(startIdx + i, (i < ledsLit) ? RGB_GREEN : RGB_WHITE);
-                }
-              } else {
-                // No progress yet - show white background while waiting
-                setRingColor(r, RGB_WHITE);
-              }
-            } else {
-              setRingColor(r, RGB_OFF);
-            }
-          }
-        }
-
-        unsigned long elapsed = now - shakeStartTime;
-        uint8_t ledsRemaining = LEDS_PER_RING - (elapsed / SHAKE_LED_INTERVAL);
-        if (ledsRemaining > LEDS_PER_RING) ledsRemaining = 0;
-
-        RgbColor countdownColor;
-        if (ledsRemaining > 8)       countdownColor = RGB_GREEN;
-        else if (ledsRemaining > 4)  countdownColor = RGB_YELLOW;
-        else                          countdownColor = RGB_RED;
-
-        int startIdx = CENTER_RING * LEDS_PER_RING;
-        for (int i = 0; i < LEDS_PER_RING; i++) {
-          pixels.SetPixelColor(startIdx + i, (i < ledsRemaining) ? countdownColor : RGB_OFF);
-        }
-
-        pixelsShow();
+    case NEO_SHAKE_COUNTDOWN: {
+      // Player rings: finished players come from the overrides (solid green or blinking red)
+      rings.fill(LED_OFF);
+      applyRingOverrides(true);
+      const uint32_t nowUs = micros();
+      for (int p = 0; p < MAX_PLAYERS; p++) {
+        if (!(view.joined & view.active & (1 << p))) continue;
+        uint8_t r = playerToRing(p);
+        if (view.shake.target(p) > 0) drawShakeProgress(r, p, nowUs);
+        else rings.fillRing(r, LED_WHITE);   // no progress yet
+      }
+
+      unsigned long elapsed = now - view.shakeStartMs;
+      uint8_t ledsRemaining = LEDS_PER_RING - (elapsed / SHAKE_LED_INTERVAL);
+      if (ledsRemaining > LEDS_PER_RING) ledsRemaining = 0;
+
+      LedRgb countdownColor;
+      if (ledsRemaining > 8)       countdownColor = LED_GREEN;
+      else if (ledsRemaining > 4)  countdownColor = LED_YELLOW;
+      else                          countdownColor = LED_RED;
+      for (uint8_t i = 0; i < LEDS_PER_RING; i++) {
+        rings.set(CENTER_RING, i, i < ledsRemaining ? countdownColor : LED_OFF);
       }
+      rings.clearOverride(CENTER_RING);
       break;
+    }
 
     default:
+      rings.fill(LED_OFF);
       break;
   }
 }
 
-// Set NeoPixels to yellow for joined players when GO fires (visual "press now" cue)
-void freezeNeoPixels() {
-  pixels.ClearTo(RGB_OFF);
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (players[i].joined) {
-      setRingColor(playerToRing(i), RGB_YELLOW);
-    }
-  }
-  pixelsShow();
-  neoState = NEO_FIXED_COLOR;
-}
-
-// =============================================================================
-// WS2812B STRIP - NON-BLOCKING RANDOM ANIMATIONS (89 LEDs on GPIO16)
-// Uses NeoPixelBus with ESP32 RMT DMA — Show() returns immediately.
-// =============================================================================
-enum StripAnim : uint8_t {
-  ANIM_RAINBOW_CYCLE,
-  ANIM_SPARKLE,
-  ANIM_METEOR,
-  ANIM_COLOR_CHASE,
-  ANIM_BREATHING,
-  ANIM_FIRE,
-  ANIM_COUNT  // total number of animations
-};
-
-StripAnim stripAnim = ANIM_RAINBOW_CYCLE;
-unsigned long stripLastUpdate = 0;
-unsigned long stripAnimStart = 0;       // when current animation started
-uint32_t stripStep = 0;                 // animation step counter
-#define STRIP_ANIM_DURATION  15000      // switch animation every 15 seconds
-
-// Per-LED heat buffer for fire effect
-uint8_t stripHeat[STRIP_LED_COUNT];
-
-// Helper: color wheel for the strip (returns RgbColor)
-RgbColor stripWheel(uint8_t pos) {
-  pos = 255 - pos;
-  if (pos < 85)  return RgbColor(255 - pos * 3, 0, pos * 3);
-  if (pos < 170) { pos -= 85; return RgbColor(0, pos * 3, 255 - pos * 3); }
-  pos -= 170;
-  return RgbColor(pos * 3, 255 - pos * 3, 0);
-}
-
-// Helper: dim an RgbColor by a factor (0-255)
-RgbColor dimColor(RgbColor color, uint8_t bright) {
-  return RgbColor(
-    (uint16_t)color.R * bright / 255,
-    (uint16_t)color.G * bright / 255,
-    (uint16_t)color.B * bright / 255
-  );
+// One ring frame. The flash overlay holds the animation; a frame the RMT
+// wasn't ready for is offered again unchanged, and sent as soon as it is.
+void updateNeoPixels(unsigned long now) {
+  if (!ringsPending && !rings.flashing(now)) drawRingLayers(now);
+  ringsPending = !rings.present(now);
 }
 
-// Helper: non-blocking show — only pushes data if RMT DMA is idle
-void stripShow() {
-  if (strip.CanShow()) strip.Show();
-}
-
-// --- Animation: Rainbow Cycle ---
-void stripRainbowCycle() {
-  if (millis() - stripLastUpdate < 30) return;
-  stripLastUpdate = millis();
-  for (int i = 0; i < STRIP_LED_COUNT; i++) {
-    strip.SetPixelColor(i, stripWheel((i * 256 / STRIP_LED_COUNT + stripStep) & 255));
+// Newest scene in, its events applied: a new mode starts from the top, the
+// flash goes up, and at GO the joined players' rings go yellow on this pass
+void takeRingScenes(unsigned long now) {
+  RingScene s;
+  bool got = false;
+  while (ringScenes.pop(s)) got = true;
+  if (!got) return;
+  const bool newMode = s.modeSeq != view.modeSeq;
+  const bool flashed = s.flashUntilMs != view.flashUntilMs;
+  const bool frozen = s.freezeSeq != view.freezeSeq;
+  view = s;
+  if (newMode) {
+    if (view.mode == NEO_IDLE_RAINBOW) neoOffset = 0;
+    neoBlink = false;
+    ringDueMs = now;
   }
-  stripShow();
-  stripStep++;
-}
-
-// --- Animation: Sparkle / Twinkle ---
-void stripSparkle() {
-  if (millis() - stripLastUpdate < 50) return;
-  stripLastUpdate = millis();
-  // Fade all LEDs slightly
-  for (int i = 0; i < STRIP_LED_COUNT; i++) {
-    RgbColor c = strip.GetPixelColor(i);
-    strip.SetPixelColor(i, dimColor(c, 200));
+  if (flashed) {
+    rings.flash(view.flashUntilMs);   // white overlay, synced with audio/vibe
+    ringDueMs = now;
   }
-  // Light up 2-3 random LEDs with random bright colors
-  for (int s = 0; s < 3; s++) {
-    int pos = random(STRIP_LED_COUNT);
-    strip.SetPixelColor(pos, stripWheel(random(256)));
+  if (frozen) {
+    drawFrozen();
+    ringsPending = !rings.present(now);
+    if (ringsPending) ringDueMs = now;   // RMT busy: send it the moment it's free
   }
-  stripShow();
 }
 
-// --- Animation: Meteor Rain ---
-void stripMeteor() {
-  if (millis() - stripLastUpdate < 25) return;
-  stripLastUpdate = millis();
-  // Randomly fade each LED (creates trail)
-  for (int i = 0; i < STRIP_LED_COUNT; i++) {
-    if (random(10) > 4) {
-      RgbColor c = strip.GetPixelColor(i);
-      strip.SetPixelColor(i, dimColor(c, 160));
-    }
+// Renderer: scenes, then a ring frame if one is due. Period follows the
+// mode; fast while the flash is up or a frame waits for the RMT. Returns
+// the ms until the next frame.
+uint32_t renderRings() {
+  const unsigned long now = millis();
+  takeRingScenes(now);
+  if ((int32_t)(now - ringDueMs) >= 0) {
+    updateNeoPixels(now);
+    const bool fast = ringsPending || rings.flashing(now);
+    ringDueMs = now + (fast ? NEO_FLASH_PERIOD_MS : NEO_PERIOD_MS[view.mode]);
   }
-  // Draw meteor head (6 LEDs)
-  uint16_t head = stripStep % (STRIP_LED_COUNT + 20);
-  for (int j = 0; j < 6; j++) {
-    int pos = head - j;
-    if (pos >= 0 && pos < STRIP_LED_COUNT) {
-      uint8_t bright = 255 - j * 40;
-      strip.SetPixelColor(pos, dimColor(RgbColor(200, 80, 255), bright));
-    }
-  }
-  stripShow();
-  stripStep++;
+  const int32_t wait = (int32_t)(ringDueMs - millis());
+  return wait > 0 ? wait : 0;
 }
 
-// --- Animation: Color Chase ---
-void stripColorChase() {
-  if (millis() - stripLastUpdate < 60) return;
-  stripLastUpdate = millis();
-  // 3 colored segments chasing around the strip
-  for (int i = 0; i < STRIP_LED_COUNT; i++) {
-    uint8_t seg = (i + stripStep) % 18;
-    if (seg < 6)       strip.SetPixelColor(i, RgbColor(255, 0, 0));
-    else if (seg < 12) strip.SetPixelColor(i, RgbColor(0, 255, 0));
-    else               strip.SetPixelColor(i, RgbColor(0, 0, 255));
-  }
-  stripShow();
-  stripStep++;
-}
+// =============================================================================
+// WS2812B STRIP - TIME-BASED RANDOM ANIMATIONS (89 LEDs on GPIO16)
+// StripEngine.h renders and cross-fades them; the render task runs a frame
+// every STRIP_FRAME_US, or updateStrip() is a scheduler job without it.
+// =============================================================================
+StripEngine<decltype(strip), STRIP_LED_COUNT> stripEngine(strip, stripFx);
 
-// --- Animation: Breathing (single color pulsing) ---
-void stripBreathing() {
-  if (millis() - stripLastUpdate < 20) return;
-  stripLastUpdate = millis();
-  uint8_t phase = stripStep & 0xFF;
-  // Triangle wave: 0->255->0
-  uint8_t level = (phase < 128) ? phase * 2 : (255 - phase) * 2;
-  // Gamma-correct for smoother visual
-  uint8_t bright = (uint16_t)level * level / 255;
-  // Cycle hue slowly over time
-  uint8_t hue = (stripStep / 4) & 0xFF;
-  RgbColor color = dimColor(stripWheel(hue), bright);
-  strip.ClearTo(color);
-  stripShow();
-  stripStep++;
-}
+void updateStrip() { stripEngine.run(micros()); }
 
-// --- Animation: Fire Effect ---
-void stripFire() {
-  if (millis() - stripLastUpdate < 30) return;
-  stripLastUpdate = millis();
-  // Cool down every cell a little
-  for (int i = 0; i < STRIP_LED_COUNT; i++) {
-    uint8_t cooldown = random(0, 20);
-    stripHeat[i] = (stripHeat[i] > cooldown) ? stripHeat[i] - cooldown : 0;
-  }
-  // Heat drifts up and diffuses
-  for (int i = STRIP_LED_COUNT - 1; i >= 2; i--) {
-    stripHeat[i] = (stripHeat[i - 1] + stripHeat[i - 2] + stripHeat[i - 2]) / 3;
-  }
-  // Randomly ignite new sparks near the bottom
-  if (random(255) < 160) {
-    int pos = random(7);
-    stripHeat[pos] = min(255L, (long)stripHeat[pos] + random(160, 255));
-  }
-  // Map heat to color (black -> red -> yellow -> white)
-  for (int i = 0; i < STRIP_LED_COUNT; i++) {
-    uint8_t t = stripHeat[i];
-    uint8_t r, g, b;
-    if (t < 85) {
-      r = t * 3; g = 0; b = 0;
-    } else if (t < 170) {
-      r = 255; g = (t - 85) * 3; b = 0;
-    } else {
-      r = 255; g = 255; b = (t - 170) * 3;
+// =============================================================================
+// RENDER TASK (core 0): rings and strip, woken early by a new ring scene
+// =============================================================================
+#if RENDER_USE_TASK
+void renderTaskEntry(void*) {
+  uint32_t stripDueUs = micros();
+  for (;;) {
+    renderMeter.start();
+    uint32_t waitMs = renderRings();
+    const uint32_t nowUs = micros();
+    if ((int32_t)(nowUs - stripDueUs) >= 0) {
+      stripEngine.run(nowUs);
+      stripDueUs += STRIP_FRAME_US;
+      if ((int32_t)(nowUs - stripDueUs) >= 0) stripDueUs = nowUs + STRIP_FRAME_US;   // fell behind: drop frames
     }
-    strip.SetPixelColor(i, RgbColor(r, g, b));
+    const int32_t stripWaitMs = (int32_t)(stripDueUs - micros()) / 1000;
+    if (stripWaitMs < (int32_t)waitMs) waitMs = stripWaitMs > 0 ? stripWaitMs : 0;
+    renderMeter.stop();
+    // At least a tick: audio and the log drain share this core
+    ulTaskNotifyTake(pdTRUE, waitMs ? pdMS_TO_TICKS(waitMs) : 1);
   }
-  stripShow();
 }
+#endif
 
-// --- Strip Update: picks and runs current animation, switches randomly ---
-void updateStrip() {
-  unsigned long now = millis();
-  // Switch to a random animation periodically
-  if (now - stripAnimStart > STRIP_ANIM_DURATION) {
-    StripAnim newAnim;
-    do { newAnim = (StripAnim)random(ANIM_COUNT); } while (newAnim == stripAnim && ANIM_COUNT > 1);
-    stripAnim = newAnim;
-    stripStep = 0;
-    stripAnimStart = now;
-    memset(stripHeat, 0, sizeof(stripHeat));
-    // Clear strip on transition for clean start
-    strip.ClearTo(RgbColor(0));
-    stripShow();
-    Serial.printf("[STRIP] Switched to animation %d\n", stripAnim);
-  }
-  switch (stripAnim) {
-    case ANIM_RAINBOW_CYCLE: stripRainbowCycle(); break;
-    case ANIM_SPARKLE:       stripSparkle();      break;
-    case ANIM_METEOR:        stripMeteor();       break;
-    case ANIM_COLOR_CHASE:   stripColorChase();   break;
-    case ANIM_BREATHING:     stripBreathing();    break;
-    case ANIM_FIRE:          stripFire();         break;
-    default:                 stripRainbowCycle(); break;
-  }
+// =============================================================================
+// RADIO
+// Every host transmission goes through here; a trace replay swallows them
+// so replayed traffic never reaches real peers.
+// =============================================================================
+void radioSend(const uint8_t* mac, const uint8_t* data, size_t len) {
+  if (packetTrace.mutesRadio()) return;
+  flightRecorder.frame(FL_TX, data, len, true);
+  esp_now_send(mac, data, len);
 }
 
 // =============================================================================
@@ -688,19 +505,19 @@ void updateStrip() {
 // =============================================================================
 void sendToDisplay(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) {
   GamePacket pkt;
-  uint16_t data = ((uint16_t)dataHigh << 8) | dataLow;
+  uint16_t data = packData(dataHigh, dataLow);
   buildPacket(&pkt, ID_DISPLAY, ID_HOST, cmd, data);
-  esp_now_send(displayMac, (uint8_t*)&pkt, sizeof(pkt));
-  Serial.printf("[DISP] cmd=0x%02X data=%d,%d\n", cmd, dataHigh, dataLow);
+  radioSend(displayMac, (uint8_t*)&pkt, sizeof(pkt));
+  LOGD(LOG_DISP, "[DISP] cmd=0x%02X data=%d,%d\n", cmd, dataHigh, dataLow);
 }
 
 // =============================================================================
 // ESP-NOW SEND
 // =============================================================================
-void espnowSend(uint8_t* mac, uint8_t dest, uint8_t cmd, uint16_t data) {
+void espnowSend(const uint8_t* mac, uint8_t dest, uint8_t cmd, uint16_t data) {
   GamePacket pkt;
   buildPacket(&pkt, dest, ID_HOST, cmd, data);
-  esp_now_send(mac, (uint8_t*)&pkt, sizeof(pkt));
+  radioSend(mac, (uint8_t*)&pkt, sizeof(pkt));
 }
 
 void espnowBroadcast(uint8_t cmd, uint16_t data) {
@@ -708,786 +525,933 @@ void espnowBroadcast(uint8_t cmd, uint16_t data) {
 }
 
 // =============================================================================
-// ACK + RETRY (non-blocking)
-// PendingAck struct, pendingAcks[], and defines declared above resetPlayers()
+// ACK + RETRY (non-blocking, see ReliableLink.h)
 // =============================================================================
 
-// Map stick/display ID to pending ACK slot index (0-3 = sticks, 4 = display)
-int8_t ackSlotFor(uint8_t destId) {
-  if (destId >= ID_STICK1 && destId <= ID_STICK4) return destId - ID_STICK1;
-  if (destId == ID_DISPLAY) return 4;
-  return -1;
+void linkSend(const uint8_t* mac, const uint8_t* data, size_t len) {
+  radioSend(mac, data, len);
 }
 
-// MAC lookup by device ID
-uint8_t* macForDest(uint8_t destId) {
-  switch (destId) {
-    case ID_STICK1: return stick1Mac;
-    case ID_STICK2: return stick2Mac;
-    case ID_STICK3: return stick3Mac;
-    case ID_STICK4: return stick4Mac;
-    case ID_DISPLAY: return displayMac;
-    default: return nullptr;
-  }
+// ArenaLink hooks: move the radio, broadcast on whatever channel it is on
+void arenaSetChannel(uint8_t channel) {
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
 }
 
-// Send a critical command with ACK tracking (replaces espnowSend for critical cmds)
-void sendWithRetry(uint8_t destId, uint8_t cmd, uint16_t data) {
-  int8_t slot = ackSlotFor(destId);
-  if (slot < 0) return;
-
-  uint8_t* mac = macForDest(destId);
-  if (!mac) return;
-
-  // Store pending ACK
-  PendingAck &pa = pendingAcks[slot];
-  pa.waiting = true;
-  pa.dest = destId;
-  pa.cmd = cmd;
-  pa.data = data;
-  memcpy(pa.mac, mac, 6);
-  pa.retries = ACK_MAX_RETRIES;
-  pa.lastSend = millis();
-
-  // Send first attempt
-  espnowSend(mac, destId, cmd, data);
-  Serial.printf("[ACK] Sent cmd=0x%02X to 0x%02X (retries=%d)\n", cmd, destId, pa.retries);
+void arenaSend(const uint8_t* data, size_t len) {
+  radioSend(broadcastMac, data, len);
 }
 
-// Send a critical command to all active joysticks (respects deuce filtering)
-void sendToJoysticksWithRetry(uint8_t cmd, uint16_t data) {
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (isActivePlayer(i)) {
-      sendWithRetry(slotToStick[i], cmd, data);
-    }
-  }
+// Send a critical command with ACK tracking (replaces espnowSend for critical cmds).
+// Several commands can be in flight to the same peer; each is retried on its own.
+void sendWithRetry(uint8_t destId, uint8_t cmd, uint16_t data) {
+  ackLink.send(destId, cmd, data);
 }
 
 // Send a critical command to display with ACK tracking
 void sendToDisplayWithRetry(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) {
-  uint16_t data = ((uint16_t)dataHigh << 8) | dataLow;
+  uint16_t data = packData(dataHigh, dataLow);
   sendWithRetry(ID_DISPLAY, cmd, data);
-  Serial.printf("[DISP] cmd=0x%02X data=%d,%d\n", cmd, dataHigh, dataLow);
+  LOGD(LOG_DISP, "[DISP] cmd=0x%02X data=%d,%d\n", cmd, dataHigh, dataLow);
 }
 
-// Called in loop() — retransmits pending commands that haven't been ACK'd
-void updateRetries() {
-  unsigned long now = millis();
-  for (int i = 0; i < ACK_SLOT_COUNT; i++) {
-    PendingAck &pa = pendingAcks[i];
-    if (!pa.waiting) continue;
-    if (now - pa.lastSend < ACK_RETRY_INTERVAL) continue;
-
-    if (pa.retries > 0) {
-      pa.retries--;
-      pa.lastSend = now;
-      espnowSend(pa.mac, pa.dest, pa.cmd, pa.data);
-      Serial.printf("[ACK] Retry cmd=0x%02X to 0x%02X (retries=%d)\n", pa.cmd, pa.dest, pa.retries);
-    } else {
-      pa.waiting = false;
-      Serial.printf("[ACK] GAVE UP cmd=0x%02X to 0x%02X\n", pa.cmd, pa.dest);
-    }
-  }
+// Batched display updates (protocol v4): items collect between displayBatchBegin()
+// and displayBatchFlush() and go out as one CMD_BATCH frame with one ACK.
+// A display on older firmware (or one we haven't heard from) gets one packet per item.
+FwVersion displayFw = {0, 0, 0};  // from the display's CMD_REQ_ID hello, 0.0.0 = unknown
+BatchWriter displayBatch;
+
+void displayBatchBegin() {
+  displayBatch.begin(ID_DISPLAY, ID_HOST);
 }
 
-// Handle incoming ACK — clear matching pending slot
-void handleAck(uint8_t srcId, uint8_t ackedCmd) {
-  int8_t slot = ackSlotFor(srcId);
-  if (slot < 0) return;
+void displayBatchFlush() {
+  if (!displayBatch.empty()) ackLink.sendBatch(ID_DISPLAY, displayBatch);
+  displayBatchBegin();
+}
 
-  PendingAck &pa = pendingAcks[slot];
-  if (pa.waiting && pa.cmd == ackedCmd) {
-    pa.waiting = false;
-    Serial.printf("[ACK] Received ACK for cmd=0x%02X from 0x%02X\n", ackedCmd, srcId);
+void displayBatchAdd(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) {
+  if (cmd == DISP_NEXT_ROUND && !supportsRoundLookahead(displayFw)) return;  // hint only
+  if (cmd == DISP_TOUR_SEAT && !supportsTournament(displayFw)) return;
+  if (displayFw.major < BATCH_MIN_MAJOR) {
+    sendToDisplayWithRetry(cmd, dataHigh, dataLow);
+    return;
+  }
+  uint16_t data = packData(dataHigh, dataLow);
+  if (!displayBatch.add(cmd, data)) {  // frame full - ship it and start another
+    displayBatchFlush();
+    displayBatch.add(cmd, data);
+  }
+  LOGD(LOG_DISP, "[DISP] batch cmd=0x%02X data=%d,%d\n", cmd, dataHigh, dataLow);
+}
+
+// Result time: 4-byte ticks to displays that show sub-ms, rounded ms to the rest
+void displayBatchAddTime(uint8_t cmd, uint32_t ticks) {
+  if (!supportsFineResults(displayFw)) {
+    uint16_t ms = resultTicksToMs(ticks);
+    displayBatchAdd(cmd, dataHigh(ms), dataLow(ms));
+    return;
   }
+  if (!displayBatch.add32(cmd, ticks)) {
+    displayBatchFlush();
+    displayBatch.add32(cmd, ticks);
+  }
+  LOGD(LOG_DISP, "[DISP] batch cmd=0x%02X ticks=%lu\n", cmd, (unsigned long)ticks);
 }
 
 // =============================================================================
 // HARDWARE SIGNALS
 // =============================================================================
-void sendGO() {
-  // Send GO individually to each joined joystick (with ACK tracking)
-  sendToJoysticksWithRetry(CMD_GO, 0);
-  Serial.println("[GO] Sent CMD_GO to all joined joysticks");
+// goHostUs = micros() when the GO cue became visible. One broadcast reaches all
+// sticks at once; missed ones get unicast retries carrying the same timestamp,
+// and each stick backdates its timer to goHostUs using its clock sync.
+void sendGO(uint32_t goHostUs) {
+  uint16_t ticks = goTicks(goHostUs);
+  uint16_t stickMask = 0;
+  for (int i = 0; i < MAX_PLAYERS; i++) {
+    if (game.isActivePlayer(i)) stickMask |= 1 << stickIndex(game.slotToStick[i]);
+  }
+  latency.goStart(goHostUs, stickMask);
+  espnowBroadcast(CMD_GO, ticks);
+  latency.goSent();
+  for (int i = 0; i < MAX_PLAYERS; i++) {
+    if (game.isActivePlayer(i)) ackLink.track(game.slotToStick[i], CMD_GO, ticks);
+  }
+  LOGI(LOG_GAME, "[GO] Broadcast CMD_GO at host t=%lu us\n", (unsigned long)goHostUs);
+
+  unsigned long now = millis();
+  for (int i = 0; i < MAX_PLAYERS; i++) {
+    if (!game.isActivePlayer(i)) continue;
+    uint8_t s = stickIndex(game.slotToStick[i]);
+    const StickSync &ss = stickSync[s];
+    if (ss.lastReport == 0 || now - ss.lastReport > SYNC_STALE_MS || ss.rttUs == 0xFFFF) {
+      LOGW(LOG_SYNC, "[SYNC] Player %d (stick %d): NOT synced - timing from GO arrival\n", i + 1, s + 1);
+    } else {
+      long driftPpm = 0;
+      unsigned long span = ss.lastReport - ss.prevReport;
+      if (ss.prevReport != 0 && span > 0)
+        driftPpm = (long)((int64_t)(ss.offsetUs - ss.lastOffsetUs) * 1000 / (long)span);
+      LOGI(LOG_SYNC, "[SYNC] Player %d (stick %d): offset=%ld us rtt=%u us drift~%ld ppm\n",
+                     i + 1, s + 1, (long)ss.offsetUs, ss.rttUs, driftPpm);
+    }
+  }
+}
+
+// Answer a stick's clock-sync ping (runs in the ESP-NOW receive callback so
+// t2/t3 are as close to the radio as we can get). The report it carries goes
+// through the RX queue: stickSync is loop()'s (onSyncReport()).
+void handleSyncRequest(const uint8_t *mac, const SyncPacket &req, uint32_t t2) {
+  uint8_t src = req.src_id;
+  if (!isStickId(src)) return;
+
+  SyncPacket resp;
+  memset(&resp, 0, sizeof(resp));
+  resp.dest_id = src;
+  resp.src_id = ID_HOST;
+  resp.cmd = CMD_SYNC_RESP;
+  resp.seq = req.seq;
+  resp.t1 = req.t1;
+  resp.t2 = t2;
+  resp.t3 = micros();
+  sealSyncPacket(&resp);
+  radioSend(stickPeers.addrFor(src), (uint8_t*)&resp, sizeof(resp));
 }
 
 // =============================================================================
-// ESP-NOW CALLBACKS
+// RECEIVE QUEUE
+// The ESP-NOW callback runs in the WiFi task (other core). It only validates,
+// timestamps and enqueues; all game state is touched from loop() via
+// processRxQueue(), so there are no torn updates and no UART on the radio path.
 // =============================================================================
-void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
-  if (len != (int)sizeof(GamePacket)) return;
+#define RX_QUEUE_SIZE 32        // power of 2; a full round of traffic is ~15 packets
 
+struct RxEvent {
   GamePacket pkt;
-  memcpy(&pkt, data, sizeof(pkt));
-  if (!validatePacket(&pkt)) return;
+  bool sequenced;               // arrived as a ReliablePacket
+  uint8_t seq;
+  uint8_t epoch;
+  bool fine;                    // batch item carried a 4-byte result (FINE RESULT TIMES)
+  uint32_t fineTicks;
+  uint8_t mac[6];
+  uint32_t rxUs;                // micros() at callback entry
+};
+
+SpscQueue<RxEvent, RX_QUEUE_SIZE> rxQueue;
+volatile uint32_t rxDropped = 0;   // written by WiFi task only
+uint32_t rxDroppedReported = 0;
+
+// =============================================================================
+// PACKET HANDLING (loop context)
+// =============================================================================
+uint32_t displayTelemetry[TELEM_FIELD_COUNT] = {};  // last report from the display
+
+void logDisplayTelemetry() {
+  const uint32_t *t = displayTelemetry;
+  LOGI(LOG_DISP, "[DISP] Telemetry at %lu ms: %lu frames, %lu vsyncs, RX queue max %lu\n",
+                 (unsigned long)t[TELEM_UPTIME_MS], (unsigned long)t[TELEM_FRAMES],
+                 (unsigned long)t[TELEM_VSYNCS], (unsigned long)t[TELEM_QUEUE_MAX]);
+  LOGI(LOG_DISP, "[DISP]   render p50/p99/max %lu/%lu/%lu us, flush %lu/%lu/%lu us\n",
+                 (unsigned long)t[TELEM_RENDER_P50_US], (unsigned long)t[TELEM_RENDER_P99_US],
+                 (unsigned long)t[TELEM_RENDER_MAX_US], (unsigned long)t[TELEM_FLUSH_P50_US],
+                 (unsigned long)t[TELEM_FLUSH_P99_US], (unsigned long)t[TELEM_FLUSH_MAX_US]);
+  LOGI(LOG_DISP, "[DISP]   %lu updates, packet-to-pixel p50/p99/max %lu/%lu/%lu us, %lu duplicates\n",
+                 (unsigned long)t[TELEM_LATENCY_COUNT], (unsigned long)t[TELEM_LATENCY_P50_US],
+                 (unsigned long)t[TELEM_LATENCY_P99_US], (unsigned long)t[TELEM_LATENCY_MAX_US],
+                 (unsigned long)t[TELEM_DROP_DUPLICATE]);
+  LOGI(LOG_DISP, "[DISP]   drops: queue %lu, len %lu, start %lu, crc %lu, dest %lu, src %lu\n",
+                 (unsigned long)t[TELEM_DROP_QUEUE_FULL], (unsigned long)t[TELEM_DROP_BAD_LEN],
+                 (unsigned long)t[TELEM_DROP_BAD_START], (unsigned long)t[TELEM_DROP_BAD_CRC],
+                 (unsigned long)t[TELEM_DROP_WRONG_DEST], (unsigned long)t[TELEM_DROP_NOT_FROM_HOST]);
+}
+
+void logStickPower(uint8_t idx) {
+  const uint32_t *p = stickPower[idx];
+  LOGI(LOG_NET, "[POWER] Stick %d: %lu mV, awake %lu/1000, %lu sleeps, wake radio %lu us, beacon +%lu ms\n",
+       idx + 1, (unsigned long)p[POWER_VCC_MV], (unsigned long)p[POWER_AWAKE_PERMILLE],
+       (unsigned long)p[POWER_SLEEPS], (unsigned long)p[POWER_WAKE_RADIO_US], (unsigned long)p[POWER_WAKE_BEACON_MS]);
+}
+
+// Register mac (or find its old ID) and tell the stick, which answers to
+// replyTo until then. unicastOnly: replyTo is another stick's ID too, so a
+// broadcast reply would move both. Returns the ID, 0 if the table is full.
+uint8_t assignStickId(const uint8_t *mac, uint8_t replyTo, bool unicastOnly) {
+  bool added;
+  uint8_t id = stickPeers.assign(mac, &added);
+  if (!id) return 0;
+  if (added) ackLink.addPeer(id, stickPeers.addrFor(id));
+  if (unicastOnly && !stickPeers.unicast(id)) return id;
+  espnowSend(stickPeers.addrFor(id), replyTo, CMD_ASSIGN_ID, id);
+  LOGI(LOG_JOIN, "[JOIN] Joystick %d assigned (was 0x%02X)\n", stickIndex(id) + 1, replyTo);
+  return id;
+}
 
+// SYNC REPORT: a stick's offset/RTT estimate from its last ping (receiveFrame())
+void onSyncReport(uint8_t src, uint16_t rttUs, int32_t offsetUs) {
+  StickSync &ss = stickSync[stickIndex(src)];
+  ss.prevReport = ss.lastReport;
+  ss.lastOffsetUs = ss.offsetUs;
+  ss.offsetUs = offsetUs;
+  ss.rttUs = rttUs;
+  ss.lastReport = millis();
+}
+
+void handlePacket(const RxEvent &ev) {
+  const GamePacket &pkt = ev.pkt;
+  const uint8_t *mac = ev.mac;
   uint8_t src = pkt.src_id;
   uint16_t val = packetData(&pkt);
 
+  if (pkt.cmd == CMD_SYNC_REQ) {
+    if (isStickId(src)) onSyncReport(src, val, (int32_t)ev.fineTicks);
+    return;
+  }
+
+  // Other tables' hosts (control channel): registration, standings
+  if (pkt.cmd == CMD_ARENA_HELLO) {
+    if (src != ID_HOST || pkt.dest_id != ID_COORDINATOR || !ARENA_COORDINATOR) return;
+    espnowSend(broadcastMac, ID_HOST, CMD_ARENA_ASSIGN, arena.onHello(mac, val & 0xFF, millis()));
+    return;
+  }
+  if (pkt.cmd == CMD_ARENA_ASSIGN) {
+    if (src == ID_COORDINATOR) arena.onAssign(val >> 8, val & 0xFF);
+    return;
+  }
+  if (pkt.cmd == CMD_ARENA_STANDING) {
+    if (src == ID_HOST && pkt.dest_id == ID_COORDINATOR) {
+      arena.onStanding(val >> 8, val & 0xFF, ev.fineTicks, millis());
+    }
+    return;
+  }
+
+  // Registering or reporting on the control channel: the frames there belong to arena 0
+  if (arena.joining() || arena.hopping()) return;
+
   // Handle CMD_ACK from any source (joysticks or display)
   if (pkt.cmd == CMD_ACK) {
-    handleAck(src, pkt.data_low);
+    if (isStickId(src) && decodeAck(val).cmd == CMD_GO) {
+      latency.onGoAck(stickIndex(src), ev.rxUs);
+    }
+    if (ev.sequenced) {
+      ReliablePacket ack;
+      ack.base = pkt;
+      ack.seq = ev.seq;
+      ack.epoch = ev.epoch;
+      ackLink.onAck(src, ack);
+    } else {
+      ackLink.onLegacyAck(src, decodeAck(val).cmd);
+    }
+    return;
+  }
+
+  // The display announces its firmware at boot and whenever the host epoch changes
+  if (src == ID_DISPLAY && pkt.cmd == CMD_REQ_ID) {
+    displayFw = decodeVersion(val);
+    LOGI(LOG_DISP, "[DISP] Display firmware V%d.%d.%d - %s%s\n",
+                   displayFw.major, displayFw.minor, displayFw.patch,
+                   displayFw.major >= BATCH_MIN_MAJOR ? "batched updates" : "single packets",
+                   supportsFineResults(displayFw) ? ", sub-ms times" : "");
+    stats.markBoardChanged();   // a rebooted display starts without the leaderboard
+    return;
+  }
+
+  // Periodic display report, one field per event; TELEM_UPTIME_MS closes it
+  if (src == ID_DISPLAY && pkt.cmd == CMD_DISP_TELEMETRY) {
+    if (val >= TELEM_FIELD_COUNT) return;
+    displayTelemetry[val] = ev.fineTicks;
+    if (val == TELEM_UPTIME_MS) logDisplayTelemetry();
     return;
   }
 
-  // All other commands must come from joysticks
-  if (src < ID_STICK1 || src > ID_STICK4) return;
-  uint8_t stickIdx = src - ID_STICK1;  // which physical joystick (0-3)
+  // A stick without an ID announces itself: hand it one (ID ASSIGNMENT in Protocol.h)
+  if (pkt.cmd == CMD_HELLO) {
+    if (!isTempId(src)) return;
+    uint8_t id = assignStickId(mac, src, false);
+    if (id) stickFw[stickIndex(id)] = decodeVersion(val);
+    return;
+  }
+
+  // All other commands must come from registered joysticks; fixed-ID
+  // sticks are registered here, an ID taken by another MAC gets reassigned
+  if (!isStickId(src)) return;
+  bool added;
+  if (!stickPeers.learn(src, mac, &added)) {
+    LOGW(LOG_NET, "[PEER] 0x%02X from a MAC registered elsewhere - reassigning\n", src);
+    assignStickId(mac, src, true);
+    return;
+  }
+  if (added) ackLink.addPeer(src, stickPeers.addrFor(src));
+  uint8_t stickIdx = stickIndex(src);  // which physical joystick
 
   // Debug: log all incoming packets
-  Serial.printf("[ESP-NOW] Recv cmd=0x%02X from stick %d (0x%02X), data=%d, state=%d\n",
-                pkt.cmd, stickIdx + 1, src, val, gameState);
+  LOGD(LOG_NET, "[ESP-NOW] Recv cmd=0x%02X from stick %d (0x%02X), data=%d, state=%d, queued %lu us\n",
+                pkt.cmd, stickIdx + 1, src, val, game.state, (unsigned long)(micros() - ev.rxUs));
+
+  // Power report, one field per event; the last field closes it (STICK POWER)
+  if (pkt.cmd == CMD_STICK_POWER) {
+    if (val >= POWER_FIELD_COUNT) return;
+    stickPower[stickIdx][val] = ev.fineTicks;
+    if (val == POWER_FIELD_COUNT - 1) {
+      stickPowerValid[stickIdx] = true;
+      logStickPower(stickIdx);
+    }
+    return;
+  }
 
   // Handle join request during JOIN phase
   if (pkt.cmd == CMD_REQ_ID) {
     // Decode joystick firmware version from data field
-    // data_high = (MAJOR<<4)|MINOR, data_low = PATCH
-    uint8_t jsMajor = (pkt.data_high >> 4) & 0x0F;
-    uint8_t jsMinor = pkt.data_high & 0x0F;
-    uint8_t jsPatch = pkt.data_low;
-    Serial.printf("[JOIN] Joystick %d firmware: V%d.%d.%d\n",
-                  stickIdx + 1, jsMajor, jsMinor, jsPatch);
-
-    if (gameState == STATE_JOIN) {
-      // Check if this joystick already claimed a slot
-      if (stickClaimed[stickIdx]) {
-        Serial.printf("[JOIN] Joystick %d already claimed a slot, ignoring\n", stickIdx + 1);
-        return;
-      }
-
-      // Check if current prompted slot is still available
-      uint8_t slot = currentPromptSlot;
-      if (slotToStick[slot] != 0xFF) {
-        Serial.printf("[JOIN] Slot %d already taken, ignoring\n", slot + 1);
-        return;
-      }
-
-      // Claim the current slot for this joystick
-      slotToStick[slot] = src;
-      stickClaimed[stickIdx] = 1;
-      players[slot].joined = true;
-      joinedCount++;
-
-      // Turn this slot's ring to the joystick's identity color
-      uint8_t ring = playerToRing(slot);
-      ringOverride[ring] = stickColor(src);
-
-      // Notify display that player is ready (data_high = player slot 1-4, data_low = joystick ID)
-      sendToDisplayWithRetry(DISP_PLAYER_READY, slot + 1, src);
+    FwVersion fw = decodeVersion(val);
+    stickFw[stickIdx] = fw;
+    uint8_t jsMajor = fw.major;
+    uint8_t jsMinor = fw.minor;
+    uint8_t jsPatch = fw.patch;
+    LOGD(LOG_JOIN, "[JOIN] Joystick %d firmware: V%d.%d.%d\n",
+                   stickIdx + 1, jsMajor, jsMinor, jsPatch);
+    if (!versionAtLeast(fw, 3, 2)) {
+      LOGW(LOG_JOIN, "[JOIN] Joystick %d firmware too old for sequenced ACKs - commands will time out\n",
+                     stickIdx + 1);
+    }
 
+    uint8_t slot = game.onJoinRequest(src);
+    if (slot != 0xFF) {
       // Send ACK to joystick (with slot number in data)
-      espnowSend((uint8_t*)mac, src, CMD_OK, slot + 1);
-
-      Serial.printf("[JOIN] Joystick %d (V%d.%d.%d) claimed Player %d slot! Total: %d\n",
-                    stickIdx + 1, jsMajor, jsMinor, jsPatch, slot + 1, joinedCount);
-
-      // Advance to next slot immediately
-      promptStartTime = 0;  // trigger immediate advance in handleJoin
+      espnowSend(stickPeers.addrFor(src), src, CMD_OK, slot + 1);
+      LOGI(LOG_JOIN, "[JOIN] Joystick %d (V%d.%d.%d) claimed Player %d slot! Total: %d\n",
+                     stickIdx + 1, jsMajor, jsMinor, jsPatch, slot + 1, game.joinedCount);
     }
     return;
   }
 
   // Find which player slot this joystick is assigned to
-  int8_t playerSlot = -1;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (slotToStick[i] == src) {
-      playerSlot = i;
-      break;
-    }
-  }
+  int8_t playerSlot = game.playerForStick(src);
   if (playerSlot < 0) {
-    Serial.printf("[ERR] Joystick 0x%02X not in slotToStick! Map: [0x%02X,0x%02X,0x%02X,0x%02X]\n",
-                  src, slotToStick[0], slotToStick[1], slotToStick[2], slotToStick[3]);
+    LOGE(LOG_NET, "[ERR] Joystick 0x%02X not in slotToStick! Map: [%s]\n", src, game.slotMap());
     return;
   }
 
-  // Handle shake progress updates (data_high = count, data_low = target)
+  // Handle shake progress updates (count / target)
   if (pkt.cmd == CMD_SHAKE_PROGRESS) {
-    if (playerSlot >= 0 && playerSlot < MAX_PLAYERS && gameState == STATE_SHAKE) {
-      shakeProgress[playerSlot] = pkt.data_high;
-      shakeProgressTarget[playerSlot] = pkt.data_low;
-      Serial.printf("[SHAKE] Player %d progress: %d/%d\n",
-                    playerSlot + 1, pkt.data_high, pkt.data_low);
-    }
+    ShakeProgressData progress = decodeShakeProgress(val);
+    game.onShakeProgress(playerSlot, progress.count, progress.target);
     return;
   }
 
   if (pkt.cmd == CMD_REACTION_DONE || pkt.cmd == CMD_SHAKE_DONE) {
-    // Check we're in correct state to receive results
-    if (gameState != STATE_COLLECT && gameState != STATE_SHAKE) {
-      Serial.printf("[WARN] Got result in wrong state %d, ignoring\n", gameState);
-      return;
-    }
-    if (players[playerSlot].finished) {
-      Serial.printf("[WARN] Player %d already finished, ignoring\n", playerSlot + 1);
-      return;
-    }
-
-    players[playerSlot].reactionTime = val;
-    players[playerSlot].finished = true;
-
-    Serial.printf("[RECV] Player %d (stick %d): %s = %d ms\n",
-                  playerSlot + 1, stickIdx + 1,
-                  (pkt.cmd == CMD_REACTION_DONE) ? "REACTION" : "SHAKE",
-                  val);
-
-    // Immediately turn that player's ring GREEN if valid, BLINK RED if penalty
-    uint8_t ring = playerToRing(playerSlot);
-    if (val == TIME_PENALTY) {
-      ringOverride[ring] = RGB_RED;
-      ringBlink[ring] = true;  // blink red for penalty
-      Serial.printf("[NEO] Player %d ring %d -> BLINK RED (penalty)\n", playerSlot + 1, ring);
-    } else {
-      ringOverride[ring] = RGB_GREEN;
-      ringBlink[ring] = false;
-      Serial.printf("[NEO] Player %d ring %d -> GREEN (time=%d)\n", playerSlot + 1, ring, val);
-    }
-    // If we were in NEO_FIXED_COLOR or NEO_RANDOM_FAST, switch to status mode
-    // so the ring override renders immediately
-    if (neoState == NEO_FIXED_COLOR || neoState == NEO_RANDOM_FAST) {
-      // During COLLECT: set non-finished players' rings to yellow so they stay visible
-      if (gameState == STATE_COLLECT) {
-        for (int j = 0; j < MAX_PLAYERS; j++) {
-          if (players[j].joined && !players[j].finished) {
-            uint8_t rj = playerToRing(j);
-            if (ringOverride[rj] == RGB_OFF) {
-              ringOverride[rj] = RGB_YELLOW;
-              ringBlink[rj] = false;
-            }
-          }
-        }
-      }
-      neoState = NEO_STATUS;
+    // Every copy: the stick stops resending on the first ACK that gets through (RESULT ACK)
+    espnowSend(stickPeers.addrFor(src), src, CMD_ACK, encodeAck(pkt.cmd));
+    uint32_t ticks = ev.fine ? ev.fineTicks : resultTicksFromMs(val);
+    bool reaction = pkt.cmd == CMD_REACTION_DONE;
+    if (game.onResult(playerSlot, reaction, ticks) && reaction) {
+      latency.onResult(stickIdx, ev.rxUs, ticks);
+      arena.reaction(ticks);
     }
   }
 }
 
-void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
-  // optional
-}
-
-// =============================================================================
-// STATE HANDLERS
-// =============================================================================
-
-// --- IDLE ---
-void handleIdle() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-
-    // Broadcast IDLE to ALL joysticks before resetting player state
-    // (sendToJoysticksWithRetry won't work after resetPlayers clears slotToStick)
-    espnowBroadcast(CMD_IDLE, 0);
-
-    resetPlayers();
-    currentRound = 0;
-    neoState = NEO_IDLE_RAINBOW;
-    neoOffset = 0;
-    for (int i = 0; i < 5; i++) ringOverride[i] = RGB_OFF;
-
-    sendToDisplayWithRetry(DISP_IDLE, 0, 0);
-    audio.queueSound(SND_PRESS_TO_JOIN);
-    Serial.println("[STATE] IDLE");
+// Drain everything the callback queued since the last pass
+void processRxQueue() {
+  latency.drainTx();
+  const uint32_t depth = rxQueue.size();
+  RxEvent ev;
+  while (rxQueue.pop(ev)) {
+    handlePacket(ev);
+    uint32_t now = micros();
+    packetTrace.onHandled(now, now - ev.rxUs, depth);
   }
 
-  // Auto-transition to JOIN after 3s
-  if (millis() - stateStartTime > 3000) {
-    gameState = STATE_JOIN;
-    stateStartTime = 0;
+  uint32_t dropped = rxDropped;
+  if (dropped != rxDroppedReported) {
+    LOGW(LOG_NET, "[ESP-NOW] RX queue full - dropped %lu packet(s) (total %lu)\n",
+                  (unsigned long)(dropped - rxDroppedReported), (unsigned long)dropped);
+    rxDroppedReported = dropped;
   }
 }
 
-// --- JOIN ---
-// Sequential player slot prompting: P1 -> P2 -> P3 -> P4
-// Each slot blinks on NeoPixel ring and display. Any unclaimed joystick can press to claim.
-// After all 4 prompts (5s each) or skip timeout, proceed if >= 2 players joined.
-#define PROMPT_DURATION 5000  // 5 seconds per player prompt
-
-void startPromptSlot(uint8_t slot) {
-  currentPromptSlot = slot;
-  promptStartTime = millis();
-  blinkSlot = slot;
-  neoState = NEO_BLINK_SLOT;
-  neoBlink = false;
-  neoLastUpdate = 0;
-
-  // Send prompt to display (player number 1-4)
-  sendToDisplayWithRetry(DISP_PLAYER_PROMPT, 0, slot + 1);
-
-  // Interrupt any currently playing audio, then play new player number
-  audio.stop();
-  audio.playPlayerNumber(slot + 1);
-
-  Serial.printf("[JOIN] Prompting Player %d slot...\n", slot + 1);
+// =============================================================================
+// ESP-NOW CALLBACKS (WiFi task)
+// =============================================================================
+void queueRx(const RxEvent &ev) {
+  if (rxQueue.push(ev)) {
+    if (gameTask) xTaskNotifyGive(gameTask);   // handled now, not at the next job
+    return;
+  }
+  rxDropped = rxDropped + 1;
+  flightRecorder.record(FL_RX_DROP, ev.pkt.cmd, ev.pkt.src_id);
 }
 
-void handleJoin() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    joinComplete = false;
-    // Clear all ring overrides
-    for (int i = 0; i < 5; i++) ringOverride[i] = RGB_OFF;
-
-    // Start with Player 1 prompt
-    startPromptSlot(0);
-    Serial.println("[STATE] JOIN - sequential player prompting");
+// Validate and queue one frame: the radio callback's work, also the replay entry point
+void receiveFrame(const uint8_t *mac, const uint8_t *data, int len, uint32_t rxUs) {
+  // Firmware update requests: served from loop() by otaJob
+  if (isOtaFrame(data, len)) {
+    ota.onFrame(data, len);
+    return;
   }
 
-  // Waiting 1s after join complete so players can see their assigned colors
-  if (joinComplete) {
-    if (millis() - joinCompleteTime > 1000) {
-      audio.queueSound(SND_GET_READY);
-      gameState = STATE_COUNTDOWN;
-      stateStartTime = 0;
-      countdownNum = 3;
-    }
+  RxEvent ev;
+  ev.fine = false;
+  ev.fineTicks = RESULT_TICKS_NONE;
+  memcpy(ev.mac, mac, 6);
+  ev.rxUs = rxUs;
+
+  // Clock sync is answered right here: queueing would add loop() latency to t3-t2
+  // and, worse, make it unbounded while a frame is rendering. The stick's report
+  // is queued (SYNC REPORT: rtt in data, offset in fineTicks).
+  if (len == (int)SYNC_PACKET_SIZE) {
+    SyncPacket sp;
+    memcpy(&sp, data, sizeof(sp));
+    if (!validateSyncPacket(&sp) || sp.cmd != CMD_SYNC_REQ) return;
+    handleSyncRequest(mac, sp, rxUs);
+    ev.sequenced = false;
+    ev.seq = 0;
+    ev.epoch = 0;
+    ev.fineTicks = (uint32_t)sp.offset_us;
+    buildPacket(&ev.pkt, ID_HOST, sp.src_id, CMD_SYNC_REQ, sp.rtt_us);
+    queueRx(ev);
     return;
   }
 
-  // Check if current slot has timed out or was just claimed (promptStartTime = 0)
-  bool shouldAdvance = (promptStartTime == 0) ||
-                       (millis() - promptStartTime > PROMPT_DURATION);
-
-  if (shouldAdvance) {
-    // Find next unclaimed slot
-    uint8_t nextSlot = currentPromptSlot + 1;
-    while (nextSlot < MAX_PLAYERS && slotToStick[nextSlot] != 0xFF) {
-      nextSlot++;  // skip already-claimed slots
-    }
-
-    if (nextSlot >= MAX_PLAYERS) {
-      // All slots prompted - check if we have enough players
-      if (joinedCount < 2) {
-        Serial.println("[JOIN] Not enough players, restarting join prompts");
-        // Silently cycle back to P1 without error sound or idle screen
-        currentPromptSlot = 0;
-        startPromptSlot(0);
-        return;
+  // Stick result batches: one event per item, as if each came in its own packet
+  if (isBatchFrame(data, len)) {
+    if (!validateBatch(data, len)) return;
+    const BatchHeader* h = (const BatchHeader*)data;
+    BatchReader reader(data);
+    BatchItem item;
+    ev.sequenced = false;
+    ev.seq = h->seq;
+    ev.epoch = h->epoch;
+    while (reader.next(&item)) {
+      uint8_t field;
+      uint32_t value;
+      uint8_t arenaId;
+      if (decodeArenaStanding(item, &arenaId, &field, &value)) {
+        // ARENA STANDINGS: arena/field in data, value in fineTicks
+        ev.fine = false;
+        ev.fineTicks = value;
+        buildPacket(&ev.pkt, h->dest_id, h->src_id, item.cmd, packData(arenaId, field));
+        queueRx(ev);
+        continue;
       }
-      Serial.printf("[JOIN] Starting with %d players. Map: [0x%02X,0x%02X,0x%02X,0x%02X]\n",
-                    joinedCount, slotToStick[0], slotToStick[1], slotToStick[2], slotToStick[3]);
-      // Show all joined player colors for 1s before starting
-      neoState = NEO_STATUS;
-      audio.stop();
-      joinComplete = true;
-      joinCompleteTime = millis();
-      return;
+      if (decodeStickPower(item, &field, &value)) {
+        // STICK POWER: field in data, value in fineTicks
+        ev.fine = false;
+        ev.fineTicks = value;
+        buildPacket(&ev.pkt, h->dest_id, h->src_id, item.cmd, field);
+        queueRx(ev);
+        continue;
+      }
+      if (decodeTelemetry(item, &field, &value)) {
+        // DISPLAY TELEMETRY: field in data, value in fineTicks
+        ev.fine = false;
+        ev.fineTicks = value;
+        buildPacket(&ev.pkt, h->dest_id, h->src_id, item.cmd, field);
+        queueRx(ev);
+        continue;
+      }
+      ev.fine = item.len >= 4;
+      ev.fineTicks = ev.fine ? item.data32() : RESULT_TICKS_NONE;
+      uint16_t data16 = ev.fine ? resultTicksToMs(ev.fineTicks) : item.data();
+      buildPacket(&ev.pkt, h->dest_id, h->src_id, item.cmd, data16);
+      queueRx(ev);
     }
-
-    // Prompt next slot
-    startPromptSlot(nextSlot);
+    return;
   }
 
-  // If all 4 players joined, show colors for 1s before starting
-  if (joinedCount >= MAX_PLAYERS) {
-    Serial.printf("[JOIN] All %d players joined! Map: [0x%02X,0x%02X,0x%02X,0x%02X]\n",
-                  joinedCount, slotToStick[0], slotToStick[1], slotToStick[2], slotToStick[3]);
-    neoState = NEO_STATUS;
-    audio.stop();
-    joinComplete = true;
-    joinCompleteTime = millis();
+  if (len == (int)RELIABLE_PACKET_SIZE) {
+    ReliablePacket rp;
+    memcpy(&rp, data, sizeof(rp));
+    if (!validateReliablePacket(&rp)) return;
+    ev.pkt = rp.base;
+    ev.sequenced = true;
+    ev.seq = rp.seq;
+    ev.epoch = rp.epoch;
+  } else if (len == (int)sizeof(GamePacket)) {
+    memcpy(&ev.pkt, data, sizeof(ev.pkt));
+    if (!validatePacket(&ev.pkt)) return;
+    ev.sequenced = false;
+    ev.seq = 0;
+    ev.epoch = 0;
+  } else {
+    return;
   }
+  queueRx(ev);
 }
 
-// --- COUNTDOWN ---
-void handleCountdown() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    resetRound();
-    currentRound++;
-
-    // Pick mode from shuffle bag (ensures both modes played before repeat)
-    gameMode = getNextGameMode();
-    if (gameMode == MODE_REACTION) {
-      delayIdx = getRandomIndex(&lastDelayIdx, NUM_REACT_DELAYS);
-      Serial.printf("[COUNTDOWN] Round %d: REACTION, delay=%dms\n",
-                    currentRound, REACT_DELAYS[delayIdx]);
-      sendToDisplayWithRetry(DISP_REACTION_MODE, 0, 0);
-      audio.queueSound(SND_REACTION_MODE);
-      // Only play instruction the first time reaction mode is played this game
-      if (!reactionInstructPlayed) {
-        audio.queueSound(SND_REACTION_INSTRUCT);
-        reactionInstructPlayed = true;
-        reactionFirstInstruct = true;
-        Serial.println("[COUNTDOWN] First reaction mode - playing instruction");
-      } else {
-        reactionFirstInstruct = false;
-      }
-      // NeoPixels: random cycling during reaction mode
-      neoState = NEO_RANDOM_FAST;
+void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
+  uint32_t rxUs = micros();  // sync t2 - take before anything else
+  flightRecorder.frame(FL_RX, data, len, false);
+  if (packetTrace.replaying()) return;  // the trace is the only source during a replay
+  packetTrace.record(mac, data, len, rxUs);
+  receiveFrame(mac, data, len, rxUs);
+}
 
-      // Send mode to joysticks
-      sendToJoysticksWithRetry(CMD_GAME_START, ((uint16_t)gameMode << 8) | 0);
+// Trace peer index (LatencyTrace.h) for a destination MAC, -1 = unknown
+int8_t tracePeerFor(const uint8_t *mac) {
+  if (memcmp(mac, displayMac, 6) == 0) return TRACE_PEER_DISPLAY;
+  if (memcmp(mac, broadcastMac, 6) == 0) return TRACE_PEER_BCAST;
+  return stickPeers.indexForMac(mac);
+}
 
-      // Reaction mode: NO countdown - wait for announcements then random delay
-      Serial.println("[REACTION] Waiting for announcements before random delay");
-      reactionAnnouncementDone = false;
-      gameState = STATE_REACTION;
-      stateStartTime = 0;
-      return;
-    } else {
-      gameMode = MODE_SHAKE;
-      targetIdx = getRandomIndex(&lastTargetIdx, NUM_SHAKE_TARGETS);
-      shakeTargetCount = SHAKE_TARGETS[targetIdx];
-      Serial.printf("[COUNTDOWN] Round %d: SHAKE, target=%d\n",
-                    currentRound, SHAKE_TARGETS[targetIdx]);
-      sendToDisplayWithRetry(DISP_SHAKE_MODE, 0, SHAKE_TARGETS[targetIdx]);
-      audio.queueSound(SND_SHAKE_IT);
-      // Only play instruction the first time shake mode is played this game
-      if (!shakeInstructPlayed) {
-        audio.queueSound(SND_YOU_WILL_SHAKE);
-        shakeInstructPlayed = true;
-        shakeFirstInstruct = true;
-        Serial.println("[COUNTDOWN] First shake mode - playing instruction");
-      } else {
-        shakeFirstInstruct = false;
-      }
-      // Announce target number (plays "Ten", "Fifteen", or "Twenty")
-      audio.playShakeTarget(SHAKE_TARGETS[targetIdx]);
-      // NeoPixels: red blink during countdown for shake mode
-      neoState = NEO_COUNTDOWN;
-
-      // Send mode+param to all joysticks so they know what to do after GO
-      uint16_t param = SHAKE_TARGETS[targetIdx];
-      sendToJoysticksWithRetry(CMD_GAME_START, ((uint16_t)gameMode << 8) | param);
-
-      // Wait for announcements to finish before starting countdown
-      shakeAnnouncementDone = false;
-      countdownNum = 3;
-    }
-  }
+// WiFi task: MAC-layer outcome of every esp_now_send, counted per peer
+void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
+  const int8_t peer = tracePeerFor(mac);
+  latency.onSent(peer, status == ESP_NOW_SEND_SUCCESS);
+  if (status != ESP_NOW_SEND_SUCCESS) flightRecorder.record(FL_TX_FAIL, (uint8_t)peer, 0);
+}
 
-  // Shake mode: wait for announcements before starting countdown
-  if (gameMode == MODE_SHAKE && !shakeAnnouncementDone) {
-    unsigned long shakeAnnounceDelay = shakeFirstInstruct
-        ? SHAKE_ANNOUNCE_DELAY_FIRST
-        : SHAKE_ANNOUNCE_DELAY;
-    if (millis() - stateStartTime > shakeAnnounceDelay) {
-      shakeAnnouncementDone = true;
-      stateStartTime = millis();  // reset for countdown timing
-      // Start countdown 3
-      sendToDisplayWithRetry(DISP_COUNTDOWN, 0, countdownNum);
-      sendToJoysticksWithRetry(CMD_COUNTDOWN, countdownNum);
-      countdownFlashStart = millis();
-      audio.playCountdown(countdownNum);
-      Serial.printf("[COUNTDOWN] %d\n", countdownNum);
-      countdownNum--;
-    }
-    return;  // wait for announcement delay
-  }
+// =============================================================================
+// GAME CORE ADAPTERS
+// =============================================================================
+void HostRadio::broadcast(uint8_t cmd, uint16_t data) { espnowBroadcast(cmd, data); }
+void HostRadio::sendWithRetry(uint8_t destId, uint8_t cmd, uint16_t data) { ::sendWithRetry(destId, cmd, data); }
+void HostRadio::sendGO(uint32_t goUs) { ::sendGO(goUs); }
+bool HostRadio::timedCues(uint8_t stickId) { return supportsTimedCues(stickFw[stickIndex(stickId)]); }
+void HostRadio::displayBatchBegin() { ::displayBatchBegin(); }
+void HostRadio::displayBatchAdd(uint8_t cmd, uint8_t dataHigh, uint8_t dataLow) { ::displayBatchAdd(cmd, dataHigh, dataLow); }
+void HostRadio::displayBatchAddTime(uint8_t cmd, uint32_t ticks) { ::displayBatchAddTime(cmd, ticks); }
+void HostRadio::displayBatchFlush() { ::displayBatchFlush(); }
+void HostRadio::resetLinks() { ackLink.reset(); }
+
+// Events for the renderer (takeRingScenes), queued straight away so it wakes now
+void HostLeds::setMode(NeoMode) {
+  ringScene.modeSeq++;
+  publishRingScene();
+}
 
-  // Tick every 1 second (countdown 2, 1, GO)
-  if (millis() - stateStartTime > 1000) {
-    stateStartTime = millis();
-
-    // Countdown only runs for shake mode (reaction mode skips directly to STATE_REACTION)
-    if (countdownNum > 0) {
-      sendToDisplayWithRetry(DISP_COUNTDOWN, 0, countdownNum);
-      sendToJoysticksWithRetry(CMD_COUNTDOWN, countdownNum);
-      countdownFlashStart = millis();  // trigger NeoPixel flash sync with audio/vibe
-      audio.playCountdown(countdownNum);
-      Serial.printf("[COUNTDOWN] %d\n", countdownNum);
-      countdownNum--;
-    } else {
-      // Countdown done -> fire GO for shake mode
-      sendToDisplayWithRetry(DISP_GO, 0, 0);
-      sendGO(); // hardware sync - joysticks vibrate on hardware GO
-      audio.queueSound(SND_BEEP);
-      Serial.println("[GO] Shake mode started!");
-      gameState = STATE_SHAKE;
-      stateStartTime = 0;
-    }
-  }
+void HostLeds::flash() {
+  ringScene.flashUntilMs = millis() + COUNTDOWN_FLASH_DURATION;
+  publishRingScene();
 }
 
-// --- REACTION (random wait then GO) ---
-// Waits for voice announcements, then random delay, then GO
-void handleReaction() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    // NeoPixels should already be in NEO_RANDOM_FAST
-    // (for reaction mode). If not, set it.
-    if (neoState != NEO_RANDOM_FAST) neoState = NEO_RANDOM_FAST;
-    Serial.println("[REACTION] Waiting for announcements...");
-  }
+// Rings yellow for joined players when GO fires (visual "press now" cue)
+void HostLeds::freeze() {
+  ringScene.freezeSeq++;
+  publishRingScene();
+}
 
-  // Wait for voice announcements to finish before starting random delay
-  if (!reactionAnnouncementDone) {
-    unsigned long announceDelay = reactionFirstInstruct
-        ? REACT_ANNOUNCE_DELAY_FIRST
-        : REACT_ANNOUNCE_DELAY;
-    if (millis() - stateStartTime > announceDelay) {
-      reactionAnnouncementDone = true;
-      stateStartTime = millis();  // reset for random delay timing
-      Serial.printf("[REACTION] Announcements done, random delay=%dms\n", REACT_DELAYS[delayIdx]);
+// =============================================================================
+// SCHEDULER JOBS
+// =============================================================================
+// Hard: state machine, timeline cues (countdown, GO), RX drain and ACK retries - run every frame
+// Soft: audio decode, ring scene to the renderer (without RENDER_USE_TASK the
+//       rings themselves) - skipped for a frame if it is already full
+// Best effort: ambient strip (only without RENDER_USE_TASK)
+#define JOB_BUDGET_RX_US     500
+#define JOB_BUDGET_CUES_US   500
+#define JOB_BUDGET_GAME_US   1000
+#define JOB_BUDGET_RETRY_US  300
+#define JOB_BUDGET_REPLAY_US 300
+#define JOB_PERIOD_ARENA_US  5000
+#define JOB_BUDGET_ARENA_US  300
+#define JOB_BUDGET_BEACON_US 100
+#define JOB_PERIOD_SCAN_US   50000
+#define JOB_BUDGET_SCAN_US   300    // scoring the scan results
+#define JOB_BUDGET_SHAKE_US  200
+#define JOB_PERIOD_STATS_US  500000
+#define JOB_BUDGET_STATS_US  300    // flash writes run long, but only outside timed phases
+#define JOB_PERIOD_HEAP_US   5000000
+#define JOB_BUDGET_HEAP_US   50
+#define JOB_PERIOD_OTA_US    5000   // OTA_CHUNKS_PER_RUN chunks each: ~120 kB/s while idle
+#define JOB_BUDGET_OTA_US    1500   // SPIFFS reads
+#if AUDIO_USE_TASK
+#define JOB_PERIOD_AUDIO_US  100000 // underrun report only - decoding runs in the audio task
+#define JOB_BUDGET_AUDIO_US  100
+#else
+#define JOB_PERIOD_AUDIO_US  0
+#define JOB_BUDGET_AUDIO_US  3000   // one MP3 frame decode
+#endif
+#define JOB_PERIOD_RINGS_US  10000  // ring scene changes reach the renderer within this
+#define JOB_BUDGET_RINGS_US  500
+#define JOB_BUDGET_STRIP_US  1500
+#define JOB_PERIOD_SERIAL_US 50000
+#define JOB_BUDGET_SERIAL_US 500    // a "lat" dump is ~40 log records
+#define JOB_PERIOD_FLIGHT_US 20000  // FLIGHT_DUMP_LINES each: a full ring in ~1.3 s
+#define JOB_BUDGET_FLIGHT_US 200
+
+HostGameState lastJobState = STATE_IDLE;  // for PacketTrace transition timing
+
+// Results as the round ends: one record per active player that has one - a
+// player cut off by a decided round has none (RAM until statsJob flushes)
+void recordRound() {
+  stats.addRound();
+  for (uint8_t i = 0; i < MAX_PLAYERS; i++) {
+    if (!game.recordsResult(i)) continue;
+    stats.addResult(game.gameMode == MODE_REACTION, stickIndex(game.slotToStick[i]), game.currentRound,
+                    game.players[i].resultTicks);
+    if (game.tour.active() && game.gameMode == MODE_REACTION) {
+      stats.addEntrantResult(game.tour.entrantAt(i), game.players[i].resultTicks);
     }
-    return;
   }
+}
 
-  // After random delay, fire GO
-  if (millis() - stateStartTime >= REACT_DELAYS[delayIdx]) {
-    // FREEZE neopixels - this is the visual "press now" cue
-    freezeNeoPixels();
-
-    // Display GO - synced with neopixels and joysticks
-    sendToDisplayWithRetry(DISP_GO, 0, 0);
-
-    // Hardware GO pulse to all joysticks (starts their timer + vibration)
-    sendGO();
-
-    // Audio beep - stop any pending sounds so beep plays immediately
-    audio.stop();
-    audio.queueSound(SND_BEEP);
-
-    Serial.println("[GO] Reaction GO fired! LEDs frozen.");
+void recordGame() {
+  const uint8_t w = game.findFinalWinner();
+  stats.addGame(w == 0xFF ? 0xFF : stickIndex(game.slotToStick[w]), game.currentRound, game.inDeuce);
+}
 
-    // Move to collect
-    gameState = STATE_COLLECT;
-    stateStartTime = 0;
-    collectPlayer = 0;
+void gameJob() {
+  game.step();
+  if (game.state != lastJobState) {
+    packetTrace.onTransition(lastJobState, game.state, micros());
+    flightRecorder.record(FL_STATE, game.state, lastJobState);
+    if (game.state == STATE_SHOW_RESULTS) {
+      arena.roundPlayed();
+      recordRound();
+    }
+    if (game.state == STATE_FINAL_WINNER) recordGame();
+    if (game.state == STATE_FINAL_WINNER) arena.gameOver(millis(), ackLink.totalResends());
+    lastJobState = game.state;
   }
 }
 
-// --- SHAKE (GO already fired, wait for shake results) ---
-void handleShake() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    shakeStartTime = millis();  // for center ring countdown
-    neoState = NEO_SHAKE_COUNTDOWN;  // random player rings + center countdown
-    Serial.println("[SHAKE] Waiting for shake results...");
-  }
+// Arena registration / report hops; the coordinator forwards new standings
+void arenaJob() {
+  arena.run(millis());
+  if (!arena.standingsChanged()) return;
+  BatchWriter w;
+  w.begin(ID_DISPLAY, ID_HOST);
+  arena.takeStandings(w);
+  if (displayFw.major >= BATCH_MIN_MAJOR) ackLink.sendBatch(ID_DISPLAY, w);
+}
 
-  // Timeout after 30s
-  if (millis() - stateStartTime > TIMEOUT_SHAKE) {
-    Serial.println("[SHAKE] Timeout - moving to results");
-    // Mark any unfinished active players as penalty
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-      if (isActivePlayer(i) && !players[i].finished) {
-        players[i].finished = true;
-        players[i].reactionTime = TIME_PENALTY;
-        uint8_t ring = playerToRing(i);
-        ringOverride[ring] = RGB_RED;
-      }
-    }
-    neoState = NEO_STATUS;
-    gameState = STATE_SHOW_RESULTS;
-    stateStartTime = 0;
-    return;
+// Stats to flash only where nothing is timed: between games (or tournament
+// matches), or on the results screen once a long (deuce) game has filled
+// most of the buffer.
+// Then the leaderboard to the display if it changed (LEADERBOARD in Protocol.h).
+void statsJob() {
+  const uint8_t waiting = stats.pending();
+  if (game.state == STATE_IDLE || (game.state == STATE_JOIN && game.tour.seated()) ||
+      (game.state == STATE_SHOW_RESULTS && waiting >= STATS_FLUSH_AT)) {
+    HeapWatchAllow nvsWrites;
+    stats.flush();
   }
+  if (!supportsLeaderboard(displayFw) || arena.hopping() || !stats.takeBoardChanged()) return;
+  BatchWriter w;
+  w.begin(ID_DISPLAY, ID_HOST);
+  stats.addLeaderboard(w);
+  ackLink.sendBatch(ID_DISPLAY, w);
+}
 
-  // Check if all active players finished
-  bool allDone = true;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (isActivePlayer(i) && !players[i].finished) {
-      allDone = false;
-      break;
-    }
-  }
-  if (allDone) {
-    Serial.println("[SHAKE] All players done");
-    neoState = NEO_STATUS;
-    gameState = STATE_SHOW_RESULTS;
-    stateStartTime = 0;
+// Live shake progress to the display (SHAKE STREAM in Protocol.h): one
+// unsequenced batch per period with the players that moved, never resent
+void shakeRelayJob() {
+  if (!supportsShakeStream(displayFw) || arena.hopping()) return;
+  const uint8_t moved = game.shakeTrack.takeDirty();
+  if (!moved) return;
+  BatchWriter w;
+  w.begin(ID_DISPLAY, ID_HOST);
+  for (uint8_t p = 0; p < MAX_PLAYERS; p++) {
+    if (moved & (1 << p)) addShakeProgress(w, p + 1, game.shakeTrack.count(p), game.shakeTrack.target(p));
   }
+  radioSend(displayMac, w.buf, w.seal(0, 0));
 }
 
-// --- COLLECT (reaction mode - wait for all results, with yellow warning) ---
-void handleCollect() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    collectYellowPhase = false;
-    Serial.println("[COLLECT] Waiting for reaction results...");
+// -----------------------------------------------------------------------------
+// Firmware updates (FIRMWARE UPDATE in Protocol.h): between games only,
+// never while the radio is away on an arena hop
+// -----------------------------------------------------------------------------
+bool otaIdle() { return game.state == STATE_IDLE && !arena.hopping() && !channelScanRunning; }
+
+void otaJob() {
+  if (!ota.isLoaded()) {
+    if (!audio.filesReady()) return;   // SPIFFS not mounted yet
+    HeapWatchAllow packageFiles;
+    ota.load();
   }
+  ota.run(otaIdle());
+}
 
-  // Check if all active players have finished (results come in via ESP-NOW callback)
-  bool allDone = true;
-  for (int i = 0; i < MAX_PLAYERS; i++) {
-    if (isActivePlayer(i) && !players[i].finished) {
-      allDone = false;
-      break;
-    }
+// Right behind a beacon: a sleeping stick is awake for it
+void otaOffers() {
+  if (!ota.offersDue(millis(), otaIdle())) return;
+  for (uint8_t i = 0; i < MAX_STICKS; i++) {
+    const uint8_t id = ID_STICK_FIRST + i;
+    if (stickPeers.registered(id)) ota.offer(id, stickPeers.addrFor(id), stickFw[i]);
   }
+  ota.offer(ID_DISPLAY, displayMac, displayFw);
+}
 
-  // Yellow warning phase: players can still react during this time
-  if (collectYellowPhase) {
-    if (allDone || millis() - collectYellowStart > TIMEOUT_REACTION) {
-      // Warning expired or all responded - disqualify any still unfinished
-      for (int i = 0; i < MAX_PLAYERS; i++) {
-        if (isActivePlayer(i) && !players[i].finished) {
-          players[i].finished = true;
-          players[i].reactionTime = TIME_PENALTY;
-          uint8_t ring = playerToRing(i);
-          ringOverride[ring] = RGB_RED;
-          ringBlink[ring] = true;
-        }
-      }
-      neoState = NEO_STATUS;
-      gameState = STATE_SHOW_RESULTS;
-      stateStartTime = 0;
-      collectYellowPhase = false;
-      Serial.println("[COLLECT] Yellow warning done - disqualified remaining");
-    }
+// -----------------------------------------------------------------------------
+// Channel beacon and loss fallback (CHANNEL SELECTION in Protocol.h)
+// -----------------------------------------------------------------------------
+#define CHANNEL_CHECK_US    5000000  // loss window
+#define CHANNEL_LOSS_PCT    30       // resends per send that make us move
+#define CHANNEL_LOSS_MIN    20       // sends in a window before it counts
+
+uint8_t channelMoveTo = 0;           // announcing a move there, 0 = none
+uint8_t channelMoveBeacons = 0;
+uint32_t lossDelivered = 0;          // ackLink totals at the start of the window
+uint32_t lossResends = 0;
+
+// Every BEACON_INTERVAL_MS: where we are, or where we are about to go
+void beaconJob() {
+  if (arena.joining() || arena.hopping() || channelScanRunning) return;
+  if (!channelMoveTo) {
+    espnowBroadcast(CMD_CHANNEL_BEACON, encodeBeacon(arena.channel(), ARENA_ID));
+    otaOffers();
     return;
   }
+  espnowBroadcast(CMD_CHANNEL_BEACON, encodeBeacon(channelMoveTo, ARENA_ID));
+  if (++channelMoveBeacons < BEACON_MOVE_REPEAT) return;
+  LOGI(LOG_NET, "[CHAN] Now on channel %d\n", channelMoveTo);
+  arena.moveHome(channelMoveTo);
+  if (CHANNEL_AUTO) channelScan.keep(channelMoveTo);
+  channelMoveTo = 0;
+}
 
-  if (allDone) {
-    // All responded before timeout (early-press penalties already blink red)
-    neoState = NEO_STATUS;
-    gameState = STATE_SHOW_RESULTS;
-    stateStartTime = 0;
+// Cold boot: scan once the host is up and idle, then move the sticks the
+// way a loss move does. The radio is off channel for the ~1.5 s it takes;
+// sticks keep their last beacon for BEACON_LOST_MS.
+void scanJob() {
+  if (!channelScanPending) return;
+  if (!channelScanRunning) {
+    if (game.state != STATE_IDLE || arena.joining() || arena.hopping() || channelMoveTo) return;
+    if (!channelScan.start()) {
+      LOGW(LOG_NET, "[CHAN] Channel scan failed to start - staying on channel %d\n", arena.channel());
+      channelScanPending = false;
+      return;
+    }
+    channelScanRunning = true;
     return;
   }
-
-  // Timeout after TIMEOUT_REACTION - start yellow warning
-  // Players are NOT marked as finished yet - they can still react!
-  if (millis() - stateStartTime > TIMEOUT_REACTION) {
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-      if (isActivePlayer(i) && !players[i].finished) {
-        uint8_t ring = playerToRing(i);
-        ringOverride[ring] = RGB_YELLOW;
-        ringBlink[ring] = false;  // solid yellow during warning
-        Serial.printf("[COLLECT] Player %d: yellow warning (can still react)\n", i + 1);
-      }
-    }
-    collectYellowPhase = true;
-    collectYellowStart = millis();
-    neoState = NEO_STATUS;
-    Serial.println("[COLLECT] Starting yellow warning phase (5s)");
+  if (!channelScan.poll()) return;
+  channelScanRunning = false;
+  channelScanPending = false;
+  arenaSetChannel(arena.channel());   // the scan leaves the radio on its last channel
+  const uint8_t to = channelScan.best();
+  LOGI(LOG_NET, "[CHAN] Channel scan: %d access points, quietest channel %d\n", channelScan.accessPoints(), to);
+  if (to == arena.channel()) {
+    channelScan.keep(to);
+    return;
   }
+  channelMoveTo = to;
+  channelMoveBeacons = 0;
 }
 
-// --- SHOW RESULTS ---
-static bool resultsPhase2 = false;  // false = showing times, true = showing winner/scores
-
-void handleShowResults() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    resultsPhase2 = false;
-
-    // Phase 1: Send reaction times to display (only active players)
-    const uint8_t timeCmds[] = {DISP_TIME_P1, DISP_TIME_P2, DISP_TIME_P3, DISP_TIME_P4};
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-      if (isActivePlayer(i)) {
-        uint16_t t = players[i].reactionTime;
-        sendToDisplay(timeCmds[i], (t >> 8) & 0xFF, t & 0xFF);
-        delay(10);
-      }
-    }
-    Serial.println("[RESULTS] Phase 1: Showing reaction times");
+// Between games only: a move mid-round would cost the round
+void channelJob() {
+  if (!CHANNEL_AUTO || channelMoveTo || channelScanPending) return;
+  const uint32_t delivered = ackLink.totalDelivered();
+  const uint32_t resends = ackLink.totalResends();
+  if (delivered < lossDelivered || resends < lossResends) {   // "lat reset"
+    lossDelivered = delivered;
+    lossResends = resends;
+    return;
   }
+  const uint32_t d = delivered - lossDelivered;
+  const uint32_t r = resends - lossResends;
+  if (d + r < CHANNEL_LOSS_MIN) return;
+  if (game.state != STATE_IDLE && game.state != STATE_JOIN) return;
+  lossDelivered = delivered;
+  lossResends = resends;
+  if (r * 100 < (d + r) * CHANNEL_LOSS_PCT) return;
+
+  const uint8_t from = arena.channel();
+  channelScan.penalize(from);
+  const uint8_t to = channelScan.best();
+  if (to == from) return;
+  LOGW(LOG_NET, "[CHAN] %lu resends for %lu deliveries on channel %d - moving to %d\n",
+       (unsigned long)r, (unsigned long)d, from, to);
+  channelMoveTo = to;
+  channelMoveBeacons = 0;
+}
 
-  // After 3 seconds, send winner and scores (Phase 2)
-  if (!resultsPhase2 && millis() - stateStartTime > 3000) {
-    resultsPhase2 = true;
-
-    // Find and announce winner
-    uint8_t winner = findRoundWinner();
-    if (winner != 0xFF) {
-      players[winner].score++;
-      sendToDisplayWithRetry(DISP_ROUND_WINNER, 0, winner + 1);
-      audio.playPlayerNumber(winner + 1);
-      audio.queueSound(SND_FASTEST);
-      Serial.printf("[RESULTS] Round %d winner: Player %d\n", currentRound, winner+1);
-    } else {
-      sendToDisplayWithRetry(DISP_ROUND_WINNER, 0, 0); // no winner
-      Serial.println("[RESULTS] No winner this round");
-    }
+void retryJob() { ackLink.update(millis()); }
+void heapJob() { heapWatch.sample(); }
+void replayJob() { packetTrace.run(micros(), rxDropped); }
+void flightJob() { flightRecorder.dumpJob(); }
 
-    // Send scores
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-      if (players[i].joined) {
-        sendToDisplay(DISP_SCORES, i + 1, players[i].score);
-      }
+// =============================================================================
+// SERIAL COMMANDS (one per line)
+//   lat              GO round-trip histograms, MAC send counts, per-peer link stats
+//   lat reset        clear them
+//   peers            registered joysticks and how they are reached
+//   arenas           this table's arena and the standings it knows
+//   channels         boot scan scores per channel
+//   power            last battery / sleep report of every stick
+//   stats            session and all-time stats, leaderboard, per-stick averages
+//   stats clear      erase them (between games only)
+//   tour N           tournament of N entrants from the next join (Tournament.h, between games)
+//   tour             standings;  tour stop ends it
+//   collect [P]      when a reaction round ends: full, decided, adaptive (CollectPolicy.h)
+//   heap             free heap, largest block and their lows (HeapWatch.h)
+//   cpu              per-task CPU use and stack headroom since the last `cpu` (TaskLoad.h)
+//   boot             setup() stage times and the reset reason (BootProfile.h)
+//   ota              update packages loaded and each device's progress (OtaServer.h)
+//   flight           the flight recorder ring, oldest first (FlightRecorder.h)
+//   flight prev      what it held when this boot started: the run up to the reset
+//   trace rec        record received frames (PacketTrace.h); trace stop ends it
+//   trace play N     replay the recording at N x speed (1, 10, 100), from IDLE
+//   trace save/load  keep the recording in SPIFFS
+// =============================================================================
+char serialLine[32];
+uint8_t serialLen = 0;
+
+void runSerialCommand(const char *line) {
+  if (strcmp(line, "lat") == 0) {
+    latency.dump();
+    ackLink.logStats();
+  } else if (strcmp(line, "lat reset") == 0) {
+    latency.reset();
+    ackLink.resetStats();
+    LOGI(LOG_LAT, "[LAT] Stats cleared\n");
+  } else if (strcmp(line, "peers") == 0) {
+    stickPeers.dump();
+  } else if (strcmp(line, "arenas") == 0) {
+    arena.dump();
+  } else if (strcmp(line, "channels") == 0) {
+    channelScan.dump();
+  } else if (strcmp(line, "rings") == 0) {
+    rings.dump();
+  } else if (strcmp(line, "stats") == 0) {
+    stats.dump();
+  } else if (strcmp(line, "stats clear") == 0) {
+    if (game.state == STATE_IDLE) stats.clear();
+    else LOGW(LOG_GAME, "[STATS] Not during a game\n");
+  } else if (strcmp(line, "tour") == 0) {
+    game.tour.dump();
+  } else if (strcmp(line, "tour stop") == 0) {
+    game.stopTournament();
+  } else if (strncmp(line, "tour ", 5) == 0) {
+    const int n = atoi(line + 5);
+    if (n < 2 || n > TOUR_MAX_ENTRANTS) {
+      LOGW(LOG_GAME, "[TOUR] 2 to %d entrants\n", TOUR_MAX_ENTRANTS);
+    } else if (!game.startTournament((uint8_t)n, stats.entrantBests())) {
+      LOGW(LOG_GAME, "[TOUR] Not during a game\n");
     }
-
-    Serial.println("[RESULTS] Phase 2: Showing winner and scores");
-    for (int i = 0; i < MAX_PLAYERS; i++) {
-      if (players[i].joined)
-        Serial.printf("  Player %d: score=%d, time=%d ms\n", i+1, players[i].score, players[i].reactionTime);
+  } else if (strncmp(line, "collect", 7) == 0 && (line[7] == '\0' || line[7] == ' ')) {
+    if (line[7]) {
+      uint8_t p = 0;
+      while (p < COLLECT_POLICY_COUNT && strcmp(line + 8, COLLECT_POLICY_NAMES[p]) != 0) p++;
+      if (p < COLLECT_POLICY_COUNT) game.collectPolicy = (CollectPolicy)p;
+      else LOGW(LOG_GAME, "[COLLECT] full, decided or adaptive\n");
     }
-  }
-
-  // After 6 seconds total (3s times + 3s scores), transition to next state
-  if (millis() - stateStartTime > 6000) {
-    // Track consecutive all-timeout rounds; reset to join after 2 in a row
-    if (findRoundWinner() == 0xFF) {
-      consecutiveTimeouts++;
-      Serial.printf("[RESULTS] All players timed out (%d consecutive)\n", consecutiveTimeouts);
-      if (consecutiveTimeouts >= 2) {
-        Serial.println("[RESULTS] 2 consecutive timeouts - returning to join phase");
-        sendToJoysticksWithRetry(CMD_IDLE, 0);
-        sendToDisplayWithRetry(DISP_IDLE, 0, 0);
-        gameState = STATE_IDLE;
-        stateStartTime = 0;
-        resultsPhase2 = false;
-        return;
-      }
-    } else {
-      consecutiveTimeouts = 0;
+    LOGI(LOG_GAME, "[COLLECT] Policy: %s\n", COLLECT_POLICY_NAMES[game.collectPolicy]);
+  } else if (strcmp(line, "cpu") == 0) {
+    taskLoad.report();
+    if (ringSceneDrops) LOGW(LOG_SCHED, "[CPU] %lu ring scenes dropped (renderer behind)\n", (unsigned long)ringSceneDrops);
+  } else if (strcmp(line, "boot") == 0) {
+    bootProfile.report();
+  } else if (strcmp(line, "ota") == 0) {
+    ota.dump();
+  } else if (strcmp(line, "flight") == 0) {
+    flightRecorder.startDump(false);
+  } else if (strcmp(line, "flight prev") == 0) {
+    flightRecorder.startDump(true);
+  } else if (strcmp(line, "heap") == 0) {
+    heapWatch.sample();
+    heapWatch.dump();
+  } else if (strcmp(line, "power") == 0) {
+    for (uint8_t i = 0; i < MAX_STICKS; i++) {
+      if (stickPowerValid[i]) logStickPower(i);
     }
-
-    if (inDeuce) {
-      // Check if either deuce player has enough lead
-      int diff = abs((int)players[deucePlayer[0]].score - (int)players[deucePlayer[1]].score);
-      if (diff >= DEUCE_LEAD) {
-        Serial.printf("[DEUCE] Lead of %d reached - going to final winner\n", diff);
-        gameState = STATE_FINAL_WINNER;
-      } else {
-        Serial.printf("[DEUCE] Score diff=%d, need %d - continuing\n", diff, DEUCE_LEAD);
-        gameState = STATE_COUNTDOWN;
-      }
-    } else if (currentRound >= TOTAL_ROUNDS) {
-      if (checkDeuce()) {
-        // Deuce detected — enter deuce mode
-        inDeuce = true;
-        Serial.printf("[DEUCE] Deuce between Player %d and Player %d!\n",
-                      deucePlayer[0] + 1, deucePlayer[1] + 1);
-        sendToDisplayWithRetry(DISP_DEUCE, deucePlayer[0] + 1, deucePlayer[1] + 1);
-        // Send CMD_IDLE to non-deuce joysticks
-        for (int i = 0; i < MAX_PLAYERS; i++) {
-          if (players[i].joined && slotToStick[i] != 0xFF &&
-              i != deucePlayer[0] && i != deucePlayer[1]) {
-            sendWithRetry(slotToStick[i], CMD_IDLE, 0);
-            Serial.printf("[DEUCE] Sent CMD_IDLE to Player %d (out of deuce)\n", i + 1);
-          }
-        }
-        gameState = STATE_COUNTDOWN;
-      } else {
-        gameState = STATE_FINAL_WINNER;
-      }
+  } else if (strcmp(line, "trace rec") == 0) {
+    game.restartIdle();   // from IDLE, the recording starts where a replay will
+    packetTrace.startRecording(micros());
+  } else if (strcmp(line, "trace stop") == 0) {
+    packetTrace.stopRecording();
+    packetTrace.abortReplay(micros(), rxDropped);
+  } else if (strncmp(line, "trace play", 10) == 0) {
+    // Only between games: a replay mutes every send and would end a live round
+    int speed = atoi(line + 10);
+    if (game.state != STATE_IDLE) {
+      LOGW(LOG_LAT, "[TRACE] Replays start in IDLE only\n");
+    } else if (packetTrace.startReplay(speed > 0 ? speed : 1, receiveFrame, micros(), rxDropped)) {
+      game.restartIdle();
     } else {
-      gameState = STATE_COUNTDOWN;
+      LOGW(LOG_LAT, "[TRACE] Nothing to replay (or busy)\n");
     }
-    stateStartTime = 0;
-    resultsPhase2 = false;
+  } else if (strcmp(line, "trace save") == 0) {
+    saveTrace(packetTrace);
+  } else if (strcmp(line, "trace load") == 0) {
+    loadTrace(packetTrace);
+  } else if (line[0]) {
+    LOGW(LOG_LAT, "[CMD] Unknown serial command (try: lat, lat reset, peers, arenas, channels, rings, power, stats [clear], tour [N|stop], collect [P], heap, cpu, boot, ota, flight [prev], trace rec|stop|play N|save|load)\n");
   }
 }
 
-// --- FINAL WINNER ---
-void handleFinalWinner() {
-  if (stateStartTime == 0) {
-    stateStartTime = millis();
-    uint8_t winner = findFinalWinner();
-    neoState = NEO_IDLE_RAINBOW;
-    neoOffset = 0;
-
-    if (winner != 0xFF) {
-      Serial.printf("[FINAL] Winner: Player %d\n", winner + 1);
-      sendToDisplayWithRetry(DISP_FINAL_WINNER, 0, winner + 1);
-      // Play winner announcement first, then victory music, then game over
-      audio.playPlayerWins(winner + 1);
-      audio.queueSound(SND_VICTORY_FANFARE);
-    } else {
-      Serial.println("[FINAL] No winner (all scores 0)");
-      sendToDisplayWithRetry(DISP_FINAL_WINNER, 0, 0);
+void serialJob() {
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r' || c == '\n') {
+      serialLine[serialLen] = '\0';
+      HeapWatchAllow operatorCommand;
+      runSerialCommand(serialLine);
+      serialLen = 0;
+    } else if (serialLen < sizeof(serialLine) - 1) {
+      serialLine[serialLen++] = c;
     }
-    audio.queueSound(SND_GAME_OVER);
   }
+}
+void cueJob() { game.runCues(micros()); }
+void audioJob() { audio.update(); }
+
+void ringsJob() {
+  publishRingScene();
+#if !RENDER_USE_TASK
+  renderRings();
+#endif
+}
 
-  if (millis() - stateStartTime > DURATION_FINAL) {
-    gameState = STATE_IDLE;
-    stateStartTime = 0;
-  }
+void setupScheduler() {
+  scheduler.add("rx",    processRxQueue, JOB_HARD, 0,    JOB_BUDGET_RX_US);
+  scheduler.add("cues",  cueJob,         JOB_HARD, 0,    JOB_BUDGET_CUES_US);
+  scheduler.add("game",  gameJob,        JOB_HARD, 0,    JOB_BUDGET_GAME_US);
+  scheduler.add("retry", retryJob,       JOB_HARD, 1000, JOB_BUDGET_RETRY_US);
+  scheduler.add("replay", replayJob,     JOB_HARD, 0,    JOB_BUDGET_REPLAY_US);
+  scheduler.add("arena", arenaJob,       JOB_SOFT, JOB_PERIOD_ARENA_US, JOB_BUDGET_ARENA_US);
+  scheduler.add("beacon", beaconJob,     JOB_SOFT, BEACON_INTERVAL_MS * 1000UL, JOB_BUDGET_BEACON_US);
+  scheduler.add("shake", shakeRelayJob,  JOB_SOFT, SHAKE_RELAY_MS * 1000UL, JOB_BUDGET_SHAKE_US);
+  scheduler.add("chan",  channelJob,     JOB_BEST_EFFORT, CHANNEL_CHECK_US, JOB_BUDGET_BEACON_US);
+  scheduler.add("scan",  scanJob,        JOB_BEST_EFFORT, JOB_PERIOD_SCAN_US, JOB_BUDGET_SCAN_US);
+  scheduler.add("stats", statsJob,       JOB_BEST_EFFORT, JOB_PERIOD_STATS_US, JOB_BUDGET_STATS_US);
+  scheduler.add("heap",  heapJob,        JOB_BEST_EFFORT, JOB_PERIOD_HEAP_US, JOB_BUDGET_HEAP_US);
+  scheduler.add("ota",   otaJob,         JOB_BEST_EFFORT, JOB_PERIOD_OTA_US, JOB_BUDGET_OTA_US);
+  scheduler.add("audio", audioJob,       JOB_SOFT, JOB_PERIOD_AUDIO_US, JOB_BUDGET_AUDIO_US);
+  ringJob = scheduler.add("rings", ringsJob, JOB_SOFT, JOB_PERIOD_RINGS_US, JOB_BUDGET_RINGS_US);
+#if !RENDER_USE_TASK
+  scheduler.add("strip", updateStrip, JOB_BEST_EFFORT, STRIP_FRAME_US, JOB_BUDGET_STRIP_US);
+#endif
+  scheduler.add("serial", serialJob, JOB_BEST_EFFORT, JOB_PERIOD_SERIAL_US, JOB_BUDGET_SERIAL_US);
+  scheduler.add("flight", flightJob, JOB_BEST_EFFORT, JOB_PERIOD_FLIGHT_US, JOB_BUDGET_FLIGHT_US);
 }
 
 // =============================================================================
@@ -1499,30 +1463,32 @@ void setup() {
   Serial.println("       REACTION TIME DUEL - HOST");
   Serial.printf("            Firmware %s\n", FW_VERSION_STRING);
   Serial.println("========================================");
-
-  // Game rings (NeoPixelBus RMT ch0 — non-blocking)
-  pixels.Begin();
-  pixels.SetBrightness(NEO_BRIGHTNESS);
-  pixels.Show();
-
-  // WS2812B ambient strip (89 LEDs) — NeoPixelBus with RMT DMA (non-blocking)
-  strip.Begin();
-  strip.SetBrightness(STRIP_BRIGHTNESS);
-  strip.Show();
-  stripAnimStart = millis();
-  Serial.println("WS2812B strip ready (89 LEDs on GPIO16, NeoPixelBus RMT DMA)");
-
-  // Audio
-  if (audio.begin()) {
-    Serial.println("Audio ready");
-  } else {
-    Serial.println("Audio init failed - continuing without audio");
+  bootProfile.begin();
+  flightRecorder.begin(bootProfile.warm(), esp_reset_reason());
+  if (flightRecorder.keptCount()) {
+    Serial.printf("Flight recorder: %u events from before the reset (`flight prev`)\n", flightRecorder.keptCount());
   }
 
-  // ESP-NOW
+  // Runtime logging goes through the async ring from here on
+  asyncLog.begin();
+  bootProfile.mark("log");
+
+  // ESP-NOW first: sticks are heard (and queued for the rx job) while the rest comes up
   WiFi.mode(WIFI_STA);
   WiFi.disconnect();
-  esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+  uint8_t channel = ARENA_COORDINATOR ? ARENA_CONTROL_CHANNEL : arenaChannel(ARENA_ID);
+  if (CHANNEL_AUTO) {
+    // Warm boot (brownout, panic, watchdog): back on the channel the sticks are on, no scan.
+    // Cold boot: up on the default channel now, scanJob() scans once we are idle.
+    if (bootProfile.warm() && channelScan.restore(channel)) {
+      Serial.printf("Warm boot: channel %d kept, scan skipped\n", channel);
+    } else {
+      channelScanPending = true;
+      Serial.printf("Cold boot: channel %d until the channel scan\n", channel);
+    }
+    channelScan.keep(channel);
+  }
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
 
   if (esp_now_init() != ESP_OK) {
     Serial.println("ESP-NOW init failed!");
@@ -1535,7 +1501,7 @@ void setup() {
   auto addPeer = [](uint8_t* mac, const char* name) {
     esp_now_peer_info_t p = {};
     memcpy(p.peer_addr, mac, 6);
-    p.channel = ESPNOW_CHANNEL;
+    p.channel = 0;  // current channel, so an arena move takes the peers along
     p.encrypt = false;
     p.ifidx = WIFI_IF_STA;
     if (esp_now_add_peer(&p) == ESP_OK) {
@@ -1547,20 +1513,74 @@ void setup() {
 
   addPeer(broadcastMac, "Broadcast");
   addPeer(displayMac, "Display");
-  addPeer(stick1Mac, "Joystick 1");
-  addPeer(stick2Mac, "Joystick 2");
-  // Only add stick3/4 if MACs are filled (non-zero)
-  if (stick3Mac[0] || stick3Mac[1] || stick3Mac[2])
-    addPeer(stick3Mac, "Joystick 3");
-  if (stick4Mac[0] || stick4Mac[1] || stick4Mac[2])
-    addPeer(stick4Mac, "Joystick 4");
+  // Joysticks are added as they are heard from (handlePacket)
+
+  // Reliable delivery: fresh epoch per boot so receivers reset their windows
+  ackLink.begin(esp_random() & 0xFF, linkSend);
+  ackLink.addPeer(ID_DISPLAY, displayMac);
+  ota.begin(radioSend);
 
   Serial.print("Host MAC: ");
   Serial.println(WiFi.macAddress());
+  arena.start(ARENA_ID, ARENA_COORDINATOR, channel, arenaSetChannel, arenaSend, millis());
+  bootProfile.mark("espnow");
+
+  // Game rings (NeoPixelBus RMT ch0 — non-blocking)
+  pixels.Begin();
+  pixels.SetBrightness(NEO_BRIGHTNESS);
+  ringFx.begin();
+  rings.begin();
+  pixels.Show();
+
+  // WS2812B ambient strip (89 LEDs) — NeoPixelBus with RMT DMA (non-blocking)
+  strip.Begin();
+  strip.SetBrightness(STRIP_BRIGHTNESS);
+  stripFx.begin();
+  strip.Show();
+  stripEngine.begin(micros());
+  Serial.println("WS2812B strip ready (89 LEDs on GPIO16, NeoPixelBus RMT DMA)");
+
+#if RENDER_USE_TASK
+  // Rings and strip from here on belong to the render task
+  if (xTaskCreatePinnedToCore(renderTaskEntry, "render", RENDER_TASK_STACK, nullptr,
+                              RENDER_TASK_PRIORITY, &renderTask, RENDER_TASK_CORE) != pdPASS) {
+    Serial.println("Render task start failed - rings and strip stay dark");
+  } else {
+    Serial.printf("Render task on core %d\n", RENDER_TASK_CORE);
+  }
+#endif
+  bootProfile.mark("leds");
+
+  // Audio (the task mounts SPIFFS and reads the clips in the background)
+  if (audio.begin()) {
+    Serial.println("Audio ready");
+  } else {
+    Serial.println("Audio init failed - continuing without audio");
+  }
+  bootProfile.mark("audio");
+
+  // All-time stats: summary and open log chunk from NVS
+  stats.begin();
+  bootProfile.mark("stats");
 
   // Random seed
   randomSeed(analogRead(36));
 
+  setupScheduler();
+
+  // loop() is the game task: above anything unpinned that could land on its core
+  gameTask = xTaskGetCurrentTaskHandle();
+  vTaskPrioritySet(nullptr, GAME_TASK_PRIORITY);
+  Serial.printf("Game task on core %d, priority %d\n", xPortGetCoreID(), GAME_TASK_PRIORITY);
+  taskLoad.add("game", xTaskGetCurrentTaskHandle(), xPortGetCoreID(), scheduler.meter());
+  taskLoad.add("render", renderTask, RENDER_TASK_CORE, &renderMeter);
+  taskLoad.add("audio", audio.taskHandle(), AUDIO_TASK_CORE, audio.meter());
+
+  // Everything is allocated by now: from here on loop() shouldn't touch the heap
+  heapWatch.arm();
+  bootProfile.mark("ready");
+  bootProfile.report();
+
   // Players join dynamically via CMD_REQ_ID during JOIN phase
   Serial.println("Host ready! Waiting for players to join...");
 }
@@ -1569,20 +1589,17 @@ void setup() {
 // LOOP
 // =============================================================================
 void loop() {
-  audio.update();
-  updateNeoPixels();
-  updateStrip();
-  updateRetries();
-
-  switch (gameState) {
-    case STATE_IDLE:            handleIdle();           break;
-    case STATE_JOIN:            handleJoin();           break;
-    case STATE_COUNTDOWN:       handleCountdown();      break;
-    case STATE_REACTION:        handleReaction();       break;
-    case STATE_SHAKE:           handleShake();          break;
-    case STATE_COLLECT:         handleCollect();        break;
-    case STATE_SHOW_RESULTS:    handleShowResults();    break;
-    case STATE_FINAL_WINNER:    handleFinalWinner();    break;
+  scheduler.run();
+
+  // Sleep until the next periodic job (whole ticks, rounded up: a job may run
+  // up to a tick late) or a received frame. A cue is never slept past: the
+  // last part of a tick before it is spun, so GO keeps its microseconds.
+  TickType_t ticks = (scheduler.usUntilDue() + GAME_TICK_US - 1) / GAME_TICK_US;
+  uint32_t cueUs;
+  if (ticks && game.nextCueUs(&cueUs)) {
+    const int32_t toCue = (int32_t)(cueUs - micros());
+    const TickType_t cueTicks = toCue > 0 ? toCue / GAME_TICK_US : 0;
+    if (cueTicks < ticks) ticks = cueTicks;
   }
-  // No delay - ESP32 handles WiFi/system tasks automatically via FreeRTOS
+  if (ticks) ulTaskNotifyTake(pdTRUE, ticks);
 }
@@ -0,0 +1,164 @@
+/*
+ * ButtonCapture.h - Button edges timed on the CPU cycle counter
+ * ESP8266 Joystick only
+ *
+ * The button interrupt fires on both edges and stays armed in every state:
+ * each press and release is stamped with the CPU cycle counter (12.5 ns at
+ * 80 MHz), extended to 64 bits so it never wraps, and confirmed edges are
+ * queued in a small ring for loop() to take. The game decides what an edge
+ * means (join, early press, reaction) from the time it happened, not from
+ * when loop() got to it.
+ *
+ * Glitch filter: the first edge to the other level is a candidate and
+ * keeps its own time; edges in the BUTTON_GLITCH_US after it are bounce on
+ * the slow, capacitor-filtered edge. If the pin is still at the new level
+ * when that window ends the change is confirmed at the candidate's time,
+ * otherwise the pulse is dropped (motor noise, a knock). A press is timed
+ * at its leading edge and reported BUTTON_GLITCH_US later.
+ *
+ * The 32-bit counter wraps every 53 s at 80 MHz (27 s at 160); poll() runs
+ * every loop() pass, far more often. Nothing is timed across light sleep:
+ * the counter doesn't run there and the wake pin takes over the GPIO
+ * interrupt, so resume() after a sleep re-arms it and takes the level as
+ * it finds it. Cycles and micros() run off the same crystal.
+ */
+
+#ifndef BUTTONCAPTURE_H
+#define BUTTONCAPTURE_H
+
+#include <Arduino.h>
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define BUTTON_GLITCH_US    5000    // shorter pulses are bounce or noise
+#define BUTTON_RING         8       // confirmed edges waiting for loop() (power of 2)
+
+struct ButtonEdge {
+  uint64_t at;          // cycles, ButtonCapture::now() timebase
+  bool pressed;
+};
+
+class ButtonCapture {
+public:
+  // Pin already configured (INPUT_PULLUP, active LOW); isr calls onEdge()
+  void begin(uint8_t buttonPin, void (*buttonIsr)()) {
+    pin = buttonPin;
+    isr = buttonIsr;
+    cyclesPerUs = ESP.getCpuFreqMHz();
+    glitchCycles = (uint32_t)BUTTON_GLITCH_US * cyclesPerUs;
+    isPressed = false;
+    resume();
+  }
+
+  // After light sleep: re-arm and take the level as found (a wake press
+  // still passes the glitch window)
+  void resume() {
+    attachInterrupt(digitalPinToInterrupt(pin), isr, CHANGE);
+    const uint32_t ps = xt_rsil(15);
+    const uint64_t t = stamp();
+    rawLow = digitalRead(pin) == LOW;
+    candidate = rawLow != isPressed;
+    candidateAt = t;
+    xt_wsr_ps(ps);
+  }
+
+  // From the button interrupt (CHANGE)
+  void IRAM_ATTR onEdge() {
+    const uint64_t t = stamp();
+    settle(t);
+    rawLow = digitalRead(pin) == LOW;
+    if (!candidate && rawLow != isPressed) {
+      candidate = true;
+      candidateAt = t;
+    }
+  }
+
+  // Every loop() pass: decides a finished window, keeps the counter extended
+  void poll() {
+    const uint32_t ps = xt_rsil(15);
+    settle(stamp());
+    xt_wsr_ps(ps);
+  }
+
+  // Oldest confirmed edge not yet taken
+  bool next(ButtonEdge &e) {
+    const uint32_t ps = xt_rsil(15);
+    const bool any = tail != head;
+    if (any) {
+      e = ring[tail];
+      tail = (tail + 1) & (BUTTON_RING - 1);
+    }
+    xt_wsr_ps(ps);
+    return any;
+  }
+
+  uint64_t now() {
+    const uint32_t ps = xt_rsil(15);
+    const uint64_t t = stamp();
+    xt_wsr_ps(ps);
+    return t;
+  }
+
+  // Confirmed state, and when it last changed
+  bool pressed() const { return isPressed; }
+  uint64_t changedAt() {
+    const uint32_t ps = xt_rsil(15);
+    const uint64_t t = lastChange;
+    xt_wsr_ps(ps);
+    return t;
+  }
+
+  // Pin level the last edge left, bounce included (the flight recorder's)
+  bool IRAM_ATTR rawLevelLow() const { return rawLow; }
+
+  // Released with no change pending (safe to sleep)
+  bool idle() const { return !isPressed && !candidate; }
+
+  uint64_t toUs(uint64_t cycles) const { return cycles / cyclesPerUs; }
+  uint64_t fromUs(uint32_t us) const { return (uint64_t)us * cyclesPerUs; }
+
+private:
+  // Interrupts off (or in the ISR)
+  uint64_t IRAM_ATTR stamp() {
+    const uint32_t c = ESP.getCycleCount();
+    if (c < lastCycles) wraps++;
+    lastCycles = c;
+    return ((uint64_t)wraps << 32) | c;
+  }
+
+  // A window that has run out is decided on the level it ended at: the
+  // level since the last edge, as an edge after it would have settled it
+  void IRAM_ATTR settle(uint64_t t) {
+    if (!candidate || t - candidateAt < glitchCycles) return;
+    candidate = false;
+    if (rawLow == isPressed) return;
+    isPressed = rawLow;
+    lastChange = candidateAt;
+    const uint8_t h = (head + 1) & (BUTTON_RING - 1);
+    if (h == tail) return;  // loop() stalled: state stays right, the edge is lost
+    ring[head].at = candidateAt;
+    ring[head].pressed = rawLow;
+    head = h;
+  }
+
+  uint8_t pin = 0;
+  void (*isr)() = nullptr;
+  uint32_t cyclesPerUs = 80;
+  uint32_t glitchCycles = 0;
+
+  uint32_t lastCycles = 0;
+  uint32_t wraps = 0;
+
+  volatile bool rawLow = false;
+  volatile bool isPressed = false;
+  volatile bool candidate = false;
+  uint64_t candidateAt = 0;
+  uint64_t lastChange = 0;
+
+  ButtonEdge ring[BUTTON_RING];
+  volatile uint8_t head = 0;
+  volatile uint8_t tail = 0;
+};
+
+#endif // BUTTONCAPTURE_H
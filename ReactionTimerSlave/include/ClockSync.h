@@ -0,0 +1,160 @@
+/*
+ * ClockSync.h - Host clock estimation for the joystick
+ * ESP8266 Joystick only
+ *
+ * The stick pings the host with CMD_SYNC_REQ and the host answers with its
+ * receive/send timestamps (see CLOCK SYNC in Protocol.h). Of the last
+ * SYNC_WINDOW samples the one with the smallest RTT is trusted (least
+ * queueing delay = least asymmetry), and drift is tracked between
+ * best samples a few seconds apart so the estimate stays valid between pings.
+ */
+
+#ifndef CLOCKSYNC_H
+#define CLOCKSYNC_H
+
+#include <Arduino.h>
+#include "Protocol.h"
+
+// =============================================================================
+// SYNC CONFIGURATION
+// =============================================================================
+#define SYNC_INTERVAL_FAST      100       // ms between pings until converged
+#define SYNC_INTERVAL_SLOW      1000      // ms between pings once converged
+#define SYNC_WINDOW             8         // samples kept for min-RTT selection
+#define SYNC_MIN_SAMPLES        4         // samples needed before synced() is true
+#define SYNC_MAX_RTT_US         20000     // discard samples slower than this
+#define SYNC_STALE_MS           5000      // no good sample for this long = unsynced
+#define SYNC_DRIFT_SPAN_US      4000000   // min spacing between drift anchor samples
+#define SYNC_MAX_DRIFT_PPB      200000    // ignore drift estimates beyond 200 ppm
+
+class ClockSync {
+public:
+  void reset() {
+    count = 0;
+    head = 0;
+    seq = 0;
+    pendingT1 = 0;
+    pendingValid = false;
+    bestValid = false;
+    anchorValid = false;
+    driftPpb = 0;
+    lastGoodMs = 0;
+    lastSendMs = 0;
+  }
+
+  // True when it's time to send another ping
+  bool due(unsigned long nowMs) const {
+    unsigned long interval = synced(nowMs) ? SYNC_INTERVAL_SLOW : SYNC_INTERVAL_FAST;
+    return nowMs - lastSendMs >= interval;
+  }
+
+  // Fill a CMD_SYNC_REQ stamped with t1 = now; send it immediately
+  void buildRequest(SyncPacket* pkt, uint8_t src, unsigned long nowMs) {
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->dest_id = ID_HOST;
+    pkt->src_id = src;
+    pkt->cmd = CMD_SYNC_REQ;
+    pkt->seq = ++seq;
+    pkt->rtt_us = bestValid ? best.rtt : 0xFFFF;
+    pkt->offset_us = bestValid ? best.offset : 0;
+    pkt->t1 = micros();
+    sealSyncPacket(pkt);
+    pendingT1 = pkt->t1;
+    pendingValid = true;
+    lastSendMs = nowMs;
+  }
+
+  // Feed a CMD_SYNC_RESP with t4 = local receive time. Returns true if accepted.
+  bool handleResponse(const SyncPacket* pkt, uint32_t t4, unsigned long nowMs) {
+    if (!pendingValid || pkt->seq != seq || pkt->t1 != pendingT1) return false;
+    pendingValid = false;
+
+    int32_t total = (int32_t)(t4 - pkt->t1);
+    int32_t hostHold = (int32_t)(pkt->t3 - pkt->t2);
+    int32_t rtt = total - hostHold;
+    if (total < 0 || hostHold < 0 || rtt < 0 || rtt > SYNC_MAX_RTT_US) return false;
+
+    Sample &s = samples[head];
+    s.local = t4;
+    s.rtt = (uint16_t)rtt;
+    s.offset = (int32_t)(((int64_t)(int32_t)(pkt->t2 - pkt->t1) +
+                          (int64_t)(int32_t)(pkt->t3 - t4)) / 2);
+    head = (head + 1) % SYNC_WINDOW;
+    if (count < SYNC_WINDOW) count++;
+
+    selectBest();
+    updateDrift();
+    lastGoodMs = nowMs;
+    return true;
+  }
+
+  bool synced(unsigned long nowMs) const {
+    return bestValid && count >= SYNC_MIN_SAMPLES && (nowMs - lastGoodMs) < SYNC_STALE_MS;
+  }
+
+  // Estimated (host - local) offset at the given local time, drift-corrected
+  int32_t offsetAt(uint32_t localUs) const {
+    if (!bestValid) return 0;
+    int32_t since = (int32_t)(localUs - best.local);
+    return best.offset + (int32_t)((int64_t)driftPpb * since / 1000000000LL);
+  }
+
+  uint32_t localToHost(uint32_t localUs) const {
+    return localUs + offsetAt(localUs);
+  }
+
+  uint16_t rttUs() const { return bestValid ? best.rtt : 0xFFFF; }
+  int32_t drift() const { return driftPpb; }
+
+private:
+  struct Sample {
+    uint32_t local;   // t4 of this sample
+    int32_t offset;   // host - local
+    uint16_t rtt;
+  };
+
+  // Pick the minimum-RTT sample in the window (offsetAt() projects it forward by drift)
+  void selectBest() {
+    uint8_t bestIdx = 0;
+    for (uint8_t i = 1; i < count; i++) {
+      if (samples[i].rtt < samples[bestIdx].rtt) bestIdx = i;
+    }
+    best = samples[bestIdx];
+    bestValid = true;
+  }
+
+  void updateDrift() {
+    if (!anchorValid) {
+      anchor = best;
+      anchorValid = true;
+      return;
+    }
+    int32_t span = (int32_t)(best.local - anchor.local);
+    if (span < SYNC_DRIFT_SPAN_US) return;
+
+    int64_t raw = (int64_t)(best.offset - anchor.offset) * 1000000000LL / span;
+    if (raw > SYNC_MAX_DRIFT_PPB || raw < -SYNC_MAX_DRIFT_PPB) {
+      anchor = best;  // outlier (host reboot, clock step) - start over
+      return;
+    }
+    // First estimate taken as-is, then EMA (alpha = 1/4)
+    driftPpb = (driftPpb == 0) ? (int32_t)raw : (int32_t)((3LL * driftPpb + raw) / 4);
+    anchor = best;
+  }
+
+  Sample samples[SYNC_WINDOW];
+  uint8_t count = 0;
+  uint8_t head = 0;
+  uint8_t seq = 0;
+  uint32_t pendingT1 = 0;
+  bool pendingValid = false;
+  Sample best;
+  bool bestValid = false;
+  Sample anchor;
+  bool anchorValid = false;
+  int32_t driftPpb = 0;
+  unsigned long lastGoodMs = 0;
+  unsigned long lastSendMs = 0;
+};
+
+#endif // CLOCKSYNC_H
@@ -0,0 +1,125 @@
+/*
+ * FlightRecorder.h - Always-on event ring in RTC user memory (FlightLog.h)
+ * ESP8266 Joystick only
+ *
+ * record() is a micros() and three word stores with interrupts masked, so
+ * the button interrupt, the ESP-NOW callbacks and loop() all record into
+ * the same ring: joystick state changes, every frame handed to the radio
+ * and every one the receive callback sees, MAC failures to the host,
+ * result resends and give-ups, button edges.
+ *
+ * The ring lives in the 512-byte RTC user memory, which every reset but
+ * power-on leaves alone (watchdog, exception, ESP.restart(), the reset
+ * pin, deep sleep). eboot keeps its update command in the first 128 bytes
+ * (OtaClient.h stages images through it), so the ring takes the rest:
+ * FLIGHT_RECORDS events, a round or two of play. The words are written
+ * straight at their mapped address; ESP.rtcUserMemoryWrite() would copy
+ * them through the SDK for every event.
+ *
+ * begin() copies what the last boot left before this one writes over it.
+ * A `flight` line on the serial port prints the ring (earlier boots'
+ * events follow on from a BOOT line), `flight prev` the copy.
+ */
+
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <Arduino.h>
+#include "FlightLog.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define FLIGHT_RTC_WORD     32           // first user RTC word eboot leaves free
+#define FLIGHT_HEADER_WORDS 3            // magic, slot | count << 16, boots
+#define FLIGHT_RECORDS      46           // (128 - 32 - 3) / 2 words
+#define FLIGHT_KEPT_MAGIC   0x464C5231UL // "FLR1"
+
+// RTC user memory as the CPU sees it: ESP.rtcUserMemoryWrite() offset 0
+#define FLIGHT_RTC          ((volatile uint32_t*)0x60001200 + FLIGHT_RTC_WORD)
+
+static_assert(FLIGHT_RTC_WORD + FLIGHT_HEADER_WORDS + 2 * FLIGHT_RECORDS <= 128, "ring past the 512-byte RTC user memory");
+
+class FlightRecorder {
+public:
+  // First thing in setup(); reason = ESP.getResetInfoPtr()->reason
+  void begin(uint32_t reason) {
+    volatile uint32_t* kept = FLIGHT_RTC;
+    const uint16_t keptSlot = (uint16_t)kept[1];
+    const uint16_t keptCount = (uint16_t)(kept[1] >> 16);
+    if (reason != REASON_DEFAULT_RST && kept[0] == FLIGHT_KEPT_MAGIC &&
+        keptSlot < FLIGHT_RECORDS && keptCount <= FLIGHT_RECORDS) {
+      slot = keptSlot;
+      count = keptCount;
+      boots = kept[2] + 1;
+      for (uint16_t i = 0; i < count; i++) prev[prevCount++] = at(slot + FLIGHT_RECORDS - count + i);
+    } else {
+      kept[0] = FLIGHT_KEPT_MAGIC;
+    }
+    kept[2] = boots;
+    record(FL_BOOT, (uint8_t)reason, (uint16_t)boots);
+  }
+
+  // Button interrupt too: IRAM, interrupts masked around the slot
+  void IRAM_ATTR record(uint8_t type, uint8_t a, uint16_t b) {
+    const uint32_t us = micros();
+    const uint32_t ps = xt_rsil(15);
+    volatile uint32_t* rec = FLIGHT_RTC + FLIGHT_HEADER_WORDS + 2 * slot;
+    rec[0] = us;
+    rec[1] = flightWord(type, a, b);
+    if (++slot == FLIGHT_RECORDS) slot = 0;
+    if (count < FLIGHT_RECORDS) count++;
+    FLIGHT_RTC[1] = slot | (uint32_t)count << 16;
+    xt_wsr_ps(ps);
+  }
+
+  // Frame header: [1] dest, [2] src, [3] cmd for every frame type
+  void IRAM_ATTR frame(uint8_t type, const uint8_t* data, uint8_t len, bool outgoing) {
+    if (len < 4) return;
+    record(type, data[3], (uint16_t)(outgoing ? data[1] : data[2]) | (uint16_t)len << 8);
+  }
+
+  // What begin() kept from before the reset
+  uint16_t keptCount() const { return prevCount; }
+
+  // Serial command: previous = the copy taken at boot. Blocks for the UART.
+  void dump(bool previous) {
+    if (previous && !prevCount) {
+      Serial.println("[FLIGHT] Nothing kept from before this boot");
+      return;
+    }
+    FlightRecord ring[FLIGHT_RECORDS];
+    uint16_t n = 0;
+    const uint32_t ps = xt_rsil(15);
+    for (; !previous && n < count; n++) ring[n] = at(slot + FLIGHT_RECORDS - count + n);
+    xt_wsr_ps(ps);
+    if (previous) n = prevCount;
+    Serial.printf("[FLIGHT] %d events%s, oldest first\n", n, previous ? " from before the reset" : "");
+    for (uint16_t i = 0; i < n; i++) {
+      const FlightRecord &r = previous ? prev[i] : ring[i];
+      unsigned args[3];
+      const char* fmt = flightDecode(r, args);
+      Serial.printf(fmt, (unsigned long)r.us, args[0], args[1], args[2]);
+    }
+  }
+
+private:
+  // Record i (mod FLIGHT_RECORDS) out of RTC memory
+  FlightRecord at(uint16_t i) const {
+    volatile uint32_t* rec = FLIGHT_RTC + FLIGHT_HEADER_WORDS + 2 * (i % FLIGHT_RECORDS);
+    FlightRecord r;
+    r.us = rec[0];
+    r.word = rec[1];
+    return r;
+  }
+
+  volatile uint16_t slot = 0;       // next record
+  volatile uint16_t count = 0;      // records held, up to FLIGHT_RECORDS
+  uint32_t boots = 0;               // warm boots since the last power-on
+  FlightRecord prev[FLIGHT_RECORDS];  // begin(): the ring as the reset left it
+  uint16_t prevCount = 0;
+};
+
+extern FlightRecorder flightRecorder;  // defined in main.cpp
+
+#endif // FLIGHTRECORDER_H
@@ -0,0 +1,77 @@
+/*
+ * LightSleep.h - Forced light sleep between host beacons, button wake
+ * ESP8266 Joystick only
+ *
+ * ESP-NOW has no access point to keep the SDK's automatic modem / light
+ * sleep in step with, so idle sleep is done by hand: sleep() turns the
+ * radio off, puts the chip into forced light sleep for up to sleepMs and
+ * wakes early on a LOW level on the wake pin (the button), then brings the
+ * radio back on the same channel. The caller times sleepMs so the radio is
+ * back just before the host's next beacon (CHANNEL SELECTION in Protocol.h).
+ *
+ * The CPU clock stops while asleep, so millis() doesn't move; asleep time is
+ * measured on the RTC timer, which keeps running. Stats cover the period
+ * since the last takeStats().
+ */
+
+#ifndef LIGHTSLEEP_H
+#define LIGHTSLEEP_H
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+extern "C" {
+#include "user_interface.h"
+#include "gpio.h"
+}
+
+class LightSleep {
+public:
+  struct Stats {
+    uint32_t sleeps;
+    uint32_t asleepMs;
+    uint32_t radioMaxUs;    // wake -> radio back on its channel, worst this period
+  };
+
+  // Blocks until the timer or the wake pin ends the sleep. Returns ms asleep.
+  uint32_t sleep(uint32_t sleepMs, uint8_t wakePin, uint8_t channel) {
+    woke = false;
+    const uint32_t rtcStart = system_get_rtc_time();
+    const uint32_t cal = system_rtc_clock_cali_proc();   // us per RTC tick, Q12
+
+    wifi_set_opmode_current(NULL_MODE);
+    wifi_fpm_set_sleep_type(LIGHT_SLEEP_T);
+    wifi_fpm_open();
+    wifi_fpm_set_wakeup_cb(onWake);
+    gpio_pin_wakeup_enable(GPIO_ID_PIN(wakePin), GPIO_PIN_INTR_LOLEVEL);
+    wifi_fpm_do_sleep(sleepMs * 1000);
+    // Sleep starts once we hand control to the SDK; the callback ends it
+    for (uint32_t i = 0; i <= sleepMs && !woke; i++) delay(1);
+
+    const uint32_t wakeUs = micros();
+    gpio_pin_wakeup_disable();
+    wifi_fpm_close();
+    wifi_set_opmode_current(STATION_MODE);
+    wifi_set_channel(channel);
+    const uint32_t radioUs = micros() - wakeUs;
+
+    const uint32_t asleepMs = (uint32_t)(((uint64_t)(system_get_rtc_time() - rtcStart) * cal) >> 12) / 1000;
+    stats.sleeps++;
+    stats.asleepMs += asleepMs;
+    if (radioUs > stats.radioMaxUs) stats.radioMaxUs = radioUs;
+    return asleepMs;
+  }
+
+  Stats takeStats() {
+    Stats s = stats;
+    stats = Stats();
+    return s;
+  }
+
+private:
+  static void onWake() { woke = true; }
+
+  static inline volatile bool woke = false;   // inline (C++17): defined here, once per program
+  Stats stats = {};
+};
+
+#endif // LIGHTSLEEP_H
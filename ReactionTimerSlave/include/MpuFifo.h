@@ -0,0 +1,186 @@
+/*
+ * MpuFifo.h - MPU-6050 accelerometer FIFO sampling
+ * ESP8266 Joystick only
+ *
+ * The MPU samples the accelerometer on its own clock (MPU_SAMPLE_RATE_HZ)
+ * into its 1 KB FIFO and pulses INT on every new sample. The loop drains the
+ * FIFO in bursts (one I2C transaction per MPU_DRAIN_MAX_SAMPLES) instead of
+ * polling a single sample every few ms, so the shake detector sees every
+ * sample and the I2C cost per sample drops. If INT isn't wired, draining
+ * falls back to a timer (MPU_DRAIN_MS).
+ *
+ * Sample n of a run was taken n / MPU_SAMPLE_RATE_HZ seconds after start(),
+ * independent of when it was drained.
+ */
+
+#ifndef MPUFIFO_H
+#define MPUFIFO_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// =============================================================================
+// MPU-6050 REGISTERS
+// =============================================================================
+#define MPU_ADDR              0x68
+#define MPU_REG_SMPLRT_DIV    0x19
+#define MPU_REG_CONFIG        0x1A
+#define MPU_REG_ACCEL_CONFIG  0x1C
+#define MPU_REG_FIFO_EN       0x23
+#define MPU_REG_INT_PIN_CFG   0x37
+#define MPU_REG_INT_ENABLE    0x38
+#define MPU_REG_INT_STATUS    0x3A
+#define MPU_REG_ACCEL_XH      0x3B
+#define MPU_REG_USER_CTRL     0x6A
+#define MPU_REG_PWR_MGMT1     0x6B
+#define MPU_REG_FIFO_COUNTH   0x72
+#define MPU_REG_FIFO_R_W      0x74
+
+#define MPU_FIFO_EN_ACCEL     0x08  // FIFO_EN: accel X/Y/Z
+#define MPU_USER_FIFO_EN      0x40  // USER_CTRL: enable FIFO
+#define MPU_USER_FIFO_RESET   0x04  // USER_CTRL: reset FIFO
+#define MPU_INT_DATA_RDY      0x01  // INT_ENABLE / INT_STATUS: data ready
+#define MPU_INT_FIFO_OFLOW    0x10  // INT_STATUS: FIFO overflow
+#define MPU_INT_CFG_PULSE     0x10  // INT_PIN_CFG: active high, push-pull, 50us pulse, clear on any read
+#define MPU_PWR_CLK_PLL_X     0x01  // PWR_MGMT1: wake, gyro X PLL clock (more stable than 8 MHz RC)
+
+// =============================================================================
+// FIFO CONFIGURATION
+// =============================================================================
+#define MPU_SAMPLE_RATE_HZ    1000  // 1 kHz gyro clock (DLPF on) / (1 + SMPLRT_DIV)
+#define MPU_DLPF_CFG          3     // accel ~44 Hz bandwidth: keeps shake energy, drops jitter
+#define MPU_FIFO_BYTES        1024
+#define MPU_SAMPLE_BYTES      6     // accel X/Y/Z, big-endian int16
+#define MPU_DRAIN_MAX_SAMPLES 20    // per I2C read: 120 bytes fits the 128-byte Wire buffer
+#define MPU_DRAIN_BURST       8     // INT pulses to collect before draining
+#define MPU_DRAIN_MS          10    // drain at least this often (INT not wired / missed)
+
+struct AccelSample {
+  int16_t x, y, z;
+};
+
+class MpuFifo {
+public:
+  // Configure rate, DLPF and INT; leaves the FIFO stopped
+  bool begin() {
+    if (!writeReg(MPU_REG_PWR_MGMT1, MPU_PWR_CLK_PLL_X)) return false;
+    delay(10);  // MPU-6050 wakes within a few ms
+    writeReg(MPU_REG_CONFIG, MPU_DLPF_CFG);
+    writeReg(MPU_REG_SMPLRT_DIV, (1000 / MPU_SAMPLE_RATE_HZ) - 1);
+    writeReg(MPU_REG_ACCEL_CONFIG, 0x00);  // ±2 g, matches the shake thresholds
+    writeReg(MPU_REG_INT_PIN_CFG, MPU_INT_CFG_PULSE);
+    stop();
+    return true;
+  }
+
+  // Empty the FIFO and start collecting; sample 0 is taken ~now
+  void start() {
+    resetFifo();
+    writeReg(MPU_REG_INT_ENABLE, MPU_INT_DATA_RDY);
+    startMs = millis();
+    lastDrainMs = startMs;
+    sampleIndex = 0;
+    overflows = 0;
+    running = true;
+  }
+
+  // FIFO and INT off between rounds (no 1 kHz interrupt while idle)
+  void stop() {
+    writeReg(MPU_REG_INT_ENABLE, 0);
+    writeReg(MPU_REG_FIFO_EN, 0);
+    writeReg(MPU_REG_USER_CTRL, 0);
+    running = false;
+  }
+
+  // True when enough INT pulses arrived or the fallback timer expired
+  bool drainDue(uint16_t intPulses, unsigned long nowMs) const {
+    return running && (intPulses >= MPU_DRAIN_BURST || nowMs - lastDrainMs >= MPU_DRAIN_MS);
+  }
+
+  // Read up to MPU_DRAIN_MAX_SAMPLES samples. Returns how many were stored in out[].
+  uint8_t drain(AccelSample* out) {
+    if (!running) return 0;
+    lastDrainMs = millis();
+
+    uint8_t status = 0;
+    readBlock(MPU_REG_INT_STATUS, &status, 1);
+    if (status & MPU_INT_FIFO_OFLOW) {
+      // Samples were lost: restart the FIFO and skip the index ahead to wall time
+      overflows++;
+      resetFifo();
+      sampleIndex = (uint32_t)(millis() - startMs) * MPU_SAMPLE_RATE_HZ / 1000;
+      return 0;
+    }
+
+    uint8_t cnt[2];
+    if (!readBlock(MPU_REG_FIFO_COUNTH, cnt, 2)) return 0;
+    uint16_t bytes = ((uint16_t)cnt[0] << 8) | cnt[1];
+    uint16_t n = bytes / MPU_SAMPLE_BYTES;
+    if (n > MPU_DRAIN_MAX_SAMPLES) n = MPU_DRAIN_MAX_SAMPLES;
+    if (n == 0) return 0;
+
+    uint8_t raw[MPU_DRAIN_MAX_SAMPLES * MPU_SAMPLE_BYTES];
+    if (!readBlock(MPU_REG_FIFO_R_W, raw, n * MPU_SAMPLE_BYTES)) return 0;
+    for (uint16_t i = 0; i < n; i++) {
+      const uint8_t* b = &raw[i * MPU_SAMPLE_BYTES];
+      out[i].x = (int16_t)((b[0] << 8) | b[1]);
+      out[i].y = (int16_t)((b[2] << 8) | b[3]);
+      out[i].z = (int16_t)((b[4] << 8) | b[5]);
+    }
+    firstIndex = sampleIndex;
+    sampleIndex += n;
+    return (uint8_t)n;
+  }
+
+  // Time of sample i of the last drain(), in ms after start()
+  uint32_t sampleTimeMs(uint8_t i) const {
+    return (uint32_t)((uint64_t)(firstIndex + i) * 1000 / MPU_SAMPLE_RATE_HZ);
+  }
+
+  unsigned long startedAtMs() const { return startMs; }
+  uint16_t overflowCount() const { return overflows; }
+  bool isRunning() const { return running; }
+
+  // Single-sample read (outside FIFO runs)
+  bool readAccel(int16_t &ax, int16_t &ay, int16_t &az) {
+    uint8_t data[6];
+    if (!readBlock(MPU_REG_ACCEL_XH, data, 6)) return false;
+    ax = (int16_t)((data[0] << 8) | data[1]);
+    ay = (int16_t)((data[2] << 8) | data[3]);
+    az = (int16_t)((data[4] << 8) | data[5]);
+    return true;
+  }
+
+private:
+  void resetFifo() {
+    writeReg(MPU_REG_FIFO_EN, 0);
+    writeReg(MPU_REG_USER_CTRL, MPU_USER_FIFO_RESET);
+    writeReg(MPU_REG_USER_CTRL, MPU_USER_FIFO_EN);
+    writeReg(MPU_REG_FIFO_EN, MPU_FIFO_EN_ACCEL);
+  }
+
+  bool writeReg(uint8_t reg, uint8_t val) {
+    Wire.beginTransmission(MPU_ADDR);
+    Wire.write(reg);
+    Wire.write(val);
+    return Wire.endTransmission() == 0;
+  }
+
+  bool readBlock(uint8_t reg, uint8_t* buf, uint8_t len) {
+    Wire.beginTransmission(MPU_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)MPU_ADDR, len) != len) return false;
+    for (uint8_t i = 0; i < len; i++) buf[i] = Wire.read();
+    return true;
+  }
+
+  unsigned long startMs = 0;
+  unsigned long lastDrainMs = 0;
+  uint32_t sampleIndex = 0;     // samples drained since start()
+  uint32_t firstIndex = 0;      // index of out[0] in the last drain()
+  uint16_t overflows = 0;
+  bool running = false;
+};
+
+#endif // MPUFIFO_H
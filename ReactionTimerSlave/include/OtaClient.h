@@ -0,0 +1,228 @@
+/*
+ * OtaClient.h - Firmware update pulled from the host (FIRMWARE UPDATE in Protocol.h)
+ * ESP8266 Joystick only
+ *
+ * A CMD_OTA_OFFER for a newer stick image built against this firmware
+ * (or a full image) starts a session: Update.begin() reserves the free
+ * flash after the sketch, and loop() requests the blocks in order. The
+ * receive callback only copies chunks into the record buffer; update()
+ * decodes a complete block (OtaImage.h, base copies read straight from
+ * the running sketch in flash), checks its CRC-32 and hands it to
+ * Update.write(). Requests go out only while the stick is in JS_IDLE, and
+ * the session stays in RAM across a game, so the transfer resumes at the
+ * block it stopped at.
+ *
+ * The ESP8266 has no second app slot to roll back to: the new image is
+ * staged in the free space and eboot copies it over the sketch on the
+ * next boot. So every block is checked, and the CRC-32 of the whole image
+ * is checked before its last block is written; Update.end() fails on a
+ * short image and nothing is staged. A failed session answers
+ * OTA_BLOCK_FAIL and that package is not tried again until a reboot.
+ */
+
+#ifndef OTACLIENT_H
+#define OTACLIENT_H
+
+#include <Arduino.h>
+#include <Updater.h>
+#include "Protocol.h"
+#include "OtaImage.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define OTA_DONE_REPEATS   3     // OTA_BLOCK_DONE sends before the reboot
+#define OTA_REBOOT_MS      200   // for the last frames to leave
+#define OTA_STALL_MS       30000 // idle this long without a chunk: host gone, give the session up
+
+typedef int (*OtaSendFn)(const uint8_t* data, uint8_t len);
+
+class OtaClient {
+public:
+  explicit OtaClient(OtaSendFn sendFn) : sendFrame(sendFn) {}
+
+  // Receive callback: an OTA frame from the host for myId (already known to be one)
+  void onFrame(const uint8_t* data, uint8_t len, uint8_t myId) {
+    if (!validateOtaFrame(data, len) || data[1] != myId || data[2] != ID_HOST) return;
+    if (data[3] == CMD_OTA_OFFER) {
+      if (active || offerPending) return;
+      memcpy(&offer, data, sizeof(offer));
+      offerPending = true;
+    } else if (data[3] == CMD_OTA_DATA && active) {
+      const OtaDataHeader* h = (const OtaDataHeader*)data;
+      if (h->imageCrc != imageCrc || h->block != block) return;
+      if (have && h->recordLen != recordLen) return;
+      recordLen = h->recordLen;
+      memcpy(record + (uint16_t)h->chunk * OTA_CHUNK_BYTES, data + sizeof(OtaDataHeader),
+             len - sizeof(OtaDataHeader) - 4);
+      have |= 1UL << h->chunk;
+      progressMs = millis();
+    }
+  }
+
+  // loop(): idle = JS_IDLE with a locked channel and an assigned ID
+  void update(uint32_t nowMs, bool idle, uint8_t myId) {
+    if (offerPending) {
+      if (idle) start(nowMs, myId);
+      offerPending = false;
+    }
+    if (!active) return;
+    if (!idle) {
+      progressMs = nowMs;   // a game pauses the session, it doesn't age it
+      return;
+    }
+    if (nowMs - progressMs >= OTA_STALL_MS) {
+      Serial.printf("[OTA] No data for %d s - session dropped at block %d\n", OTA_STALL_MS / 1000, block);
+      close();
+      return;
+    }
+    if (recordLen && have == allChunks()) {
+      if (!writeBlock()) {
+        fail(myId);
+        return;
+      }
+      if (++block == blocks) {
+        finish(myId);
+        return;
+      }
+      request(nowMs, myId);
+    } else if (nowMs - lastReqMs >= OTA_REQ_RETRY_MS) {
+      request(nowMs, myId);
+    }
+  }
+
+  // A session is open: keep the radio up
+  bool busy() const { return active || offerPending; }
+
+private:
+  void start(uint32_t nowMs, uint8_t myId) {
+    const OtaOfferPacket &o = offer;
+    if (o.target != OTA_TARGET_STICK || o.version <= FW_VERSION_DATA || o.imageCrc == failedCrc ||
+        (o.base && o.base != FW_VERSION_DATA) || o.blocks != (o.imageSize + OTA_BLOCK_SIZE - 1) / OTA_BLOCK_SIZE) {
+      return;
+    }
+    imageCrc = o.imageCrc;
+    imageSize = o.imageSize;
+    blocks = o.blocks;
+    const FwVersion v = decodeVersion(o.version);
+    Serial.printf("[OTA] V%d.%d.%d offered (%s, %lu bytes)\n", v.major, v.minor, v.patch,
+                  o.base ? "delta" : "full image", (unsigned long)imageSize);
+    record = (uint8_t*)malloc(OTA_RECORD_MAX);
+    out = (uint8_t*)malloc(OTA_BLOCK_SIZE);
+    baseSize = (ESP.getSketchSize() + OTA_BLOCK_SIZE - 1) & ~(uint32_t)(OTA_BLOCK_SIZE - 1);
+    if (!record || !out || !Update.begin(imageSize)) {
+      Serial.printf("[OTA] Cannot stage %lu bytes (%lu free) - not updating\n",
+                    (unsigned long)imageSize, (unsigned long)ESP.getFreeSketchSpace());
+      fail(myId);
+      return;
+    }
+    active = true;
+    block = 0;
+    runningCrc = 0;
+    startMs = nowMs;
+    progressMs = nowMs;
+    request(nowMs, myId);
+  }
+
+  uint32_t allChunks() const {
+    const uint8_t n = otaChunks(recordLen);
+    return n >= 32 ? 0xFFFFFFFFUL : (1UL << n) - 1;
+  }
+
+  // Decode and stage the block; the image CRC before the last one
+  bool writeBlock() {
+    const uint16_t outLen = block + 1 < blocks ? OTA_BLOCK_SIZE : (uint16_t)(imageSize - (uint32_t)block * OTA_BLOCK_SIZE);
+    if (!otaDecodeBlock(record, recordLen, out, outLen, readBase)) {
+      Serial.printf("[OTA] Block %d does not decode - wrong base image?\n", block);
+      return false;
+    }
+    runningCrc = calcCRC32(out, outLen, runningCrc);
+    if (block + 1 == blocks && runningCrc != imageCrc) {
+      Serial.println("[OTA] Image CRC mismatch - not staged");
+      return false;
+    }
+    if (Update.write(out, outLen) != outLen) {
+      Serial.printf("[OTA] Flash write failed at block %d (error %d)\n", block, Update.getError());
+      return false;
+    }
+    recordLen = 0;
+    have = 0;
+    if ((block & 31) == 31) Serial.printf("[OTA] %d/%d blocks\n", block + 1, blocks);
+    return true;
+  }
+
+  void request(uint32_t nowMs, uint8_t myId) {
+    send(myId, block, have);
+    lastReqMs = nowMs;
+  }
+
+  void send(uint8_t myId, uint16_t b, uint32_t held) {
+    OtaReqPacket r;
+    r.dest_id = ID_HOST;
+    r.src_id = myId;
+    r.cmd = CMD_OTA_REQ;
+    r.imageCrc = imageCrc;
+    r.block = b;
+    r.have = held;
+    sealOtaFrame((uint8_t*)&r, sizeof(r));
+    sendFrame((const uint8_t*)&r, sizeof(r));
+  }
+
+  void finish(uint8_t myId) {
+    if (!Update.end()) {
+      Serial.printf("[OTA] Update.end() failed (error %d)\n", Update.getError());
+      fail(myId);
+      return;
+    }
+    Serial.printf("[OTA] %d blocks in %lu ms, image checked - rebooting\n", blocks,
+                  (unsigned long)(millis() - startMs));
+    for (uint8_t i = 0; i < OTA_DONE_REPEATS; i++) send(myId, OTA_BLOCK_DONE, 0);
+    delay(OTA_REBOOT_MS);
+    ESP.restart();
+  }
+
+  void fail(uint8_t myId) {
+    send(myId, OTA_BLOCK_FAIL, 0);
+    failedCrc = imageCrc;
+    close();
+  }
+
+  void close() {
+    active = false;
+    free(record);
+    free(out);
+    record = out = nullptr;
+    recordLen = 0;
+    have = 0;
+    if (Update.isRunning()) Update.end();   // short of the image size: dropped, eboot not told
+  }
+
+  // OtaBaseRead: the running sketch, from flash address 0
+  static bool readBase(uint32_t offset, uint8_t* dst, uint16_t len) {
+    return offset + len <= baseSize && ESP.flashRead(offset, dst, len);
+  }
+
+  OtaSendFn sendFrame;
+  OtaOfferPacket offer;
+  volatile bool offerPending = false;
+  bool active = false;
+
+  uint32_t imageCrc = 0;
+  uint32_t imageSize = 0;
+  uint16_t blocks = 0;
+  uint16_t block = 0;
+  uint32_t runningCrc = 0;
+  uint32_t failedCrc = 0;
+  uint32_t lastReqMs = 0;
+  uint32_t startMs = 0;
+  uint32_t progressMs = 0;      // last chunk, or the end of the last pause
+
+  uint8_t* record = nullptr;    // OTA_RECORD_MAX, while a session is open
+  uint8_t* out = nullptr;       // OTA_BLOCK_SIZE
+  uint16_t recordLen = 0;       // set by the first chunk of the block
+  uint32_t have = 0;            // chunks of it received
+
+  static inline uint32_t baseSize = 0;   // sketch size, rounded up to a flash sector
+};
+
+#endif // OTACLIENT_H
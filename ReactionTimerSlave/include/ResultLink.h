@@ -0,0 +1,116 @@
+/*
+ * ResultLink.h - Non-blocking, ACK-driven delivery of the round result
+ * ESP8266 Joystick only
+ *
+ * One result (CMD_REACTION_DONE / CMD_SHAKE_DONE, plain packet or fine
+ * one-item batch) is in flight at a time. send() transmits it once and
+ * returns; update() from loop() resends it when the MAC layer reported a
+ * failure (after RESULT_MAC_RETRY_MS) or no host ACK came within
+ * RESULT_RTO_MS, up to RESULT_MAX_SENDS in all (RESULT ACK in Protocol.h).
+ * So the first delivered copy is usually the only one on the air, and
+ * loop() keeps running the motor, the MPU and host commands meanwhile.
+ *
+ * onSent() runs in the send callback, onAck() in the receive callback;
+ * both only set flags.
+ */
+
+#ifndef RESULTLINK_H
+#define RESULTLINK_H
+
+#include <Arduino.h>
+#include "Protocol.h"
+#include "FlightRecorder.h"
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+#define RESULT_RTO_MS        25   // no host ACK by then: send again
+#define RESULT_MAC_RETRY_MS  5    // MAC layer gave up: send again this soon
+#define RESULT_MAX_SENDS     6
+
+typedef int (*ResultSendFn)(const uint8_t* data, uint8_t len);
+
+class ResultLink {
+public:
+  explicit ResultLink(ResultSendFn sendFn) : sendFrame(sendFn) {}
+
+  // Plain GamePacket result (ms form, or TIME_PENALTY)
+  void send(uint8_t src, uint8_t cmd, uint16_t data, uint32_t nowMs) {
+    GamePacket pkt;
+    buildPacket(&pkt, ID_HOST, src, cmd, data);
+    memcpy(frame.buf, &pkt, sizeof(pkt));
+    start(cmd, sizeof(pkt), nowMs);
+  }
+
+  // Fine result (FINE RESULT TIMES): one-item batch
+  void sendTicks(uint8_t src, uint8_t cmd, uint32_t ticks, uint32_t nowMs) {
+    frame.begin(ID_HOST, src);
+    frame.add32(cmd, ticks);
+    start(cmd, frame.seal(0, 0), nowMs);
+  }
+
+  // loop(): resend when due. Returns false once nothing is pending.
+  bool update(uint32_t nowMs) {
+    if (!pendingCmd) return false;
+    if (acked) {
+      Serial.printf("[RESULT] 0x%02X ACKed after %d send(s)\n", pendingCmd, sends);
+      pendingCmd = 0;
+      return false;
+    }
+    const uint8_t mac = macStatus;
+    const uint32_t wait = mac == MAC_FAILED ? RESULT_MAC_RETRY_MS : RESULT_RTO_MS;
+    if (nowMs - lastSendMs < wait) return true;
+    if (sends >= RESULT_MAX_SENDS) {
+      flightRecorder.record(FL_GIVE_UP, pendingCmd, (uint16_t)ID_HOST | (uint16_t)sends << 8);
+      Serial.printf("[RESULT] 0x%02X not ACKed after %d sends - giving up\n", pendingCmd, sends);
+      pendingCmd = 0;
+      return false;
+    }
+    flightRecorder.record(FL_RETRY, pendingCmd, (uint16_t)ID_HOST | (uint16_t)(sends + 1) << 8);
+    transmit(nowMs);
+    return true;
+  }
+
+  // Receive callback: host CMD_ACK for cmd
+  void onAck(uint8_t cmd) {
+    if (cmd && cmd == pendingCmd) acked = true;
+  }
+
+  // Send callback: MAC-layer outcome of the last transmission to the host
+  void onSent(bool ok) { macStatus = ok ? MAC_OK : MAC_FAILED; }
+
+  // A new round or CMD_IDLE: the old result no longer matters
+  void cancel() { pendingCmd = 0; }
+
+  bool pending() const { return pendingCmd != 0; }
+
+private:
+  enum : uint8_t { MAC_PENDING, MAC_OK, MAC_FAILED };
+
+  void start(uint8_t cmd, uint8_t len, uint32_t nowMs) {
+    frameLen = len;
+    sends = 0;
+    acked = false;
+    pendingCmd = cmd;
+    transmit(nowMs);
+  }
+
+  void transmit(uint32_t nowMs) {
+    macStatus = MAC_PENDING;
+    int result = sendFrame(frame.buf, frameLen);
+    sends++;
+    lastSendMs = nowMs;
+    Serial.printf("[SEND] result 0x%02X copy %d result=%d\n", pendingCmd, sends, result);
+  }
+
+  ResultSendFn sendFrame;
+  BatchWriter frame;            // a GamePacket result uses the start of buf
+  uint8_t frameLen = 0;
+  uint8_t sends = 0;
+  uint32_t lastSendMs = 0;
+  volatile uint8_t pendingCmd = 0;
+  volatile bool acked = false;
+  volatile uint8_t macStatus = MAC_PENDING;
+};
+
+#endif // RESULTLINK_H
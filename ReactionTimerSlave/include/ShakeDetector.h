@@ -0,0 +1,309 @@
+/*
+ * ShakeDetector.h - Fixed-point shake detection pipeline
+ * ESP8266 Joystick only
+ *
+ * The ESP8266 has no FPU, so every stage is integer-only:
+ *
+ *   raw accel -> decimate to SHAKE_DSP_RATE_HZ (boxcar average, 3 axes)
+ *             -> DC removal (one-pole high-pass, takes out gravity + tilt)
+ *             -> band-pass biquad around human shake rates (Q14)
+ *             -> energy |x|+|y|+|z|
+ *             -> peak detector (threshold + hysteresis + refractory period)
+ *
+ * A push-and-return shake gives one energy peak per half-cycle, so the
+ * detector counts SHAKE_PEAKS_PER_SHAKE peaks per physical shake.
+ *
+ * calibrate() runs while the stick rests (after joining): it learns the
+ * gravity vector, which pre-loads the DC stage so the round starts settled,
+ * and the noise floor, which sets the peak threshold for this device.
+ *
+ * Cost: three adds per raw sample, one filter step per SHAKE_DSP_RATE_HZ
+ * sample. The worst filter step is measured in CPU cycles and compared
+ * against SHAKE_DSP_BUDGET_CYCLES so a regression shows up in the log.
+ *
+ * ThresholdShakeDetector is the old raw-magnitude detector behind the same
+ * interface (build with -DSHAKE_DSP=0 to compare).
+ */
+
+#ifndef SHAKEDETECTOR_H
+#define SHAKEDETECTOR_H
+
+#include <Arduino.h>
+#include "MpuFifo.h"
+
+// =============================================================================
+// PIPELINE CONFIGURATION
+// =============================================================================
+#define SHAKE_DSP_RATE_HZ        100    // filter rate; input rate must be a multiple
+#define SHAKE_Q_1G               4096   // 1 g after scaling (raw ±2 g counts >> 2)
+#define SHAKE_DC_SHIFT           6      // DC tracker: tau = 64 samples (0.64 s, ~0.25 Hz corner)
+
+// Band-pass: RBJ constant-peak-gain, f0 = 4 Hz, Q = 0.8 at 100 Hz (Q14).
+// Gain: 0.64 @ 2 Hz, 1.0 @ 4 Hz, 0.63 @ 8 Hz, 0.22 @ 20 Hz.
+// b1 = 0 and b2 = -b0 for this design, so one multiply covers the zeros.
+#define SHAKE_BP_B0              2204
+#define SHAKE_BP_A1              (-27469)
+#define SHAKE_BP_A2              11976
+#define SHAKE_Q14_SHIFT          14
+
+// Peak detector
+#define SHAKE_PEAKS_PER_SHAKE    2      // energy peaks per push-and-return
+#define SHAKE_MIN_PEAK           (SHAKE_Q_1G * 6 / 10)  // never trigger below 0.6 g band energy
+#define SHAKE_NOISE_MULT         6      // threshold = noise floor x this (if above SHAKE_MIN_PEAK)
+#define SHAKE_REFRACTORY_MS      80     // min spacing between counted peaks (~6 Hz shaking)
+
+// Calibration (in DSP samples)
+#define SHAKE_CAL_GRAVITY_LOG2   5      // 32 samples (0.32 s) to average gravity
+#define SHAKE_CAL_NOISE_LOG2     5      // then 32 samples to average the noise floor
+#define SHAKE_CAL_MAX_MOTION     (SHAKE_MIN_PEAK / 2)   // energy above this = stick moved, retry
+
+#define SHAKE_DSP_BUDGET_CYCLES  4000   // 50 us at 80 MHz per filter step
+
+static_assert(SHAKE_Q_1G * 2 * 2 * (SHAKE_BP_B0 - SHAKE_BP_A1 + SHAKE_BP_A2) < 0x7FFFFFFFL,
+              "Q14 biquad accumulator can overflow int32");
+
+enum ShakeCalState : uint8_t {
+  CAL_RUNNING,
+  CAL_DONE,
+  CAL_FAILED     // stick moved; defaults kept
+};
+
+// =============================================================================
+// STAGES
+// =============================================================================
+
+// One-pole DC tracker: y = x - dc, dc follows x with time constant 2^SHAKE_DC_SHIFT
+struct DcBlocker {
+  int32_t dcQ8 = 0;   // Q8 so the slow tracker doesn't stall on rounding
+
+  void preset(int32_t dc) { dcQ8 = dc << 8; }
+  int32_t step(int32_t x) {
+    dcQ8 += ((x << 8) - dcQ8) >> SHAKE_DC_SHIFT;
+    return x - (dcQ8 >> 8);
+  }
+};
+
+// Band-pass biquad, direct form I, Q14 coefficients
+struct BandPass {
+  int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+  void reset() { x1 = x2 = y1 = y2 = 0; }
+  int32_t step(int32_t x) {
+    int32_t acc = SHAKE_BP_B0 * (x - x2) - SHAKE_BP_A1 * y1 - SHAKE_BP_A2 * y2;
+    int32_t y = (acc + (1L << (SHAKE_Q14_SHIFT - 1))) >> SHAKE_Q14_SHIFT;
+    x2 = x1; x1 = x;
+    y2 = y1; y1 = y;
+    return y;
+  }
+};
+
+// Local-maximum detector: a peak is the highest energy between rising above
+// the threshold and falling below half of it. Peaks closer than the
+// refractory period to the last counted one are filter ringing, not shakes.
+struct PeakDetector {
+  int32_t threshold = SHAKE_MIN_PEAK;
+  int32_t peakVal = 0;
+  uint32_t peakMs = 0;
+  uint32_t lastMs = 0;
+  bool inPeak = false;
+  bool counted = false;     // any peak counted since reset()
+
+  void reset() { peakVal = 0; inPeak = false; counted = false; }
+
+  // Returns true when a peak has just ended and counts
+  bool step(int32_t e, uint32_t tMs) {
+    if (e > threshold) {
+      if (!inPeak || e > peakVal) { peakVal = e; peakMs = tMs; }
+      inPeak = true;
+      return false;
+    }
+    if (!inPeak || e > threshold / 2) return false;
+    inPeak = false;
+    if (counted && peakMs - lastMs < SHAKE_REFRACTORY_MS) return false;
+    counted = true;
+    lastMs = peakMs;
+    return true;
+  }
+};
+
+// =============================================================================
+// DSP DETECTOR
+// =============================================================================
+class ShakeDetector {
+public:
+  static const uint8_t PEAKS_PER_SHAKE = SHAKE_PEAKS_PER_SHAKE;
+
+  void begin(uint16_t inputRateHz) {
+    decim = inputRateHz / SHAKE_DSP_RATE_HZ;
+    if (decim < 1) decim = 1;
+    for (uint8_t a = 0; a < 3; a++) gravity[a] = 0;
+    gravity[2] = SHAKE_Q_1G;  // flat until calibrated
+    peak.threshold = SHAKE_MIN_PEAK;
+    noiseFloor = 0;
+    isCalibrated = false;
+    reset();
+  }
+
+  // Start of a round: settled DC stage, empty filters, no peaks
+  void reset() {
+    for (uint8_t a = 0; a < 3; a++) {
+      dc[a].preset(gravity[a]);
+      bp[a].reset();
+    }
+    peak.reset();
+    accN = 0;
+    accX = accY = accZ = 0;
+    worstCycles = 0;
+  }
+
+  // Feed one raw sample taken tMs after GO. Returns true when a shake peak was counted.
+  bool push(const AccelSample &s, uint32_t tMs) {
+    if (!accumulate(s, tMs)) return false;
+    uint32_t c0 = ESP.getCycleCount();
+    int32_t e = energy();
+    bool hit = peak.step(e, blockMs);
+    uint32_t cycles = ESP.getCycleCount() - c0;
+    if (cycles > worstCycles) worstCycles = cycles;
+    return hit;
+  }
+
+  // Time (ms after GO) of the last counted peak
+  uint32_t peakTimeMs() const { return peak.lastMs; }
+
+  void beginCalibration() {
+    calN = 0;
+    gX = gY = gZ = 0;
+    noiseSum = 0;
+    noiseMax = 0;
+    accN = 0;
+    accX = accY = accZ = 0;
+  }
+
+  // Feed raw samples while the stick is at rest
+  ShakeCalState calibrate(const AccelSample &s) {
+    if (!accumulate(s, 0)) return CAL_RUNNING;
+
+    const uint16_t gravityN = 1 << SHAKE_CAL_GRAVITY_LOG2;
+    const uint16_t noiseN = 1 << SHAKE_CAL_NOISE_LOG2;
+    if (calN < gravityN) {
+      gX += blockX; gY += blockY; gZ += blockZ;
+      if (++calN == gravityN) {
+        // Settle the filters on the measured gravity before sampling noise
+        dc[0].preset(gX >> SHAKE_CAL_GRAVITY_LOG2);
+        dc[1].preset(gY >> SHAKE_CAL_GRAVITY_LOG2);
+        dc[2].preset(gZ >> SHAKE_CAL_GRAVITY_LOG2);
+        for (uint8_t a = 0; a < 3; a++) bp[a].reset();
+      }
+      return CAL_RUNNING;
+    }
+
+    int32_t e = energy();
+    noiseSum += e;
+    if (e > noiseMax) noiseMax = e;
+    if (++calN < gravityN + noiseN) return CAL_RUNNING;
+
+    if (noiseMax > SHAKE_CAL_MAX_MOTION) return CAL_FAILED;
+    gravity[0] = gX >> SHAKE_CAL_GRAVITY_LOG2;
+    gravity[1] = gY >> SHAKE_CAL_GRAVITY_LOG2;
+    gravity[2] = gZ >> SHAKE_CAL_GRAVITY_LOG2;
+    noiseFloor = noiseSum >> SHAKE_CAL_NOISE_LOG2;
+    int32_t thr = noiseFloor * SHAKE_NOISE_MULT;
+    peak.threshold = thr > SHAKE_MIN_PEAK ? thr : SHAKE_MIN_PEAK;
+    isCalibrated = true;
+    return CAL_DONE;
+  }
+
+  bool calibrated() const { return isCalibrated; }
+  int32_t gravityAxis(uint8_t a) const { return gravity[a]; }
+  int32_t noise() const { return noiseFloor; }
+  int32_t threshold() const { return peak.threshold; }
+  uint32_t worstStepCycles() const { return worstCycles; }
+  bool overBudget() const { return worstCycles > SHAKE_DSP_BUDGET_CYCLES; }
+
+private:
+  // Boxcar-average decim raw samples into one scaled block sample
+  bool accumulate(const AccelSample &s, uint32_t tMs) {
+    if (accN == 0) firstMs = tMs;
+    accX += s.x; accY += s.y; accZ += s.z;
+    if (++accN < decim) return false;
+    int32_t div = (int32_t)decim * (32768 / SHAKE_Q_1G / 2);
+    blockX = accX / div;
+    blockY = accY / div;
+    blockZ = accZ / div;
+    blockMs = firstMs + (tMs - firstMs) / 2;  // boxcar centre
+    accN = 0;
+    accX = accY = accZ = 0;
+    return true;
+  }
+
+  // DC removal + band-pass on each axis, then L1 energy
+  int32_t energy() {
+    int32_t x = bp[0].step(dc[0].step(blockX));
+    int32_t y = bp[1].step(dc[1].step(blockY));
+    int32_t z = bp[2].step(dc[2].step(blockZ));
+    return abs(x) + abs(y) + abs(z);
+  }
+
+  DcBlocker dc[3];
+  BandPass bp[3];
+  PeakDetector peak;
+
+  uint8_t decim = 1;
+  uint8_t accN = 0;
+  int32_t accX = 0, accY = 0, accZ = 0;
+  int32_t blockX = 0, blockY = 0, blockZ = 0;
+  uint32_t firstMs = 0, blockMs = 0;
+
+  int32_t gravity[3] = {0, 0, SHAKE_Q_1G};
+  int32_t noiseFloor = 0;
+  bool isCalibrated = false;
+
+  uint16_t calN = 0;
+  int32_t gX = 0, gY = 0, gZ = 0;
+  int32_t noiseSum = 0, noiseMax = 0;
+
+  uint32_t worstCycles = 0;
+};
+
+// =============================================================================
+// LEGACY DETECTOR (raw magnitude threshold)
+// =============================================================================
+// At rest, magnitude ≈ 16384 (1g). Threshold set well above to ignore gravity.
+#define SHAKE_BASE_G          16384
+#define SHAKE_THRESHOLD       ((SHAKE_BASE_G + 6000) * 3)  // ~67152
+#define SHAKE_REARM           (SHAKE_THRESHOLD - 9000)     // must fall below this before the next edge
+
+class ThresholdShakeDetector {
+public:
+  static const uint8_t PEAKS_PER_SHAKE = 3;   // threshold crossings per physical shake
+
+  void begin(uint16_t) { reset(); }
+  void reset() { wasAbove = false; lastMs = 0; }
+
+  bool push(const AccelSample &s, uint32_t tMs) {
+    int32_t mag = abs((int32_t)s.x) + abs((int32_t)s.y) + abs((int32_t)s.z);
+    // Hysteresis: at 1 kHz the magnitude dithers around the threshold on every peak
+    bool above = mag > (wasAbove ? SHAKE_REARM : SHAKE_THRESHOLD);
+    bool edge = above && !wasAbove;
+    wasAbove = above;
+    if (edge) lastMs = tMs;
+    return edge;
+  }
+
+  uint32_t peakTimeMs() const { return lastMs; }
+
+  void beginCalibration() {}
+  ShakeCalState calibrate(const AccelSample &) { return CAL_DONE; }
+  bool calibrated() const { return true; }
+  int32_t gravityAxis(uint8_t a) const { return a == 2 ? SHAKE_BASE_G : 0; }
+  int32_t noise() const { return 0; }
+  int32_t threshold() const { return SHAKE_THRESHOLD; }
+  uint32_t worstStepCycles() const { return 0; }
+  bool overBudget() const { return false; }
+
+private:
+  bool wasAbove = false;
+  uint32_t lastMs = 0;
+};
+
+#endif // SHAKEDETECTOR_H
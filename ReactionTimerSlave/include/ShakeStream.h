@@ -0,0 +1,72 @@
+/*
+ * ShakeStream.h - Adaptive-rate shake progress to the host (SHAKE STREAM in Protocol.h)
+ * ESP8266 Joystick only
+ *
+ * update() from loop() sends CMD_SHAKE_PROGRESS when the count moved and
+ * shakeStreamIntervalMs() for the distance left has passed since the last
+ * update, so the host hears more often the closer a player gets. A MAC
+ * failure on our own update (onSent(), send callback) doubles the interval
+ * up to SHAKE_STREAM_MAX_BACKOFF times; a success halves it again. Nothing
+ * waits: a busy channel just sees fewer, fresher counts.
+ *
+ * ACKs, results and power reports go to the host too, and their callbacks
+ * arrive the same way. The send function returns a number for the update
+ * it sent (the caller counts host sends, 0 = not sent) and the callback
+ * passes the number it answers, so only our update's outcome moves the
+ * interval.
+ */
+
+#ifndef SHAKESTREAM_H
+#define SHAKESTREAM_H
+
+#include <Arduino.h>
+#include "Protocol.h"
+
+typedef uint32_t (*ShakeSendFn)(uint8_t cmd, uint16_t data);   // send number, 0 = not sent
+
+class ShakeStream {
+public:
+  explicit ShakeStream(ShakeSendFn sendFn) : sendPacket(sendFn) {}
+
+  // GO: a new count from 0
+  void begin(uint8_t shakeTarget, uint32_t nowMs) {
+    target = shakeTarget;
+    lastSent = 0;
+    lastSendMs = nowMs;
+    backoff = 0;
+    inFlightSend = 0;
+    sent = 0;
+  }
+
+  void update(uint16_t count, uint32_t nowMs) {
+    if (count <= lastSent || count >= target) return;   // nothing new, or CMD_SHAKE_DONE's job
+    const uint32_t wait = shakeStreamIntervalMs(target - count, target) << backoff;
+    if (nowMs - lastSendMs < wait) return;
+    lastSent = count;
+    lastSendMs = nowMs;
+    sent++;
+    inFlightSend = sendPacket(CMD_SHAKE_PROGRESS, encodeShakeProgress(count, target));
+  }
+
+  // Send callback: MAC-layer outcome of host send n, only counted for our own update
+  void onSent(uint32_t n, bool ok) {
+    if (!inFlightSend || n != inFlightSend) return;
+    inFlightSend = 0;
+    if (!ok && backoff < SHAKE_STREAM_MAX_BACKOFF) backoff++;
+    else if (ok && backoff) backoff--;
+  }
+
+  uint8_t updatesSent() const { return sent; }
+  uint8_t backoffShift() const { return backoff; }
+
+private:
+  ShakeSendFn sendPacket;
+  uint8_t target = 0;
+  uint8_t lastSent = 0;
+  uint32_t lastSendMs = 0;
+  uint8_t sent = 0;
+  volatile uint8_t backoff = 0;
+  volatile uint32_t inFlightSend = 0;   // our update's send number, 0 = none pending
+};
+
+#endif // SHAKESTREAM_H
@@ -12,22 +12,31 @@
  *   GPIO12: Vibration motor output
  *   GPIO4:  SDA (MPU-6050)
  *   GPIO5:  SCL (MPU-6050)
+ *   GPIO13: INT (MPU-6050 data ready, optional - FIFO drain falls back to a timer)
  *
  * Game modes:
  *   REACTION: Wait for ESP-NOW GO -> start timer -> wait for button press -> send time
  *   SHAKE:    Wait for ESP-NOW GO -> count shakes via MPU-6050 -> send time when target reached
  *
  * Timing:
- *   The CMD_GO ESP-NOW message starts the timer.
- *   Button press (GPIO14 falling edge) stops the timer via IRAM interrupt (reaction mode).
- *   Shake completion time is recorded when shake count reaches target.
+ *   The CMD_GO ESP-NOW message starts the timer. Its data is the host time at
+ *   which GO fired; with a synced clock (ClockSync.h) the timer is backdated to
+ *   that instant, so radio delay and retries don't count toward the result.
+ *   Button edges are stamped on the CPU cycle counter by an always-armed IRAM
+ *   interrupt (ButtonCapture.h); the first press after GO stops the timer, one
+ *   between GAME_START and GO (or a press held at GO) is an early press.
+ *   Shake completion time is the time of the peak that reaches the target
+ *   (band-pass + peak detector in ShakeDetector.h, calibrated at join).
  *
  * Communication:
  *   ESP-NOW to Host ESP32 (unicast)
  *   CMD_GAME_START received -> sets mode + param
  *   CMD_GO received -> start timing + vibrate motor (haptic GO cue)
  *   CMD_COUNTDOWN -> vibrate briefly (haptic countdown cue)
- *   CMD_REACTION_DONE / CMD_SHAKE_DONE sent back with time_ms
+ *   CMD_CUE_AT -> same pulse, held until the host instant it's stamped with
+ *   CMD_REACTION_DONE sent back in 10 us result ticks (4-byte batch item)
+ *   CMD_SHAKE_DONE sent back with time_ms
+ *   Both are resent from loop() until the host's CMD_ACK (ResultLink.h)
  *
  */
 
@@ -37,13 +46,28 @@
 #include <Wire.h>
 #include "Protocol.h"
 #include "GameTypes.h"
+#include "ClockSync.h"
+#include "MpuFifo.h"
+#include "ShakeDetector.h"
+#include "LightSleep.h"
+#include "ResultLink.h"
+#include "ShakeStream.h"
+#include "ButtonCapture.h"
+#include "OtaClient.h"
+#include "FlightRecorder.h"
+
+ADC_MODE(ADC_VCC);  // A0 reads the chip supply: battery report (STICK POWER in Protocol.h)
 
 // =============================================================================
-// CONFIGURATION - MY_ID set via platformio.ini build flag
+// CONFIGURATION - MY_ID: fixed ID from the stick1-4 envs in platformio.ini.
+// Without it (env:stick) the host assigns one at boot (ID ASSIGNMENT in Protocol.h).
+// ARENA_ID: the table this stick plays at, same as its host (ARENAS in Protocol.h).
 // =============================================================================
-#ifndef MY_ID
-#define MY_ID             ID_STICK1
+#ifndef ARENA_ID
+#define ARENA_ID 0
 #endif
+static_assert(ARENA_ID < MAX_ARENAS, "ARENA_ID out of range");
+#define STICK_CHANNEL     arenaChannel(ARENA_ID)
 
 // =============================================================================
 // PIN DEFINITIONS (from schematic)
@@ -52,23 +76,70 @@
 #define PIN_MOTOR         12    // GPIO12 - vibration motor
 #define PIN_SDA           4     // GPIO4  - MPU-6050 SDA
 #define PIN_SCL           5     // GPIO5  - MPU-6050 SCL
+#define PIN_MPU_INT       13    // GPIO13 - MPU-6050 INT (data ready pulse)
 
 // =============================================================================
-// MPU-6050 CONSTANTS
+// SHAKE DETECTION
 // =============================================================================
-#define MPU_ADDR          0x68
-#define MPU_REG_PWR_MGMT1 0x6B
-#define MPU_REG_ACCEL_XH  0x3B
+// 1 = MPU-6050 FIFO at MPU_SAMPLE_RATE_HZ, drained in bursts (MpuFifo.h)
+// 0 = legacy: one I2C read every 5 ms from loop()
+#ifndef SHAKE_USE_FIFO
+#define SHAKE_USE_FIFO        1
+#endif
+
+// 1 = fixed-point band-pass + peak detector with calibration (ShakeDetector.h)
+// 0 = legacy raw-magnitude threshold
+#ifndef SHAKE_DSP
+#define SHAKE_DSP             1
+#endif
 
-// Shake detection: raw magnitude threshold (works in any orientation)
-// At rest, magnitude ≈ 16384 (1g). Threshold set well above to ignore gravity.
-#define SHAKE_BASE_G          16384
-#define SHAKE_THRESHOLD       ((SHAKE_BASE_G + 6000) * 3)  // ~67152
+#define SHAKE_POLL_MS         5     // legacy polling period (200 Hz)
+#if SHAKE_USE_FIFO
+#define SHAKE_INPUT_RATE_HZ   MPU_SAMPLE_RATE_HZ
+#else
+#define SHAKE_INPUT_RATE_HZ   (1000 / SHAKE_POLL_MS)
+#endif
+
+// =============================================================================
+// POWER (STICK POWER in Protocol.h)
+// Idle and not seated: sleep POWER_SLEEP_BEACONS beacon intervals at a time,
+// waking POWER_WAKE_GUARD_MS ahead of the beacon; the button wakes at once.
+// =============================================================================
+#ifndef POWER_SAVE
+#define POWER_SAVE            1
+#endif
+#define POWER_IDLE_AFTER_MS   10000 // awake this long after the last activity
+#define POWER_SLEEP_BEACONS   4
+#define POWER_WAKE_GUARD_MS   20
+#define POWER_LISTEN_MAX_MS   (BEACON_INTERVAL_MS * 2)  // awake window when the beacon is late
 
 // =============================================================================
 // ESP-NOW
 // =============================================================================
-uint8_t hostMac[6] = {0x88, 0x57, 0x21, 0xB3, 0x05, 0xAC};
+uint8_t hostMac[6] = {0x88, 0x57, 0x21, 0xB3, 0x05, 0xAC};  // replaced by CMD_ASSIGN_ID's sender
+uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+#ifdef MY_ID
+uint8_t myId = MY_ID;
+volatile bool idAssigned = true;
+#else
+uint8_t myId = 0;                   // temporary ID until CMD_ASSIGN_ID (set in setup)
+volatile bool idAssigned = false;
+#endif
+uint8_t newHostMac[6];
+volatile bool hostMacChanged = false;  // set by OnDataRecv, paired in loop()
+volatile bool hostMacHeard = false;    // a frame from hostMac since boot...
+volatile unsigned long hostMacHeardMs = 0;  // ...and millis() of the last one
+
+// Channel follow (CHANNEL SELECTION in Protocol.h): listen until our host's beacon
+uint8_t radioChannel = STICK_CHANNEL;
+bool channelLocked = false;
+volatile uint8_t beaconChannel = 0;    // set by OnDataRecv, applied in loop(); 0 = none
+volatile bool hostHeard = false;
+unsigned long lastHostMs = 0;
+unsigned long lastBeaconMs = 0;
+unsigned long listenStartMs = 0;
+unsigned long lastHello = 0;
 
 // =============================================================================
 // GAME STATE
@@ -86,67 +157,78 @@ uint8_t currentMode = MODE_REACTION;
 uint8_t shakeTarget = 10;
 uint8_t assignedSlot = 0;           // which player slot we were assigned (1-4), 0 = not assigned
 
-// Button debouncing for join (capacitor causes slow edges)
-bool lastButtonState = HIGH;
-unsigned long lastButtonChange = 0;
 bool joinSent = false;              // prevent repeat join sends while held
-#define DEBOUNCE_MS 50
 
 // =============================================================================
 // PRECISE TIMING
 // =============================================================================
-volatile uint32_t g_go_time_us = 0;       // timestamp when GO received
+volatile uint32_t g_go_time_us = 0;       // GO instant, micros()
 volatile bool g_go_received = false;       // flag: GO happened
-volatile uint32_t g_button_time_us = 0;   // timestamp when button pressed
-volatile bool g_button_pressed = false;    // flag: button was pressed
+uint64_t g_go_at = 0;                      // GO instant, button cycles
+uint64_t g_armed_at = 0;                   // GAME_START: presses from here on count
+uint64_t g_press_at = 0;                   // first press since armed
+bool g_press_seen = false;
+
+ButtonCapture button;
+ClockSync clockSync;
+FlightRecorder flightRecorder;   // last events before a reset, in RTC memory (FlightRecorder.h)
+#define GO_MAX_AGE_US     250000   // older GO timestamps mean a bad estimate - fall back to receive time
 
-// Button press: falling edge on GPIO14 (active LOW)
+// Button: both edges on GPIO14 (active LOW), always armed
 void IRAM_ATTR onButton() {
-  if (g_go_received && jsState == JS_REACTION_TIMING) {
-    g_button_time_us = micros();
-    g_button_pressed = true;
-  }
+  button.onEdge();
+  flightRecorder.record(FL_ISR, FL_IRQ_BUTTON, button.rawLevelLow());
+}
+
+// GO-to-button interval on the host's timebase. Measured in cycles; the
+// drift correction (crystal ppm error over the interval) is ClockSync's.
+uint32_t reactionElapsedUs() {
+  uint32_t localUs = (uint32_t)button.toUs(g_press_at - g_go_at);
+  if (!clockSync.synced(millis())) return localUs;
+  return clockSync.localToHost(g_go_time_us + localUs) - clockSync.localToHost(g_go_time_us);
 }
 
 // Called when CMD_GO is received via ESP-NOW
-void handleGO() {
-  g_go_time_us = micros();
+// hostTicks = host GO time (goTicks()), rxUs / rxAt = local receive time
+void handleGO(uint16_t hostTicks, uint32_t rxUs, uint64_t rxAt) {
+  if (g_go_received) return;  // retried GO carries the same timestamp
+
+  uint32_t goUs = rxUs;
+  if (clockSync.synced(millis())) {
+    uint16_t nowTicks = goTicks(clockSync.localToHost(rxUs));
+    int32_t ageUs = (int32_t)(int16_t)(nowTicks - hostTicks) << GO_TICK_SHIFT;
+    if (ageUs < 0) ageUs = 0;  // GO can't be in the future - estimate error
+    if (ageUs <= GO_MAX_AGE_US) {
+      goUs = rxUs - ageUs;
+      Serial.printf("[GO] Backdated %ld us (rtt=%u us)\n", (long)ageUs, clockSync.rttUs());
+    } else {
+      Serial.printf("[GO] Timestamp too old (%ld us), using receive time\n", (long)ageUs);
+    }
+  } else {
+    Serial.println("[GO] Clock not synced, using receive time");
+  }
+  g_go_time_us = goUs;
+  g_go_at = rxAt - button.fromUs(rxUs - goUs);
   g_go_received = true;
 }
 
 // =============================================================================
-// MPU-6050 FUNCTIONS
+// MPU-6050
 // =============================================================================
-void mpuWriteReg(uint8_t reg, uint8_t val) {
-  Wire.beginTransmission(MPU_ADDR);
-  Wire.write(reg);
-  Wire.write(val);
-  Wire.endTransmission();
-}
-
-bool mpuReadBlock(uint8_t reg, uint8_t *buf, uint8_t len) {
-  Wire.beginTransmission(MPU_ADDR);
-  Wire.write(reg);
-  if (Wire.endTransmission(false) != 0) return false;
-  if (Wire.requestFrom(MPU_ADDR, len) != len) return false;
-  for (uint8_t i = 0; i < len; i++) buf[i] = Wire.read();
-  return true;
-}
+MpuFifo mpu;
+volatile uint16_t g_mpu_pulses = 0;       // INT pulses since the last FIFO drain
 
-bool mpuInit() {
-  mpuWriteReg(MPU_REG_PWR_MGMT1, 0x00); // wake up
-  delay(10);  // reduced from 100ms - MPU-6050 wakes faster
-  return true;
+void IRAM_ATTR onMpuInt() {
+  g_mpu_pulses = g_mpu_pulses + 1;
 }
 
-bool mpuReadAccel(int16_t &ax, int16_t &ay, int16_t &az) {
-  uint8_t data[6];
-  if (!mpuReadBlock(MPU_REG_ACCEL_XH, data, 6)) return false;
-  ax = (int16_t)((data[0] << 8) | data[1]);
-  ay = (int16_t)((data[2] << 8) | data[3]);
-  az = (int16_t)((data[4] << 8) | data[5]);
-  return true;
-}
+#if SHAKE_DSP
+ShakeDetector shaker;
+#else
+ThresholdShakeDetector shaker;
+#endif
+volatile bool g_calibrate_pending = false;  // set on join, run from loop() while idle
+bool calibrating = false;
 
 // =============================================================================
 // MOTOR VIBRATION
@@ -167,61 +249,207 @@ void vibUpdate() {
   }
 }
 
+// Countdown pulse scheduled by CMD_CUE_AT (local micros())
+#define CUE_PULSE_MS      200
+uint32_t cueAtUs = 0;
+bool cuePending = false;
+
+// hostTicks = host cue time (goTicks()), rxUs = local receive time
+void handleCueAt(uint16_t hostTicks, uint32_t rxUs) {
+  if (clockSync.synced(millis())) {
+    uint16_t nowTicks = goTicks(clockSync.localToHost(rxUs));
+    int32_t leadUs = (int32_t)(int16_t)(hostTicks - nowTicks) << GO_TICK_SHIFT;
+    if (leadUs > 0 && leadUs <= CUE_MAX_LEAD_US) {
+      cueAtUs = rxUs + leadUs;
+      cuePending = true;
+      return;
+    }
+  }
+  vibStart(CUE_PULSE_MS);  // unsynced or stamp out of range: pulse now
+}
+
+void cueUpdate() {
+  if (cuePending && (int32_t)(micros() - cueAtUs) >= 0) {
+    cuePending = false;
+    vibStart(CUE_PULSE_MS);
+  }
+}
+
 // =============================================================================
 // ESP-NOW SEND
 // =============================================================================
+// Every stick transmission goes through here (FL_TX in the flight recorder).
+// Sends to the host that went out are numbered; OnDataSent numbers their
+// callbacks the same way, in order, so a callback can be matched to its frame.
+uint32_t hostSends = 0;          // host sends esp_now_send() took
+uint32_t hostSendsAnswered = 0;  // send callbacks for them
+
+int radioSend(uint8_t* mac, const uint8_t* data, uint8_t len) {
+  flightRecorder.frame(FL_TX, data, len, true);
+  const int result = esp_now_send(mac, (uint8_t*)data, len);
+  if (result == 0 && mac == hostMac) hostSends++;
+  return result;
+}
+
 void sendToHost(uint8_t cmd, uint16_t data) {
   GamePacket pkt;
-  buildPacket(&pkt, ID_HOST, MY_ID, cmd, data);
-  int result = esp_now_send(hostMac, (uint8_t*)&pkt, sizeof(pkt));
+  buildPacket(&pkt, ID_HOST, myId, cmd, data);
+  int result = radioSend(hostMac, (uint8_t*)&pkt, sizeof(pkt));
   Serial.printf("[SEND] cmd=0x%02X data=%d result=%d\n", cmd, data, result);
 }
 
-// Send critical result with retries (reaction/shake done)
-void sendToHostRetry(uint8_t cmd, uint16_t data) {
-  for (int i = 0; i < 3; i++) {
-    sendToHost(cmd, data);
-    delay(20);
-  }
+// Round results: sent once, resent from loop() until the host ACKs (ResultLink.h)
+int sendResultFrame(const uint8_t* data, uint8_t len) {
+  return radioSend(hostMac, data, len);
+}
+
+ResultLink resultLink(sendResultFrame);
+
+// Firmware updates from the host, pulled while idle (OtaClient.h)
+OtaClient otaClient(sendResultFrame);
+
+void sendResult(uint8_t cmd, uint16_t data) {
+  resultLink.send(myId, cmd, data, millis());
+}
+
+// Fine result (FINE RESULT TIMES in Protocol.h): one-item batch
+void sendResultTicks(uint8_t cmd, uint32_t ticks) {
+  resultLink.sendTicks(myId, cmd, ticks, millis());
+}
+
+// Shake progress: adaptive rate, no serial line per update (ShakeStream.h)
+uint32_t sendProgressPacket(uint8_t cmd, uint16_t data) {
+  GamePacket pkt;
+  buildPacket(&pkt, ID_HOST, myId, cmd, data);
+  return radioSend(hostMac, (uint8_t*)&pkt, sizeof(pkt)) == 0 ? hostSends : 0;
+}
+
+ShakeStream shakeStream(sendProgressPacket);
+
+// Sequenced ACK for a ReliablePacket from the host
+SeqWindow hostWindow;
+
+void sendSeqAck(const ReliablePacket &rx) {
+  ReliablePacket ack;
+  buildSeqAck(&ack, myId, &rx, &hostWindow);
+  radioSend(hostMac, (uint8_t*)&ack, sizeof(ack));
 }
 
 // =============================================================================
 // ESP-NOW CALLBACK
 // =============================================================================
 void OnDataRecv(uint8_t *mac, uint8_t *data, uint8_t len) {
-  if (len != (uint8_t)sizeof(GamePacket)) return;
+  uint32_t rxUs = micros();  // first thing: receive timestamp for GO / sync
+  uint64_t rxAt = button.now();
+  flightRecorder.frame(FL_RX, data, len, false);
+  if (memcmp(mac, hostMac, 6) == 0) {
+    hostMacHeardMs = millis();
+    hostMacHeard = true;
+  }
+
+  // Firmware update frames, from our host only: copied here, decoded and written from loop()
+  if (isOtaFrame(data, len)) {
+    if (channelLocked && memcmp(mac, hostMac, 6) == 0) otaClient.onFrame(data, len, myId);
+    return;
+  }
+
+  if (len == (uint8_t)SYNC_PACKET_SIZE) {
+    SyncPacket sp;
+    memcpy(&sp, data, sizeof(sp));
+    if (!validateSyncPacket(&sp)) return;
+    if (sp.cmd != CMD_SYNC_RESP || sp.dest_id != myId) return;
+    hostHeard = true;
+    clockSync.handleResponse(&sp, rxUs, millis());
+    return;
+  }
 
   GamePacket pkt;
-  memcpy(&pkt, data, sizeof(pkt));
-  if (!validatePacket(&pkt)) return;
-  if (pkt.dest_id != MY_ID && pkt.dest_id != ID_BROADCAST) return;
+  bool sequenced = false;  // true = already ACKed with a sequenced ACK
+
+  if (len == (uint8_t)RELIABLE_PACKET_SIZE) {
+    ReliablePacket rp;
+    memcpy(&rp, data, sizeof(rp));
+    if (!validateReliablePacket(&rp)) return;
+    if (rp.base.dest_id != myId) return;
+    bool fresh = hostWindow.accept(rp.epoch, rp.seq);
+    sendSeqAck(rp);  // ACK every copy - the host may have lost our last ACK
+    if (!fresh) {
+      Serial.printf("[CMD] duplicate seq=%d cmd=0x%02X\n", rp.seq, rp.base.cmd);
+      return;
+    }
+    pkt = rp.base;
+    sequenced = true;
+  } else if (len == (uint8_t)sizeof(GamePacket)) {
+    memcpy(&pkt, data, sizeof(pkt));
+    if (!validatePacket(&pkt)) return;
+    if (pkt.dest_id != myId && pkt.dest_id != ID_BROADCAST) return;
+  } else {
+    return;
+  }
+
+  // Until our host's beacon, the frames we hear may belong to another table
+  if (pkt.cmd == CMD_CHANNEL_BEACON) {
+    if (pkt.src_id == ID_HOST && pkt.data_low == ARENA_ID) beaconChannel = pkt.data_high;
+    return;
+  }
+  if (!channelLocked) return;
+  if (pkt.src_id == ID_HOST) hostHeard = true;
 
   switch (pkt.cmd) {
+    case CMD_ACK:
+      resultLink.onAck(decodeAck(packetData(&pkt)).cmd);
+      break;
+
     case CMD_IDLE:
+      resultLink.cancel();
       jsState = JS_IDLE;
       assignedSlot = 0;  // reset slot assignment
       joinSent = false;  // allow new join request
       g_go_received = false;
-      g_button_pressed = false;
-      sendToHost(CMD_ACK, CMD_IDLE);
+      g_press_seen = false;
+      cuePending = false;
+      if (!sequenced) sendToHost(CMD_ACK, CMD_IDLE);
       Serial.println("[CMD] IDLE");
       break;
 
+    case CMD_ASSIGN_ID:
+      // Host registered our MAC: answer to this ID and send to this host from now on.
+      // Once we have an ID, another host (a neighbouring table) may only take us
+      // over after ours has been silent for BEACON_LOST_MS.
+      if (pkt.src_id != ID_HOST || !isStickId(pkt.data_low)) break;
+      if (idAssigned && memcmp(mac, hostMac, 6) != 0 && hostMacHeard &&
+          millis() - hostMacHeardMs < BEACON_LOST_MS) {
+        Serial.printf("[CMD] ASSIGN_ID from another host ignored - ours is still here\n");
+        break;
+      }
+      myId = pkt.data_low;
+      if (memcmp(mac, hostMac, 6) != 0) {
+        memcpy(newHostMac, mac, 6);
+        hostMacChanged = true;
+        hostMacHeardMs = millis();   // the new host, from now on
+      }
+      idAssigned = true;
+      Serial.printf("[CMD] ASSIGN_ID - now joystick %d (0x%02X)\n", myId - ID_STICK_FIRST + 1, myId);
+      break;
+
     case CMD_OK:
       // Host acknowledged our join request, data = slot number (1-4)
       assignedSlot = pkt.data_low;
       vibStart(200);  // haptic feedback for successful join
+      g_calibrate_pending = true;  // stick is usually at rest right after the press
       Serial.printf("[CMD] OK - assigned to Player %d slot\n", assignedSlot);
       break;
 
     case CMD_GAME_START:
-      // data_high = mode, data_low = param (shake target or 0)
-      currentMode = pkt.data_high;
-      shakeTarget = pkt.data_low * 3;  // MPU detects ~3 edges per shake, so triple the target
+      resultLink.cancel();
+      currentMode = decodeGameStart(packetData(&pkt)).mode;
+      shakeTarget = decodeGameStart(packetData(&pkt)).param * shaker.PEAKS_PER_SHAKE;
+      if (!shaker.calibrated()) g_calibrate_pending = true;  // join-time attempt moved: retry
       jsState = JS_WAITING_GO;
       g_go_received = false;
-      g_button_pressed = false;
-      sendToHost(CMD_ACK, CMD_GAME_START);
+      g_press_seen = false;
+      g_armed_at = button.now();
+      if (!sequenced) sendToHost(CMD_ACK, CMD_GAME_START);
       Serial.printf("[CMD] GAME_START mode=%d param=%d\n", currentMode, shakeTarget);
       break;
 
@@ -233,16 +461,22 @@ void OnDataRecv(uint8_t *mac, uint8_t *data, uint8_t len) {
 
     case CMD_COUNTDOWN:
       // Haptic countdown pulse: 200ms vibrate
-      vibStart(200);
-      sendToHost(CMD_ACK, CMD_COUNTDOWN);
+      vibStart(CUE_PULSE_MS);
+      if (!sequenced) sendToHost(CMD_ACK, CMD_COUNTDOWN);
       Serial.printf("[CMD] COUNTDOWN %d\n", pkt.data_low);
       break;
 
+    case CMD_CUE_AT:
+      handleCueAt(packetData(&pkt), rxUs);
+      if (!sequenced) sendToHost(CMD_ACK, CMD_CUE_AT);
+      Serial.printf("[CMD] CUE_AT %s\n", cuePending ? "scheduled" : "now");
+      break;
+
     case CMD_GO:
       // GO signal received via ESP-NOW - start timing!
-      sendToHost(CMD_ACK, CMD_GO);
+      if (!sequenced) sendToHost(CMD_ACK, CMD_GO);
       if (jsState == JS_WAITING_GO) {
-        handleGO();  // sets g_go_time_us and g_go_received
+        handleGO(packetData(&pkt), rxUs, rxAt);  // sets g_go_time_us and g_go_received
         Serial.println("[CMD] GO received!");
       }
       break;
@@ -253,61 +487,94 @@ void OnDataRecv(uint8_t *mac, uint8_t *data, uint8_t len) {
 }
 
 void OnDataSent(uint8_t *mac, uint8_t status) {
-  // optional
+  if (memcmp(mac, hostMac, 6) != 0) return;
+  const uint32_t n = ++hostSendsAnswered;
+  if (status != 0) flightRecorder.record(FL_TX_FAIL, 0, 0);
+  if (resultLink.pending()) resultLink.onSent(status == 0);
+  shakeStream.onSent(n, status == 0);
 }
 
 // =============================================================================
 // SHAKE COUNTING (non-blocking, called in loop during JS_SHAKE_COUNTING)
 // =============================================================================
 uint16_t shakeCount = 0;
-bool shakeWasAbove = false;         // true = last sample was above threshold
 uint32_t shakeStartTime_ms = 0;
-uint8_t shakeLastReported = 0;     // last progress milestone sent (multiple of 5)
+uint32_t shakeDoneAt_ms = 0;       // GO-relative time of the sample that reached the target
 
 void shakeReset() {
   shakeCount = 0;
-  shakeWasAbove = false;
-  shakeLastReported = 0;
-  shakeStartTime_ms = millis();
+  shaker.reset();
+  calibrating = false;  // GO wins over a calibration still in progress
+  shakeDoneAt_ms = 0;
+  // Start from the (backdated) GO instant, not from when we noticed it
+  shakeStartTime_ms = millis() - (micros() - g_go_time_us) / 1000;
+  shakeStream.begin(shakeTarget, millis());
+#if SHAKE_USE_FIFO
+  g_mpu_pulses = 0;
+  mpu.start();
+#endif
+}
+
+// Run the detector on one sample taken tMs after GO. Returns true once the target is reached.
+bool shakeSample(const AccelSample &s, uint32_t tMs) {
+  if (shaker.push(s, tMs)) {
+    shakeCount++;
+    Serial.printf("[SHAKE] count=%d/%d  t=%lu\n", shakeCount, shakeTarget,
+                  (unsigned long)shaker.peakTimeMs());
+  }
+
+  if (shakeCount >= shakeTarget) {
+    shakeDoneAt_ms = shaker.peakTimeMs();
+    return true;
+  }
+  return false;
 }
 
 // Returns: 0 = still counting, TIME_PENALTY = timeout, >0 = completion time in ms
 uint16_t shakeUpdate() {
+  bool done = false;
+
+#if SHAKE_USE_FIFO
+  if (mpu.drainDue(g_mpu_pulses, millis())) {
+    g_mpu_pulses = 0;
+    // Sample times are relative to mpu.start(); shift them to be relative to GO
+    uint32_t fifoOffsetMs = mpu.startedAtMs() - shakeStartTime_ms;
+    AccelSample batch[MPU_DRAIN_MAX_SAMPLES];
+    uint8_t n;
+    do {
+      n = mpu.drain(batch);
+      for (uint8_t i = 0; i < n && !done; i++) {
+        done = shakeSample(batch[i], fifoOffsetMs + mpu.sampleTimeMs(i));
+      }
+    } while (!done && n == MPU_DRAIN_MAX_SAMPLES);
+  }
+#else
   // Throttle to ~200Hz (matches working joystick test code)
   static unsigned long lastRead = 0;
-  if (millis() - lastRead < 5) return 0;
-  lastRead = millis();
-
-  int16_t ax, ay, az;
-  if (!mpuReadAccel(ax, ay, az)) return 0;
-
-  // Raw magnitude across all axes — threshold is high enough to ignore gravity
-  int32_t mag = abs((int32_t)ax) + abs((int32_t)ay) + abs((int32_t)az);
-  bool above = mag > SHAKE_THRESHOLD;
-
-  // Rising-edge detection: count when magnitude crosses above threshold
-  if (above && !shakeWasAbove) {
-    shakeCount++;
-    Serial.printf("[SHAKE] count=%d/%d  mag=%ld\n", shakeCount, shakeTarget, (long)mag);
-
-    // Send progress to host in steps matched to internal target
-    // ~12 updates total (one per ring LED), using internal counts
-    uint8_t step = shakeTarget / 12;
-    if (step < 1) step = 1;
-    uint8_t milestone = (shakeCount / step) * step;
-    if (milestone > shakeLastReported && milestone < shakeTarget) {
-      shakeLastReported = milestone;
-      uint16_t progressData = ((uint16_t)milestone << 8) | shakeTarget;
-      sendToHost(CMD_SHAKE_PROGRESS, progressData);
+  if (millis() - lastRead >= SHAKE_POLL_MS) {
+    lastRead = millis();
+    AccelSample sample;
+    if (mpu.readAccel(sample.x, sample.y, sample.z)) {
+      done = shakeSample(sample, millis() - shakeStartTime_ms);
     }
   }
-  shakeWasAbove = above;
+#endif
+
+  // Progress goes out from here, not per peak: a FIFO drain can count several at once
+  shakeStream.update(shakeCount, millis());
 
   // Check if target reached
-  if (shakeCount >= shakeTarget) {
-    uint32_t elapsed = millis() - shakeStartTime_ms;
+  if (done) {
+    Serial.printf("[SHAKE] %d progress updates sent (backoff %d)\n",
+                  shakeStream.updatesSent(), shakeStream.backoffShift());
+    if (shaker.overBudget()) {
+      Serial.printf("[SHAKE] DSP step took %lu cycles (budget %d)\n",
+                    (unsigned long)shaker.worstStepCycles(), SHAKE_DSP_BUDGET_CYCLES);
+    }
+    uint32_t elapsed = shakeDoneAt_ms;
     // Cap at 0xFFFE (0xFFFF is penalty)
     if (elapsed > 0xFFFE) elapsed = 0xFFFE;
+    if (elapsed == 0) elapsed = 1;
     return (uint16_t)elapsed;
   }
 
@@ -319,44 +586,252 @@ uint16_t shakeUpdate() {
   return 0; // still going
 }
 
+// =============================================================================
+// SHAKE CALIBRATION (gravity + noise floor, runs while idle after joining)
+// =============================================================================
+void calibrationUpdate() {
+  if (jsState != JS_IDLE && jsState != JS_WAITING_GO) {
+    calibrating = false;  // round started: runJoystick() hands the MPU back
+    return;
+  }
+
+  if (!calibrating) {
+    if (!g_calibrate_pending) return;
+    g_calibrate_pending = false;
+    calibrating = true;
+    shaker.beginCalibration();
+#if SHAKE_USE_FIFO
+    g_mpu_pulses = 0;
+    mpu.start();
+#endif
+  }
+
+  ShakeCalState st = CAL_RUNNING;
+#if SHAKE_USE_FIFO
+  if (!mpu.drainDue(g_mpu_pulses, millis())) return;
+  g_mpu_pulses = 0;
+  AccelSample batch[MPU_DRAIN_MAX_SAMPLES];
+  uint8_t n = mpu.drain(batch);
+  for (uint8_t i = 0; i < n && st == CAL_RUNNING; i++) st = shaker.calibrate(batch[i]);
+#else
+  static unsigned long lastRead = 0;
+  if (millis() - lastRead < SHAKE_POLL_MS) return;
+  lastRead = millis();
+  AccelSample sample;
+  if (mpu.readAccel(sample.x, sample.y, sample.z)) st = shaker.calibrate(sample);
+#endif
+  if (st == CAL_RUNNING) return;
+
+  calibrating = false;
+  mpu.stop();
+  if (st == CAL_DONE) {
+    Serial.printf("[CAL] gravity=(%ld,%ld,%ld) noise=%ld threshold=%ld\n",
+                  (long)shaker.gravityAxis(0), (long)shaker.gravityAxis(1),
+                  (long)shaker.gravityAxis(2), (long)shaker.noise(), (long)shaker.threshold());
+  } else {
+    Serial.println("[CAL] Stick moved - keeping previous calibration");
+  }
+}
+
+// =============================================================================
+// CHANNEL FOLLOW (CHANNEL SELECTION in Protocol.h)
+// =============================================================================
+void setRadioChannel(uint8_t ch) {
+  radioChannel = ch;
+  wifi_set_channel(ch);
+  esp_now_set_peer_channel(hostMac, ch);
+  if (!idAssigned) esp_now_set_peer_channel(broadcastMac, ch);
+}
+
+void channelUpdate() {
+  unsigned long now = millis();
+  uint8_t ch = beaconChannel;
+  if (ch >= CHANNEL_FIRST && ch <= CHANNEL_LAST) {
+    beaconChannel = 0;
+    lastHostMs = now;
+    lastBeaconMs = now;
+    if (!channelLocked) Serial.printf("[CH] Host found, channel %d\n", ch);
+    else if (ch != radioChannel) Serial.printf("[CH] Host moved to channel %d\n", ch);
+    channelLocked = true;
+    if (ch != radioChannel) setRadioChannel(ch);
+    return;
+  }
+  if (hostHeard) {
+    hostHeard = false;
+    lastHostMs = now;
+  }
+  if (channelLocked) {
+    if (now - lastHostMs < BEACON_LOST_MS) return;
+    channelLocked = false;
+    listenStartMs = now;
+    Serial.printf("[CH] Host lost on channel %d - listening\n", radioChannel);
+    return;
+  }
+  if (now - listenStartMs < CHANNEL_LISTEN_MS) return;
+  listenStartMs = now;
+  setRadioChannel(nextScanChannel(radioChannel));
+}
+
+// =============================================================================
+// IDLE LIGHT SLEEP + POWER REPORT (STICK POWER in Protocol.h)
+// millis() stands still while asleep: awake time is millis(), asleep time
+// comes from LightSleep's RTC measurement.
+// =============================================================================
+LightSleep lightSleep;
+unsigned long powerActiveMs = 0;      // last time we had a reason to stay awake
+unsigned long wakeMs = 0;
+bool awaitingBeacon = false;          // woke up, first beacon not heard yet
+uint32_t wakeBeaconMaxMs = 0;
+unsigned long powerPeriodMs = 0;      // millis() at the start of the report period
+uint32_t periodAsleepMs = 0;
+
+void powerReport(unsigned long now) {
+  const uint32_t awakeMs = now - powerPeriodMs;
+  if (awakeMs + periodAsleepMs < POWER_REPORT_MS || !channelLocked || !idAssigned) return;
+  const LightSleep::Stats st = lightSleep.takeStats();
+  const uint32_t v[POWER_FIELD_COUNT] = {
+    ESP.getVcc(),
+    (uint32_t)((uint64_t)awakeMs * 1000 / (awakeMs + periodAsleepMs)),
+    st.sleeps,
+    st.radioMaxUs,
+    wakeBeaconMaxMs,
+  };
+  static BatchWriter batch;
+  batch.begin(ID_HOST, myId);
+  for (uint8_t f = 0; f < POWER_FIELD_COUNT; f++) addStickPower(batch, f, v[f]);
+  radioSend(hostMac, batch.buf, batch.seal(0, 0));
+  Serial.printf("[POWER] %lu mV, awake %lu/1000, %lu sleeps, wake radio %lu us, beacon +%lu ms\n",
+                (unsigned long)v[POWER_VCC_MV], (unsigned long)v[POWER_AWAKE_PERMILLE],
+                (unsigned long)st.sleeps, (unsigned long)st.radioMaxUs, (unsigned long)wakeBeaconMaxMs);
+  powerPeriodMs = now;
+  periodAsleepMs = 0;
+  wakeBeaconMaxMs = 0;
+}
+
+// Seated sticks never sleep, so CMD_GAME_START / CMD_GO latency is unchanged
+void powerUpdate() {
+  unsigned long now = millis();
+  powerReport(now);
+  if (!POWER_SAVE) return;
+  bool idle = channelLocked && idAssigned && jsState == JS_IDLE && assignedSlot == 0 &&
+              !joinSent && !vibActive && !calibrating && !cuePending && button.idle() && !otaClient.busy();
+  if (!idle) {
+    powerActiveMs = now;
+    awaitingBeacon = false;
+    return;
+  }
+  if (now - powerActiveMs < POWER_IDLE_AFTER_MS) return;
+
+  // Stay up for the beacon we woke for: it re-aligns the next sleep
+  uint32_t sinceBeacon = 0;
+  if (awaitingBeacon) {
+    if ((long)(lastBeaconMs - wakeMs) >= 0) {
+      if (lastBeaconMs - wakeMs > wakeBeaconMaxMs) wakeBeaconMaxMs = lastBeaconMs - wakeMs;
+      sinceBeacon = now - lastBeaconMs;
+    } else if (now - wakeMs < POWER_LISTEN_MAX_MS) {
+      return;
+    }
+  } else {
+    sinceBeacon = (now - lastBeaconMs) % BEACON_INTERVAL_MS;
+  }
+  const uint32_t cycleMs = POWER_SLEEP_BEACONS * BEACON_INTERVAL_MS - POWER_WAKE_GUARD_MS;
+  if (sinceBeacon >= cycleMs) sinceBeacon = 0;
+
+  Serial.flush();
+  periodAsleepMs += lightSleep.sleep(cycleMs - sinceBeacon, PIN_BUTTON, radioChannel);
+  button.resume();
+  wakeMs = millis();
+  awaitingBeacon = true;
+}
+
+// =============================================================================
+// ID ASSIGNMENT (CMD_HELLO until the host answers, see Protocol.h)
+// =============================================================================
+void idAssignmentUpdate() {
+  if (hostMacChanged) {
+    hostMacChanged = false;
+    esp_now_del_peer(hostMac);
+    memcpy(hostMac, newHostMac, 6);
+    esp_now_add_peer(hostMac, ESP_NOW_ROLE_COMBO, radioChannel, NULL, 0);
+    hostSendsAnswered = hostSends;   // the old host's callbacks no longer match hostMac
+    Serial.printf("[ID] Host is %02X:%02X:%02X:%02X:%02X:%02X\n",
+                  hostMac[0], hostMac[1], hostMac[2], hostMac[3], hostMac[4], hostMac[5]);
+  }
+  if (idAssigned || !channelLocked) return;
+
+  unsigned long now = millis();
+  if (lastHello != 0 && now - lastHello < HELLO_INTERVAL_MS) return;
+  lastHello = now;
+  GamePacket pkt;
+  buildPacket(&pkt, ID_HOST, myId, CMD_HELLO, FW_VERSION_DATA);
+  radioSend(broadcastMac, (uint8_t*)&pkt, sizeof(pkt));
+}
+
+// =============================================================================
+// CLOCK SYNC (pings host; paused while a round is being timed)
+// =============================================================================
+void clockSyncUpdate() {
+  if (!idAssigned || !channelLocked) return;
+  if (jsState == JS_REACTION_TIMING || jsState == JS_SHAKE_COUNTING) return;
+
+  unsigned long now = millis();
+  if (!clockSync.due(now)) return;
+
+  SyncPacket sp;
+  clockSync.buildRequest(&sp, myId, now);
+  radioSend(hostMac, (uint8_t*)&sp, sizeof(sp));
+}
+
+// =============================================================================
+// BUTTON (confirmed edges from ButtonCapture, by the time they happened)
+// =============================================================================
+void joinPress() {
+  if (!idAssigned) {
+    Serial.println("[JOIN] No ID from the host yet");
+  } else if (assignedSlot == 0) {
+    // Send version in CMD_REQ_ID so the host can check compatibility
+    sendToHost(CMD_REQ_ID, FW_VERSION_DATA);
+    Serial.printf("[JOIN] Button pressed - sending CMD_REQ_ID (firmware %s)\n", FW_VERSION_STRING);
+  } else {
+    // Seated: a tournament changeover takes this as "the next entrant is here"
+    sendToHost(CMD_REQ_ID, FW_VERSION_DATA);
+    Serial.printf("[JOIN] Ready on slot %d\n", assignedSlot);
+  }
+  joinSent = true;  // prevent repeat sends while held
+}
+
+void buttonUpdate() {
+  button.poll();
+  ButtonEdge e;
+  while (button.next(e)) {
+    if (!e.pressed) {
+      joinSent = false;
+    } else if (jsState == JS_IDLE) {
+      if (!joinSent) joinPress();
+    } else if (!g_press_seen && e.at >= g_armed_at &&
+               (jsState == JS_WAITING_GO || jsState == JS_REACTION_TIMING)) {
+      g_press_at = e.at;
+      g_press_seen = true;
+    }
+  }
+}
+
 // =============================================================================
 // MAIN STATE MACHINE (runs in loop)
 // =============================================================================
 void runJoystick() {
+  buttonUpdate();
+  resultLink.update(millis());
+  cueUpdate();
   vibUpdate(); // keep motor timing working
 
-  switch (jsState) {
-    case JS_IDLE: {
-      // Poll button for join request (debounced due to capacitor)
-      bool currentButton = digitalRead(PIN_BUTTON);
-      unsigned long now = millis();
-
-      // Track when button state changes
-      if (currentButton != lastButtonState) {
-        lastButtonChange = now;
-        lastButtonState = currentButton;
-      }
-
-      // Act only after button held LOW for DEBOUNCE_MS (stable press)
-      if (currentButton == LOW && (now - lastButtonChange) > DEBOUNCE_MS && !joinSent) {
-        // Confirmed press - send join request if not already assigned
-        if (assignedSlot == 0) {
-          // Send version in CMD_REQ_ID: data_high = (MAJOR<<4)|MINOR, data_low = PATCH
-          uint16_t versionData = ((uint16_t)((FW_VERSION_MAJOR << 4) | FW_VERSION_MINOR) << 8) | FW_VERSION_PATCH;
-          sendToHost(CMD_REQ_ID, versionData);
-          Serial.printf("[JOIN] Button pressed - sending CMD_REQ_ID (firmware %s)\n", FW_VERSION_STRING);
-        } else {
-          Serial.printf("[JOIN] Already assigned to slot %d\n", assignedSlot);
-        }
-        joinSent = true;  // prevent repeat sends while held
-      }
+  // Round ended or host reset us mid-shake: stop sampling
+  if (mpu.isRunning() && jsState != JS_SHAKE_COUNTING && !calibrating) mpu.stop();
+  calibrationUpdate();
 
-      // Reset when button released
-      if (currentButton == HIGH) {
-        joinSent = false;
-      }
-      break;
-    }
+  switch (jsState) {
+    case JS_IDLE:
+      break;  // join presses are taken in buttonUpdate()
 
     case JS_WAITING_GO:
       // Wait for ESP-NOW CMD_GO (handleGO sets g_go_received)
@@ -364,16 +839,17 @@ void runJoystick() {
         Serial.println("[GO] ESP-NOW GO received!");
 
         if (currentMode == MODE_REACTION) {
-          // Check for early button press BEFORE starting motor
-          // (motor current draw can glitch the button pin)
-          bool earlyPress = (digitalRead(PIN_BUTTON) == LOW);
+          // Pressed since GAME_START, or held down, before the GO instant.
+          // Presses still in their glitch window are judged in JS_REACTION_TIMING.
+          bool earlyPress = (g_press_seen && g_press_at < g_go_at) ||
+                            (button.pressed() && button.changedAt() < g_go_at);
 
           // Haptic GO cue
           vibStart(500);
 
           if (earlyPress) {
             Serial.println("[REACTION] PENALTY - early press!");
-            sendToHostRetry(CMD_REACTION_DONE, TIME_PENALTY);
+            sendResult(CMD_REACTION_DONE, TIME_PENALTY);
             jsState = JS_DONE;
           } else {
             jsState = JS_REACTION_TIMING;
@@ -390,26 +866,29 @@ void runJoystick() {
       break;
 
     case JS_REACTION_TIMING:
-      // Wait for button press (interrupt sets g_button_pressed)
-      if (g_button_pressed) {
-        // Calculate time in ms from GO to button
-        uint32_t elapsed_us = g_button_time_us - g_go_time_us;
-        uint16_t elapsed_ms = (uint16_t)(elapsed_us / 1000);
-        if (elapsed_ms == 0) elapsed_ms = 1; // minimum 1ms
+      // Wait for button press (first confirmed press since GAME_START)
+      if (g_press_seen && g_press_at < g_go_at) {
+        Serial.println("[REACTION] PENALTY - early press!");
+        sendResult(CMD_REACTION_DONE, TIME_PENALTY);
+        jsState = JS_DONE;
+      } else if (g_press_seen) {
+        // GO to button in result ticks (10 us), sub-ms ties are decided by the host
+        uint32_t elapsed_us = reactionElapsedUs();
+        uint32_t ticks = resultTicksFromUs(elapsed_us);
+        if (ticks == 0) ticks = 1; // minimum one tick
 
-        Serial.printf("[REACTION] Time: %d ms (%d us)\n", elapsed_ms, elapsed_us);
-        sendToHostRetry(CMD_REACTION_DONE, elapsed_ms);
+        Serial.printf("[REACTION] Time: %lu.%02lu ms (%lu us)\n",
+                      (unsigned long)(ticks / RESULT_TICKS_PER_MS),
+                      (unsigned long)(ticks % RESULT_TICKS_PER_MS), (unsigned long)elapsed_us);
+        sendResultTicks(CMD_REACTION_DONE, ticks);
 
         // Brief vibrate on completion
         vibStart(100);
         jsState = JS_DONE;
-      }
-
-      // Timeout (10s) - no button press
-      // Use millis comparison against GO time (convert g_go_time_us to ms)
-      if (millis() > (g_go_time_us / 1000) + TIMEOUT_REACTION) {
+      } else if (micros() - g_go_time_us > (uint32_t)TIMEOUT_REACTION * 1000UL) {
+        // Timeout - no button press (wrap-safe micros delta from GO)
         Serial.println("[REACTION] TIMEOUT");
-        sendToHostRetry(CMD_REACTION_DONE, TIME_PENALTY);
+        sendResult(CMD_REACTION_DONE, TIME_PENALTY);
         jsState = JS_DONE;
       }
       break;
@@ -424,7 +903,7 @@ void runJoystick() {
           // Vibrate on completion
           vibStart(200);
         }
-        sendToHostRetry(CMD_SHAKE_DONE, result);
+        sendResult(CMD_SHAKE_DONE, result);
         jsState = JS_DONE;
       }
       break;
@@ -433,7 +912,7 @@ void runJoystick() {
     case JS_DONE:
       // Wait for next GAME_START or IDLE from host
       // Safety: if stuck in DONE for 60s (missed CMD_IDLE), auto-reset
-      if (millis() - (g_go_time_us / 1000) > 60000) {
+      if (micros() - g_go_time_us > 60000000UL) {
         jsState = JS_IDLE;
         assignedSlot = 0;
         joinSent = false;
@@ -443,6 +922,32 @@ void runJoystick() {
   }
 }
 
+// =============================================================================
+// FLIGHT RECORDER (FlightRecorder.h: state changes, `flight [prev]` on serial)
+// =============================================================================
+JoystickState flightState = JS_IDLE;
+char serialLine[16];
+uint8_t serialLen = 0;
+
+void flightUpdate() {
+  const JoystickState s = jsState;
+  if (s != flightState) {
+    flightRecorder.record(FL_STATE, s, flightState);
+    flightState = s;
+  }
+  while (Serial.available() > 0) {
+    const char c = (char)Serial.read();
+    if (c == '\r' || c == '\n') {
+      serialLine[serialLen] = '\0';
+      if (strcmp(serialLine, "flight") == 0) flightRecorder.dump(false);
+      if (strcmp(serialLine, "flight prev") == 0) flightRecorder.dump(true);
+      serialLen = 0;
+    } else if (serialLen < sizeof(serialLine) - 1) {
+      serialLine[serialLen++] = c;
+    }
+  }
+}
+
 // =============================================================================
 // SETUP
 // =============================================================================
@@ -452,7 +957,16 @@ void setup() {
   Serial.println("     REACTION TIME DUEL - JOYSTICK");
   Serial.printf("            Firmware %s\n", FW_VERSION_STRING);
   Serial.println("========================================");
-  Serial.printf("My ID: 0x%02X\n", MY_ID);
+  flightRecorder.begin(ESP.getResetInfoPtr()->reason);
+  if (flightRecorder.keptCount()) {
+    Serial.printf("Flight recorder: %d events from before the reset (`flight prev`)\n", flightRecorder.keptCount());
+  }
+#ifndef MY_ID
+  myId = ID_TEMP_FIRST | (os_random() & ID_TEMP_MASK);
+  Serial.printf("My ID: assigned by the host (temporary 0x%02X)\n", myId);
+#else
+  Serial.printf("My ID: 0x%02X\n", myId);
+#endif
 
   // Motor output
   pinMode(PIN_MOTOR, OUTPUT);
@@ -461,22 +975,27 @@ void setup() {
   // Button input (active LOW)
   pinMode(PIN_BUTTON, INPUT_PULLUP);
 
-  // Button interrupt
-  attachInterrupt(digitalPinToInterrupt(PIN_BUTTON), onButton, FALLING);
+  // Button interrupt (both edges, cycle-stamped)
+  button.begin(PIN_BUTTON, onButton);
 
   // I2C + MPU-6050 (400kHz for faster reads)
   Wire.begin(PIN_SDA, PIN_SCL);
   Wire.setClock(400000);
-  if (mpuInit()) {
-    Serial.println("MPU-6050 ready");
+  if (mpu.begin()) {
+    Serial.printf("MPU-6050 ready (%s)\n", SHAKE_USE_FIFO ? "FIFO @ 1 kHz" : "polled @ 200 Hz");
   } else {
     Serial.println("MPU-6050 init failed!");
   }
+  shaker.begin(SHAKE_INPUT_RATE_HZ);
+#if SHAKE_USE_FIFO
+  pinMode(PIN_MPU_INT, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_MPU_INT), onMpuInt, RISING);
+#endif
 
   // ESP-NOW
   WiFi.mode(WIFI_STA);
   WiFi.disconnect();
-  wifi_set_channel(ESPNOW_CHANNEL);
+  wifi_set_channel(STICK_CHANNEL);
 
   if (esp_now_init() != 0) {
     Serial.println("ESP-NOW init failed!");
@@ -488,22 +1007,31 @@ void setup() {
   esp_now_register_send_cb(OnDataSent);
 
   // Pair with host
-  int result = esp_now_add_peer(hostMac, ESP_NOW_ROLE_COMBO, ESPNOW_CHANNEL, NULL, 0);
+  int result = esp_now_add_peer(hostMac, ESP_NOW_ROLE_COMBO, STICK_CHANNEL, NULL, 0);
   if (result == 0) {
     Serial.println("Host paired");
   } else {
     Serial.printf("Host pair failed: %d\n", result);
   }
+  if (!idAssigned) esp_now_add_peer(broadcastMac, ESP_NOW_ROLE_COMBO, STICK_CHANNEL, NULL, 0);
 
   Serial.print("My MAC: ");
   Serial.println(WiFi.macAddress());
-  Serial.println("Joystick ready!");
+  clockSync.reset();
+  listenStartMs = millis();
+  Serial.printf("Joystick ready! Listening for the host from channel %d\n", radioChannel);
 }
 
 // =============================================================================
 // LOOP
 // =============================================================================
 void loop() {
+  channelUpdate();
+  idAssignmentUpdate();
+  clockSyncUpdate();
   runJoystick();
+  otaClient.update(millis(), channelLocked && idAssigned && jsState == JS_IDLE, myId);
+  powerUpdate();
+  flightUpdate();
   yield();  // allow WiFi/system tasks without blocking - much faster than delay(5)
 }
@@ -0,0 +1,82 @@
+/*
+ * FlightLog.h - Flight recorder event format
+ * Shared by the host and the joysticks
+ *
+ * Every FlightRecorder.h event is two words: micros() when it happened
+ * and (type | a << 8 | b << 16). The devices keep a ring of them in
+ * memory that a reset other than power-on leaves alone, so after a
+ * watchdog, a panic or a stall that needed the reset button the last
+ * events before it are still there to read out.
+ *
+ * flightDecode() turns a record back into a line: a printf format per
+ * type and the fields it prints, so the device dumps it as text and
+ * nothing has to be decoded off-board.
+ */
+
+#ifndef FLIGHT_LOG_H
+#define FLIGHT_LOG_H
+
+#include <stdint.h>
+
+enum FlightEvent : uint8_t {
+  FL_NONE = 0,
+  FL_BOOT,      // a = reset reason (the platform's code), b = boot count
+  FL_STATE,     // a = new state, b = old state (host HostGameState, stick JoystickState)
+  FL_TX,        // a = cmd, b = dest | len << 8: handed to esp_now_send()
+  FL_TX_FAIL,   // a = peer, MAC layer gave up (host: LatencyTrace peer index, stick: 0 = host)
+  FL_RX,        // a = cmd, b = src | len << 8: receive callback, before any check
+  FL_RX_DROP,   // a = cmd, b = src: host rx queue full
+  FL_RETRY,     // a = cmd, b = dest | send count << 8
+  FL_GIVE_UP,   // a = cmd, b = dest | send count << 8
+  FL_ISR,       // a = FlightIrq, b = pin level
+  FL_OVERRUN,   // a = scheduler job index, b = run time in us (capped at 65535)
+  FL_EVENT_COUNT
+};
+
+enum FlightIrq : uint8_t {
+  FL_IRQ_BUTTON = 1,
+};
+
+struct FlightRecord {
+  uint32_t us;
+  uint32_t word;
+};
+
+inline uint32_t flightWord(uint8_t type, uint8_t a, uint16_t b) {
+  return (uint32_t)type | (uint32_t)a << 8 | (uint32_t)b << 16;
+}
+
+inline uint8_t flightType(const FlightRecord &r) { return (uint8_t)r.word; }
+inline uint8_t flightA(const FlightRecord &r) { return (uint8_t)(r.word >> 8); }
+inline uint16_t flightB(const FlightRecord &r) { return (uint16_t)(r.word >> 16); }
+
+// Decoder: the printf format for r and its args after the timestamp,
+// printed as (fmt, (unsigned long)r.us, args[0], args[1], args[2])
+inline const char* flightDecode(const FlightRecord &r, unsigned args[3]) {
+  const uint8_t a = flightA(r);
+  const uint16_t b = flightB(r);
+  args[0] = a;
+  args[1] = b & 0xFF;
+  args[2] = b >> 8;
+  switch (flightType(r)) {
+    case FL_BOOT:
+      args[1] = b;
+      return "[FLIGHT] %10lu us  BOOT     reset reason %u, boot %u\n";
+    case FL_STATE:    return "[FLIGHT] %10lu us  STATE    -> %u (from %u)\n";
+    case FL_TX:       return "[FLIGHT] %10lu us  TX       cmd=0x%02X to 0x%02X, %u B\n";
+    case FL_TX_FAIL:  return "[FLIGHT] %10lu us  TX FAIL  peer %u\n";
+    case FL_RX:       return "[FLIGHT] %10lu us  RX       cmd=0x%02X from 0x%02X, %u B\n";
+    case FL_RX_DROP:  return "[FLIGHT] %10lu us  RX DROP  cmd=0x%02X from 0x%02X (queue full)\n";
+    case FL_RETRY:    return "[FLIGHT] %10lu us  RETRY    cmd=0x%02X to 0x%02X, send %u\n";
+    case FL_GIVE_UP:  return "[FLIGHT] %10lu us  GIVE UP  cmd=0x%02X to 0x%02X after %u sends\n";
+    case FL_ISR:      return "[FLIGHT] %10lu us  ISR      irq %u, level %u\n";
+    case FL_OVERRUN:
+      args[1] = b;
+      return "[FLIGHT] %10lu us  OVERRUN  job %u ran %u us\n";
+    default:
+      args[0] = flightType(r);
+      return "[FLIGHT] %10lu us  ?        type %u\n";
+  }
+}
+
+#endif // FLIGHT_LOG_H
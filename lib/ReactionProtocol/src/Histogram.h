@@ -0,0 +1,72 @@
+/*
+ * Histogram.h - Fixed-size log2 histogram for latencies and durations
+ * Shared by the host and the display
+ *
+ * add() is a count-leading-zeros and an increment: bucket 0 holds 0,
+ * bucket b (1..32) holds [2^(b-1), 2^b). percentile() answers with the
+ * upper bound of the bucket it lands in (capped at the exact max), so a
+ * p99 of "4095 us" means "under 4.1 ms" - coarse, but small and cheap
+ * enough to feed from a frame or packet path. No allocation; one owner
+ * context writes it, copies can be taken for reporting.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#define HISTOGRAM_BUCKETS 33
+
+struct LogHistogram {
+  uint32_t buckets[HISTOGRAM_BUCKETS];
+  uint32_t n;
+  uint32_t maxValue;
+  uint64_t sum;
+
+  LogHistogram() { reset(); }
+
+  void reset() {
+    for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++) buckets[i] = 0;
+    n = 0;
+    maxValue = 0;
+    sum = 0;
+  }
+
+  static uint8_t bucketOf(uint32_t v) {
+    return v ? (uint8_t)(32 - __builtin_clz(v)) : 0;
+  }
+
+  // Largest value bucket b can hold
+  static uint32_t bucketTop(uint8_t b) {
+    return b == 0 ? 0 : b >= 32 ? 0xFFFFFFFFUL : (1UL << b) - 1;
+  }
+
+  void add(uint32_t v) {
+    buckets[bucketOf(v)]++;
+    n++;
+    sum += v;
+    if (v > maxValue) maxValue = v;
+  }
+
+  uint32_t count() const { return n; }
+  uint32_t max() const { return maxValue; }
+  uint32_t mean() const { return n ? (uint32_t)(sum / n) : 0; }
+
+  // pct 0-100; 0 when empty
+  uint32_t percentile(uint8_t pct) const {
+    if (!n) return 0;
+    uint32_t rank = (uint32_t)(((uint64_t)n * pct + 99) / 100);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+      seen += buckets[b];
+      if (seen >= rank) {
+        uint32_t top = bucketTop(b);
+        return top < maxValue ? top : maxValue;
+      }
+    }
+    return maxValue;
+  }
+};
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,79 @@
+/*
+ * OtaImage.h - Decoder for one block of a firmware update package
+ * Shared library (lib/ReactionProtocol): joysticks and display decode, the
+ * host only serves the records (FIRMWARE UPDATE in Protocol.h).
+ *
+ * A record is one OTA_BLOCK_SIZE block of the new image, encoded by
+ * ota_pack.py against the image the device runs now (the base):
+ *   [block CRC-32, 4 bytes LE] then ops until the block is complete:
+ *   0x00-0x7F  literal:   op + 1 bytes follow
+ *   0x80-0xBF  copy base: len = (op & 0x3F) + 4, or a u16 LE when op & 0x3F
+ *                         is 0x3F; then a u24 LE offset into the base image
+ *   0xC0-0xFF  copy back: len = (op & 0x3F) + 3, or a u16 LE when op & 0x3F
+ *                         is 0x3F; then a u16 LE distance back in this block
+ * A copy back may overlap what it writes (runs). Records are independent:
+ * any block can be decoded on its own, so a transfer resumes at a block.
+ * A full image (base 0) has no base copies.
+ */
+
+#ifndef OTA_IMAGE_H
+#define OTA_IMAGE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Protocol.h"
+
+#define OTA_OP_COPY_BASE  0x80
+#define OTA_OP_COPY_BACK  0xC0
+#define OTA_OP_LONG       0x3F
+
+// Fill dst with len bytes of the running image from offset; false when
+// that runs past its end or the flash read failed
+typedef bool (*OtaBaseRead)(uint32_t offset, uint8_t* dst, uint16_t len);
+
+// Decode rec into out, which must come to exactly outLen bytes and match
+// the record's CRC-32. readBase may be nullptr for a full image.
+inline bool otaDecodeBlock(const uint8_t* rec, uint16_t recLen, uint8_t* out, uint16_t outLen,
+                           OtaBaseRead readBase) {
+  if (recLen < 4) return false;
+  uint32_t crc;
+  memcpy(&crc, rec, 4);
+  uint16_t pos = 4;
+  uint16_t n = 0;
+  while (n < outLen) {
+    if (pos >= recLen) return false;
+    const uint8_t op = rec[pos++];
+    if (op < OTA_OP_COPY_BASE) {
+      const uint16_t len = op + 1;
+      if (pos + len > recLen || n + len > outLen) return false;
+      memcpy(out + n, rec + pos, len);
+      pos += len;
+      n += len;
+      continue;
+    }
+    const bool base = op < OTA_OP_COPY_BACK;
+    uint16_t len = (op & OTA_OP_LONG) + (base ? 4 : 3);
+    if ((op & OTA_OP_LONG) == OTA_OP_LONG) {
+      if (pos + 2 > recLen) return false;
+      len = (uint16_t)(rec[pos] | (rec[pos + 1] << 8));
+      pos += 2;
+    }
+    if (len == 0 || n + len > outLen) return false;
+    if (base) {
+      if (pos + 3 > recLen || !readBase) return false;
+      const uint32_t offset = rec[pos] | ((uint32_t)rec[pos + 1] << 8) | ((uint32_t)rec[pos + 2] << 16);
+      pos += 3;
+      if (!readBase(offset, out + n, len)) return false;
+    } else {
+      if (pos + 2 > recLen) return false;
+      const uint16_t dist = (uint16_t)(rec[pos] | (rec[pos + 1] << 8));
+      pos += 2;
+      if (dist == 0 || dist > n) return false;
+      for (uint16_t i = 0; i < len; i++) out[n + i] = out[n + i - dist];  // byte by byte: runs overlap
+    }
+    n += len;
+  }
+  return pos == recLen && calcCRC32(out, outLen) == crc;
+}
+
+#endif // OTA_IMAGE_H
@@ -0,0 +1,1226 @@
+/*
+ * Protocol.h - Reaction Time Duel Communication Protocol
+ * Shared library (lib/ReactionProtocol): ESP32 Host, ESP8266 Joysticks and
+ * ESP32-S3 Display all build against this one header.
+ *
+ * Packet Format (7 bytes):
+ * [START][DEST_ID][SRC_ID][CMD][DATA_HIGH][DATA_LOW][CRC8]
+ *
+ * Clock sync uses a longer SyncPacket (see CLOCK SYNC below); receivers
+ * dispatch on packet length. Batched frames (BATCHED FRAMES) are variable
+ * length and are recognised by byte 3 == CMD_BATCH, firmware update frames
+ * (FIRMWARE UPDATE) by byte 3 == CMD_OTA_*.
+ *
+ * Use the typed encoders/decoders (TYPED PAYLOADS) rather than shifting
+ * data_high/data_low by hand.
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+
+// =============================================================================
+// FIRMWARE VERSION — increment on every code change
+// Encoded in CMD_REQ_ID: data_high = (MAJOR<<4)|MINOR, data_low = PATCH.
+// MAJOR and MINOR are 4 bits each, and OTA offers and supportsX() compare
+// the encoded value: after minor 15 the next bump is a major (5.0), never
+// 4.16, which would wrap to 4.0 (static_assert at FW_VERSION_DATA).
+// =============================================================================
+#define FW_VERSION_MAJOR  4
+#define FW_VERSION_MINOR  13
+#define FW_VERSION_PATCH  0
+#define FW_VERSION_STRING "V4.13.0"
+
+// =============================================================================
+// PACKET STRUCTURE
+// =============================================================================
+#define PACKET_START      0x0A
+#define PACKET_SIZE       7
+
+typedef struct __attribute__((packed)) {
+  uint8_t start;
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t cmd;
+  uint8_t data_high;
+  uint8_t data_low;
+  uint8_t crc;
+} GamePacket;
+
+// =============================================================================
+// DEVICE IDS
+// =============================================================================
+#define ID_HOST           0x00
+#define ID_STICK1         0x01
+#define ID_STICK2         0x02
+#define ID_STICK3         0x03
+#define ID_STICK4         0x04
+#define ID_DISPLAY        0x10
+#define ID_COORDINATOR    0x20    // the host that runs arena 0 and collects standings (ARENAS)
+#define ID_BROADCAST      0xFF
+
+// Joystick IDs run ID_STICK_FIRST..ID_STICK_LAST; ID_STICK1-4 are the first four.
+// Every per-stick table on the host is sized from MAX_STICKS.
+#define MAX_STICKS        12
+#define ID_STICK_FIRST    ID_STICK1
+#define ID_STICK_LAST     (ID_STICK_FIRST + MAX_STICKS - 1)
+
+// A stick without an ID yet (see ID ASSIGNMENT) uses a random temporary one
+#define ID_TEMP_FIRST     0x80
+#define ID_TEMP_MASK      0x3F    // temporary IDs 0x80-0xBF
+
+inline bool isStickId(uint8_t id) {
+  return id >= ID_STICK_FIRST && id <= ID_STICK_LAST;
+}
+
+inline bool isTempId(uint8_t id) {
+  return (id & ~ID_TEMP_MASK) == ID_TEMP_FIRST;
+}
+
+inline uint8_t stickIndex(uint8_t id) {  // 0 .. MAX_STICKS-1, for isStickId(id)
+  return id - ID_STICK_FIRST;
+}
+
+static_assert(ID_STICK_LAST < ID_DISPLAY, "Protocol.h: stick IDs run into ID_DISPLAY");
+static_assert(ID_COORDINATOR < ID_TEMP_FIRST, "Protocol.h: ID_COORDINATOR is a temporary stick ID");
+static_assert(MAX_STICKS <= 16, "Protocol.h: host stick masks are 16 bits");
+
+// =============================================================================
+// COMMANDS: Host → Display
+// =============================================================================
+#define DISP_IDLE           0x30  // Show idle/welcome screen
+#define DISP_PROMPT_JOIN    0x31  // Show "Press to join" prompt
+#define DISP_REACTION_MODE  0x32  // Show reaction mode indicator
+#define DISP_SHAKE_MODE     0x33  // Show shake mode + target count
+#define DISP_COUNTDOWN      0x34  // Show countdown number (data_low = 3, 2, 1)
+#define DISP_GO             0x35  // Show GO signal
+#define DISP_TIME_P1        0x36  // Player 1 time (data = ms, or 4-byte batch item in result ticks)
+#define DISP_TIME_P2        0x37  // Player 2 time
+#define DISP_TIME_P3        0x38  // Player 3 time
+#define DISP_TIME_P4        0x39  // Player 4 time
+#define DISP_ROUND_WINNER   0x3A  // Round winner (data_low = player 1-4, 0=none)
+#define DISP_SCORES         0x3B  // Score update (data_high = player, data_low = score)
+#define DISP_FINAL_WINNER   0x3C  // Final winner (data_low = player 1-4)
+#define DISP_PLAYER_READY   0x3D  // Player joined/ready (data_high = player slot 1-4, data_low = joystick ID)
+#define DISP_PLAYER_PROMPT  0x3E  // Prompt player to join (data_low = player 1-4, blink on display)
+#define DISP_DEUCE          0x3F  // Deuce! (data_high = player A 1-4, data_low = player B 1-4)
+
+// =============================================================================
+// COMMANDS: Host → Joysticks
+// =============================================================================
+#define CMD_OK            0x0B  // Acknowledge (join confirmed)
+#define CMD_ACK           0x0E  // ACK: data_low = cmd being acknowledged (sequenced form: see RELIABLE DELIVERY)
+#define CMD_GAME_START    0x21  // Start round (data_high=mode, data_low=param)
+#define CMD_GO            0x22  // GO signal (data = host GO time in GO ticks, see CLOCK SYNC)
+#define CMD_VIBRATE       0x23  // Vibrate (0xFF=GO signal, else duration×10ms)
+#define CMD_IDLE          0x24  // Return to idle state
+#define CMD_COUNTDOWN     0x25  // Countdown tick (data_low = 3, 2, or 1)
+#define CMD_CUE_AT        0x2B  // Countdown pulse at a host instant (data = host time in GO ticks, see TIMED CUES)
+#define CMD_ASSIGN_ID     0x2E  // Your ID (dest = the stick's temporary or old ID, data_low = new ID, see ID ASSIGNMENT)
+#define CMD_CHANNEL_BEACON 0x42 // Broadcast to sticks and display: data_high = host channel, data_low = arena (see CHANNEL SELECTION)
+
+// =============================================================================
+// COMMANDS: Joysticks → Host
+// =============================================================================
+#define CMD_REQ_ID        0x0D  // Request to join game
+#define CMD_REACTION_DONE 0x26  // Reaction complete (data = time_ms, 0xFFFF=penalty; fine form: see FINE RESULT TIMES)
+#define CMD_SHAKE_DONE    0x27  // Shake complete (data = time_ms, 0xFFFF=timeout)
+#define CMD_SHAKE_PROGRESS 0x28 // Shake progress (data_high=count, data_low=target), see SHAKE STREAM
+#define CMD_HELLO         0x2D  // Broadcast announce by a stick without an ID (data = firmware, as CMD_REQ_ID)
+#define CMD_STICK_POWER   0x43  // One power report field, batch item: [field][value, 4 bytes big-endian] (see STICK POWER)
+
+// =============================================================================
+// COMMANDS: Host ↔ Coordinator (control channel, see ARENAS)
+// =============================================================================
+#define CMD_ARENA_HELLO    0x2F // Host → Coordinator, broadcast: data_low = arena wanted
+#define CMD_ARENA_ASSIGN   0x40 // Coordinator → Host, broadcast: data_high = arena, data_low = channel (0 = taken)
+#define CMD_ARENA_STANDING 0x41 // One standings field, batch item: [arena][field][value, 4 bytes big-endian]
+
+// =============================================================================
+// COMMANDS: Clock sync (SyncPacket, not GamePacket)
+// =============================================================================
+#define CMD_SYNC_REQ      0x29  // Stick → Host: ping (t1 = stick send time)
+#define CMD_SYNC_RESP     0x2A  // Host → Stick: pong (t1 echoed, t2/t3 = host rx/tx time)
+
+// =============================================================================
+// COMMANDS: Batched frames (variable length, see BATCHED FRAMES)
+// =============================================================================
+#define CMD_BATCH         0x0F  // Several commands in one frame (byte 3): Host → Display, Stick → Host results
+
+// =============================================================================
+// COMMANDS: Display → Host (batch items only, see DISPLAY TELEMETRY)
+// =============================================================================
+#define CMD_DISP_TELEMETRY 0x2C // One telemetry field: [field][value, 4 bytes big-endian]
+
+// =============================================================================
+// COMMANDS: Host → Display (stream batch items only, see SHAKE STREAM)
+// =============================================================================
+#define DISP_SHAKE_PROGRESS 0x44 // One player's shake progress: [player 1-4][count][target]
+
+// =============================================================================
+// COMMANDS: Host → Display (see ROUND LOOKAHEAD)
+// =============================================================================
+#define DISP_NEXT_ROUND   0x45  // Next round's mode, not shown yet: data_high = mode, data_low = shake target (0 = reaction)
+#define DISP_LEADERBOARD  0x46  // One all-time best, batch item: [rank][stick 1-N, 0 = empty][ticks, 4 bytes big-endian] (see LEADERBOARD)
+#define DISP_TOUR_SEAT    0x47  // Next tournament match: data_high = player slot 1-4, data_low = entrant 1-N (0 = empty seat) (see TOURNAMENT)
+
+// =============================================================================
+// COMMANDS: Firmware update (own frames, see FIRMWARE UPDATE)
+// =============================================================================
+#define CMD_OTA_OFFER     0x48  // Host → Stick/Display: a package is available (OtaOfferPacket)
+#define CMD_OTA_REQ       0x49  // Stick/Display → Host: block wanted + chunks held (OtaReqPacket)
+#define CMD_OTA_DATA      0x4A  // Host → Stick/Display: one chunk of a block (OtaDataHeader + bytes)
+
+// =============================================================================
+// GAME MODES
+// =============================================================================
+#define MODE_REACTION     0x01
+#define MODE_SHAKE        0x02
+
+// =============================================================================
+// ESP-NOW CONFIGURATION
+// =============================================================================
+#define ESPNOW_CHANNEL    6
+
+// =============================================================================
+// SPECIAL VALUES
+// =============================================================================
+#define TIME_PENALTY      0xFFFF  // Timeout or early press
+#define VIBRATE_GO        0xFF    // GO signal vibration
+
+// =============================================================================
+// COMMAND ID CHECK
+// Every command byte above, in one list. Add new commands here too: the
+// build fails if two of them share an ID.
+// =============================================================================
+static constexpr uint8_t PROTOCOL_COMMANDS[] = {
+  DISP_IDLE, DISP_PROMPT_JOIN, DISP_REACTION_MODE, DISP_SHAKE_MODE, DISP_COUNTDOWN,
+  DISP_GO, DISP_TIME_P1, DISP_TIME_P2, DISP_TIME_P3, DISP_TIME_P4, DISP_ROUND_WINNER,
+  DISP_SCORES, DISP_FINAL_WINNER, DISP_PLAYER_READY, DISP_PLAYER_PROMPT, DISP_DEUCE,
+  CMD_OK, CMD_ACK, CMD_GAME_START, CMD_GO, CMD_VIBRATE, CMD_IDLE, CMD_COUNTDOWN, CMD_CUE_AT,
+  CMD_ASSIGN_ID, CMD_REQ_ID, CMD_REACTION_DONE, CMD_SHAKE_DONE, CMD_SHAKE_PROGRESS, CMD_HELLO,
+  CMD_SYNC_REQ, CMD_SYNC_RESP, CMD_BATCH, CMD_DISP_TELEMETRY,
+  CMD_ARENA_HELLO, CMD_ARENA_ASSIGN, CMD_ARENA_STANDING, CMD_CHANNEL_BEACON,
+  CMD_STICK_POWER, DISP_SHAKE_PROGRESS, DISP_NEXT_ROUND, DISP_LEADERBOARD,
+  DISP_TOUR_SEAT, CMD_OTA_OFFER, CMD_OTA_REQ, CMD_OTA_DATA
+};
+
+static constexpr uint8_t PROTOCOL_DEVICE_IDS[] = {
+  ID_HOST, ID_STICK1, ID_STICK2, ID_STICK3, ID_STICK4, ID_DISPLAY, ID_COORDINATOR, ID_BROADCAST
+};
+
+constexpr bool protoNotIn(const uint8_t* ids, uint8_t n, uint8_t v) {
+  return n == 0 || (ids[0] != v && protoNotIn(ids + 1, n - 1, v));
+}
+
+constexpr bool protoAllUnique(const uint8_t* ids, uint8_t n) {
+  return n <= 1 || (protoNotIn(ids + 1, n - 1, ids[0]) && protoAllUnique(ids + 1, n - 1));
+}
+
+static_assert(protoAllUnique(PROTOCOL_COMMANDS, sizeof(PROTOCOL_COMMANDS)),
+              "Protocol.h: two commands share the same ID");
+static_assert(protoAllUnique(PROTOCOL_DEVICE_IDS, sizeof(PROTOCOL_DEVICE_IDS)),
+              "Protocol.h: two devices share the same ID");
+
+// =============================================================================
+// CLOCK SYNC
+// Joysticks ping the host NTP-style: t1 = stick send, t2 = host receive,
+// t3 = host send, t4 = stick receive (all micros(), each in its own clock).
+//   rtt    = (t4 - t1) - (t3 - t2)
+//   offset = ((t2 - t1) + (t3 - t4)) / 2      (host = stick + offset)
+// CMD_GO carries the host time at which the LEDs froze, so every stick
+// measures against the same instant regardless of when its GO arrived.
+// =============================================================================
+#define GO_TICK_SHIFT     3       // CMD_GO data = (host micros >> 3) & 0xFFFF (8us ticks, 524ms span)
+
+typedef struct __attribute__((packed)) {
+  uint8_t start;
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t cmd;        // CMD_SYNC_REQ / CMD_SYNC_RESP
+  uint8_t seq;        // echoed by host
+  uint16_t rtt_us;    // REQ: stick's current best RTT (host bookkeeping only)
+  int32_t offset_us;  // REQ: stick's current offset estimate (host - stick)
+  uint32_t t1;        // stick send time (echoed by host)
+  uint32_t t2;        // host receive time
+  uint32_t t3;        // host send time
+  uint8_t crc;        // CRC8 over all preceding bytes
+} SyncPacket;
+
+#define SYNC_PACKET_SIZE  sizeof(SyncPacket)
+
+inline uint16_t goTicks(uint32_t hostUs) {
+  return (uint16_t)(hostUs >> GO_TICK_SHIFT);
+}
+
+// =============================================================================
+// TIMED CUES (v4.2)
+// The host sends CMD_CUE_AT up to CUE_MAX_LEAD_US before a countdown tick,
+// stamped with the host time the tick's sound and flash are scheduled for.
+// A synced stick holds the motor pulse until that instant, so radio delay
+// doesn't put the haptic behind the audio. Unsynced sticks, or a stamp
+// outside the window, pulse on receipt. Older sticks get CMD_COUNTDOWN at
+// the tick instead.
+// =============================================================================
+#define CUE_MAX_LEAD_US   200000
+#define TIMED_CUE_MAJOR   4
+#define TIMED_CUE_MINOR   2
+
+// =============================================================================
+// ID ASSIGNMENT (v4.4)
+// A stick built without a fixed ID picks a temporary one (ID_TEMP_FIRST |
+// random) and broadcasts CMD_HELLO every HELLO_INTERVAL_MS. The host keeps
+// a MAC -> ID registry: a known MAC gets its old ID back, a new one the
+// lowest free ID. CMD_ASSIGN_ID goes to the stick's MAC when the host could
+// add it as an ESP-NOW peer, otherwise to broadcast; either way dest_id is
+// the ID the stick answers to now. The stick adopts the ID and the sender's
+// MAC as the host's - src_id must be ID_HOST, and once the stick has an ID,
+// only from the host it has, or from another after BEACON_LOST_MS without a
+// frame from its own (so a neighbouring table can't take it). A stick that talks under an ID registered to another
+// MAC (e.g. after a host reboot) is moved to a free ID the same way.
+// Sticks with a fixed ID (stick1-4 builds, older firmware) don't send
+// CMD_HELLO: they are registered from their first packet.
+// =============================================================================
+#define HELLO_INTERVAL_MS 500
+
+// =============================================================================
+// CRC8 CALCULATION (Polynomial 0x8C)
+// Reflected Dallas/Maxim CRC-8, init 0x00. Table-driven: one lookup per byte
+// instead of 8 shift/branch steps. The table is generated at compile time
+// from the same bitwise definition used before, and checked against it below,
+// so frames stay interoperable with older firmware.
+// Build with -DCRC8_NIBBLE_TABLE to use a 16-entry table (two lookups per
+// byte) where 256 bytes of RAM matter more than speed.
+// =============================================================================
+#if defined(ESP_PLATFORM) || defined(ESP32)
+#include "esp_attr.h"
+#define CRC8_TABLE_ATTR   DRAM_ATTR   // keep it out of flash: usable with the cache disabled
+#else
+#define CRC8_TABLE_ATTR               // ESP8266: const data already lives in DRAM
+#endif
+
+// Bitwise reference: feed `bits` bits of crc through the polynomial
+constexpr uint8_t crc8Bits(uint8_t crc, uint8_t bits) {
+  return bits == 0 ? crc
+                   : crc8Bits((crc & 0x01) ? (uint8_t)((crc >> 1) ^ 0x8C) : (uint8_t)(crc >> 1),
+                              bits - 1);
+}
+
+constexpr uint8_t crc8Reference(const char* data, uint8_t len, uint8_t crc = 0x00) {
+  return len == 0 ? crc : crc8Reference(data + 1, len - 1, crc8Bits(crc ^ (uint8_t)*data, 8));
+}
+
+#define CRC8_T4(n)   crc8Bits((n), 8), crc8Bits((n) + 1, 8), crc8Bits((n) + 2, 8), crc8Bits((n) + 3, 8)
+#define CRC8_T16(n)  CRC8_T4(n), CRC8_T4((n) + 4), CRC8_T4((n) + 8), CRC8_T4((n) + 12)
+#define CRC8_T64(n)  CRC8_T16(n), CRC8_T16((n) + 16), CRC8_T16((n) + 32), CRC8_T16((n) + 48)
+
+#ifndef CRC8_NIBBLE_TABLE
+static constexpr uint8_t CRC8_TABLE[256] CRC8_TABLE_ATTR = {
+  CRC8_T64(0x00), CRC8_T64(0x40), CRC8_T64(0x80), CRC8_T64(0xC0)
+};
+
+constexpr uint8_t crc8Lookup(const char* data, uint8_t len, uint8_t crc = 0x00) {
+  return len == 0 ? crc : crc8Lookup(data + 1, len - 1, CRC8_TABLE[crc ^ (uint8_t)*data]);
+}
+
+inline uint8_t calcCRC8(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0x00;
+  while (len--) crc = CRC8_TABLE[crc ^ *data++];
+  return crc;
+}
+#else
+#define CRC8_N4(n)   crc8Bits((n), 4), crc8Bits((n) + 1, 4), crc8Bits((n) + 2, 4), crc8Bits((n) + 3, 4)
+static constexpr uint8_t CRC8_TABLE[16] CRC8_TABLE_ATTR = {
+  CRC8_N4(0), CRC8_N4(4), CRC8_N4(8), CRC8_N4(12)
+};
+
+constexpr uint8_t crc8Nibble(uint8_t crc) {
+  return (uint8_t)((crc >> 4) ^ CRC8_TABLE[crc & 0x0F]);
+}
+
+constexpr uint8_t crc8Lookup(const char* data, uint8_t len, uint8_t crc = 0x00) {
+  return len == 0 ? crc : crc8Lookup(data + 1, len - 1, crc8Nibble(crc8Nibble(crc ^ (uint8_t)*data)));
+}
+
+inline uint8_t calcCRC8(const uint8_t* data, uint8_t len) {
+  uint8_t crc = 0x00;
+  while (len--) {
+    crc ^= *data++;
+    crc = (uint8_t)((crc >> 4) ^ CRC8_TABLE[crc & 0x0F]);
+    crc = (uint8_t)((crc >> 4) ^ CRC8_TABLE[crc & 0x0F]);
+  }
+  return crc;
+}
+#endif
+
+// Compile-time proof the table matches the bitwise CRC (0xA1 = standard
+// CRC-8/MAXIM check value), including a full GamePacket-sized run
+static_assert(crc8Reference("123456789", 9) == 0xA1, "CRC8 reference broken");
+static_assert(crc8Lookup("123456789", 9) == 0xA1, "CRC8 table does not match polynomial 0x8C");
+static_assert(crc8Lookup("\x0A\x10\x00\x36\x01\x2C", 6) == crc8Reference("\x0A\x10\x00\x36\x01\x2C", 6),
+              "CRC8 table does not match polynomial 0x8C");
+static_assert(crc8Lookup("\xFF\x80\x7F\x01\xFE\x00\x55\xAA", 8) ==
+              crc8Reference("\xFF\x80\x7F\x01\xFE\x00\x55\xAA", 8),
+              "CRC8 table does not match polynomial 0x8C");
+
+// =============================================================================
+// PACKET HELPERS
+// =============================================================================
+inline uint16_t packetData(const GamePacket* pkt) {
+  return ((uint16_t)pkt->data_high << 8) | pkt->data_low;
+}
+
+inline void setPacketData(GamePacket* pkt, uint16_t data) {
+  pkt->data_high = (data >> 8) & 0xFF;
+  pkt->data_low = data & 0xFF;
+}
+
+inline bool validatePacket(const GamePacket* pkt) {
+  if (pkt->start != PACKET_START) return false;
+  return calcCRC8((const uint8_t*)pkt, 6) == pkt->crc;
+}
+
+inline void buildPacket(GamePacket* pkt, uint8_t dest, uint8_t src, uint8_t cmd, uint16_t data) {
+  pkt->start = PACKET_START;
+  pkt->dest_id = dest;
+  pkt->src_id = src;
+  pkt->cmd = cmd;
+  pkt->data_high = (data >> 8) & 0xFF;
+  pkt->data_low = data & 0xFF;
+  pkt->crc = calcCRC8((const uint8_t*)pkt, 6);
+}
+
+inline bool validateSyncPacket(const SyncPacket* pkt) {
+  if (pkt->start != PACKET_START) return false;
+  return calcCRC8((const uint8_t*)pkt, SYNC_PACKET_SIZE - 1) == pkt->crc;
+}
+
+inline void sealSyncPacket(SyncPacket* pkt) {
+  pkt->start = PACKET_START;
+  pkt->crc = calcCRC8((const uint8_t*)pkt, SYNC_PACKET_SIZE - 1);
+}
+
+// =============================================================================
+// TYPED PAYLOADS
+// One constexpr encoder (-> 16-bit data) and decoder (data -> struct) per
+// command layout. Commands that only use data_low take packData(0, value).
+// =============================================================================
+constexpr uint16_t packData(uint8_t high, uint8_t low) {
+  return (uint16_t)(((uint16_t)high << 8) | low);
+}
+constexpr uint8_t dataHigh(uint16_t data) { return (uint8_t)(data >> 8); }
+constexpr uint8_t dataLow(uint16_t data) { return (uint8_t)(data & 0xFF); }
+
+// CMD_REQ_ID (and the display hello): data_high = (MAJOR<<4)|MINOR, data_low = PATCH
+struct FwVersion { uint8_t major; uint8_t minor; uint8_t patch; };
+
+constexpr uint16_t encodeVersion(uint8_t major, uint8_t minor, uint8_t patch) {
+  return packData((uint8_t)(((major & 0x0F) << 4) | (minor & 0x0F)), patch);
+}
+constexpr FwVersion decodeVersion(uint16_t data) {
+  return FwVersion{(uint8_t)(dataHigh(data) >> 4), (uint8_t)(dataHigh(data) & 0x0F), dataLow(data)};
+}
+constexpr bool versionAtLeast(FwVersion v, uint8_t major, uint8_t minor) {
+  return v.major > major || (v.major == major && v.minor >= minor);
+}
+static_assert(FW_VERSION_MAJOR <= 15 && FW_VERSION_MINOR <= 15,
+              "FW_VERSION_MAJOR/MINOR are 4 bits in the hello: bump the major instead");
+constexpr uint16_t FW_VERSION_DATA = encodeVersion(FW_VERSION_MAJOR, FW_VERSION_MINOR, FW_VERSION_PATCH);
+
+// CMD_GAME_START: data_high = mode, data_low = param (shake target or 0)
+struct GameStartData { uint8_t mode; uint8_t param; };
+
+constexpr uint16_t encodeGameStart(uint8_t mode, uint8_t param) { return packData(mode, param); }
+constexpr GameStartData decodeGameStart(uint16_t data) {
+  return GameStartData{dataHigh(data), dataLow(data)};
+}
+
+// CMD_SHAKE_PROGRESS: data_high = count, data_low = target
+struct ShakeProgressData { uint8_t count; uint8_t target; };
+
+constexpr uint16_t encodeShakeProgress(uint8_t count, uint8_t target) { return packData(count, target); }
+constexpr ShakeProgressData decodeShakeProgress(uint16_t data) {
+  return ShakeProgressData{dataHigh(data), dataLow(data)};
+}
+
+// DISP_PLAYER_READY: data_high = player slot 1-4, data_low = joystick ID
+struct PlayerReadyData { uint8_t slot; uint8_t stickId; };
+
+constexpr uint16_t encodePlayerReady(uint8_t slot, uint8_t stickId) { return packData(slot, stickId); }
+constexpr PlayerReadyData decodePlayerReady(uint16_t data) {
+  return PlayerReadyData{dataHigh(data), dataLow(data)};
+}
+
+// DISP_SCORES: data_high = player 1-4, data_low = score
+struct ScoreData { uint8_t player; uint8_t score; };
+
+constexpr uint16_t encodeScore(uint8_t player, uint8_t score) { return packData(player, score); }
+constexpr ScoreData decodeScore(uint16_t data) { return ScoreData{dataHigh(data), dataLow(data)}; }
+
+// DISP_DEUCE: data_high = player A 1-4, data_low = player B 1-4
+struct DeuceData { uint8_t playerA; uint8_t playerB; };
+
+constexpr uint16_t encodeDeuce(uint8_t playerA, uint8_t playerB) { return packData(playerA, playerB); }
+constexpr DeuceData decodeDeuce(uint16_t data) { return DeuceData{dataHigh(data), dataLow(data)}; }
+
+// CMD_ACK: data_low = acked command; sequenced form also has data_high = cumulative seq
+struct AckData { uint8_t cumSeq; uint8_t cmd; };
+
+constexpr uint16_t encodeAck(uint8_t cmd, uint8_t cumSeq = 0) { return packData(cumSeq, cmd); }
+constexpr AckData decodeAck(uint16_t data) { return AckData{dataHigh(data), dataLow(data)}; }
+
+static_assert(decodeVersion(encodeVersion(4, 2, 7)).minor == 2, "version encoding broken");
+static_assert(decodeGameStart(encodeGameStart(MODE_SHAKE, 15)).param == 15, "game start encoding broken");
+static_assert(dataHigh(encodeAck(CMD_GO, 9)) == 9 && dataLow(encodeAck(CMD_GO, 9)) == CMD_GO,
+              "ACK encoding broken");
+
+// =============================================================================
+// RELIABLE DELIVERY
+// Commands the host needs ACKed travel as a ReliablePacket: the normal
+// GamePacket (own CRC, so receivers can reuse their GamePacket handling)
+// followed by a per-peer sequence number, the sender's boot epoch and an
+// outer CRC. The receiver answers every copy with a sequenced ACK, also a
+// ReliablePacket with base.cmd = CMD_ACK:
+//   data_high = cumulative seq (every seq up to here received)
+//   data_low  = acked command, seq = the seq being acked
+// 7-byte GamePackets (broadcasts, fire-and-forget) keep the legacy ACK.
+// =============================================================================
+typedef struct __attribute__((packed)) {
+  GamePacket base;
+  uint8_t seq;        // per-peer, starts at 0 for every new epoch
+  uint8_t epoch;      // sender boot id - a change resets the receiver's window
+  uint8_t crc;        // CRC8 over all preceding bytes
+} ReliablePacket;
+
+#define RELIABLE_PACKET_SIZE  sizeof(ReliablePacket)
+#define SEQ_WINDOW_BITS       32    // receiver remembers the last 32 seqs
+
+inline void buildReliablePacket(ReliablePacket* pkt, uint8_t dest, uint8_t src, uint8_t cmd,
+                                uint16_t data, uint8_t seq, uint8_t epoch) {
+  buildPacket(&pkt->base, dest, src, cmd, data);
+  pkt->seq = seq;
+  pkt->epoch = epoch;
+  pkt->crc = calcCRC8((const uint8_t*)pkt, RELIABLE_PACKET_SIZE - 1);
+}
+
+inline bool validateReliablePacket(const ReliablePacket* pkt) {
+  if (!validatePacket(&pkt->base)) return false;
+  return calcCRC8((const uint8_t*)pkt, RELIABLE_PACKET_SIZE - 1) == pkt->crc;
+}
+
+// Receiver-side duplicate suppression + cumulative ACK tracking (one per sender)
+struct SeqWindow {
+  bool valid = false;
+  uint8_t epoch = 0;
+  uint8_t last = 0;       // highest seq seen
+  uint8_t cum = 0;        // every seq up to and including this one seen
+  uint32_t seen = 0;      // bit n = (last - n) seen
+
+  bool seenSeq(uint8_t s) const {
+    uint8_t back = (uint8_t)(last - s);
+    return back < SEQ_WINDOW_BITS && ((seen >> back) & 1);
+  }
+
+  // Returns true if this seq is new (deliver it), false for a duplicate
+  bool accept(uint8_t ep, uint8_t s) {
+    if (!valid) {
+      // We just booted: take the stream from here, anything older is history
+      valid = true;
+      epoch = ep;
+      last = s;
+      cum = s;
+      seen = 0xFFFFFFFF;
+      return true;
+    }
+    if (ep != epoch) {
+      // Sender rebooted: its new stream starts at seq 0
+      epoch = ep;
+      last = 0xFF;
+      cum = 0xFF;
+      seen = 0xFFFFFFFF;
+    }
+
+    int8_t ahead = (int8_t)(s - last);
+    if (ahead > 0) {
+      seen = (ahead >= (int8_t)SEQ_WINDOW_BITS) ? 1 : ((seen << ahead) | 1);
+      last = s;
+    } else {
+      uint8_t back = (uint8_t)(last - s);
+      if (back >= SEQ_WINDOW_BITS || ((seen >> back) & 1)) return false;
+      seen |= (1UL << back);
+    }
+
+    // Gaps older than the window are never going to be filled
+    if ((uint8_t)(last - cum) >= SEQ_WINDOW_BITS) cum = last - (SEQ_WINDOW_BITS - 1);
+    while (cum != last && seenSeq(cum + 1)) cum++;
+    return true;
+  }
+};
+
+// Sequenced ACK for any sequenced frame (ReliablePacket or batch)
+inline void buildSeqAck(ReliablePacket* ack, uint8_t src, uint8_t rxSrc, uint8_t rxCmd,
+                        uint8_t rxSeq, uint8_t rxEpoch, const SeqWindow* win) {
+  buildReliablePacket(ack, rxSrc, src, CMD_ACK, encodeAck(rxCmd, win->cum), rxSeq, rxEpoch);
+}
+
+inline void buildSeqAck(ReliablePacket* ack, uint8_t src, const ReliablePacket* rx,
+                        const SeqWindow* win) {
+  buildSeqAck(ack, src, rx->base.src_id, rx->base.cmd, rx->seq, rx->epoch, win);
+}
+
+// =============================================================================
+// BATCHED FRAMES (protocol v4)
+// Several commands in one ESP-NOW frame, e.g. all result times at once:
+//   [START][DEST][SRC][CMD_BATCH][VERSION][SEQ][EPOCH][COUNT]
+//   COUNT x [CMD][LEN][VALUE...]          (VALUE is big-endian, like data_high/low)
+//   [CRC8 over everything before it]
+// A batch is always sequenced (seq/epoch as in RELIABLE DELIVERY) and is
+// answered with one sequenced ACK whose data_low = CMD_BATCH. The host only
+// batches to peers that announced FW_VERSION_MAJOR >= BATCH_MIN_MAJOR in
+// CMD_REQ_ID; everyone else keeps getting one GamePacket per command.
+// =============================================================================
+#define BATCH_VERSION     1
+#define BATCH_MIN_MAJOR   4     // first firmware major that understands CMD_BATCH
+#define BATCH_MAX_BYTES   250   // ESP_NOW_MAX_DATA_LEN
+#define BATCH_MAX_ITEMS   30
+
+typedef struct __attribute__((packed)) {
+  uint8_t start;
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t cmd;        // CMD_BATCH
+  uint8_t version;    // BATCH_VERSION
+  uint8_t seq;
+  uint8_t epoch;
+  uint8_t count;      // number of items that follow
+} BatchHeader;
+
+#define BATCH_HEADER_SIZE sizeof(BatchHeader)
+
+// Host side: collect items, then seal() with the link's seq/epoch and send buf
+struct BatchWriter {
+  uint8_t buf[BATCH_MAX_BYTES];
+  uint8_t len = 0;
+
+  void begin(uint8_t dest, uint8_t src) {
+    BatchHeader* h = (BatchHeader*)buf;
+    h->start = PACKET_START;
+    h->dest_id = dest;
+    h->src_id = src;
+    h->cmd = CMD_BATCH;
+    h->version = BATCH_VERSION;
+    h->seq = 0;
+    h->epoch = 0;
+    h->count = 0;
+    len = BATCH_HEADER_SIZE;
+  }
+
+  uint8_t count() const { return len ? ((const BatchHeader*)buf)->count : 0; }
+  bool empty() const { return count() == 0; }
+
+  // Returns false (item not added) when the frame or item limit is reached
+  bool add(uint8_t cmd, const uint8_t* value, uint8_t n) {
+    BatchHeader* h = (BatchHeader*)buf;
+    if (h->count >= BATCH_MAX_ITEMS || len + 2 + n + 1 > BATCH_MAX_BYTES) return false;
+    buf[len++] = cmd;
+    buf[len++] = n;
+    for (uint8_t i = 0; i < n; i++) buf[len++] = value[i];
+    h->count++;
+    return true;
+  }
+
+  bool add(uint8_t cmd, uint16_t data) {
+    const uint8_t v[2] = {(uint8_t)(data >> 8), (uint8_t)(data & 0xFF)};
+    return add(cmd, v, 2);
+  }
+
+  bool add32(uint8_t cmd, uint32_t data) {
+    const uint8_t v[4] = {(uint8_t)(data >> 24), (uint8_t)(data >> 16),
+                          (uint8_t)(data >> 8), (uint8_t)(data & 0xFF)};
+    return add(cmd, v, 4);
+  }
+
+  // Stamp seq/epoch, append the CRC; returns the frame length to send
+  uint8_t seal(uint8_t seq, uint8_t epoch) {
+    BatchHeader* h = (BatchHeader*)buf;
+    h->seq = seq;
+    h->epoch = epoch;
+    buf[len] = calcCRC8(buf, len);
+    return len + 1;
+  }
+};
+
+struct BatchItem {
+  uint8_t cmd;
+  uint8_t len;
+  const uint8_t* value;
+
+  uint16_t data() const {
+    if (len >= 2) return ((uint16_t)value[0] << 8) | value[1];
+    return len ? value[0] : 0;
+  }
+
+  uint32_t data32() const {
+    if (len < 4) return data();
+    return ((uint32_t)value[0] << 24) | ((uint32_t)value[1] << 16) |
+           ((uint32_t)value[2] << 8) | value[3];
+  }
+};
+
+inline bool isBatchFrame(const uint8_t* data, int len) {
+  return len >= (int)BATCH_HEADER_SIZE + 1 && data[0] == PACKET_START && data[3] == CMD_BATCH;
+}
+
+// Checks CRC, version and that every item fits inside the frame
+inline bool validateBatch(const uint8_t* data, int len) {
+  if (!isBatchFrame(data, len) || len > BATCH_MAX_BYTES) return false;
+  if (calcCRC8(data, len - 1) != data[len - 1]) return false;
+  const BatchHeader* h = (const BatchHeader*)data;
+  if (h->version != BATCH_VERSION || h->count > BATCH_MAX_ITEMS) return false;
+  int pos = BATCH_HEADER_SIZE;
+  for (uint8_t i = 0; i < h->count; i++) {
+    if (pos + 2 > len - 1) return false;
+    pos += 2 + data[pos + 1];
+  }
+  return pos == len - 1;
+}
+
+// Walk the items of a frame that passed validateBatch()
+struct BatchReader {
+  const uint8_t* data;
+  uint8_t remaining;
+  int pos;
+
+  explicit BatchReader(const uint8_t* frame)
+      : data(frame), remaining(((const BatchHeader*)frame)->count), pos(BATCH_HEADER_SIZE) {}
+
+  bool next(BatchItem* item) {
+    if (!remaining) return false;
+    item->cmd = data[pos];
+    item->len = data[pos + 1];
+    item->value = &data[pos + 2];
+    pos += 2 + item->len;
+    remaining--;
+    return true;
+  }
+};
+
+// =============================================================================
+// FINE RESULT TIMES (protocol 4.1)
+// Reaction results travel as 32-bit counts of RESULT_TICK_US in a 4-byte
+// batch item instead of 16-bit ms, so ties are decided below 1 ms:
+//   Stick → Host:    one-item batch, CMD_REACTION_DONE (unsequenced, sent
+//                    with the same repeats as the 7-byte result)
+//   Host → Display:  DISP_TIME_Px items, to displays >= FINE_RESULT_MINOR
+// A 2-byte item or a plain GamePacket still carries ms (older firmware,
+// penalties, shake results).
+// =============================================================================
+#define RESULT_TICK_US      10
+#define RESULT_TICKS_PER_MS (1000 / RESULT_TICK_US)
+#define RESULT_TICKS_NONE   0xFFFFFFFFUL   // penalty / no result (TIME_PENALTY in ms form)
+#define FINE_RESULT_MAJOR   4
+#define FINE_RESULT_MINOR   1
+
+constexpr uint32_t resultTicksFromUs(uint32_t us) { return us / RESULT_TICK_US; }  // never NONE
+constexpr uint32_t resultTicksFromMs(uint16_t ms) {
+  return ms == TIME_PENALTY ? RESULT_TICKS_NONE : (uint32_t)ms * RESULT_TICKS_PER_MS;
+}
+// Rounded to the nearest ms and capped below TIME_PENALTY
+constexpr uint16_t resultTicksToMs(uint32_t ticks) {
+  return ticks == RESULT_TICKS_NONE ? TIME_PENALTY
+       : (ticks + RESULT_TICKS_PER_MS / 2) / RESULT_TICKS_PER_MS >= TIME_PENALTY ? TIME_PENALTY - 1
+       : (uint16_t)((ticks + RESULT_TICKS_PER_MS / 2) / RESULT_TICKS_PER_MS);
+}
+// Either item width: 4 bytes = ticks, 2 bytes = ms
+inline uint32_t resultTicks(const BatchItem &item) {
+  return item.len >= 4 ? item.data32() : resultTicksFromMs(item.data());
+}
+constexpr bool supportsFineResults(FwVersion v) {
+  return versionAtLeast(v, FINE_RESULT_MAJOR, FINE_RESULT_MINOR);
+}
+constexpr bool supportsTimedCues(FwVersion v) {
+  return versionAtLeast(v, TIMED_CUE_MAJOR, TIMED_CUE_MINOR);
+}
+
+static_assert(resultTicksToMs(resultTicksFromMs(1234)) == 1234, "result tick conversion broken");
+static_assert(resultTicksToMs(resultTicksFromUs(215049)) == 215, "result tick rounding broken");
+static_assert(resultTicksFromMs(TIME_PENALTY) == RESULT_TICKS_NONE, "penalty must survive conversion");
+
+// =============================================================================
+// DISPLAY TELEMETRY (protocol 4.3)
+// Every TELEMETRY_PERIOD_MS the display sends the host one unsequenced,
+// unACKed batch (seq = epoch = 0) of CMD_DISP_TELEMETRY items, one per
+// TelemetryField in enum order, so the host knows a report is complete
+// when TELEM_UPTIME_MS arrives. A lost report is simply replaced by the
+// next one. Counters run since display boot; timings (p50/p99/max) cover
+// the period since the previous report.
+// =============================================================================
+#define TELEMETRY_PERIOD_MS   10000
+#define TELEMETRY_ITEM_LEN    5
+
+enum TelemetryField : uint8_t {
+  TELEM_FRAMES = 0,         // frames flushed
+  TELEM_VSYNCS,             // RGB panel vsync interrupts
+  TELEM_RENDER_P50_US,      // LVGL render, render start -> first flush
+  TELEM_RENDER_P99_US,
+  TELEM_RENDER_MAX_US,
+  TELEM_FLUSH_P50_US,       // frame buffer copies + switch + vsync wait
+  TELEM_FLUSH_P99_US,
+  TELEM_FLUSH_MAX_US,
+  TELEM_LATENCY_COUNT,      // commands that changed the screen this period
+  TELEM_LATENCY_P50_US,     // packet received -> frame flushed
+  TELEM_LATENCY_P99_US,
+  TELEM_LATENCY_MAX_US,
+  TELEM_QUEUE_MAX,          // deepest RX queue this period
+  TELEM_DROP_QUEUE_FULL,    // drop counters, one per DisplayDrop
+  TELEM_DROP_BAD_LEN,
+  TELEM_DROP_BAD_START,
+  TELEM_DROP_BAD_CRC,
+  TELEM_DROP_WRONG_DEST,
+  TELEM_DROP_NOT_FROM_HOST,
+  TELEM_DROP_DUPLICATE,
+  TELEM_UPTIME_MS,          // last: marks the end of a report
+  TELEM_FIELD_COUNT
+};
+
+// Why the display threw a frame (or command) away; TELEM_DROP_QUEUE_FULL + reason
+enum DisplayDrop : uint8_t {
+  DROP_QUEUE_FULL = 0,      // RX queue to the LVGL task was full
+  DROP_BAD_LEN,             // not a GamePacket, ReliablePacket or batch
+  DROP_BAD_START,
+  DROP_BAD_CRC,             // GamePacket, ReliablePacket or batch failed its check
+  DROP_WRONG_DEST,
+  DROP_NOT_FROM_HOST,       // source ID or MAC is not the host's
+  DROP_DUPLICATE,           // sequenced frame seen before (ACKed again, not applied)
+  DISPLAY_DROP_COUNT
+};
+
+static_assert(TELEM_DROP_QUEUE_FULL + DISPLAY_DROP_COUNT == TELEM_UPTIME_MS,
+              "one telemetry field per DisplayDrop");
+static_assert(BATCH_HEADER_SIZE + TELEM_FIELD_COUNT * (2 + TELEMETRY_ITEM_LEN) + 1 <= BATCH_MAX_BYTES,
+              "telemetry report must fit one batch");
+
+inline bool addTelemetry(BatchWriter &w, uint8_t field, uint32_t value) {
+  const uint8_t v[TELEMETRY_ITEM_LEN] = {field, (uint8_t)(value >> 24), (uint8_t)(value >> 16),
+                                         (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+  return w.add(CMD_DISP_TELEMETRY, v, TELEMETRY_ITEM_LEN);
+}
+
+// False for anything that isn't a well-formed telemetry item
+inline bool decodeTelemetry(const BatchItem &item, uint8_t* field, uint32_t* value) {
+  if (item.cmd != CMD_DISP_TELEMETRY || item.len != TELEMETRY_ITEM_LEN) return false;
+  *field = item.value[0];
+  *value = ((uint32_t)item.value[1] << 24) | ((uint32_t)item.value[2] << 16) |
+           ((uint32_t)item.value[3] << 8) | item.value[4];
+  return *field < TELEM_FIELD_COUNT;
+}
+
+// =============================================================================
+// ARENAS (protocol 4.5)
+// Several tables (arena = host + its sticks + display) run side by side, each
+// on its own channel (arenaChannel()) so their traffic doesn't collide.
+// Every device of an arena is built with the same -DARENA_ID (default 0:
+// one table on ESPNOW_CHANNEL, as before). Arena 0's host is the
+// coordinator (-DARENA_COORDINATOR=1) and stays on ARENA_CONTROL_CHANNEL.
+//
+// At boot another arena's host broadcasts CMD_ARENA_HELLO on the control
+// channel until the coordinator answers with CMD_ARENA_ASSIGN (channel for
+// that arena, or 0 if another host already holds it), then moves to its
+// channel; with no coordinator after a few seconds it runs there on its own.
+// After each game it hops back to the control channel for a moment and
+// broadcasts one unsequenced batch of CMD_ARENA_STANDING items, one per
+// ArenaField in enum order (the last one completes a report). The
+// coordinator keeps the latest report per arena and forwards all of them
+// to its display as one batch of the same items.
+// =============================================================================
+#define MAX_ARENAS            3
+#define ARENA_CONTROL_CHANNEL ESPNOW_CHANNEL
+#define ARENA_ITEM_LEN        6
+
+// Non-overlapping 2.4 GHz channels, arena 0 first
+constexpr uint8_t arenaChannel(uint8_t arena) {
+  return arena == 1 ? 1 : arena == 2 ? 11 : ARENA_CONTROL_CHANNEL;
+}
+
+enum ArenaField : uint8_t {
+  ARENA_GAMES = 0,          // games finished since the arena's host booted
+  ARENA_ROUNDS,             // rounds played
+  ARENA_RESENDS,            // reliable-delivery resends (crosstalk shows up here)
+  ARENA_BEST_TICKS,         // best reaction time (RESULT_TICK_US units), last field
+  ARENA_FIELD_COUNT
+};
+
+static_assert(BATCH_HEADER_SIZE + MAX_ARENAS * ARENA_FIELD_COUNT * (2 + ARENA_ITEM_LEN) + 1 <= BATCH_MAX_BYTES,
+              "all arenas' standings must fit one batch");
+
+inline bool addArenaStanding(BatchWriter &w, uint8_t arena, uint8_t field, uint32_t value) {
+  const uint8_t v[ARENA_ITEM_LEN] = {arena, field, (uint8_t)(value >> 24), (uint8_t)(value >> 16),
+                                     (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+  return w.add(CMD_ARENA_STANDING, v, ARENA_ITEM_LEN);
+}
+
+// False for anything that isn't a well-formed standings item
+inline bool decodeArenaStanding(const BatchItem &item, uint8_t* arena, uint8_t* field, uint32_t* value) {
+  if (item.cmd != CMD_ARENA_STANDING || item.len != ARENA_ITEM_LEN) return false;
+  *arena = item.value[0];
+  *field = item.value[1];
+  *value = ((uint32_t)item.value[2] << 24) | ((uint32_t)item.value[3] << 16) |
+           ((uint32_t)item.value[4] << 8) | item.value[5];
+  return *arena < MAX_ARENAS && *field < ARENA_FIELD_COUNT;
+}
+
+// =============================================================================
+// CHANNEL SELECTION (protocol 4.6)
+// A table's host comes up on arenaChannel(ARENA_ID), scans channel
+// occupancy once it is idle and moves to the quietest channel (arena hosts
+// take the coordinator's, see ARENAS); if ACK resends climb later it moves
+// to the next best one. It broadcasts
+// CMD_CHANNEL_BEACON every BEACON_INTERVAL_MS on the channel it is on, and
+// BEACON_MOVE_REPEAT of them naming the new channel just before a move.
+//
+// Sticks and display start on arenaChannel(ARENA_ID) and listen
+// CHANNEL_LISTEN_MS per channel, CHANNEL_FIRST..CHANNEL_LAST, until a
+// beacon for their arena; they follow the channel it names, and go back
+// to listening once nothing from the host arrived for BEACON_LOST_MS.
+// =============================================================================
+#define CHANNEL_FIRST       1
+#define CHANNEL_LAST        11      // usable everywhere (12-13 are not in every country)
+#define BEACON_INTERVAL_MS  200
+#define BEACON_MOVE_REPEAT  3
+#define CHANNEL_LISTEN_MS   (BEACON_INTERVAL_MS * 3 / 2)
+#define BEACON_LOST_MS      3000
+
+static_assert(CHANNEL_LISTEN_MS > BEACON_INTERVAL_MS, "a listen window must span a beacon");
+static_assert(BEACON_LOST_MS > 10 * BEACON_INTERVAL_MS, "a few lost beacons must not start a scan");
+
+constexpr uint16_t encodeBeacon(uint8_t channel, uint8_t arena) { return packData(channel, arena); }
+
+// Followers: channel to listen on after ch
+constexpr uint8_t nextScanChannel(uint8_t ch) {
+  return ch >= CHANNEL_LAST || ch < CHANNEL_FIRST ? CHANNEL_FIRST : ch + 1;
+}
+
+// =============================================================================
+// STICK POWER (protocol 4.7)
+// A stick that is idle and not seated sleeps between host beacons (forced
+// light sleep, woken by the timer or the button; a seated stick stays
+// awake so CMD_GAME_START / CMD_GO see no extra latency). Every
+// POWER_REPORT_MS it sends the host one unsequenced batch of
+// CMD_STICK_POWER items, one per PowerField in enum order, the last one
+// completing the report. Timings cover the period since the last report.
+// =============================================================================
+#define POWER_REPORT_MS   30000
+#define POWER_ITEM_LEN    5
+
+enum PowerField : uint8_t {
+  POWER_VCC_MV = 0,         // supply at the chip (ESP.getVcc(), sags once the battery can't hold the regulator)
+  POWER_AWAKE_PERMILLE,     // share of the period spent awake
+  POWER_SLEEPS,             // light sleeps this period
+  POWER_WAKE_RADIO_US,      // worst wake -> radio back on channel
+  POWER_WAKE_BEACON_MS,     // worst wake -> first beacon heard (sleep alignment error)
+  POWER_FIELD_COUNT
+};
+
+static_assert(BATCH_HEADER_SIZE + POWER_FIELD_COUNT * (2 + POWER_ITEM_LEN) + 1 <= BATCH_MAX_BYTES,
+              "power report must fit one batch");
+
+inline bool addStickPower(BatchWriter &w, uint8_t field, uint32_t value) {
+  const uint8_t v[POWER_ITEM_LEN] = {field, (uint8_t)(value >> 24), (uint8_t)(value >> 16),
+                                     (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+  return w.add(CMD_STICK_POWER, v, POWER_ITEM_LEN);
+}
+
+// False for anything that isn't a well-formed power item
+inline bool decodeStickPower(const BatchItem &item, uint8_t* field, uint32_t* value) {
+  if (item.cmd != CMD_STICK_POWER || item.len != POWER_ITEM_LEN) return false;
+  *field = item.value[0];
+  *value = ((uint32_t)item.value[1] << 24) | ((uint32_t)item.value[2] << 16) |
+           ((uint32_t)item.value[3] << 8) | item.value[4];
+  return *field < POWER_FIELD_COUNT;
+}
+
+// =============================================================================
+// RESULT ACK (protocol 4.8)
+// The host answers every CMD_REACTION_DONE / CMD_SHAKE_DONE it gets from a
+// seated stick, plain or batched, counted or not, with an unsequenced
+// CMD_ACK (encodeAck(cmd)) to that stick. The stick sends its result once
+// and repeats it only while that ACK is missing, instead of three blind
+// copies; the game core already ignores a second result for the same round.
+// Older sticks drop the ACK (unknown command) and keep their triple send.
+// =============================================================================
+
+// =============================================================================
+// SHAKE STREAM (protocol 4.9)
+// While counting, a stick sends CMD_SHAKE_PROGRESS (plain GamePacket,
+// absolute count, so a lost update costs nothing) whenever its count moved
+// and the interval for the distance left has passed: SHAKE_STREAM_SLOW_MS
+// at the start down to SHAKE_STREAM_FAST_MS next to the target. Each MAC
+// failure doubles the interval (up to SHAKE_STREAM_MAX_BACKOFF), each
+// success halves it again. The count that reaches the target goes out as
+// CMD_SHAKE_DONE instead. Older hosts read the same packet.
+//
+// The host relays progress to displays >= SHAKE_STREAM_MINOR every
+// SHAKE_RELAY_MS as one unsequenced, unACKed batch (seq = epoch = 0) of
+// DISP_SHAKE_PROGRESS items, one per player that moved; a lost batch is
+// overtaken by the next one. Such a batch never carries other items.
+// =============================================================================
+#define SHAKE_STREAM_MAJOR        4
+#define SHAKE_STREAM_MINOR        9
+#define SHAKE_STREAM_FAST_MS      30
+#define SHAKE_STREAM_SLOW_MS      150
+#define SHAKE_STREAM_MAX_BACKOFF  3     // interval << 3 at most
+#define SHAKE_RELAY_MS            80
+#define SHAKE_PROGRESS_ITEM_LEN   3
+
+static_assert(SHAKE_STREAM_FAST_MS < SHAKE_STREAM_SLOW_MS, "stream must speed up near the target");
+
+// Interval before the next update with `left` of `target` counts to go
+constexpr uint32_t shakeStreamIntervalMs(uint8_t left, uint8_t target) {
+  return target == 0 || left >= target ? SHAKE_STREAM_SLOW_MS
+       : SHAKE_STREAM_FAST_MS + (uint32_t)(SHAKE_STREAM_SLOW_MS - SHAKE_STREAM_FAST_MS) * left / target;
+}
+
+static_assert(shakeStreamIntervalMs(1, 40) < shakeStreamIntervalMs(39, 40), "interval must shrink near the target");
+
+constexpr bool supportsShakeStream(FwVersion v) {
+  return versionAtLeast(v, SHAKE_STREAM_MAJOR, SHAKE_STREAM_MINOR);
+}
+
+inline bool addShakeProgress(BatchWriter &w, uint8_t player, uint8_t count, uint8_t target) {
+  const uint8_t v[SHAKE_PROGRESS_ITEM_LEN] = {player, count, target};
+  return w.add(DISP_SHAKE_PROGRESS, v, SHAKE_PROGRESS_ITEM_LEN);
+}
+
+// False for anything that isn't a well-formed progress item
+inline bool decodeShakeProgressItem(const BatchItem &item, uint8_t* player, uint8_t* count, uint8_t* target) {
+  if (item.cmd != DISP_SHAKE_PROGRESS || item.len != SHAKE_PROGRESS_ITEM_LEN) return false;
+  *player = item.value[0];
+  *count = item.value[1];
+  *target = item.value[2];
+  return *player >= 1 && *player <= 4;
+}
+
+// =============================================================================
+// ROUND LOOKAHEAD (protocol 4.10)
+// The host plans a game's rounds when the join completes. While a round's
+// results are up it sends DISP_NEXT_ROUND with the next round's mode, so a
+// display >= ROUND_LOOKAHEAD_MINOR can decode that banner before
+// DISP_REACTION_MODE / DISP_SHAKE_MODE asks for it. The hint changes
+// nothing on screen; older displays aren't sent it.
+// =============================================================================
+#define ROUND_LOOKAHEAD_MAJOR  4
+#define ROUND_LOOKAHEAD_MINOR  10
+
+constexpr bool supportsRoundLookahead(FwVersion v) {
+  return versionAtLeast(v, ROUND_LOOKAHEAD_MAJOR, ROUND_LOOKAHEAD_MINOR);
+}
+
+// =============================================================================
+// LEADERBOARD (protocol 4.11)
+// The host keeps the all-time fastest reactions in flash (StatsStore.h)
+// and sends them to a display >= LEADERBOARD_MINOR as one batch of
+// LEADERBOARD_SIZE DISP_LEADERBOARD items, rank 0 first: when the display
+// says hello and whenever the table changes. An empty rank has stick 0.
+// =============================================================================
+#define LEADERBOARD_MAJOR     4
+#define LEADERBOARD_MINOR     11
+#define LEADERBOARD_SIZE      5
+#define LEADERBOARD_ITEM_LEN  6
+
+static_assert(BATCH_HEADER_SIZE + LEADERBOARD_SIZE * (2 + LEADERBOARD_ITEM_LEN) + 1 <= BATCH_MAX_BYTES,
+              "the leaderboard must fit one batch");
+
+constexpr bool supportsLeaderboard(FwVersion v) {
+  return versionAtLeast(v, LEADERBOARD_MAJOR, LEADERBOARD_MINOR);
+}
+
+inline bool addLeaderboardEntry(BatchWriter &w, uint8_t rank, uint8_t stick, uint32_t ticks) {
+  const uint8_t v[LEADERBOARD_ITEM_LEN] = {rank, stick, (uint8_t)(ticks >> 24), (uint8_t)(ticks >> 16),
+                                           (uint8_t)(ticks >> 8), (uint8_t)(ticks & 0xFF)};
+  return w.add(DISP_LEADERBOARD, v, LEADERBOARD_ITEM_LEN);
+}
+
+// False for anything that isn't a well-formed leaderboard item
+inline bool decodeLeaderboardEntry(const BatchItem &item, uint8_t* rank, uint8_t* stick, uint32_t* ticks) {
+  if (item.cmd != DISP_LEADERBOARD || item.len != LEADERBOARD_ITEM_LEN) return false;
+  *rank = item.value[0];
+  *stick = item.value[1];
+  *ticks = ((uint32_t)item.value[2] << 24) | ((uint32_t)item.value[3] << 16) |
+           ((uint32_t)item.value[4] << 8) | item.value[5];
+  return *rank < LEADERBOARD_SIZE;
+}
+
+// =============================================================================
+// TOURNAMENT (protocol 4.12)
+// In a tournament (Tournament.h on the host) the sticks stay seated from one
+// match to the next and the people change. When a match is over the host
+// sends a display >= TOURNAMENT_MINOR one batch of DISP_TOUR_SEAT items, one
+// per seat, naming the entrants of the next match. A seated stick >= 4.12
+// sends CMD_REQ_ID on a press in JS_IDLE as "I'm here"; the host answers
+// with CMD_OK for the same slot once, between matches. Older sticks just
+// wait for the changeover to time out.
+// =============================================================================
+#define TOURNAMENT_MAJOR  4
+#define TOURNAMENT_MINOR  12
+
+constexpr bool supportsTournament(FwVersion v) {
+  return versionAtLeast(v, TOURNAMENT_MAJOR, TOURNAMENT_MINOR);
+}
+
+// =============================================================================
+// FIRMWARE UPDATE (protocol 4.13)
+// The host serves update packages (ota_pack.py on the host) from SPIFFS to
+// sticks and display >= OTA_MINOR, in STATE_IDLE only. A package is the new
+// image in OTA_BLOCK_SIZE blocks, each encoded on its own (OtaImage.h):
+// copies from the image the device runs now (the delta), copies from
+// earlier in the block (compression) and literals. A package built against
+// base version B is offered only to devices running B; base 0 is a full
+// image, offered to any older device.
+//
+// The device pulls, one block at a time:
+//   Host → device  CMD_OTA_OFFER  every OTA_OFFER_MS while idle
+//   device → Host  CMD_OTA_REQ    block wanted, bitmap of its chunks held
+//   Host → device  CMD_OTA_DATA   every chunk not in the bitmap
+//   device → Host  CMD_OTA_REQ    next block ... OTA_BLOCK_DONE when the
+//                                 image checked out and it is rebooting
+// Every frame ends in a CRC-32 over the bytes before it. A device missing
+// chunks asks again after OTA_REQ_RETRY_MS with what it has, so a lost
+// chunk costs one chunk and a pause (a game started, the host rebooted)
+// picks up at the block where it stopped. Blocks are checked against
+// their CRC-32 after decoding and the whole image against imageCrc before
+// it is committed; OTA_BLOCK_FAIL ends the session (wrong base image,
+// flash error) and the host stops offering that package to the device.
+// =============================================================================
+#define OTA_MAJOR         4
+#define OTA_MINOR         13
+#define OTA_BLOCK_SIZE    4096    // decoded bytes per block (the last one may be short)
+#define OTA_CHUNK_BYTES   200     // record bytes per CMD_OTA_DATA
+#define OTA_MAX_CHUNKS    32      // per block: an encoded block is at most OTA_RECORD_MAX
+#define OTA_RECORD_MAX    (OTA_MAX_CHUNKS * OTA_CHUNK_BYTES)
+#define OTA_OFFER_MS      2000
+#define OTA_REQ_RETRY_MS  300
+#define OTA_BLOCK_DONE    0xFFFF
+#define OTA_BLOCK_FAIL    0xFFFE
+
+enum OtaTarget : uint8_t {
+  OTA_TARGET_STICK = 1,
+  OTA_TARGET_DISPLAY = 2
+};
+
+constexpr bool supportsOta(FwVersion v) {
+  return versionAtLeast(v, OTA_MAJOR, OTA_MINOR);
+}
+
+// CRC-32 (IEEE 802.3, reflected 0xEDB88320, as zlib.crc32): nibble table
+constexpr uint32_t crc32Bits(uint32_t crc, uint8_t bits) {
+  return bits == 0 ? crc : crc32Bits((crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : crc >> 1, bits - 1);
+}
+
+#define CRC32_N4(n)  crc32Bits((n), 4), crc32Bits((n) + 1, 4), crc32Bits((n) + 2, 4), crc32Bits((n) + 3, 4)
+static constexpr uint32_t CRC32_TABLE[16] CRC8_TABLE_ATTR = {
+  CRC32_N4(0), CRC32_N4(4), CRC32_N4(8), CRC32_N4(12)
+};
+
+constexpr uint32_t crc32Nibble(uint32_t crc) { return (crc >> 4) ^ CRC32_TABLE[crc & 0x0F]; }
+
+constexpr uint32_t crc32Lookup(const char* data, uint32_t len, uint32_t crc = 0xFFFFFFFFUL) {
+  return len == 0 ? ~crc : crc32Lookup(data + 1, len - 1, crc32Nibble(crc32Nibble(crc ^ (uint8_t)*data)));
+}
+
+static_assert(crc32Lookup("123456789", 9) == 0xCBF43926UL, "CRC32 table does not match 0xEDB88320");
+
+// crc = the result of the previous call to continue a running CRC
+inline uint32_t calcCRC32(const uint8_t* data, uint32_t len, uint32_t crc = 0) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *data++;
+    crc = crc32Nibble(crc32Nibble(crc));
+  }
+  return ~crc;
+}
+
+typedef struct __attribute__((packed)) {
+  uint8_t start;
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t cmd;        // CMD_OTA_OFFER
+  uint8_t target;     // OtaTarget
+  uint16_t version;   // encodeVersion() of the new image
+  uint16_t base;      // image the delta is against, 0 = full image
+  uint32_t imageSize;
+  uint32_t imageCrc;  // CRC-32 of the whole new image; names the session
+  uint16_t blocks;
+  uint32_t crc;
+} OtaOfferPacket;
+
+typedef struct __attribute__((packed)) {
+  uint8_t start;
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t cmd;        // CMD_OTA_REQ
+  uint32_t imageCrc;
+  uint16_t block;     // wanted, or OTA_BLOCK_DONE / OTA_BLOCK_FAIL
+  uint32_t have;      // chunks of it already held (bit n = chunk n)
+  uint32_t crc;
+} OtaReqPacket;
+
+typedef struct __attribute__((packed)) {
+  uint8_t start;
+  uint8_t dest_id;
+  uint8_t src_id;
+  uint8_t cmd;        // CMD_OTA_DATA
+  uint32_t imageCrc;
+  uint16_t block;
+  uint16_t recordLen; // whole encoded block; chunk n holds bytes n*OTA_CHUNK_BYTES..
+  uint8_t chunk;
+} OtaDataHeader;      // then up to OTA_CHUNK_BYTES, then CRC-32
+
+#define OTA_DATA_MAX_BYTES  (sizeof(OtaDataHeader) + OTA_CHUNK_BYTES + 4)
+static_assert(OTA_DATA_MAX_BYTES <= BATCH_MAX_BYTES, "Protocol.h: OTA chunk does not fit a frame");
+static_assert(sizeof(OtaOfferPacket) != SYNC_PACKET_SIZE && sizeof(OtaReqPacket) != SYNC_PACKET_SIZE,
+              "Protocol.h: OTA frames would be taken for SyncPackets");
+
+constexpr uint8_t otaChunks(uint16_t recordLen) {
+  return (uint8_t)((recordLen + OTA_CHUNK_BYTES - 1) / OTA_CHUNK_BYTES);
+}
+
+// Bytes in chunk n of a record
+constexpr uint16_t otaChunkLen(uint16_t recordLen, uint8_t chunk) {
+  return recordLen - (uint16_t)chunk * OTA_CHUNK_BYTES < OTA_CHUNK_BYTES
+       ? (uint16_t)(recordLen - (uint16_t)chunk * OTA_CHUNK_BYTES) : (uint16_t)OTA_CHUNK_BYTES;
+}
+
+inline bool isOtaFrame(const uint8_t* data, int len) {
+  return len >= 8 && data[0] == PACKET_START &&
+         (data[3] == CMD_OTA_OFFER || data[3] == CMD_OTA_REQ || data[3] == CMD_OTA_DATA);
+}
+
+// Fill in the CRC-32 of a frame of len bytes (its last 4)
+inline void sealOtaFrame(uint8_t* frame, uint32_t len) {
+  frame[0] = PACKET_START;
+  const uint32_t crc = calcCRC32(frame, len - 4);
+  memcpy(frame + len - 4, &crc, 4);
+}
+
+// Checks the CRC and the length the command calls for
+inline bool validateOtaFrame(const uint8_t* data, int len) {
+  if (!isOtaFrame(data, len)) return false;
+  switch (data[3]) {
+    case CMD_OTA_OFFER: if (len != (int)sizeof(OtaOfferPacket)) return false; break;
+    case CMD_OTA_REQ:   if (len != (int)sizeof(OtaReqPacket)) return false; break;
+    default: {
+      if (len < (int)sizeof(OtaDataHeader) + 1 + 4 || len > (int)OTA_DATA_MAX_BYTES) return false;
+      const OtaDataHeader* h = (const OtaDataHeader*)data;
+      if (h->recordLen == 0 || h->recordLen > OTA_RECORD_MAX || h->chunk >= otaChunks(h->recordLen)) return false;
+      if (len - (int)sizeof(OtaDataHeader) - 4 != otaChunkLen(h->recordLen, h->chunk)) return false;
+      break;
+    }
+  }
+  uint32_t crc;
+  memcpy(&crc, data + len - 4, 4);
+  return calcCRC32(data, len - 4) == crc;
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,56 @@
+/*
+ * SpscQueue.h - Fixed-capacity lock-free single-producer/single-consumer ring
+ * Shared by the host and the display
+ *
+ * One context pushes (e.g. the ESP-NOW receive callback on the WiFi task),
+ * one context pops (the host's loop(), the display's LVGL task). No locks,
+ * no allocation: indices are free-running 32-bit counters published with
+ * release/acquire ordering so the consumer never sees a slot before its
+ * contents are written.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, uint32_t N>
+class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of 2");
+
+public:
+  // Producer side. Returns false (item dropped) when full.
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= N) return false;
+    buf[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when empty.
+  bool pop(T& out) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    if (t == h) return false;
+    out = buf[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+  static constexpr uint32_t capacity() { return N; }
+
+private:
+  T buf[N];
+  std::atomic<uint32_t> head{0};  // written by producer only
+  std::atomic<uint32_t> tail{0};  // written by consumer only
+};
+
+#endif // SPSCQUEUE_H